@@ -2175,3 +2175,77 @@ DynamicLibrary* DynamicLibrary::Load(const char* /* modulePath */)
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Implements the platform specific part of file mapping.
+ *
+ * @param path The path to the file to map.
+ * @return A mapped file instance or NULL as mapping is not supported on this platform.
+ */
+MappedFile* MappedFile::Map(const char* /* path */)
+{
+  // Not implemented.
+  return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Implements the platform specific part of running work on several threads.
+ * Not implemented, so work is performed on the calling thread.
+ */
+int Workers::Count()
+{
+  return 1;
+}
+
+void Workers::Run(WorkFunction fn, void** work, int count)
+{
+  for (int i = 0; i < count; i++)
+    fn(work[i]);
+}
+
+bool Workers::Start(WorkFunction /* fn */, void* /* work */)
+{
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Implements the platform specific part of mutual exclusion between threads.
+ * As Workers::Start does not start threads, nothing can be waited for.
+ */
+class MutexImpl : public Mutex
+{
+public:
+  virtual void Lock() {}
+  virtual void Unlock() {}
+};
+
+Mutex* Mutex::Create()
+{
+  return new MutexImpl();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Implements the platform specific part of reference counts shared between threads.
+ */
+void AtomicCount::Increment(int* count)
+{
+  __sync_add_and_fetch(count, 1);
+}
+
+bool AtomicCount::Decrement(int* count)
+{
+  return __sync_sub_and_fetch(count, 1) == 0;
+}
+
+int AtomicCount::Get(int* count)
+{
+  return __sync_fetch_and_add(count, 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+
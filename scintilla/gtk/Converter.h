@@ -68,3 +68,75 @@ public:
 		}
 	}
 };
+
+/**
+ * Convert text that arrives in pieces, such as while loading or saving, into
+ * bounded buffers. A character split between two pieces is held back until the
+ * next piece completes it so pieces may be cut anywhere.
+ */
+class ChunkConverter {
+	enum { maxPartial = 16 };
+	Converter conv;
+	char partial[maxPartial];
+	size_t lengthPartial;
+public:
+	enum Status { convertOK, convertOutputFull, convertInvalid };
+	ChunkConverter(const char *charSetDestination, const char *charSetSource, bool transliterations) :
+		conv(charSetDestination, charSetSource, transliterations), lengthPartial(0) {
+	}
+	operator bool() const {
+		return conv;
+	}
+	/// Convert as much of src as fits in dst, advancing both.
+	/// Returns convertOutputFull when dst is full before all of src is used.
+	Status Convert(const char **src, size_t *srcleft, char **dst, size_t *dstleft) {
+		while (lengthPartial > 0) {
+			// Complete the held back character a byte at a time
+			if (*srcleft == 0)
+				return convertOK;
+			partial[lengthPartial++] = **src;
+			(*src)++;
+			(*srcleft)--;
+			char *pin = partial;
+			size_t inLeft = lengthPartial;
+			if (conv.Convert(&pin, &inLeft, dst, dstleft) != ((size_t)(-1))) {
+				lengthPartial = 0;
+			} else if (errno == E2BIG) {
+				lengthPartial--;
+				(*src)--;
+				(*srcleft)++;
+				return convertOutputFull;
+			} else if ((errno != EINVAL) || (lengthPartial == maxPartial)) {
+				return convertInvalid;
+			}
+		}
+		char *pin = const_cast<char *>(*src);
+		const size_t conversions = conv.Convert(&pin, srcleft, dst, dstleft);
+		*src = pin;
+		if (conversions != ((size_t)(-1)))
+			return convertOK;
+		if (errno == E2BIG)
+			return convertOutputFull;
+		if ((errno == EINVAL) && (*srcleft < maxPartial)) {
+			// Incomplete character at the end of this piece
+			memcpy(partial, *src, *srcleft);
+			lengthPartial = *srcleft;
+			*src += *srcleft;
+			*srcleft = 0;
+			return convertOK;
+		}
+		return convertInvalid;
+	}
+	/// True when no incomplete character is held back at the end of the text.
+	bool Complete() const {
+		return lengthPartial == 0;
+	}
+	/// After the last piece, write what returns a stateful character set such as
+	/// ISO-2022-JP to its initial state. Returns convertOutputFull when dst has no
+	/// room for it, so it can be called again once dst is written out.
+	Status Finish(char **dst, size_t *dstleft) {
+		if (conv.Convert(0, 0, dst, dstleft) != ((size_t)(-1)))
+			return convertOK;
+		return (errno == E2BIG) ? convertOutputFull : convertInvalid;
+	}
+};
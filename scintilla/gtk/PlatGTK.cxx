@@ -4,6 +4,7 @@
 // The License.txt file describes the conditions under which this software may be distributed.
 
 #include <string.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -1974,6 +1975,189 @@ DynamicLibrary *DynamicLibrary::Load(const char *modulePath) {
 	return static_cast<DynamicLibrary *>( new DynamicLibraryImpl(modulePath) );
 }
 
+class MappedFileImpl : public MappedFile {
+protected:
+	GMappedFile *mf;
+public:
+	MappedFileImpl(const char *path) {
+		mf = g_mapped_file_new(path, FALSE, NULL);
+	}
+
+	virtual ~MappedFileImpl() {
+		if (mf != NULL) {
+#if GLIB_CHECK_VERSION(2,22,0)
+			g_mapped_file_unref(mf);
+#else
+			g_mapped_file_free(mf);
+#endif
+		}
+	}
+
+	virtual const char *Data() {
+		return mf ? g_mapped_file_get_contents(mf) : NULL;
+	}
+
+	virtual size_t Length() {
+		return mf ? g_mapped_file_get_length(mf) : 0;
+	}
+
+	virtual bool IsValid() {
+		return mf != NULL;
+	}
+};
+
+MappedFile *MappedFile::Map(const char *path) {
+	return static_cast<MappedFile *>( new MappedFileImpl(path) );
+}
+
+#if USE_LOCK
+struct WorkItem {
+	Workers::WorkFunction fn;
+	void *work;
+};
+
+static gpointer WorkerThread(gpointer data) {
+	WorkItem *item = static_cast<WorkItem *>(data);
+	item->fn(item->work);
+	return NULL;
+}
+#endif
+
+int Workers::Count() {
+#if USE_LOCK && GLIB_CHECK_VERSION(2,36,0)
+	return g_get_num_processors();
+#else
+	return 1;
+#endif
+}
+
+void Workers::Run(WorkFunction fn, void **work, int count) {
+#if USE_LOCK
+	InitializeGLIBThreads();
+	WorkItem *items = new WorkItem[count];
+	GThread **threads = new GThread *[count];
+	// The first piece of work is done on this thread while the others run
+	for (int i = 1; i < count; i++) {
+		items[i].fn = fn;
+		items[i].work = work[i];
+#if GLIB_CHECK_VERSION(2,32,0)
+		threads[i] = g_thread_try_new("scintilla-worker", WorkerThread, &items[i], NULL);
+#else
+		threads[i] = g_thread_create(WorkerThread, &items[i], TRUE, NULL);
+#endif
+		if (!threads[i])
+			fn(work[i]);
+	}
+	if (count > 0)
+		fn(work[0]);
+	for (int i = 1; i < count; i++) {
+		if (threads[i])
+			g_thread_join(threads[i]);
+	}
+	delete []threads;
+	delete []items;
+#else
+	for (int i = 0; i < count; i++)
+		fn(work[i]);
+#endif
+}
+
+#if USE_LOCK
+static gpointer DetachedThread(gpointer data) {
+	WorkItem *item = static_cast<WorkItem *>(data);
+	item->fn(item->work);
+	delete item;
+	return NULL;
+}
+#endif
+
+bool Workers::Start(WorkFunction fn, void *work) {
+#if USE_LOCK
+	InitializeGLIBThreads();
+	WorkItem *item = new WorkItem;
+	item->fn = fn;
+	item->work = work;
+#if GLIB_CHECK_VERSION(2,32,0)
+	GThread *thread = g_thread_try_new("scintilla-worker", DetachedThread, item, NULL);
+	if (thread)
+		g_thread_unref(thread);
+#else
+	GThread *thread = g_thread_create(DetachedThread, item, FALSE, NULL);
+#endif
+	if (!thread) {
+		delete item;
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+class MutexImpl : public Mutex {
+#if USE_LOCK
+#if GLIB_CHECK_VERSION(2,32,0)
+	GMutex mutex;
+#else
+	GMutex *mutex;
+#endif
+#endif
+public:
+	MutexImpl() {
+#if USE_LOCK
+		InitializeGLIBThreads();
+#if GLIB_CHECK_VERSION(2,32,0)
+		g_mutex_init(&mutex);
+#else
+		mutex = g_mutex_new();
+#endif
+#endif
+	}
+	virtual ~MutexImpl() {
+#if USE_LOCK
+#if GLIB_CHECK_VERSION(2,32,0)
+		g_mutex_clear(&mutex);
+#else
+		g_mutex_free(mutex);
+#endif
+#endif
+	}
+	virtual void Lock() {
+#if USE_LOCK
+#if GLIB_CHECK_VERSION(2,32,0)
+		g_mutex_lock(&mutex);
+#else
+		g_mutex_lock(mutex);
+#endif
+#endif
+	}
+	virtual void Unlock() {
+#if USE_LOCK
+#if GLIB_CHECK_VERSION(2,32,0)
+		g_mutex_unlock(&mutex);
+#else
+		g_mutex_unlock(mutex);
+#endif
+#endif
+	}
+};
+
+Mutex *Mutex::Create() {
+	return new MutexImpl();
+}
+
+void AtomicCount::Increment(int *count) {
+	g_atomic_int_inc(count);
+}
+
+bool AtomicCount::Decrement(int *count) {
+	return g_atomic_int_dec_and_test(count) != FALSE;
+}
+
+int AtomicCount::Get(int *count) {
+	return g_atomic_int_get(count);
+}
+
 double ElapsedTime::Duration(bool reset) {
 	GTimeVal curTime;
 	g_get_current_time(&curTime);
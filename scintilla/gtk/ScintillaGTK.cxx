@@ -6,6 +6,7 @@
 #include <new>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <stdio.h>
 #include <assert.h>
 #include <ctype.h>
@@ -172,6 +173,8 @@ private:
 	virtual bool ValidCodePage(int codePage) const;
 public: 	// Public for scintilla_send_message
 	virtual sptr_t WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam);
+	// Public for scintilla_get_document_charset
+	const char *DocumentCharSet() const;
 private:
 	virtual sptr_t DefWndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam);
 	virtual void SetTicking(bool on);
@@ -867,6 +870,25 @@ fprintf(stderr, "Can not iconv %s %s\n", charSetDest, charSetSource);
 	return destForm;
 }
 
+// Converts len bytes of s a bounded piece at a time, appending the result to output
+// when it is not NULL, so that no buffer the size of the whole text is needed.
+// Return false if s can not be converted.
+static bool ConvertInPieces(ChunkConverter &conv, const char *s, size_t len, char *output, int *lenResult) {
+	char piece[4000];
+	ChunkConverter::Status status = ChunkConverter::convertOutputFull;
+	while (status == ChunkConverter::convertOutputFull) {
+		char *pout = piece;
+		size_t outLeft = sizeof(piece);
+		status = conv.Convert(&s, &len, &pout, &outLeft);
+		if (status == ChunkConverter::convertInvalid)
+			return false;
+		if (output)
+			memcpy(output + *lenResult, piece, pout - piece);
+		*lenResult += pout - piece;
+	}
+	return true;
+}
+
 // Returns the target converted to UTF8.
 // Return the length in bytes.
 int ScintillaGTK::TargetAsUTF8(char *text) {
@@ -879,19 +901,28 @@ int ScintillaGTK::TargetAsUTF8(char *text) {
 		// Need to convert
 		const char *charSetBuffer = CharacterSetID();
 		if (*charSetBuffer) {
-//~ fprintf(stderr, "AsUTF8 %s %d  %0d-%0d\n", charSetBuffer, targetLength, targetStart, targetEnd);
-			char *s = new char[targetLength];
-			if (s) {
-				pdoc->GetCharRange(s, targetStart, targetLength);
-//~ fprintf(stderr, "    \"%s\"\n", s);
-				if (text) {
-					char *tmputf = ConvertText(&targetLength, s, targetLength, "UTF-8", charSetBuffer, false);
-					memcpy(text, tmputf, targetLength);
-					delete []tmputf;
-//~ fprintf(stderr, "    \"%s\"\n", text);
+			// Convert the text where it is stored rather than copying the whole target
+			ChunkConverter conv("UTF-8", charSetBuffer, false);
+			if (!conv) {
+				fprintf(stderr, "Can not iconv %s %s\n", "UTF-8", charSetBuffer);
+				return 0;
+			}
+			int lengthUTF8 = 0;
+			Sci_Position position = targetStart;
+			while (position < targetEnd) {
+				Sci_Position lengthSegment = 0;
+				const char *segment = pdoc->TextSegment(position, lengthSegment);
+				if (!segment)
+					break;
+				if (lengthSegment > targetEnd - position)
+					lengthSegment = targetEnd - position;
+				if (!ConvertInPieces(conv, segment, lengthSegment, text, &lengthUTF8)) {
+					fprintf(stderr, "iconv %s->%s failed\n", charSetBuffer, "UTF-8");
+					return 0;
 				}
-				delete []s;
+				position += lengthSegment;
 			}
+			targetLength = lengthUTF8;
 		} else {
 			if (text) {
 				pdoc->GetCharRange(text, targetStart, targetLength);
@@ -915,13 +946,13 @@ int ScintillaGTK::EncodedFromUTF8(char *utf8, char *encoded) {
 		// Need to convert
 		const char *charSetBuffer = CharacterSetID();
 		if (*charSetBuffer) {
+			ChunkConverter conv(charSetBuffer, "UTF-8", true);
 			int outLength = 0;
-			char *tmpEncoded = ConvertText(&outLength, utf8, inputLength, charSetBuffer, "UTF-8", true);
-			if (tmpEncoded) {
-				if (encoded) {
-					memcpy(encoded, tmpEncoded, outLength);
-				}
-				delete []tmpEncoded;
+			if (!conv) {
+				fprintf(stderr, "Can not iconv %s %s\n", charSetBuffer, "UTF-8");
+			} else if (!ConvertInPieces(conv, utf8, inputLength, encoded, &outLength)) {
+				fprintf(stderr, "iconv %s->%s failed for %s\n", "UTF-8", charSetBuffer, utf8);
+				outLength = 0;
 			}
 			return outLength;
 		} else {
@@ -1257,6 +1288,11 @@ const char *ScintillaGTK::CharacterSetID() const {
 	return ::CharacterSetID(vs.styles[STYLE_DEFAULT].characterSet);
 }
 
+// The character set of the bytes in the document or "" when it is not known
+const char *ScintillaGTK::DocumentCharSet() const {
+	return IsUnicodeMode() ? "UTF-8" : CharacterSetID();
+}
+
 class CaseFolderUTF8 : public CaseFolderTable {
 public:
 	CaseFolderUTF8() {
@@ -2824,6 +2860,103 @@ sptr_t scintilla_send_message(ScintillaObject *sci, unsigned int iMessage, uptr_
 	return psci->WndProc(iMessage, wParam, lParam);
 }
 
+const char *scintilla_get_document_charset(ScintillaObject *sci) {
+	ScintillaGTK *psci = reinterpret_cast<ScintillaGTK *>(sci->pscin);
+	return psci->DocumentCharSet();
+}
+
+void *scintilla_converter_new(const char *charSetDestination, const char *charSetSource) {
+	ChunkConverter *conv = new ChunkConverter(charSetDestination, charSetSource, false);
+	if (!*conv) {
+		delete conv;
+		return 0;
+	}
+	return conv;
+}
+
+int scintilla_converter_convert(void *converter, const char **src, size_t *srcleft, char **dst, size_t *dstleft) {
+	switch (reinterpret_cast<ChunkConverter *>(converter)->Convert(src, srcleft, dst, dstleft)) {
+	case ChunkConverter::convertOK:
+		return 0;
+	case ChunkConverter::convertOutputFull:
+		return 1;
+	default:
+		return -1;
+	}
+}
+
+int scintilla_converter_complete(void *converter) {
+	return reinterpret_cast<ChunkConverter *>(converter)->Complete();
+}
+
+int scintilla_converter_finish(void *converter, char **dst, size_t *dstleft) {
+	switch (reinterpret_cast<ChunkConverter *>(converter)->Finish(dst, dstleft)) {
+	case ChunkConverter::convertOK:
+		return 0;
+	case ChunkConverter::convertOutputFull:
+		return 1;
+	default:
+		return -1;
+	}
+}
+
+void scintilla_converter_free(void *converter) {
+	delete reinterpret_cast<ChunkConverter *>(converter);
+}
+
+// The loader returned by SCI_CREATELOADER is not attached to any window so these
+// may be called from any thread while the loader is only used by that thread.
+
+int scintilla_loader_add_data(void *loader, char *data, int length) {
+	return reinterpret_cast<ILoader *>(loader)->AddData(data, length);
+}
+
+void *scintilla_loader_convert_to_document(void *loader) {
+	return reinterpret_cast<ILoader *>(loader)->ConvertToDocument();
+}
+
+int scintilla_loader_release(void *loader) {
+	return reinterpret_cast<ILoader *>(loader)->Release();
+}
+
+// Snapshots returned by SCI_CREATESNAPSHOT are frozen so these may be called from any thread.
+
+void scintilla_snapshot_add_ref(void *snapshot) {
+	reinterpret_cast<ISnapshot *>(snapshot)->AddRef();
+}
+
+void scintilla_snapshot_release(void *snapshot) {
+	reinterpret_cast<ISnapshot *>(snapshot)->Release();
+}
+
+int scintilla_snapshot_version(void *snapshot) {
+	return reinterpret_cast<ISnapshot *>(snapshot)->Version();
+}
+
+long scintilla_snapshot_length(void *snapshot) {
+	return reinterpret_cast<ISnapshot *>(snapshot)->Length();
+}
+
+char scintilla_snapshot_char_at(void *snapshot, long position) {
+	return reinterpret_cast<ISnapshot *>(snapshot)->CharAt(position);
+}
+
+void scintilla_snapshot_get_char_range(void *snapshot, char *buffer, long position, long length) {
+	reinterpret_cast<ISnapshot *>(snapshot)->GetCharRange(buffer, position, length);
+}
+
+char scintilla_snapshot_style_at(void *snapshot, long position) {
+	return reinterpret_cast<ISnapshot *>(snapshot)->StyleAt(position);
+}
+
+void scintilla_snapshot_get_style_range(void *snapshot, char *buffer, long position, long length) {
+	reinterpret_cast<ISnapshot *>(snapshot)->GetStyleRange(buffer, position, length);
+}
+
+const char *scintilla_snapshot_text_segment(void *snapshot, long position, long *length) {
+	return reinterpret_cast<ISnapshot *>(snapshot)->TextSegment(position, length);
+}
+
 static void scintilla_class_init(ScintillaClass *klass);
 static void scintilla_init(ScintillaObject *sci);
 
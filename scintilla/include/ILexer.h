@@ -18,7 +18,7 @@ namespace Scintilla {
 	#define SCI_METHOD
 #endif
 
-enum { dvOriginal=0 };
+enum { dvOriginal=0, dvRestartPoints=1, dvTextSegments=2 };
 
 class IDocument {
 public:
@@ -45,6 +45,23 @@ public:
 	virtual int SCI_METHOD GetLineIndentation(int line) = 0;
 };
 
+// Lexers usually start at a line start, so a change to a very long line restyles all of
+// it before the change. A restart point is a position within a line where lexing can
+// start again with the style before it as the initial style: the lexer's state there and
+// the styles before it do not depend on any text at or after it.
+class IDocumentWithRestartPoints : public IDocument {
+public:
+	virtual void SCI_METHOD SetRestartPoint(int position) = 0;
+};
+
+// Lexers may read the text where it is stored instead of copying it. A segment is the
+// contiguous text from position, which stays valid while lexing until BufferPointer is
+// called. Returns 0 with *lengthSegment 0 when position is outside the document.
+class IDocumentWithTextSegments : public IDocumentWithRestartPoints {
+public:
+	virtual const char * SCI_METHOD TextSegment(int position, int *lengthSegment) const = 0;
+};
+
 enum { lvOriginal=0 };
 
 class ILexer {
@@ -70,6 +87,23 @@ public:
 	virtual void * SCI_METHOD ConvertToDocument() = 0;
 };
 
+// A frozen copy of the text and styles of a document that may be read and released on
+// any thread while the document is changed.
+class ISnapshot {
+public:
+	virtual void SCI_METHOD AddRef() = 0;
+	virtual void SCI_METHOD Release() = 0;
+	// The document version from SCI_GETDOCUMENTVERSION when the snapshot was taken
+	virtual int SCI_METHOD Version() const = 0;
+	virtual long SCI_METHOD Length() const = 0;
+	virtual char SCI_METHOD CharAt(long position) const = 0;
+	virtual void SCI_METHOD GetCharRange(char *buffer, long position, long lengthRetrieve) const = 0;
+	virtual char SCI_METHOD StyleAt(long position) const = 0;
+	virtual void SCI_METHOD GetStyleRange(char *buffer, long position, long lengthRetrieve) const = 0;
+	// Contiguous text from position which stays valid until the snapshot is released
+	virtual const char * SCI_METHOD TextSegment(long position, long *lengthSegment) const = 0;
+};
+
 #ifdef SCI_NAMESPACE
 }
 #endif
@@ -444,6 +444,72 @@ public:
 	static DynamicLibrary *Load(const char *modulePath);
 };
 
+/**
+ * A file mapped read only into memory so that documents can use it without copying.
+ */
+class MappedFile {
+public:
+	virtual ~MappedFile() {}
+
+	/// @return Pointer to the contents of the file.
+	virtual const char *Data() = 0;
+
+	/// @return Length of the file in bytes.
+	virtual size_t Length() = 0;
+
+	/// @return true if the file was mapped successfully.
+	virtual bool IsValid() = 0;
+
+	/// @return An instance of a MappedFile subclass with "path" mapped.
+	static MappedFile *Map(const char *path);
+};
+
+/**
+ * Spreads independent pieces of work over several threads.
+ */
+class Workers {
+public:
+	typedef void (*WorkFunction)(void *work);
+
+	/// @return The number of threads worth using, 1 if threads are not available.
+	static int Count();
+
+	/// Call fn once for each of the count elements of work, in parallel where possible,
+	/// and return when all the calls have finished.
+	static void Run(WorkFunction fn, void **work, int count);
+
+	/// Call fn with work on a new thread and return without waiting for it to finish.
+	/// @return false, without calling fn, when no thread could be started.
+	static bool Start(WorkFunction fn, void *work);
+};
+
+/**
+ * Mutual exclusion so that threads take turns using data they share.
+ */
+class Mutex {
+public:
+	virtual ~Mutex() {}
+	virtual void Lock() = 0;
+	virtual void Unlock() = 0;
+
+	/// @return An instance of a Mutex subclass which is not locked.
+	static Mutex *Create();
+};
+
+/**
+ * Reference counts that may be changed from several threads at once.
+ */
+class AtomicCount {
+public:
+	static void Increment(int *count);
+
+	/// @return true when the count has fallen to zero.
+	static bool Decrement(int *count);
+
+	/// @return The current value of the count.
+	static int Get(int *count);
+};
+
 /**
  * Platform class used to retrieve system wide parameters such as double click speed
  * and chrome colour. Not a creatable object, more of a module with several functions.
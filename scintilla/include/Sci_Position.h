@@ -0,0 +1,22 @@
+/* Scintilla source code edit control */
+/** @file Sci_Position.h
+ ** Define the Sci_Position type used for positions and lengths in the text store.
+ **/
+/* The License.txt file describes the conditions under which this software may be distributed. */
+
+#ifndef SCI_POSITION_H
+#define SCI_POSITION_H
+
+/* Sci_Position is the signed type used by the text store, the line index and the
+ * run length structures for positions and lengths.
+ * Defining SCI_LARGE_DOCUMENTS makes it pointer sized so that documents larger than
+ * 2 gigabytes can be held on 64 bit platforms. Without SCI_LARGE_DOCUMENTS it stays
+ * int so that the default build is binary compatible with earlier releases. */
+#ifdef SCI_LARGE_DOCUMENTS
+#include <stddef.h>
+typedef ptrdiff_t Sci_Position;
+#else
+typedef int Sci_Position;
+#endif
+
+#endif
@@ -40,6 +40,8 @@ typedef unsigned long uptr_t;
 typedef long sptr_t;
 #endif
 
+#include "Sci_Position.h"
+
 typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam, sptr_t lParam);
 
 /* ++Autogenerated -- start of section automatically generated from Scintilla.iface */
@@ -146,6 +148,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_MARKERPREVIOUS 2048
 #define SCI_MARKERDEFINEPIXMAP 2049
 #define SCI_MARKERADDSET 2466
+#define SCI_MARKERSETMASKS 2652
 #define SCI_MARKERSETALPHA 2476
 #define SC_MARGIN_SYMBOL 0
 #define SC_MARGIN_NUMBER 1
@@ -384,6 +387,10 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_CANPASTE 2173
 #define SCI_CANUNDO 2174
 #define SCI_EMPTYUNDOBUFFER 2175
+#define SCI_SETUNDOMEMORYLIMIT 2644
+#define SCI_GETUNDOMEMORYLIMIT 2645
+#define SCI_GETUNDOMEMORY 2646
+#define SCI_GETUNDOACTIONS 2647
 #define SCI_UNDO 2176
 #define SCI_CUT 2177
 #define SCI_COPY 2178
@@ -404,6 +411,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_GETTARGETEND 2193
 #define SCI_REPLACETARGET 2194
 #define SCI_REPLACETARGETRE 2195
+#define SCI_REPLACERANGES 2648
 #define SCI_SEARCHINTARGET 2197
 #define SCI_SETSEARCHFLAGS 2198
 #define SCI_GETSEARCHFLAGS 2199
@@ -599,10 +607,15 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SELECTIONISRECTANGLE 2372
 #define SCI_SETZOOM 2373
 #define SCI_GETZOOM 2374
+#define SC_DOCUMENTOPTION_DEFAULT 0
+#define SC_DOCUMENTOPTION_TEXT_CHUNKED 0x200
+#define SC_DOCUMENTOPTION_LINES_TREE 0x400
+#define SC_DOCUMENTOPTION_LOG 0x800
 #define SCI_CREATEDOCUMENT 2375
 #define SCI_ADDREFDOCUMENT 2376
 #define SCI_RELEASEDOCUMENT 2377
 #define SCI_GETMODEVENTMASK 2378
+#define SCI_GETDOCUMENTOPTIONS 2379
 #define SCI_SETFOCUS 2380
 #define SCI_GETFOCUS 2381
 #define SC_STATUS_OK 0
@@ -728,6 +741,9 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_GETPOSITIONCACHE 2515
 #define SCI_COPYALLOWLINE 2519
 #define SCI_GETCHARACTERPOINTER 2520
+#define SCI_GETDOCUMENTVERSION 2649
+#define SCI_GETTEXTSEGMENT 2650
+#define SCI_CREATESNAPSHOT 2651
 #define SCI_SETKEYSUNICODE 2521
 #define SCI_GETKEYSUNICODE 2522
 #define SCI_INDICSETALPHA 2523
@@ -746,6 +762,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_MARGINSETSTYLES 2534
 #define SCI_MARGINGETSTYLES 2535
 #define SCI_MARGINTEXTCLEARALL 2536
+#define SCI_MARGINSETTEXTS 2653
 #define SCI_MARGINSETSTYLEOFFSET 2537
 #define SCI_MARGINGETSTYLEOFFSET 2538
 #define SC_MARGINOPTION_NONE 0
@@ -760,6 +777,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_ANNOTATIONGETSTYLES 2545
 #define SCI_ANNOTATIONGETLINES 2546
 #define SCI_ANNOTATIONCLEARALL 2547
+#define SCI_ANNOTATIONSETTEXTS 2654
 #define ANNOTATION_HIDDEN 0
 #define ANNOTATION_STANDARD 1
 #define ANNOTATION_BOXED 2
@@ -838,6 +856,16 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SETTECHNOLOGY 2630
 #define SCI_GETTECHNOLOGY 2631
 #define SCI_CREATELOADER 2632
+#define SCI_CREATEMAPPEDDOCUMENT 2643
+#define SCI_GETMEMORYUSAGE 2655
+#define SCI_HIBERNATE 2656
+#define SCI_REHYDRATE 2657
+#define SCI_ISHIBERNATING 2658
+#define SCI_SETLOGLINELIMIT 2659
+#define SCI_GETLOGLINELIMIT 2660
+#define SCI_GETLOGLINESTRIMMED 2661
+#define SCI_SETIDLESTYLING 2662
+#define SCI_GETIDLESTYLING 2663
 #define SCI_FINDINDICATORSHOW 2640
 #define SCI_FINDINDICATORFLASH 2641
 #define SCI_FINDINDICATORHIDE 2642
@@ -864,6 +892,8 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_PROPERTYTYPE 4015
 #define SCI_DESCRIBEPROPERTY 4016
 #define SCI_DESCRIBEKEYWORDSETS 4017
+#define SCI_SETBACKGROUNDLEXING 4018
+#define SCI_GETBACKGROUNDLEXING 4019
 #define SC_MOD_INSERTTEXT 0x1
 #define SC_MOD_DELETETEXT 0x2
 #define SC_MOD_CHANGESTYLE 0x4
@@ -884,7 +914,9 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SC_MOD_CHANGEANNOTATION 0x20000
 #define SC_MOD_CONTAINER 0x40000
 #define SC_MOD_LEXERSTATE 0x80000
-#define SC_MODEVENTMASKALL 0xFFFFF
+#define SC_MOD_LINESINDEXED 0x100000
+#define SC_MOD_REPLACERANGES 0x200000
+#define SC_MODEVENTMASKALL 0x3FFFFF
 #define SC_UPDATE_CONTENT 0x1
 #define SC_UPDATE_SELECTION 0x2
 #define SC_UPDATE_V_SCROLL 0x4
@@ -971,6 +1003,48 @@ struct Sci_TextToFind {
 	struct Sci_CharacterRange chrgText;
 };
 
+/* A range of the document and the text to replace it with for SCI_REPLACERANGES.
+ * When length is -1, text is zero terminated. */
+struct Sci_Replacement {
+	struct Sci_CharacterRange chrg;
+	const char *text;
+	long length;
+};
+
+/* The markers a line should have, as a mask of marker numbers, for SCI_MARKERSETMASKS. */
+struct Sci_MarkerMask {
+	int line;
+	int mask;
+};
+
+/* The text for a line set by SCI_MARGINSETTEXTS or SCI_ANNOTATIONSETTEXTS.
+ * A NULL text clears the line. */
+struct Sci_LineText {
+	int line;
+	const char *text;
+};
+
+/* Bytes used by a document, and the caches of the view asked, for SCI_GETMEMORYUSAGE.
+ * Memory viewed rather than allocated, such as a mapped file, is not counted. */
+struct Sci_MemoryUsage {
+	uptr_t text;
+	uptr_t textUnused;	/* Part of text not holding characters, such as the gap */
+	uptr_t styles;
+	uptr_t lineIndex;
+	uptr_t perLine;	/* Markers, fold levels, line states, margin text and annotations */
+	uptr_t undo;
+	uptr_t decorations;
+	uptr_t layoutCache;
+	uptr_t positionCache;
+};
+
+/* Contiguous text found by SCI_GETTEXTSEGMENT. Text is not terminated and
+ * may only be read until SCI_GETDOCUMENTVERSION changes. */
+struct Sci_TextSegment {
+	const char *text;
+	long length;
+};
+
 #define CharacterRange Sci_CharacterRange
 #define TextRange Sci_TextRange
 #define TextToFind Sci_TextToFind
@@ -39,6 +39,30 @@ GtkWidget*	scintilla_new		(void);
 void		scintilla_set_id	(ScintillaObject *sci, uptr_t id);
 sptr_t		scintilla_send_message	(ScintillaObject *sci,unsigned int iMessage, uptr_t wParam, sptr_t lParam);
 void		scintilla_release_resources(void);
+const char*	scintilla_get_document_charset(ScintillaObject *sci);
+/* Convert text that arrives in pieces with iconv, holding back characters split between
+ * pieces. scintilla_converter_convert returns 0 when all of src is used, 1 when dst is
+ * full and -1 for text that can not be converted. scintilla_converter_finish writes the
+ * end of a stateful character set after the last piece and returns in the same way. */
+void*		scintilla_converter_new(const char *charSetDestination, const char *charSetSource);
+int		scintilla_converter_convert(void *converter, const char **src, size_t *srcleft, char **dst, size_t *dstleft);
+int		scintilla_converter_complete(void *converter);
+int		scintilla_converter_finish(void *converter, char **dst, size_t *dstleft);
+void		scintilla_converter_free(void *converter);
+/* Call the ILoader returned by SCI_CREATELOADER from C */
+int		scintilla_loader_add_data(void *loader, char *data, int length);
+void*		scintilla_loader_convert_to_document(void *loader);
+int		scintilla_loader_release(void *loader);
+/* Call the ISnapshot returned by SCI_CREATESNAPSHOT from C, on any thread */
+void		scintilla_snapshot_add_ref(void *snapshot);
+void		scintilla_snapshot_release(void *snapshot);
+int		scintilla_snapshot_version(void *snapshot);
+long		scintilla_snapshot_length(void *snapshot);
+char		scintilla_snapshot_char_at(void *snapshot, long position);
+void		scintilla_snapshot_get_char_range(void *snapshot, char *buffer, long position, long length);
+char		scintilla_snapshot_style_at(void *snapshot, long position);
+void		scintilla_snapshot_get_style_range(void *snapshot, char *buffer, long position, long length);
+const char*	scintilla_snapshot_text_segment(void *snapshot, long position, long *length);
 
 #define SCINTILLA_NOTIFY "sci-notify"
 
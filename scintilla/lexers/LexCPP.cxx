@@ -462,8 +462,14 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 	int styleBeforeDCKeyword = SCE_C_DEFAULT;
 	bool continuationLine = false;
 	bool isIncludePreprocessor = false;
+	// Restart points are only declared in lines without preprocessor directives or
+	// continuations, whose state at the start of the line applies all through them
+	bool restartable = true;
 
 	int lineCurrent = styler.GetLine(startPos);
+	// Lexing only starts within a line at a restart point, which follows visible characters
+	if (static_cast<int>(startPos) > styler.LineStart(lineCurrent))
+		visibleChars = 1;
 	if ((MaskActive(initStyle) == SCE_C_PREPROCESSOR) ||
       (MaskActive(initStyle) == SCE_C_COMMENTLINE) ||
       (MaskActive(initStyle) == SCE_C_COMMENTLINEDOC)) {
@@ -513,6 +519,8 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 	}
 
 	std::string rawStringTerminator = rawStringTerminators.ValueAt(lineCurrent-1);
+	if (visibleChars)
+		rawStringTerminator = "";
 	SparseState<std::string> rawSTNew(lineCurrent);
 
 	int activitySet = preproc.IsInactive() ? activeFlag : 0;
@@ -532,12 +540,21 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 			visibleChars = 0;
 			lastWordWasUUID = false;
 			isIncludePreprocessor = false;
+			restartable = !continuationLine;
 			if (preproc.IsInactive()) {
 				activitySet = activeFlag;
 				sc.SetState(sc.state | activitySet);
 			}
 		}
 
+		// Between tokens, unless the last character would have started a comment, a number
+		// or a hash quoted string had the next one been different
+		if (restartable && visibleChars && !sc.atLineStart && !lastWordWasUUID &&
+			((MaskActive(sc.state) == SCE_C_DEFAULT) || (MaskActive(sc.state) == SCE_C_OPERATOR)) &&
+			(sc.chPrev != '/') && (sc.chPrev != '.') && (sc.chPrev != '#')) {
+			styler.SetRestartPoint(sc.currentPos);
+		}
+
 		if (sc.atLineEnd) {
 			lineCurrent++;
 			vlls.Add(lineCurrent, preproc);
@@ -838,6 +855,7 @@ void SCI_METHOD LexerCPP::Lex(unsigned int startPos, int length, int initStyle,
 			} else if (sc.ch == '#' && visibleChars == 0) {
 				// Preprocessor commands are alone on their line
 				sc.SetState(SCE_C_PREPROCESSOR|activitySet);
+				restartable = false;
 				// Skip whitespace between # and preprocessor word
 				do {
 					sc.Forward();
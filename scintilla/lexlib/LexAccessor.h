@@ -15,6 +15,10 @@ namespace Scintilla {
 class LexAccessor {
 private:
 	IDocument *pAccess;
+	/// pAccess when it takes restart points, otherwise 0
+	IDocumentWithRestartPoints *pAccessRestarts;
+	/// pAccess when it provides text segments, otherwise 0
+	IDocumentWithTextSegments *pAccessSegments;
 	enum {extremePosition=0x7FFFFFFF};
 	/** @a bufferSize is a trade off between time taken to copy the characters
 	 * and retrieval overhead.
@@ -22,9 +26,13 @@ private:
 	 * in case there is some backtracking. */
 	enum {bufferSize=4000, slopSize=bufferSize/8};
 	char buf[bufferSize+1];
+	/// The text from startPos to endPos, either buf or a segment of the document
+	const char *text;
 	int startPos;
 	int endPos;
 	int codePage;
+	/// Whether any byte is a lead byte, so single byte and UTF-8 text is not checked a byte at a time
+	bool leadBytes;
 	int lenDoc;
 	int mask;
 	char styleBuf[bufferSize];
@@ -34,7 +42,29 @@ private:
 	unsigned int startSeg;
 	int startPosStyling;
 
+	/** Use the document's text in place when the segment from before @a position
+	 * reaches at least a buffer beyond it, which is everywhere but near the gap. */
+	bool FillSegment(int position) {
+		int start = position - slopSize;
+		if (start < 0)
+			start = 0;
+		int lengthSegment = 0;
+		const char *segment = pAccessSegments->TextSegment(start, &lengthSegment);
+		int end = start + lengthSegment;
+		if (end > lenDoc)
+			end = lenDoc;
+		if (!segment || (end < position + bufferSize && end < lenDoc))
+			return false;
+		text = segment;
+		startPos = start;
+		endPos = end;
+		return true;
+	}
+
 	void Fill(int position) {
+		if (pAccessSegments && FillSegment(position))
+			return;
+		text = buf;
 		startPos = position - slopSize;
 		if (startPos + bufferSize > lenDoc)
 			startPos = lenDoc - bufferSize;
@@ -48,18 +78,29 @@ private:
 		buf[endPos-startPos] = '\0';
 	}
 
+	// Private so LexAccessor objects, whose text may point into buf, can not be copied
+	LexAccessor(const LexAccessor &);
+	LexAccessor &operator=(const LexAccessor &);
 public:
 	LexAccessor(IDocument *pAccess_) :
-		pAccess(pAccess_), startPos(extremePosition), endPos(0),
+		pAccess(pAccess_), pAccessRestarts(0), pAccessSegments(0), text(buf),
+		startPos(extremePosition), endPos(0),
 		codePage(pAccess->CodePage()), lenDoc(pAccess->Length()),
 		mask(127), validLen(0), chFlags(0), chWhile(0),
 		startSeg(0), startPosStyling(0) {
+		if (pAccess->Version() >= dvRestartPoints)
+			pAccessRestarts = static_cast<IDocumentWithRestartPoints *>(pAccess);
+		if (pAccess->Version() >= dvTextSegments)
+			pAccessSegments = static_cast<IDocumentWithTextSegments *>(pAccess);
+		leadBytes = false;
+		for (int ch = 0x80; (ch < 0x100) && !leadBytes; ch++)
+			leadBytes = pAccess->IsDBCSLeadByte(static_cast<char>(ch));
 	}
 	char operator[](int position) {
 		if (position < startPos || position >= endPos) {
 			Fill(position);
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	/** Safe version of operator[], returning a defined value for invalid position. */
 	char SafeGetCharAt(int position, char chDefault=' ') {
@@ -70,10 +111,10 @@ public:
 				return chDefault;
 			}
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	bool IsLeadByte(char ch) {
-		return pAccess->IsDBCSLeadByte(ch);
+		return leadBytes && pAccess->IsDBCSLeadByte(ch);
 	}
 
 	bool Match(int pos, const char *s) {
@@ -166,6 +207,12 @@ public:
 	void ChangeLexerState(int start, int end) {
 		pAccess->ChangeLexerState(start, end);
 	}
+	/** Lexing could start again at position, see IDocumentWithRestartPoints.
+	 * Lexers may call this often as the document keeps only a few of the points. */
+	void SetRestartPoint(int position) {
+		if (pAccessRestarts)
+			pAccessRestarts->SetRestartPoint(position);
+	}
 };
 
 #ifdef SCI_NAMESPACE
@@ -0,0 +1,97 @@
+// Scintilla source code edit control
+/** @file Arena.h
+ ** Allocates many small pieces of memory from a few large blocks.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+ * Pieces are carved sequentially from blocks so each costs no heap allocation or
+ * heap overhead of its own. Pieces can not be freed individually: freeing a piece only
+ * counts its space as wasted so that the owner can copy the live pieces into a new
+ * Arena once Wasteful returns true.
+ */
+class Arena {
+	enum { blockSize = 0x10000, alignment = 8 };
+	SplitVector<char *> blocks;
+	char *current;
+	size_t currentLeft;
+	size_t allocated;	///< Bytes in all blocks
+	size_t used;	///< Bytes in pieces not yet freed
+
+	static size_t Aligned(size_t size) {
+		return (size + alignment - 1) & ~static_cast<size_t>(alignment - 1);
+	}
+
+	char *AllocateBlock(size_t size) {
+		char *block = new char[size];
+		blocks.Insert(blocks.Length(), block);
+		allocated += size;
+		return block;
+	}
+
+	// Private so Arena objects can not be copied
+	Arena(const Arena &);
+	Arena &operator=(const Arena &);
+public:
+	Arena() : current(0), currentLeft(0), allocated(0), used(0) {
+	}
+
+	~Arena() {
+		DeleteAll();
+	}
+
+	/// Retrieve size bytes, zeroed, aligned for any member that pieces start with.
+	char *Allocate(size_t size) {
+		size = Aligned(size);
+		char *piece;
+		if (size > blockSize / 4) {
+			// Large pieces get their own block so they do not waste the rest of the current one
+			piece = AllocateBlock(size);
+		} else {
+			if (size > currentLeft) {
+				current = AllocateBlock(blockSize);
+				currentLeft = blockSize;
+			}
+			piece = current + blockSize - currentLeft;
+			currentLeft -= size;
+		}
+		used += size;
+		memset(piece, 0, size);
+		return piece;
+	}
+
+	/// Account for a piece of size bytes, as passed to Allocate, no longer being used.
+	void Free(size_t size) {
+		used -= Aligned(size);
+	}
+
+	/// @return true when more space is wasted by freed pieces than used by live ones.
+	bool Wasteful() const {
+		const size_t wasted = allocated - used;
+		return (wasted > blockSize) && (wasted > used);
+	}
+
+	size_t Allocated() const {
+		return allocated;
+	}
+
+	size_t Used() const {
+		return used;
+	}
+
+	void DeleteAll() {
+		for (int block = 0; block < blocks.Length(); block++) {
+			delete []blocks[block];
+		}
+		blocks.DeleteAll();
+		current = 0;
+		currentLeft = 0;
+		allocated = 0;
+		used = 0;
+	}
+};
+
+#endif
@@ -10,27 +10,280 @@
 #include <stdlib.h>
 #include <stdarg.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SCI_LINE_END_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && defined(SCI_LINE_END_SSE2)
+#include <intrin.h>
+#endif
+
 #include "Platform.h"
 
 #include "Scintilla.h"
 #include "SplitVector.h"
+#include "CompressedText.h"
 #include "Partitioning.h"
+#include "SharedMemory.h"
+#include "ChunkedVector.h"
+#include "PartitionTree.h"
+#include "RunStyles.h"
 #include "CellBuffer.h"
 
 #ifdef SCI_NAMESPACE
 using namespace Scintilla;
 #endif
 
-LineVector::LineVector() : starts(256), perLine(0) {
+#ifdef SCI_LINE_END_SSE2
+static inline int LowestBit(unsigned int mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+/// Find the first cr or lf in s from start up to end.
+/// @return the index of the line end character or end when there is none.
+static Sci_Position NextLineEnd(const char *s, Sci_Position start, Sci_Position end) {
+	Sci_Position i = start;
+#if defined(__AVX2__)
+	const __m256i cr32 = _mm256_set1_epi8('\r');
+	const __m256i lf32 = _mm256_set1_epi8('\n');
+	for (; i + 32 <= end; i += 32) {
+		const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+		const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, cr32), _mm256_cmpeq_epi8(block, lf32))));
+		if (mask)
+			return i + LowestBit(mask);
+	}
+#endif
+#ifdef SCI_LINE_END_SSE2
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	for (; i + 16 <= end; i += 16) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+		const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, lf))));
+		if (mask)
+			return i + LowestBit(mask);
+	}
+#endif
+	for (; i < end; i++) {
+		if ((s[i] == '\r') || (s[i] == '\n'))
+			return i;
+	}
+	return end;
+}
+
+/// Blocks of text at least twice this long have their lines found by several threads.
+static const Sci_Position lengthWorkerPiece = 0x100000;
+
+static bool UseWorkers(Sci_Position length) {
+	return (length >= lengthWorkerPiece * 2) && (Workers::Count() > 1);
+}
+
+/// A piece of a block of text whose line starts are found by one worker.
+struct LineStartsPiece {
+	const char *s;	///< The whole block
+	Sci_Position length;	///< Length of the whole block
+	char chAfter;	///< Character after the block
+	Sci_Position start;	///< Range of the block scanned by this worker
+	Sci_Position end;
+	Sci_Position position;	///< Position of the block in the document
+	Sci_Position *starts;	///< Receives the line starts or NULL to only count them
+	int count;
+};
+
+static void ScanLineStarts(void *work) {
+	LineStartsPiece *piece = static_cast<LineStartsPiece *>(work);
+	int count = 0;
+	for (Sci_Position i = NextLineEnd(piece->s, piece->start, piece->end); i < piece->end;
+		i = NextLineEnd(piece->s, i + 1, piece->end)) {
+		if (piece->s[i] == '\r') {
+			const char chNext = (i + 1 < piece->length) ? piece->s[i + 1] : piece->chAfter;
+			if (chNext == '\n')
+				continue;	// Line ends after the lf of a crlf pair
+		}
+		if (piece->starts)
+			piece->starts[count] = piece->position + i + 1;
+		count++;
+	}
+	piece->count = count;
+}
+
+/// Find the line starts of the text s, which is at position and followed by chAfter,
+/// with several threads. The threads first count the lines in their piece of the text,
+/// then store them into one array which is inserted into lv at line.
+/// An lf at the start of s is treated as a line end even if it follows a cr.
+/// @return the number of lines inserted.
+static int InsertLineStarts(LineVector &lv, int line, bool lineStart,
+	Sci_Position position, const char *s, Sci_Position length, char chAfter) {
+	int pieces = Workers::Count();
+	if (pieces > length / lengthWorkerPiece)
+		pieces = static_cast<int>(length / lengthWorkerPiece);
+	if (pieces < 1)
+		pieces = 1;
+	LineStartsPiece *work = new LineStartsPiece[pieces];
+	void **works = new void *[pieces];
+	const Sci_Position lengthPiece = length / pieces;
+	for (int piece = 0; piece < pieces; piece++) {
+		work[piece].s = s;
+		work[piece].length = length;
+		work[piece].chAfter = chAfter;
+		work[piece].start = lengthPiece * piece;
+		work[piece].end = (piece == pieces - 1) ? length : lengthPiece * (piece + 1);
+		work[piece].position = position;
+		work[piece].starts = 0;
+		work[piece].count = 0;
+		works[piece] = &work[piece];
+	}
+	Workers::Run(ScanLineStarts, works, pieces);
+	int total = 0;
+	for (int piece = 0; piece < pieces; piece++)
+		total += work[piece].count;
+	if (total > 0) {
+		Sci_Position *starts = new Sci_Position[total];
+		int first = 0;
+		for (int piece = 0; piece < pieces; piece++) {
+			work[piece].starts = starts + first;
+			first += work[piece].count;
+		}
+		Workers::Run(ScanLineStarts, works, pieces);
+		lv.InsertLines(line, starts, total, lineStart);
+		delete []starts;
+	}
+	delete []works;
+	delete []work;
+	return total;
+}
+
+/// Gathers the starts of new lines so that they are added to a LineVector in batches.
+class LineBatch {
+	enum { lengthBatch = 256 };
+	LineVector &lv;
+	int line;
+	bool lineStart;
+	int count;
+	Sci_Position positions[lengthBatch];
+public:
+	LineBatch(LineVector &lv_, int line_, bool lineStart_) :
+		lv(lv_), line(line_), lineStart(lineStart_), count(0) {
+	}
+	void Add(Sci_Position position) {
+		if (count == lengthBatch)
+			Flush();
+		positions[count++] = position;
+	}
+	/// Move the start of the most recently added line.
+	void MoveLast(Sci_Position position) {
+		if (count > 0)
+			positions[count - 1] = position;
+		else
+			lv.SetLineStart(line - 1, position);
+	}
+	void Flush() {
+		if (count > 0) {
+			lv.InsertLines(line, positions, count, lineStart);
+			line += count;
+			count = 0;
+		}
+	}
+	/// The line that will be inserted by the next Add.
+	int Line() const {
+		return line + count;
+	}
+};
+
+static Partitioning *NewPartitions(Partitioning *) {
+	return new Partitioning(256);
+}
+
+static PartitionTree *NewPartitions(PartitionTree *) {
+	return new PartitionTree();
+}
+
+/// Presents a Partitioning or PartitionTree as LineStarts.
+template <typename P>
+class LineStartsOf : public LineStarts {
+	P *body;
+	// Private so LineStartsOf objects can not be copied
+	LineStartsOf(const LineStartsOf &);
+	LineStartsOf &operator=(const LineStartsOf &);
+public:
+	LineStartsOf() : body(NewPartitions(static_cast<P *>(0))) {
+	}
+	virtual ~LineStartsOf() {
+		delete body;
+		body = 0;
+	}
+	virtual int Partitions() const {
+		return body->Partitions();
+	}
+	virtual void InsertPartition(int partition, Sci_Position pos) {
+		body->InsertPartition(partition, pos);
+	}
+	virtual void InsertPartitions(int partition, const Sci_Position *positions, int count) {
+		body->InsertPartitions(partition, positions, count);
+	}
+	virtual void SetPartitionStartPosition(int partition, Sci_Position pos) {
+		body->SetPartitionStartPosition(partition, pos);
+	}
+	virtual void InsertText(int partitionInsert, Sci_Position delta) {
+		body->InsertText(partitionInsert, delta);
+	}
+	virtual void RemovePartition(int partition) {
+		body->RemovePartition(partition);
+	}
+	virtual Sci_Position PositionFromPartition(int partition) const {
+		return body->PositionFromPartition(partition);
+	}
+	virtual int PartitionFromPosition(Sci_Position pos) const {
+		return body->PartitionFromPosition(pos);
+	}
+	virtual void DeleteAll() {
+		body->DeleteAll();
+	}
+	virtual size_t Memory() const {
+		return body->Memory();
+	}
+	virtual void Shrink() {
+		body->Shrink();
+	}
+};
+
+static LineStarts *CreateLineStarts(int documentOptions) {
+	if (documentOptions & SC_DOCUMENTOPTION_LINES_TREE)
+		return new LineStartsOf<PartitionTree>();
+	else
+		return new LineStartsOf<Partitioning>();
+}
+
+LineVector::LineVector(int documentOptions) : starts(CreateLineStarts(documentOptions)), perLine(0) {
 	Init();
 }
 
 LineVector::~LineVector() {
-	starts.DeleteAll();
+	delete starts;
+	starts = 0;
+}
+
+size_t LineVector::Memory() const {
+	return starts->Memory();
+}
+
+void LineVector::Shrink() {
+	starts->Shrink();
 }
 
 void LineVector::Init() {
-	starts.DeleteAll();
+	starts->DeleteAll();
 	if (perLine) {
 		perLine->Init();
 	}
@@ -40,12 +293,12 @@ void LineVector::SetPerLine(PerLine *pl) {
 	perLine = pl;
 }
 
-void LineVector::InsertText(int line, int delta) {
-	starts.InsertText(line, delta);
+void LineVector::InsertText(int line, Sci_Position delta) {
+	starts->InsertText(line, delta);
 }
 
-void LineVector::InsertLine(int line, int position, bool lineStart) {
-	starts.InsertPartition(line, position);
+void LineVector::InsertLine(int line, Sci_Position position, bool lineStart) {
+	starts->InsertPartition(line, position);
 	if (perLine) {
 		if ((line > 0) && lineStart)
 			line--;
@@ -53,19 +306,30 @@ void LineVector::InsertLine(int line, int position, bool lineStart) {
 	}
 }
 
-void LineVector::SetLineStart(int line, int position) {
-	starts.SetPartitionStartPosition(line, position);
+void LineVector::InsertLines(int line, const Sci_Position *positions, int count, bool lineStart) {
+	starts->InsertPartitions(line, positions, count);
+	if (perLine) {
+		if ((line > 0) && lineStart)
+			line--;
+		perLine->InsertLines(line, count);
+	}
+}
+
+void LineVector::SetLineStart(int line, Sci_Position position) {
+	starts->SetPartitionStartPosition(line, position);
 }
 
-void LineVector::RemoveLine(int line) {
-	starts.RemovePartition(line);
+void LineVector::RemoveLine(int line, bool lineStart) {
+	starts->RemovePartition(line);
 	if (perLine) {
+		if ((line > 0) && lineStart)
+			line--;
 		perLine->RemoveLine(line);
 	}
 }
 
-int LineVector::LineFromPosition(int pos) const {
-	return starts.PartitionFromPosition(pos);
+int LineVector::LineFromPosition(Sci_Position pos) const {
+	return starts->PartitionFromPosition(pos);
 }
 
 Action::Action() {
@@ -76,12 +340,7 @@ Action::Action() {
 	mayCoalesce = false;
 }
 
-Action::~Action() {
-	Destroy();
-}
-
-void Action::Create(actionType at_, int position_, char *data_, int lenData_, bool mayCoalesce_) {
-	delete []data;
+void Action::Create(actionType at_, Sci_Position position_, char *data_, Sci_Position lenData_, bool mayCoalesce_) {
 	position = position_;
 	at = at_;
 	data = data_;
@@ -89,14 +348,7 @@ void Action::Create(actionType at_, int position_, char *data_, int lenData_, bo
 	mayCoalesce = mayCoalesce_;
 }
 
-void Action::Destroy() {
-	delete []data;
-	data = 0;
-}
-
 void Action::Grab(Action *source) {
-	delete []data;
-
 	position = source->position;
 	at = source->at;
 	data = source->data;
@@ -111,6 +363,60 @@ void Action::Grab(Action *source) {
 	source->mayCoalesce = true;
 }
 
+/// Most actions are typing so blocks hold many of them. Longer text gets its own block.
+static const size_t sizeUndoBlock = 0x10000;
+
+UndoArena::UndoArena() : current(0), memory(0) {
+}
+
+UndoArena::~UndoArena() {
+	// All the text has been released by now so only the current block remains
+	if (current)
+		FreeBlock(current);
+	current = 0;
+}
+
+void UndoArena::FreeBlock(Block *block) {
+	memory -= sizeof(Block) + block->size;
+	delete [](reinterpret_cast<char *>(block));
+}
+
+char *UndoArena::Allocate(Sci_Position length) {
+	if (length <= 0)
+		return 0;
+	// Each allocation is preceded by its block so that it can be released
+	const size_t lengthNeeded = sizeof(Block *) + static_cast<size_t>(length);
+	if (!current || (current->size - current->used < lengthNeeded)) {
+		if (current && (current->live == 0))
+			FreeBlock(current);
+		const size_t size = (lengthNeeded > sizeUndoBlock) ? lengthNeeded : sizeUndoBlock;
+		current = reinterpret_cast<Block *>(new char[sizeof(Block) + size]);
+		current->size = size;
+		current->used = 0;
+		current->live = 0;
+		memory += sizeof(Block) + size;
+	}
+	char *header = BlockData(current) + current->used;
+	memcpy(header, &current, sizeof(Block *));
+	current->used += lengthNeeded;
+	current->live++;
+	return header + sizeof(Block *);
+}
+
+void UndoArena::Release(char *data) {
+	if (!data)
+		return;
+	Block *block;
+	memcpy(&block, data - sizeof(Block *), sizeof(Block *));
+	block->live--;
+	if (block->live == 0) {
+		if (block == current)
+			current->used = 0;
+		else
+			FreeBlock(block);
+	}
+}
+
 // The undo history stores a sequence of user operations that represent the user's view of the
 // commands executed on the text.
 // Each user operation contains a sequence of text insertion and text deletion actions.
@@ -137,11 +443,15 @@ UndoHistory::UndoHistory() {
 	currentAction = 0;
 	undoSequenceDepth = 0;
 	savePoint = 0;
+	lengthText = 0;
+	memoryLimit = 0;
 
 	actions[currentAction].Create(startAction);
 }
 
 UndoHistory::~UndoHistory() {
+	for (int act = 0; act <= maxAction; act++)
+		arena.Release(actions[act].data);
 	delete []actions;
 	actions = 0;
 }
@@ -153,7 +463,7 @@ void UndoHistory::EnsureUndoRoom() {
 		// Run out of undo nodes so extend the array
 		int lenActionsNew = lenActions * 2;
 		Action *actionsNew = new Action[lenActionsNew];
-		for (int act = 0; act <= currentAction; act++)
+		for (int act = 0; act <= maxAction; act++)
 			actionsNew[act].Grab(&actions[act]);
 		delete []actions;
 		lenActions = lenActionsNew;
@@ -161,7 +471,64 @@ void UndoHistory::EnsureUndoRoom() {
 	}
 }
 
-void UndoHistory::AppendAction(actionType at, int position, char *data, int lengthData,
+/// Replace the action at act, releasing its text, with one that has space for lengthData.
+void UndoHistory::CreateAction(int act, actionType at, Sci_Position position, Sci_Position lengthData, bool mayCoalesce) {
+	arena.Release(actions[act].data);
+	lengthText -= actions[act].lenData;
+	actions[act].Create(at, position, arena.Allocate(lengthData), lengthData, mayCoalesce);
+	lengthText += lengthData;
+}
+
+/// Make act the last action, releasing the text of any redo actions after it.
+void UndoHistory::SetMaxAction(int act) {
+	for (int actRedo = act + 1; actRedo <= maxAction; actRedo++) {
+		arena.Release(actions[actRedo].data);
+		lengthText -= actions[actRedo].lenData;
+		actions[actRedo].Create(startAction);
+	}
+	maxAction = act;
+}
+
+/// When over the memory limit, drop whole undo sequences from the start of the history.
+/// The sequence being added to is always kept. Dropping moves all the remaining actions
+/// so it goes 1/16 under the limit to avoid repeating this for each new action.
+void UndoHistory::DropOldest() {
+	const Sci_Position sizeAction = static_cast<Sci_Position>(sizeof(Action));
+	Sci_Position memoryKept = lengthText + (maxAction + 1) * sizeAction;
+	if ((memoryLimit <= 0) || (memoryKept <= memoryLimit))
+		return;
+	const Sci_Position memoryTarget = memoryLimit - memoryLimit / 16;
+	int drop = 0;
+	// actions[0] is always a startAction and each sequence ends before the next one
+	int act = 1;
+	while (memoryKept > memoryTarget) {
+		int actEnd = act;
+		while ((actEnd < currentAction) && (actions[actEnd].at != startAction))
+			actEnd++;
+		if (actEnd >= currentAction)
+			break;
+		// The sequence and the startAction before it
+		for (int actDrop = act - 1; actDrop < actEnd; actDrop++)
+			memoryKept -= actions[actDrop].lenData + sizeAction;
+		drop = actEnd;
+		act = actEnd + 1;
+	}
+	if (drop == 0)
+		return;
+	// The startAction ending the last dropped sequence becomes actions[0]
+	for (int actDrop = 0; actDrop < drop; actDrop++) {
+		arena.Release(actions[actDrop].data);
+		lengthText -= actions[actDrop].lenData;
+		actions[actDrop].Create(startAction);
+	}
+	for (int actMove = drop; actMove <= maxAction; actMove++)
+		actions[actMove - drop].Grab(&actions[actMove]);
+	currentAction -= drop;
+	maxAction -= drop;
+	savePoint = (savePoint >= drop) ? savePoint - drop : -1;
+}
+
+char *UndoHistory::AppendAction(actionType at, Sci_Position position, const char *data, Sci_Position lengthData,
 	bool &startSequence, bool mayCoalesce) {
 	EnsureUndoRoom();
 	//Platform::DebugPrintf("%% %d action %d %d %d\n", at, position, lengthData, currentAction);
@@ -225,10 +592,15 @@ void UndoHistory::AppendAction(actionType at, int position, char *data, int leng
 		currentAction++;
 	}
 	startSequence = oldCurrentAction != currentAction;
-	actions[currentAction].Create(at, position, data, lengthData, mayCoalesce);
+	CreateAction(currentAction, at, position, lengthData, mayCoalesce);
+	char *text = actions[currentAction].data;
+	if (data && lengthData)
+		memcpy(text, data, lengthData);
 	currentAction++;
-	actions[currentAction].Create(startAction);
-	maxAction = currentAction;
+	CreateAction(currentAction, startAction);
+	SetMaxAction(currentAction);
+	DropOldest();
+	return text;
 }
 
 void UndoHistory::BeginUndoAction() {
@@ -236,8 +608,8 @@ void UndoHistory::BeginUndoAction() {
 	if (undoSequenceDepth == 0) {
 		if (actions[currentAction].at != startAction) {
 			currentAction++;
-			actions[currentAction].Create(startAction);
-			maxAction = currentAction;
+			CreateAction(currentAction, startAction);
+			SetMaxAction(currentAction);
 		}
 		actions[currentAction].mayCoalesce = false;
 	}
@@ -251,8 +623,8 @@ void UndoHistory::EndUndoAction() {
 	if (0 == undoSequenceDepth) {
 		if (actions[currentAction].at != startAction) {
 			currentAction++;
-			actions[currentAction].Create(startAction);
-			maxAction = currentAction;
+			CreateAction(currentAction, startAction);
+			SetMaxAction(currentAction);
 		}
 		actions[currentAction].mayCoalesce = false;
 	}
@@ -263,11 +635,9 @@ void UndoHistory::DropUndoSequence() {
 }
 
 void UndoHistory::DeleteUndoHistory() {
-	for (int i = 1; i < maxAction; i++)
-		actions[i].Destroy();
-	maxAction = 0;
+	SetMaxAction(0);
 	currentAction = 0;
-	actions[currentAction].Create(startAction);
+	CreateAction(currentAction, startAction);
 	savePoint = 0;
 }
 
@@ -329,65 +699,560 @@ void UndoHistory::CompletedRedoStep() {
 	currentAction++;
 }
 
-CellBuffer::CellBuffer() {
+void UndoHistory::SetMemoryLimit(Sci_Position limit) {
+	memoryLimit = limit;
+	DropOldest();
+}
+
+size_t UndoHistory::Memory() const {
+	return lenActions * sizeof(Action) + arena.Memory();
+}
+
+int UndoHistory::Actions() const {
+	int count = 0;
+	for (int act = 0; act <= maxAction; act++) {
+		if (actions[act].at != startAction)
+			count++;
+	}
+	return count;
+}
+
+// A gap buffer has to copy text that a chunked store can reference.
+static void InsertViewInto(SplitVector<char> &body, Sci_Position position, const char *s, Sci_Position insertLength,
+	SharedMemory *) {
+	body.InsertFromArray(position, s, 0, insertLength);
+}
+
+static void InsertViewInto(ChunkedVector<char> &body, Sci_Position position, const char *s, Sci_Position insertLength,
+	SharedMemory *owner) {
+	body.InsertView(position, s, insertLength, owner);
+}
+
+// Only a chunked store can share its memory with a copy.
+static bool ShareInto(SplitVector<char> &, SplitVector<char> &) {
+	return false;
+}
+
+static bool ShareInto(ChunkedVector<char> &body, ChunkedVector<char> &copy) {
+	body.Share(copy);
+	return true;
+}
+
+/// Presents a SplitVector or ChunkedVector of char as a CellStore.
+template <typename V>
+class CellStoreOf : public CellStore {
+	V body;
+public:
+	virtual ~CellStoreOf() {}
+	virtual Sci_Position Length() const {
+		return body.Length();
+	}
+	virtual char ValueAt(Sci_Position position) const {
+		return body.ValueAt(position);
+	}
+	virtual void SetValueAt(Sci_Position position, char v) {
+		body.SetValueAt(position, v);
+	}
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		body.GetRange(buffer, position, retrieveLength);
+	}
+	virtual void InsertFromArray(Sci_Position positionToInsert, const char s[], Sci_Position positionFrom, Sci_Position insertLength) {
+		body.InsertFromArray(positionToInsert, s, positionFrom, insertLength);
+	}
+	virtual void InsertValue(Sci_Position position, Sci_Position insertLength, char v) {
+		body.InsertValue(position, insertLength, v);
+	}
+	virtual void InsertView(Sci_Position position, const char *s, Sci_Position insertLength, SharedMemory *owner) {
+		InsertViewInto(body, position, s, insertLength, owner);
+	}
+	virtual void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
+		body.DeleteRange(position, deleteLength);
+	}
+	virtual void ReAllocate(Sci_Position newSize) {
+		body.ReAllocate(newSize);
+	}
+	virtual char *BufferPointer() {
+		return body.BufferPointer();
+	}
+	virtual const char *SegmentAt(Sci_Position position, Sci_Position &lengthSegment) const {
+		return body.SegmentAt(position, lengthSegment);
+	}
+	virtual CellStore *Share() {
+		CellStoreOf<V> *copy = new CellStoreOf<V>();
+		if (!ShareInto(body, copy->body)) {
+			delete copy;
+			return 0;
+		}
+		return copy;
+	}
+	virtual CellStore *Copy() const {
+		CellStoreOf<V> *copy = new CellStoreOf<V>();
+		const Sci_Position length = body.Length();
+		copy->body.ReAllocate(length + 1);
+		Sci_Position position = 0;
+		while (position < length) {
+			Sci_Position lengthSegment = 0;
+			const char *segment = body.SegmentAt(position, lengthSegment);
+			copy->body.InsertFromArray(position, segment, 0, lengthSegment);
+			position += lengthSegment;
+		}
+		return copy;
+	}
+	virtual size_t Memory() const {
+		return body.Memory();
+	}
+	virtual size_t Unused() const {
+		return body.Unused();
+	}
+	virtual void Shrink() {
+		body.Shrink();
+	}
+};
+
+/// Holds styles as runs of equal values so that text which has not been styled, or
+/// has only been styled in places, does not need a byte for each character.
+class CellStoreRuns : public CellStore {
+	RunStyles body;
+	void Fill(Sci_Position position, Sci_Position fillLength, char v) {
+		if (fillLength > 0)
+			body.FillRange(position, static_cast<unsigned char>(v), fillLength);
+	}
+public:
+	virtual ~CellStoreRuns() {}
+	virtual Sci_Position Length() const {
+		return body.Length();
+	}
+	virtual char ValueAt(Sci_Position position) const {
+		if ((position < 0) || (position >= body.Length()))
+			return 0;
+		return static_cast<char>(body.ValueAt(position));
+	}
+	virtual void SetValueAt(Sci_Position position, char v) {
+		if ((position >= 0) && (position < body.Length()))
+			Fill(position, 1, v);
+	}
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		while (retrieveLength > 0) {
+			Sci_Position lengthRun = body.EndRun(position) - position;
+			if (lengthRun > retrieveLength)
+				lengthRun = retrieveLength;
+			memset(buffer, static_cast<char>(body.ValueAt(position)), lengthRun);
+			buffer += lengthRun;
+			position += lengthRun;
+			retrieveLength -= lengthRun;
+		}
+	}
+	virtual void InsertFromArray(Sci_Position positionToInsert, const char s[], Sci_Position positionFrom, Sci_Position insertLength) {
+		body.InsertSpace(positionToInsert, insertLength);
+		Sci_Position i = 0;
+		while (i < insertLength) {
+			const char v = s[positionFrom + i];
+			Sci_Position lengthRun = 1;
+			while ((i + lengthRun < insertLength) && (s[positionFrom + i + lengthRun] == v))
+				lengthRun++;
+			Fill(positionToInsert + i, lengthRun, v);
+			i += lengthRun;
+		}
+	}
+	virtual void InsertValue(Sci_Position position, Sci_Position insertLength, char v) {
+		body.InsertSpace(position, insertLength);
+		// Space inserted at the end of a run takes that run's value
+		Fill(position, insertLength, v);
+	}
+	virtual void InsertView(Sci_Position position, const char *s, Sci_Position insertLength, SharedMemory *) {
+		InsertFromArray(position, s, 0, insertLength);
+	}
+	virtual void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
+		body.DeleteRange(position, deleteLength);
+	}
+	virtual void ReAllocate(Sci_Position) {
+	}
+	/// Runs have no contiguous form. Styles are never accessed this way.
+	virtual char *BufferPointer() {
+		return 0;
+	}
+	virtual const char *SegmentAt(Sci_Position, Sci_Position &lengthSegment) const {
+		lengthSegment = 0;
+		return 0;
+	}
+	virtual CellStore *Share() {
+		return 0;
+	}
+	/// Copying a run at a time is proportional to the number of runs.
+	virtual CellStore *Copy() const {
+		CellStoreRuns *copy = new CellStoreRuns();
+		const Sci_Position length = body.Length();
+		Sci_Position position = 0;
+		while (position < length) {
+			const Sci_Position endRun = body.EndRun(position);
+			copy->InsertValue(position, endRun - position, static_cast<char>(body.ValueAt(position)));
+			position = endRun;
+		}
+		return copy;
+	}
+	virtual size_t Memory() const {
+		return body.Memory();
+	}
+	virtual size_t Unused() const {
+		return 0;
+	}
+	virtual void Shrink() {
+		body.Shrink();
+	}
+	/// Apply value under mask to a range a run at a time.
+	/// @return true if any style changed.
+	bool SetRange(Sci_Position position, Sci_Position lengthRange, char value, char mask) {
+		bool changed = false;
+		const Sci_Position end = position + lengthRange;
+		while (position < end) {
+			Sci_Position endRun = body.EndRun(position);
+			if (endRun > end)
+				endRun = end;
+			const char curVal = static_cast<char>(body.ValueAt(position));
+			if ((curVal & mask) != value) {
+				Fill(position, endRun - position, static_cast<char>((curVal & ~mask) | value));
+				changed = true;
+			}
+			position = endRun;
+		}
+		return changed;
+	}
+	/// Each run costs a start position and a value.
+	bool Sparse() const {
+		return body.Runs() * static_cast<Sci_Position>(sizeof(Sci_Position) + sizeof(int)) * 4 < body.Length();
+	}
+};
+
+static CellStore *CreateCellStore(int documentOptions) {
+	if (documentOptions & SC_DOCUMENTOPTION_TEXT_CHUNKED)
+		return new CellStoreOf<ChunkedVector<char> >();
+	else
+		return new CellStoreOf<SplitVector<char> >();
+}
+
+/// Holds the text of a hibernating buffer compressed. The buffer expands it into a new store
+/// of the kind it came from when it rehydrates, which it does before changing the text or
+/// pointing into it. Reads meanwhile expand the blocks they cover into a temporary buffer
+/// without keeping them, so the memory stays compressed and several threads may read.
+class CellStoreCompressed : public CellStore {
+	CompressedText text;
+	int documentOptions;
+public:
+	CellStoreCompressed(const CellStore &store, int documentOptions_) :
+		documentOptions(documentOptions_) {
+		const Sci_Position length = store.Length();
+		char *block = new char[CompressedText::blockSize];
+		for (Sci_Position position = 0; position < length; position += CompressedText::blockSize) {
+			Sci_Position lengthBlock = length - position;
+			if (lengthBlock > CompressedText::blockSize)
+				lengthBlock = CompressedText::blockSize;
+			store.GetRange(block, position, lengthBlock);
+			text.AppendBlock(block, lengthBlock);
+		}
+		delete []block;
+		text.Shrink();
+	}
+	virtual ~CellStoreCompressed() {
+	}
+	/// A new store holding the text expanded, which the caller then owns.
+	CellStore *Expand() const {
+		CellStore *expanded = CreateCellStore(documentOptions);
+		expanded->ReAllocate(text.Length() + 1);
+		char *block = new char[CompressedText::blockSize];
+		for (int b = 0; b < text.Blocks(); b++) {
+			text.ExpandBlock(b, block);
+			expanded->InsertFromArray(expanded->Length(), block, 0, text.BlockLength(b));
+		}
+		delete []block;
+		return expanded;
+	}
+	virtual Sci_Position Length() const {
+		return text.Length();
+	}
+	/// Expands a whole block so is slow when called for each byte.
+	virtual char ValueAt(Sci_Position position) const {
+		char v = 0;
+		if ((position >= 0) && (position < text.Length()))
+			GetRange(&v, position, 1);
+		return v;
+	}
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		char *block = new char[CompressedText::blockSize];
+		while (retrieveLength > 0) {
+			const int b = static_cast<int>(position / CompressedText::blockSize);
+			const Sci_Position offset = position - static_cast<Sci_Position>(b) * CompressedText::blockSize;
+			Sci_Position lengthPart = text.BlockLength(b) - offset;
+			if (lengthPart > retrieveLength)
+				lengthPart = retrieveLength;
+			text.ExpandBlock(b, block);
+			memcpy(buffer, block + offset, lengthPart);
+			buffer += lengthPart;
+			position += lengthPart;
+			retrieveLength -= lengthPart;
+		}
+		delete []block;
+	}
+	// The buffer rehydrates before any change so these are never called
+	virtual void SetValueAt(Sci_Position, char) {
+		PLATFORM_ASSERT(false);
+	}
+	virtual void InsertFromArray(Sci_Position, const char [], Sci_Position, Sci_Position) {
+		PLATFORM_ASSERT(false);
+	}
+	virtual void InsertValue(Sci_Position, Sci_Position, char) {
+		PLATFORM_ASSERT(false);
+	}
+	virtual void InsertView(Sci_Position, const char *, Sci_Position, SharedMemory *) {
+		PLATFORM_ASSERT(false);
+	}
+	virtual void DeleteRange(Sci_Position, Sci_Position) {
+		PLATFORM_ASSERT(false);
+	}
+	virtual void ReAllocate(Sci_Position) {
+	}
+	virtual char *BufferPointer() {
+		PLATFORM_ASSERT(false);
+		return 0;
+	}
+	/// No text is held expanded so there are no segments. Readers fall back to GetRange.
+	virtual const char *SegmentAt(Sci_Position, Sci_Position &lengthSegment) const {
+		lengthSegment = 0;
+		return 0;
+	}
+	virtual CellStore *Share() {
+		return 0;
+	}
+	virtual CellStore *Copy() const {
+		return Expand();
+	}
+	virtual size_t Memory() const {
+		return text.Memory();
+	}
+	virtual size_t Unused() const {
+		return 0;
+	}
+	virtual void Shrink() {
+	}
+};
+
+/// Owns a store that has been frozen so a buffer and its snapshots can read it.
+class SharedCellStore : public SharedMemory {
+	CellStore *store;
+public:
+	explicit SharedCellStore(CellStore *store_) : store(store_) {
+	}
+	virtual ~SharedCellStore() {
+		delete store;
+	}
+	/// Hand the store back for changing, when nothing else reads it, instead of copying it.
+	CellStore *Take() {
+		CellStore *taken = store;
+		store = 0;
+		return taken;
+	}
+};
+
+/// Keeps a mapped file open while a buffer or any snapshot views its memory.
+class SharedMapping : public SharedMemory {
+	MappedFile *mappedFile;
+public:
+	explicit SharedMapping(MappedFile *mappedFile_) : mappedFile(mappedFile_) {
+	}
+	virtual ~SharedMapping() {
+		delete mappedFile;
+	}
+};
+
+/// Provide a store with the contents of store for a snapshot, which is given a
+/// reference to owner. store is frozen, as recorded in shared, if it can not share.
+static const CellStore *ShareStore(CellStore *store, SharedMemory *&shared, SharedMemory *&owner) {
+	if (!shared) {
+		CellStore *copy = store->Share();
+		if (copy) {
+			owner = new SharedCellStore(copy);
+			return copy;
+		}
+		shared = new SharedCellStore(store);
+	}
+	shared->AddRef();
+	owner = shared;
+	return store;
+}
+
+/// Must be called before a store is changed so snapshots keep seeing the frozen contents.
+static void UnshareStore(CellStore *&store, SharedMemory *&shared) {
+	if (shared) {
+		SharedCellStore *frozen = static_cast<SharedCellStore *>(shared);
+		shared = 0;
+		if (frozen->Unique()) {
+			// Every snapshot has finished with it
+			store = frozen->Take();
+		} else {
+			store = store->Copy();
+		}
+		frozen->Release();
+	}
+}
+
+static void FreeStore(CellStore *store, SharedMemory *shared) {
+	if (shared)
+		shared->Release();
+	else
+		delete store;
+}
+
+CellSnapshot::CellSnapshot(const CellStore *substance_, SharedMemory *substanceOwner_,
+	const CellStore *style_, SharedMemory *styleOwner_, int version_) :
+	substance(substance_), style(style_),
+	substanceOwner(substanceOwner_), styleOwner(styleOwner_), version(version_) {
+}
+
+CellSnapshot::~CellSnapshot() {
+	substanceOwner->Release();
+	styleOwner->Release();
+}
+
+Sci_Position CellSnapshot::Length() const {
+	return substance->Length();
+}
+
+char CellSnapshot::CharAt(Sci_Position position) const {
+	return substance->ValueAt(position);
+}
+
+void CellSnapshot::GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+	if ((position < 0) || (lengthRetrieve <= 0) || (position + lengthRetrieve > substance->Length()))
+		return;
+	substance->GetRange(buffer, position, lengthRetrieve);
+}
+
+char CellSnapshot::StyleAt(Sci_Position position) const {
+	return style->ValueAt(position);
+}
+
+void CellSnapshot::GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+	if ((position < 0) || (lengthRetrieve <= 0) || (position + lengthRetrieve > style->Length()))
+		return;
+	style->GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve);
+}
+
+const char *CellSnapshot::TextSegment(Sci_Position position, Sci_Position &lengthSegment) const {
+	lengthSegment = 0;
+	if ((position < 0) || (position >= substance->Length()))
+		return 0;
+	return substance->SegmentAt(position, lengthSegment);
+}
+
+CellBuffer::CellBuffer(int documentOptions_) :
+	documentOptions(documentOptions_), lv(documentOptions_) {
+	substance = CreateCellStore(documentOptions);
+	// Styles are only allocated for each character once styling needs it
+	style = new CellStoreRuns();
+	styleRuns = true;
+	substanceShared = 0;
+	styleShared = 0;
+	mapping = 0;
+	substanceCompressed = false;
+	hibernating = false;
+	lengthUnindexed = 0;
+	version = 0;
 	readOnly = false;
 	collectingUndo = true;
 }
 
 CellBuffer::~CellBuffer() {
+	FreeStore(substance, substanceShared);
+	substance = 0;
+	FreeStore(style, styleShared);
+	style = 0;
+	// The stores may reference the mapping so it is released after them
+	if (mapping)
+		mapping->Release();
+	mapping = 0;
 }
 
-char CellBuffer::CharAt(int position) const {
-	return substance.ValueAt(position);
+char CellBuffer::CharAt(Sci_Position position) const {
+	return substance->ValueAt(position);
 }
 
-void CellBuffer::GetCharRange(char *buffer, int position, int lengthRetrieve) const {
+void CellBuffer::GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
 	if (lengthRetrieve < 0)
 		return;
 	if (position < 0)
 		return;
-	if ((position + lengthRetrieve) > substance.Length()) {
-		Platform::DebugPrintf("Bad GetCharRange %d for %d of %d\n", position,
-		                      lengthRetrieve, substance.Length());
+	if ((position + lengthRetrieve) > substance->Length()) {
+		Platform::DebugPrintf("Bad GetCharRange %ld for %ld of %ld\n", static_cast<long>(position),
+		                      static_cast<long>(lengthRetrieve), static_cast<long>(substance->Length()));
 		return;
 	}
-	substance.GetRange(buffer, position, lengthRetrieve);
+	substance->GetRange(buffer, position, lengthRetrieve);
 }
 
-char CellBuffer::StyleAt(int position) const {
-	return style.ValueAt(position);
+char CellBuffer::StyleAt(Sci_Position position) const {
+	return style->ValueAt(position);
 }
 
-void CellBuffer::GetStyleRange(unsigned char *buffer, int position, int lengthRetrieve) const {
+void CellBuffer::GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
 	if (lengthRetrieve < 0)
 		return;
 	if (position < 0)
 		return;
-	if ((position + lengthRetrieve) > style.Length()) {
-		Platform::DebugPrintf("Bad GetStyleRange %d for %d of %d\n", position,
-		                      lengthRetrieve, style.Length());
+	if ((position + lengthRetrieve) > style->Length()) {
+		Platform::DebugPrintf("Bad GetStyleRange %ld for %ld of %ld\n", static_cast<long>(position),
+		                      static_cast<long>(lengthRetrieve), static_cast<long>(style->Length()));
 		return;
 	}
-	style.GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve);
+	style->GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve);
 }
 
 const char *CellBuffer::BufferPointer() {
-	return substance.BufferPointer();
+	// Moving the gap or joining chunks invalidates segments
+	version++;
+	Rehydrate();
+	UnshareStore(substance, substanceShared);
+	return substance->BufferPointer();
+}
+
+const char *CellBuffer::TextSegment(Sci_Position position, Sci_Position &lengthSegment) const {
+	lengthSegment = 0;
+	if ((position < 0) || (position >= substance->Length()))
+		return 0;
+	return substance->SegmentAt(position, lengthSegment);
+}
+
+int CellBuffer::TextVersion() const {
+	return version;
+}
+
+CellSnapshot *CellBuffer::CreateSnapshot(bool withStyles) {
+	// Snapshots share the expanded stores rather than compressed text
+	Rehydrate();
+	SharedMemory *substanceOwner = 0;
+	const CellStore *substanceSnapshot = ShareStore(substance, substanceShared, substanceOwner);
+	SharedMemory *styleOwner = 0;
+	const CellStore *styleSnapshot = 0;
+	if (withStyles) {
+		styleSnapshot = ShareStore(style, styleShared, styleOwner);
+	} else {
+		// A single run of 0 so the style store is not frozen
+		CellStore *unstyled = new CellStoreRuns();
+		unstyled->InsertValue(0, substance->Length(), 0);
+		styleOwner = new SharedCellStore(unstyled);
+		styleSnapshot = unstyled;
+	}
+	return new CellSnapshot(substanceSnapshot, substanceOwner, styleSnapshot, styleOwner, version);
 }
 
 // The char* returned is to an allocation owned by the undo history
-const char *CellBuffer::InsertString(int position, const char *s, int insertLength, bool &startSequence) {
+const char *CellBuffer::InsertString(Sci_Position position, const char *s, Sci_Position insertLength, bool &startSequence) {
 	char *data = 0;
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	if (!readOnly) {
+		// Line ends next to the change must be known. Normally Document has already done this.
+		IndexLines(position + 1);
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
-			// This takes up about half load time
-			data = new char[insertLength];
-			for (int i = 0; i < insertLength; i++) {
-				data[i] = s[i];
-			}
-			uh.AppendAction(insertAction, position, data, insertLength, startSequence);
+			data = uh.AppendAction(insertAction, position, s, insertLength, startSequence);
 		}
 
 		BasicInsertString(position, s, insertLength);
@@ -395,25 +1260,54 @@ const char *CellBuffer::InsertString(int position, const char *s, int insertLeng
 	return data;
 }
 
-bool CellBuffer::SetStyleAt(int position, char styleValue, char mask) {
+void CellBuffer::CheckStyleRuns() {
+	if (styleRuns && !static_cast<CellStoreRuns *>(style)->Sparse()) {
+		// Styling has become detailed enough that a byte for each character is smaller
+		const Sci_Position length = style->Length();
+		CellStore *styleDense = CreateCellStore(documentOptions);
+		styleDense->ReAllocate(length + 1);
+		const Sci_Position lengthBlock = 0x10000;
+		char *block = new char[lengthBlock];
+		for (Sci_Position position = 0; position < length; position += lengthBlock) {
+			const Sci_Position lengthCopy = (length - position < lengthBlock) ? length - position : lengthBlock;
+			style->GetRange(block, position, lengthCopy);
+			styleDense->InsertFromArray(position, block, 0, lengthCopy);
+		}
+		delete []block;
+		delete style;
+		style = styleDense;
+		styleRuns = false;
+	}
+}
+
+bool CellBuffer::SetStyleAt(Sci_Position position, char styleValue, char mask) {
 	styleValue &= mask;
-	char curVal = style.ValueAt(position);
+	char curVal = style->ValueAt(position);
 	if ((curVal & mask) != styleValue) {
-		style.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
+		UnshareStore(style, styleShared);
+		style->SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
+		CheckStyleRuns();
 		return true;
 	} else {
 		return false;
 	}
 }
 
-bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue, char mask) {
+bool CellBuffer::SetStyleFor(Sci_Position position, Sci_Position lengthStyle, char styleValue, char mask) {
 	bool changed = false;
 	PLATFORM_ASSERT(lengthStyle == 0 ||
-		(lengthStyle > 0 && lengthStyle + position <= style.Length()));
+		(lengthStyle > 0 && lengthStyle + position <= style->Length()));
+	UnshareStore(style, styleShared);
+	if (styleRuns) {
+		changed = static_cast<CellStoreRuns *>(style)->SetRange(position, lengthStyle, styleValue, mask);
+		if (changed)
+			CheckStyleRuns();
+		return changed;
+	}
 	while (lengthStyle--) {
-		char curVal = style.ValueAt(position);
+		char curVal = style->ValueAt(position);
 		if ((curVal & mask) != styleValue) {
-			style.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
+			style->SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
 			changed = true;
 		}
 		position++;
@@ -422,18 +1316,16 @@ bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue, cha
 }
 
 // The char* returned is to an allocation owned by the undo history
-const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startSequence) {
+const char *CellBuffer::DeleteChars(Sci_Position position, Sci_Position deleteLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	PLATFORM_ASSERT(deleteLength > 0);
 	char *data = 0;
 	if (!readOnly) {
+		IndexLines(position + deleteLength + 1);
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
-			data = new char[deleteLength];
-			for (int i = 0; i < deleteLength; i++) {
-				data[i] = substance.ValueAt(position + i);
-			}
-			uh.AppendAction(removeAction, position, data, deleteLength, startSequence);
+			data = uh.AppendAction(removeAction, position, 0, deleteLength, startSequence);
+			substance->GetRange(data, position, deleteLength);
 		}
 
 		BasicDeleteChars(position, deleteLength);
@@ -441,13 +1333,101 @@ const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startS
 	return data;
 }
 
-int CellBuffer::Length() const {
-	return substance.Length();
+bool CellBuffer::SetMappedFile(MappedFile *mappedFile_) {
+	const Sci_Position lengthFile = static_cast<Sci_Position>(mappedFile_->Length());
+	if ((Length() != 0) || mapping || (lengthFile < 0) ||
+		(static_cast<size_t>(lengthFile) != mappedFile_->Length())) {
+		// Not empty or too large for Sci_Position
+		return false;
+	}
+	mapping = new SharedMapping(mappedFile_);
+	if (lengthFile > 0) {
+		version++;
+		UnshareStore(substance, substanceShared);
+		UnshareStore(style, styleShared);
+		substance->InsertView(0, mappedFile_->Data(), lengthFile, mapping);
+		style->InsertValue(0, lengthFile, 0);
+		lv.InsertText(0, lengthFile);
+		lengthUnindexed = lengthFile;
+	}
+	return true;
 }
 
-void CellBuffer::Allocate(int newSize) {
-	substance.ReAllocate(newSize);
-	style.ReAllocate(newSize);
+void CellBuffer::AppendWithoutLines(const char *s, Sci_Position insertLength) {
+	if (insertLength <= 0)
+		return;
+	const Sci_Position position = Length();
+	version++;
+	Rehydrate();
+	UnshareStore(substance, substanceShared);
+	UnshareStore(style, styleShared);
+	substance->InsertFromArray(position, s, 0, insertLength);
+	style->InsertValue(position, insertLength, 0);
+	lv.InsertText(lv.Lines() - 1, insertLength);
+	lengthUnindexed += insertLength;
+}
+
+int CellBuffer::IndexLines(Sci_Position upTo) {
+	if ((lengthUnindexed == 0) || (upTo <= IndexedTo()))
+		return 0;
+	if ((upTo >= Length()) && UseWorkers(lengthUnindexed) &&
+		!(documentOptions & SC_DOCUMENTOPTION_TEXT_CHUNKED)) {
+		// All the rest of a contiguous buffer, as when a loader has finished
+		const Sci_Position indexedTo = IndexedTo();
+		const char *text = BufferPointer();
+		const int linesAdded = InsertLineStarts(lv, lv.Lines(), false,
+			indexedTo, text + indexedTo, lengthUnindexed, 0);
+		lengthUnindexed = 0;
+		return linesAdded;
+	}
+	const int linesBefore = lv.Lines();
+	const Sci_Position lengthAll = Length();
+	Sci_Position position = IndexedTo();
+	Sci_Position indexedTo = position;
+	bool reached = false;
+	const Sci_Position lengthBlock = 0x10000;
+	char *block = new char[lengthBlock];
+	LineBatch batch(lv, lv.Lines(), false);
+	while (!reached && (position < lengthAll)) {
+		Sci_Position lengthRead = lengthAll - position;
+		if (lengthRead > lengthBlock)
+			lengthRead = lengthBlock;
+		substance->GetRange(block, position, lengthRead);
+		for (Sci_Position i = NextLineEnd(block, 0, lengthRead); i < lengthRead;
+			i = NextLineEnd(block, i + 1, lengthRead)) {
+			const Sci_Position lineStart = position + i + 1;
+			if (block[i] == '\r') {
+				const char chNext = (i + 1 < lengthRead) ? block[i + 1] : substance->ValueAt(lineStart);
+				if (chNext == '\n')
+					continue;	// Line ends after the lf of a crlf pair
+			}
+			batch.Add(lineStart);
+			indexedTo = lineStart;
+			if (lineStart >= upTo) {
+				reached = true;
+				break;
+			}
+		}
+		position += lengthRead;
+	}
+	batch.Flush();
+	delete []block;
+	// When the end was reached without stopping there are no more lines to find
+	lengthUnindexed = reached ? lengthAll - indexedTo : 0;
+	return lv.Lines() - linesBefore;
+}
+
+Sci_Position CellBuffer::Length() const {
+	return substance->Length();
+}
+
+void CellBuffer::Allocate(Sci_Position newSize) {
+	version++;
+	Rehydrate();
+	UnshareStore(substance, substanceShared);
+	UnshareStore(style, styleShared);
+	substance->ReAllocate(newSize);
+	style->ReAllocate(newSize);
 }
 
 void CellBuffer::SetPerLine(PerLine *pl) {
@@ -458,7 +1438,7 @@ int CellBuffer::Lines() const {
 	return lv.Lines();
 }
 
-int CellBuffer::LineStart(int line) const {
+Sci_Position CellBuffer::LineStart(int line) const {
 	if (line < 0)
 		return 0;
 	else if (line >= Lines())
@@ -485,64 +1465,76 @@ bool CellBuffer::IsSavePoint() {
 
 // Without undo
 
-void CellBuffer::InsertLine(int line, int position, bool lineStart) {
+void CellBuffer::InsertLine(int line, Sci_Position position, bool lineStart) {
 	lv.InsertLine(line, position, lineStart);
 }
 
-void CellBuffer::RemoveLine(int line) {
-	lv.RemoveLine(line);
+void CellBuffer::RemoveLine(int line, bool lineStart) {
+	lv.RemoveLine(line, lineStart);
 }
 
-void CellBuffer::BasicInsertString(int position, const char *s, int insertLength) {
+void CellBuffer::BasicInsertString(Sci_Position position, const char *s, Sci_Position insertLength) {
 	if (insertLength == 0)
 		return;
 	PLATFORM_ASSERT(insertLength > 0);
 
-	substance.InsertFromArray(position, s, 0, insertLength);
-	style.InsertValue(position, insertLength, 0);
+	version++;
+	Rehydrate();
+	UnshareStore(substance, substanceShared);
+	UnshareStore(style, styleShared);
+	substance->InsertFromArray(position, s, 0, insertLength);
+	style->InsertValue(position, insertLength, 0);
 
 	int lineInsert = lv.LineFromPosition(position) + 1;
 	bool atLineStart = lv.LineStart(lineInsert-1) == position;
 	// Point all the lines after the insertion point further along in the buffer
 	lv.InsertText(lineInsert-1, insertLength);
-	char chPrev = substance.ValueAt(position - 1);
-	char chAfter = substance.ValueAt(position + insertLength);
+	char chPrev = substance->ValueAt(position - 1);
+	char chAfter = substance->ValueAt(position + insertLength);
 	if (chPrev == '\r' && chAfter == '\n') {
 		// Splitting up a crlf pair at position
 		InsertLine(lineInsert, position, false);
 		lineInsert++;
 	}
-	char ch = ' ';
-	for (int i = 0; i < insertLength; i++) {
-		ch = s[i];
-		if (ch == '\r') {
-			InsertLine(lineInsert, (position + i) + 1, atLineStart);
-			lineInsert++;
-		} else if (ch == '\n') {
-			if (chPrev == '\r') {
-				// Patch up what was end of line
-				lv.SetLineStart(lineInsert - 1, (position + i) + 1);
-			} else {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
-			}
+	if (UseWorkers(insertLength)) {
+		Sci_Position skip = 0;
+		if ((s[0] == '\n') && (chPrev == '\r')) {
+			// Patch up what was end of line
+			lv.SetLineStart(lineInsert - 1, position + 1);
+			skip = 1;
+		}
+		// A final cr followed by an lf already in the buffer does not add a line
+		InsertLineStarts(lv, lineInsert, atLineStart, position + skip, s + skip, insertLength - skip, chAfter);
+		return;
+	}
+	LineBatch batch(lv, lineInsert, atLineStart);
+	for (Sci_Position i = NextLineEnd(s, 0, insertLength); i < insertLength;
+		i = NextLineEnd(s, i + 1, insertLength)) {
+		if ((s[i] == '\n') && (((i > 0) ? s[i - 1] : chPrev) == '\r')) {
+			// Patch up what was end of line
+			batch.MoveLast((position + i) + 1);
+		} else {
+			batch.Add((position + i) + 1);
 		}
-		chPrev = ch;
 	}
+	batch.Flush();
+	lineInsert = batch.Line();
 	// Joining two lines where last insertion is cr and following substance starts with lf
 	if (chAfter == '\n') {
-		if (ch == '\r') {
+		if (s[insertLength - 1] == '\r') {
 			// End of line already in buffer so drop the newly created one
-			RemoveLine(lineInsert - 1);
+			RemoveLine(lineInsert - 1, false);
 		}
 	}
 }
 
-void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
+void CellBuffer::BasicDeleteChars(Sci_Position position, Sci_Position deleteLength) {
 	if (deleteLength == 0)
 		return;
 
-	if ((position == 0) && (deleteLength == substance.Length())) {
+	version++;
+	Rehydrate();
+	if ((position == 0) && (deleteLength == substance->Length())) {
 		// If whole buffer is being deleted, faster to reinitialise lines data
 		// than to delete each line.
 		lv.Init();
@@ -552,9 +1544,9 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 
 		int lineRemove = lv.LineFromPosition(position) + 1;
 		lv.InsertText(lineRemove-1, - (deleteLength));
-		char chPrev = substance.ValueAt(position - 1);
+		char chPrev = substance->ValueAt(position - 1);
 		char chBefore = chPrev;
-		char chNext = substance.ValueAt(position);
+		char chNext = substance->ValueAt(position);
 		bool ignoreNL = false;
 		if (chPrev == '\r' && chNext == '\n') {
 			// Move back one
@@ -563,18 +1555,24 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 			ignoreNL = true; 	// First \n is not real deletion
 		}
 
+		// Whole lines deleted from the start, as when a log is trimmed, take their
+		// per line data with them so the line left first keeps its own
+		const char chLast = substance->ValueAt(position + deleteLength - 1);
+		const bool leadingLines = (position == 0) && ((chLast == '\n') ||
+			((chLast == '\r') && (substance->ValueAt(position + deleteLength) != '\n')));
+
 		char ch = chNext;
-		for (int i = 0; i < deleteLength; i++) {
-			chNext = substance.ValueAt(position + i + 1);
+		for (Sci_Position i = 0; i < deleteLength; i++) {
+			chNext = substance->ValueAt(position + i + 1);
 			if (ch == '\r') {
 				if (chNext != '\n') {
-					RemoveLine(lineRemove);
+					RemoveLine(lineRemove, leadingLines);
 				}
 			} else if (ch == '\n') {
 				if (ignoreNL) {
 					ignoreNL = false; 	// Further \n are real deletions
 				} else {
-					RemoveLine(lineRemove);
+					RemoveLine(lineRemove, leadingLines);
 				}
 			}
 
@@ -582,15 +1580,25 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 		}
 		// May have to fix up end if last deletion causes cr to be next to lf
 		// or removes one of a crlf pair
-		char chAfter = substance.ValueAt(position + deleteLength);
+		char chAfter = substance->ValueAt(position + deleteLength);
 		if (chBefore == '\r' && chAfter == '\n') {
 			// Using lineRemove-1 as cr ended line before start of deletion
-			RemoveLine(lineRemove - 1);
+			RemoveLine(lineRemove - 1, false);
 			lv.SetLineStart(lineRemove - 1, position + 1);
 		}
 	}
-	substance.DeleteRange(position, deleteLength);
-	style.DeleteRange(position, deleteLength);
+	UnshareStore(substance, substanceShared);
+	substance->DeleteRange(position, deleteLength);
+	if ((position == 0) && (deleteLength == style->Length()) && !styleRuns) {
+		// Emptied so release the styles until new text is styled
+		FreeStore(style, styleShared);
+		styleShared = 0;
+		style = new CellStoreRuns();
+		styleRuns = true;
+	} else {
+		UnshareStore(style, styleShared);
+		style->DeleteRange(position, deleteLength);
+	}
 }
 
 bool CellBuffer::SetUndoCollection(bool collectUndo) {
@@ -620,6 +1628,77 @@ void CellBuffer::DeleteUndoHistory() {
 	uh.DeleteUndoHistory();
 }
 
+void CellBuffer::SetUndoMemoryLimit(Sci_Position limit) {
+	uh.SetMemoryLimit(limit);
+}
+
+Sci_Position CellBuffer::UndoMemoryLimit() const {
+	return uh.MemoryLimit();
+}
+
+size_t CellBuffer::UndoMemory() const {
+	return uh.Memory();
+}
+
+size_t CellBuffer::TextMemory(size_t &unused) const {
+	unused = substance->Unused();
+	return substance->Memory();
+}
+
+void CellBuffer::Hibernate() {
+	if (hibernating)
+		return;
+	hibernating = true;
+	version++;
+	// Text viewed from a mapped file uses no memory of its own so is left as it is
+	if (!mapping && (substance->Length() > 0)) {
+		CellStore *compressed = new CellStoreCompressed(*substance, documentOptions);
+		if (compressed->Memory() < substance->Memory()) {
+			FreeStore(substance, substanceShared);
+			substanceShared = 0;
+			substance = compressed;
+			substanceCompressed = true;
+		} else {
+			delete compressed;
+		}
+	}
+	// Text that stays as it is still gives back its gap, unless snapshots are reading it
+	if (!substanceCompressed && !substanceShared)
+		substance->Shrink();
+	// Styles are recreated by styling again once awake
+	const Sci_Position length = style->Length();
+	FreeStore(style, styleShared);
+	styleShared = 0;
+	style = new CellStoreRuns();
+	style->InsertValue(0, length, 0);
+	styleRuns = true;
+	lv.Shrink();
+}
+
+void CellBuffer::Rehydrate() {
+	if (!hibernating)
+		return;
+	hibernating = false;
+	if (substanceCompressed) {
+		CellStoreCompressed *compressed = static_cast<CellStoreCompressed *>(substance);
+		substance = compressed->Expand();
+		delete compressed;
+		substanceCompressed = false;
+	}
+}
+
+size_t CellBuffer::StyleMemory() const {
+	return style->Memory();
+}
+
+size_t CellBuffer::LineIndexMemory() const {
+	return lv.Memory();
+}
+
+int CellBuffer::UndoActions() const {
+	return uh.Actions();
+}
+
 bool CellBuffer::CanUndo() {
 	return uh.CanUndo();
 }
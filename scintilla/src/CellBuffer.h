@@ -8,6 +8,8 @@
 #ifndef CELLBUFFER_H
 #define CELLBUFFER_H
 
+class SharedMemory;
+
 #ifdef SCI_NAMESPACE
 namespace Scintilla {
 #endif
@@ -18,7 +20,32 @@ public:
 	virtual ~PerLine() {}
 	virtual void Init()=0;
 	virtual void InsertLine(int)=0;
+	virtual void InsertLines(int line, int lines)=0;
 	virtual void RemoveLine(int)=0;
+	/// Bytes allocated for the data of all the lines.
+	virtual size_t Memory() const=0;
+	/// Release space allocated for more lines than there are.
+	virtual void Shrink()=0;
+};
+
+/**
+ * The starts of the lines of a document. Implemented by a Partitioning or, for documents
+ * edited at many distant lines, by a PartitionTree.
+ */
+class LineStarts {
+public:
+	virtual ~LineStarts() {}
+	virtual int Partitions() const=0;
+	virtual void InsertPartition(int partition, Sci_Position pos)=0;
+	virtual void InsertPartitions(int partition, const Sci_Position *positions, int count)=0;
+	virtual void SetPartitionStartPosition(int partition, Sci_Position pos)=0;
+	virtual void InsertText(int partitionInsert, Sci_Position delta)=0;
+	virtual void RemovePartition(int partition)=0;
+	virtual Sci_Position PositionFromPartition(int partition) const=0;
+	virtual int PartitionFromPosition(Sci_Position pos) const=0;
+	virtual void DeleteAll()=0;
+	virtual size_t Memory() const=0;
+	virtual void Shrink()=0;
 };
 
 /**
@@ -26,26 +53,35 @@ public:
  */
 class LineVector {
 
-	Partitioning starts;
+	LineStarts *starts;
 	PerLine *perLine;
 
+	// Private so LineVector objects can not be copied
+	LineVector(const LineVector &);
+	LineVector &operator=(const LineVector &);
+
 public:
 
-	LineVector();
+	/// documentOptions is a combination of SC_DOCUMENTOPTION_* values.
+	explicit LineVector(int documentOptions=0);
 	~LineVector();
 	void Init();
 	void SetPerLine(PerLine *pl);
 
-	void InsertText(int line, int delta);
-	void InsertLine(int line, int position, bool lineStart);
-	void SetLineStart(int line, int position);
-	void RemoveLine(int line);
+	void InsertText(int line, Sci_Position delta);
+	void InsertLine(int line, Sci_Position position, bool lineStart);
+	void InsertLines(int line, const Sci_Position *positions, int count, bool lineStart);
+	void SetLineStart(int line, Sci_Position position);
+	void RemoveLine(int line, bool lineStart);
+	size_t Memory() const;
+	/// Release space allocated for more lines than there are.
+	void Shrink();
 	int Lines() const {
-		return starts.Partitions();
+		return starts->Partitions();
 	}
-	int LineFromPosition(int pos) const;
-	int LineStart(int line) const {
-		return starts.PositionFromPartition(line);
+	int LineFromPosition(Sci_Position pos) const;
+	Sci_Position LineStart(int line) const {
+		return starts->PositionFromPartition(line);
 	}
 
 	int MarkValue(int line);
@@ -73,18 +109,43 @@ enum actionType { insertAction, removeAction, startAction, containerAction };
 class Action {
 public:
 	actionType at;
-	int position;
-	char *data;
-	int lenData;
+	Sci_Position position;
+	char *data;	///< Owned by the UndoArena of the history
+	Sci_Position lenData;
 	bool mayCoalesce;
 
 	Action();
-	~Action();
-	void Create(actionType at_, int position_=0, char *data_=0, int lenData_=0, bool mayCoalesce_=true);
-	void Destroy();
+	void Create(actionType at_, Sci_Position position_=0, char *data_=0, Sci_Position lenData_=0, bool mayCoalesce_=true);
 	void Grab(Action *source);
 };
 
+/**
+ * Holds the text of undo actions in large blocks instead of an allocation for each action.
+ * Text is released in any order and a block is freed when none of its text is still used.
+ */
+class UndoArena {
+	struct Block {
+		size_t size;
+		size_t used;
+		int live;
+	};
+	Block *current;
+	size_t memory;
+	static char *BlockData(Block *block) { return reinterpret_cast<char *>(block + 1); }
+	void FreeBlock(Block *block);
+
+	// Private so UndoArena objects can not be copied
+	UndoArena(const UndoArena &);
+	UndoArena &operator=(const UndoArena &);
+public:
+	UndoArena();
+	~UndoArena();
+	char *Allocate(Sci_Position length);
+	void Release(char *data);
+	/// Bytes held in blocks, including space not yet used.
+	size_t Memory() const { return memory; }
+};
+
 /**
  *
  */
@@ -95,14 +156,25 @@ class UndoHistory {
 	int currentAction;
 	int undoSequenceDepth;
 	int savePoint;
+	UndoArena arena;
+	/// Length of the text of all the actions
+	Sci_Position lengthText;
+	/// When the actions and their text use more than this the oldest undo sequences
+	/// are dropped, 0 for no limit
+	Sci_Position memoryLimit;
 
 	void EnsureUndoRoom();
+	void CreateAction(int act, actionType at, Sci_Position position=0, Sci_Position lengthData=0, bool mayCoalesce=true);
+	void SetMaxAction(int act);
+	void DropOldest();
 
 public:
 	UndoHistory();
 	~UndoHistory();
 
-	void AppendAction(actionType at, int position, char *data, int length, bool &startSequence, bool mayCoalesce=true);
+	/// Records an action with a copy of data. When data is NULL, the space is returned
+	/// for the caller to fill. @return the text of the action which is owned by the history.
+	char *AppendAction(actionType at, Sci_Position position, const char *data, Sci_Position length, bool &startSequence, bool mayCoalesce=true);
 
 	void BeginUndoAction();
 	void EndUndoAction();
@@ -124,6 +196,79 @@ public:
 	int StartRedo();
 	const Action &GetRedoStep() const;
 	void CompletedRedoStep();
+
+	void SetMemoryLimit(Sci_Position limit);
+	Sci_Position MemoryLimit() const { return memoryLimit; }
+	/// Bytes used by the actions and their text.
+	size_t Memory() const;
+	/// Number of insertion, removal and container actions that can be undone or redone.
+	int Actions() const;
+};
+
+/**
+ * Storage for the characters or the styles of a document. Implemented by a gap
+ * buffer or, for documents edited at many distant positions, by a chunked store.
+ */
+class CellStore {
+public:
+	virtual ~CellStore() {}
+	virtual Sci_Position Length() const=0;
+	virtual char ValueAt(Sci_Position position) const=0;
+	virtual void SetValueAt(Sci_Position position, char v)=0;
+	virtual void GetRange(char *buffer, Sci_Position position, Sci_Position retrieveLength) const=0;
+	virtual void InsertFromArray(Sci_Position positionToInsert, const char s[], Sci_Position positionFrom, Sci_Position insertLength)=0;
+	virtual void InsertValue(Sci_Position position, Sci_Position insertLength, char v)=0;
+	/// Insert text that may be referenced rather than copied. A reference to owner is held
+	/// while the text is referenced, so it must outlive the store and any copies from Share.
+	virtual void InsertView(Sci_Position position, const char *s, Sci_Position insertLength, SharedMemory *owner)=0;
+	virtual void DeleteRange(Sci_Position position, Sci_Position deleteLength)=0;
+	virtual void ReAllocate(Sci_Position newSize)=0;
+	virtual char *BufferPointer()=0;
+	/// Contiguous elements from position up to a gap or chunk boundary, without moving anything.
+	virtual const char *SegmentAt(Sci_Position position, Sci_Position &lengthSegment) const=0;
+	/// A store with the same contents, which may be read from any thread, that later
+	/// changes to this store do not affect. 0 when memory can not be shared cheaply.
+	virtual CellStore *Share()=0;
+	/// A copy of the contents in a new store of the same kind.
+	virtual CellStore *Copy() const=0;
+	/// Bytes allocated, not counting memory viewed from elsewhere such as a mapped file.
+	virtual size_t Memory() const=0;
+	/// Bytes allocated but not holding contents, such as a gap.
+	virtual size_t Unused() const=0;
+	/// Release what Unused counts.
+	virtual void Shrink()=0;
+};
+
+/**
+ * The text and styles of a CellBuffer at one moment, not affected by later changes to
+ * the buffer. Only const methods are called on its stores so it may be read by several
+ * threads while the buffer is edited.
+ */
+class CellSnapshot {
+	const CellStore *substance;
+	const CellStore *style;
+	/// Keep the stores alive while the buffer or other snapshots also read them
+	SharedMemory *substanceOwner;
+	SharedMemory *styleOwner;
+	int version;
+	// Private so CellSnapshot objects can not be copied
+	CellSnapshot(const CellSnapshot &);
+	CellSnapshot &operator=(const CellSnapshot &);
+public:
+	/// The snapshot takes over one reference to each owner.
+	CellSnapshot(const CellStore *substance_, SharedMemory *substanceOwner_,
+		const CellStore *style_, SharedMemory *styleOwner_, int version_);
+	~CellSnapshot();
+
+	Sci_Position Length() const;
+	/// The TextVersion of the buffer when the snapshot was taken.
+	int Version() const { return version; }
+	char CharAt(Sci_Position position) const;
+	void GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const;
+	char StyleAt(Sci_Position position) const;
+	void GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const;
+	/// Segments stay valid for the life of the snapshot.
+	const char *TextSegment(Sci_Position position, Sci_Position &lengthSegment) const;
 };
 
 /**
@@ -133,8 +278,24 @@ public:
  */
 class CellBuffer {
 private:
-	SplitVector<char> substance;
-	SplitVector<char> style;
+	int documentOptions;
+	CellStore *substance;
+	CellStore *style;
+	/// Whether style is a CellStoreRuns
+	bool styleRuns;
+	/// Set while substance or style is frozen and shared with snapshots, which means
+	/// the store is copied before it is changed
+	SharedMemory *substanceShared;
+	SharedMemory *styleShared;
+	/// Keeps a mapped file, viewed by substance and snapshots, open
+	SharedMemory *mapping;
+	/// Whether substance is a CellStoreCompressed
+	bool substanceCompressed;
+	bool hibernating;
+	/// Length of the end of the text where lines have not yet been found
+	Sci_Position lengthUnindexed;
+	/// Changed whenever text is modified or moved so that segments become stale
+	int version;
 	bool readOnly;
 
 	bool collectingUndo;
@@ -143,37 +304,59 @@ private:
 	LineVector lv;
 
 	/// Actions without undo
-	void BasicInsertString(int position, const char *s, int insertLength);
-	void BasicDeleteChars(int position, int deleteLength);
+	void BasicInsertString(Sci_Position position, const char *s, Sci_Position insertLength);
+	void BasicDeleteChars(Sci_Position position, Sci_Position deleteLength);
+	/// Change style from runs to a byte for each character when that is smaller
+	void CheckStyleRuns();
 
 public:
 
-	CellBuffer();
+	/// documentOptions is a combination of SC_DOCUMENTOPTION_* values.
+	explicit CellBuffer(int documentOptions_=0);
 	~CellBuffer();
 
+	int DocumentOptions() const { return documentOptions; }
+
 	/// Retrieving positions outside the range of the buffer works and returns 0
-	char CharAt(int position) const;
-	void GetCharRange(char *buffer, int position, int lengthRetrieve) const;
-	char StyleAt(int position) const;
-	void GetStyleRange(unsigned char *buffer, int position, int lengthRetrieve) const;
+	char CharAt(Sci_Position position) const;
+	void GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const;
+	char StyleAt(Sci_Position position) const;
+	void GetStyleRange(unsigned char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const;
 	const char *BufferPointer();
-
-	int Length() const;
-	void Allocate(int newSize);
+	const char *TextSegment(Sci_Position position, Sci_Position &lengthSegment) const;
+	int TextVersion() const;
+	/// Freeze the current text and styles. Chunked stores share their chunks, copying a
+	/// chunk when it is next modified, while other stores are copied whole by the next
+	/// modification if a snapshot still uses them. Without styles, the snapshot's styles
+	/// are all 0 and styling does not copy the style store. Delete the snapshot when finished.
+	CellSnapshot *CreateSnapshot(bool withStyles=true);
+
+	Sci_Position Length() const;
+	void Allocate(Sci_Position newSize);
 	void SetPerLine(PerLine *pl);
 	int Lines() const;
-	int LineStart(int line) const;
-	int LineFromPosition(int pos) const { return lv.LineFromPosition(pos); }
-	void InsertLine(int line, int position, bool lineStart);
-	void RemoveLine(int line);
-	const char *InsertString(int position, const char *s, int insertLength, bool &startSequence);
+	Sci_Position LineStart(int line) const;
+	int LineFromPosition(Sci_Position pos) const { return lv.LineFromPosition(pos); }
+	void InsertLine(int line, Sci_Position position, bool lineStart);
+	void RemoveLine(int line, bool lineStart);
+	const char *InsertString(Sci_Position position, const char *s, Sci_Position insertLength, bool &startSequence);
 
 	/// Setting styles for positions outside the range of the buffer is safe and has no effect.
 	/// @return true if the style of a character is changed.
-	bool SetStyleAt(int position, char styleValue, char mask='\377');
-	bool SetStyleFor(int position, int length, char styleValue, char mask);
+	bool SetStyleAt(Sci_Position position, char styleValue, char mask='\377');
+	bool SetStyleFor(Sci_Position position, Sci_Position length, char styleValue, char mask);
+
+	const char *DeleteChars(Sci_Position position, Sci_Position deleteLength, bool &startSequence);
 
-	const char *DeleteChars(int position, int deleteLength, bool &startSequence);
+	/// Make the contents of a mapped file the text of an empty buffer without copying it.
+	/// The buffer owns the mapping from then on. Lines are found by IndexLines.
+	bool SetMappedFile(MappedFile *mappedFile_);
+	/// Add text to the end without finding its lines, for loading before IndexLines finds them all at once.
+	void AppendWithoutLines(const char *s, Sci_Position insertLength);
+	/// Lines have been found up to IndexedTo and the rest of the text is part of the last line.
+	Sci_Position IndexedTo() const { return Length() - lengthUnindexed; }
+	/// Find lines at least up to upTo, ending at a line start. @return the number of lines added.
+	int IndexLines(Sci_Position upTo);
 
 	bool IsReadOnly() const;
 	void SetReadOnly(bool set);
@@ -189,6 +372,25 @@ public:
 	void EndUndoAction();
 	void AddUndoAction(int token, bool mayCoalesce);
 	void DeleteUndoHistory();
+	/// Drop the oldest undo sequences, other than the current one, when the undo actions
+	/// and their text use more than limit bytes.
+	void SetUndoMemoryLimit(Sci_Position limit);
+	Sci_Position UndoMemoryLimit() const;
+	size_t UndoMemory() const;
+	/// Bytes allocated for the text and how many of those are not used.
+	size_t TextMemory(size_t &unused) const;
+	size_t StyleMemory() const;
+	size_t LineIndexMemory() const;
+
+	/// Release as much memory as possible from a buffer that is not expected to be used
+	/// for a while. The text is compressed, styles are discarded and spare space after the
+	/// line index is released. Reading the text still works while hibernating, expanding
+	/// the blocks read each time without keeping them, and changes rehydrate first.
+	void Hibernate();
+	/// Expand the text into a store again. Styles stay discarded so must be restyled.
+	void Rehydrate();
+	bool IsHibernating() const { return hibernating; }
+	int UndoActions() const;
 
 	/// To perform an undo, StartUndo is called to retrieve the number of steps, then UndoStep is
 	/// called that many times. Similarly for redo.
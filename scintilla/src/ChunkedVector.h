@@ -0,0 +1,518 @@
+// Scintilla source code edit control
+/** @file ChunkedVector.h
+ ** Array held as a sequence of bounded chunks so that insertions and
+ ** deletions far apart in a large array stay cheap.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef CHUNKEDVECTOR_H
+#define CHUNKEDVECTOR_H
+
+/**
+ * The elements of a SplitVector frozen so that ChunkedVectors can share them as views.
+ */
+template <typename T>
+class SharedArray : public SharedMemory {
+	SplitVector<T> *body;
+	const T *data;
+public:
+	/// Takes ownership of body, moving its gap to the end so the elements are contiguous.
+	explicit SharedArray(SplitVector<T> *body_) : body(body_), data(body_->BufferPointer()) {
+	}
+	virtual ~SharedArray() {
+		delete body;
+	}
+	const T *Data() const {
+		return data;
+	}
+};
+
+/**
+ * A rope of small SplitVectors. A Partitioning maps positions onto chunks so
+ * finding a position is a binary search and an edit only moves the elements
+ * of one chunk rather than everything between the old and new gap position.
+ * A chunk may instead be a read-only view of memory owned by someone else, such
+ * as a mapped file, which is copied into a SplitVector when first modified.
+ * Views may hold a reference to a SharedMemory that keeps their memory alive, which
+ * is how Share gives copies that are not affected by later changes to either vector.
+ * Provides the same operations as SplitVector.
+ */
+template <typename T>
+class ChunkedVector {
+protected:
+	SplitVector<SplitVector<T> *> chunks;	/// NULL for chunks that are views
+	SplitVector<const T *> views;	/// Start of the viewed memory or NULL for owned chunks
+	SplitVector<SharedMemory *> owners;	/// Holds the viewed memory alive or NULL
+	Partitioning starts;	/// Partition i covers the elements of chunk i
+	Sci_Position chunkSize;	/// Target size for chunks, they may grow to twice this
+	mutable int chunkLast;	/// Chunk found by the previous lookup, checked first
+	bool lookupCache;	/// False when several threads may read at once so chunkLast is not used
+	SharedArray<T> *zeros;	/// chunkSize zero elements shared by views of zero filled ranges
+
+	int Chunks() const {
+		return starts.Partitions();
+	}
+
+	Sci_Position ChunkStart(int chunk) const {
+		return starts.PositionFromPartition(chunk);
+	}
+
+	Sci_Position ChunkLength(int chunk) const {
+		return starts.PositionFromPartition(chunk + 1) - starts.PositionFromPartition(chunk);
+	}
+
+	int ChunkFromPosition(Sci_Position position) const {
+		if (!lookupCache)
+			return starts.PartitionFromPosition(position);
+		if ((chunkLast < Chunks()) &&
+			(position >= ChunkStart(chunkLast)) && (position < ChunkStart(chunkLast + 1)))
+			return chunkLast;
+		chunkLast = starts.PartitionFromPosition(position);
+		return chunkLast;
+	}
+
+	/// Insert a new empty chunk starting at position.
+	void InsertChunk(int chunk, Sci_Position position) {
+		chunks.Insert(chunk, new SplitVector<T>());
+		views.Insert(chunk, NULL);
+		owners.Insert(chunk, NULL);
+		starts.InsertPartition(chunk, position);
+	}
+
+	/// Insert a chunk that views insertLength elements of data starting at position.
+	/// A reference to owner, when there is one, is held until the chunk stops viewing data.
+	void InsertViewChunk(int chunk, Sci_Position position, const T *data, Sci_Position insertLength,
+		SharedMemory *owner) {
+		chunks.Insert(chunk, NULL);
+		views.Insert(chunk, data);
+		owners.Insert(chunk, owner);
+		if (owner)
+			owner->AddRef();
+		starts.InsertPartition(chunk, position);
+		starts.InsertText(chunk, insertLength);
+	}
+
+	void ReleaseOwner(int chunk) {
+		SharedMemory *owner = owners.ValueAt(chunk);
+		if (owner) {
+			owners.SetValueAt(chunk, NULL);
+			owner->Release();
+		}
+	}
+
+	void ReleaseOwners() {
+		for (int chunk = 0; chunk < owners.Length(); chunk++)
+			ReleaseOwner(chunk);
+	}
+
+	/// Remove a chunk that has become empty.
+	void RemoveChunk(int chunk) {
+		PLATFORM_ASSERT(ChunkLength(chunk) == 0);
+		delete chunks.ValueAt(chunk);
+		ReleaseOwner(chunk);
+		chunks.Delete(chunk);
+		views.Delete(chunk);
+		owners.Delete(chunk);
+		starts.RemovePartition((chunk > 0) ? chunk : 1);
+	}
+
+	/// Copy a view chunk into a SplitVector so it can be modified.
+	SplitVector<T> *Materialize(int chunk) {
+		const T *view = views.ValueAt(chunk);
+		if (view) {
+			const Sci_Position lengthChunk = ChunkLength(chunk);
+			SplitVector<T> *pv = new SplitVector<T>();
+			pv->ReAllocate(lengthChunk + 1);
+			pv->InsertFromArray(0, view, 0, lengthChunk);
+			chunks.SetValueAt(chunk, pv);
+			views.SetValueAt(chunk, NULL);
+			ReleaseOwner(chunk);
+		}
+		return chunks.ValueAt(chunk);
+	}
+
+	/// Move the elements of a chunk from offset onwards into a new chunk that follows it.
+	void SplitChunk(int chunk, Sci_Position offset) {
+		const T *view = views.ValueAt(chunk);
+		const Sci_Position lengthTail = ChunkLength(chunk) - offset;
+		if (view) {
+			// Both parts stay views of the same memory
+			starts.InsertText(chunk, -lengthTail);
+			InsertViewChunk(chunk + 1, ChunkStart(chunk) + offset, view + offset, lengthTail,
+				owners.ValueAt(chunk));
+			return;
+		}
+		SplitVector<T> *head = chunks.ValueAt(chunk);
+		InsertChunk(chunk + 1, ChunkStart(chunk) + offset);
+		SplitVector<T> *tail = chunks.ValueAt(chunk + 1);
+		tail->ReAllocate(lengthTail + 1);
+		tail->InsertFromArray(0, head->BufferPointer(), offset, lengthTail);
+		head->DeleteRange(offset, lengthTail);
+	}
+
+	/// Append the following chunk onto a chunk and remove the following chunk.
+	void JoinChunks(int chunk) {
+		SplitVector<T> *pv = Materialize(chunk);
+		const Sci_Position lengthNext = ChunkLength(chunk + 1);
+		const T *view = views.ValueAt(chunk + 1);
+		SplitVector<T> *next = chunks.ValueAt(chunk + 1);
+		pv->InsertFromArray(pv->Length(), view ? view : next->BufferPointer(), 0, lengthNext);
+		delete next;
+		ReleaseOwner(chunk + 1);
+		chunks.Delete(chunk + 1);
+		views.Delete(chunk + 1);
+		owners.Delete(chunk + 1);
+		starts.RemovePartition(chunk + 1);
+	}
+
+	/// Insert views of insertLength elements at position in chunks of up to chunkSize.
+	/// When repeat is true every chunk views the same chunkSize elements of data.
+	void InsertViews(Sci_Position position, const T *data, Sci_Position insertLength, bool repeat,
+		SharedMemory *owner) {
+		PLATFORM_ASSERT((position >= 0) && (position <= Length()));
+		if ((insertLength <= 0) || (position < 0) || (position > Length())) {
+			return;
+		}
+		int chunk = ChunkFromPosition(position);
+		const Sci_Position offset = position - ChunkStart(chunk);
+		// An empty vector has a single empty chunk which is replaced
+		const bool replaceEmpty = ChunkLength(chunk) == 0;
+		if (offset > 0) {
+			if (offset < ChunkLength(chunk))
+				SplitChunk(chunk, offset);
+			chunk++;
+		}
+		Sci_Position inserted = 0;
+		while (inserted < insertLength) {
+			Sci_Position lengthPiece = insertLength - inserted;
+			if (lengthPiece > chunkSize)
+				lengthPiece = chunkSize;
+			InsertViewChunk(chunk, position + inserted, repeat ? data : data + inserted, lengthPiece, owner);
+			inserted += lengthPiece;
+			chunk++;
+		}
+		if (replaceEmpty)
+			RemoveChunk(chunk);
+	}
+
+	/// Break up a chunk that is far larger than chunkSize, as happens after
+	/// BufferPointer joins all the chunks, so that later edits are cheap again.
+	void Fragment(int chunk) {
+		while (ChunkLength(chunk) > chunkSize * 2) {
+			SplitChunk(chunk, ChunkLength(chunk) - chunkSize);
+		}
+	}
+
+	/// Merge a small chunk with a neighbour when they fit together in one chunk.
+	void Coalesce(int chunk) {
+		if ((chunk + 1 < Chunks()) && (ChunkLength(chunk) + ChunkLength(chunk + 1) <= chunkSize)) {
+			JoinChunks(chunk);
+		} else if ((chunk > 0) && (ChunkLength(chunk - 1) + ChunkLength(chunk) <= chunkSize)) {
+			JoinChunks(chunk - 1);
+		}
+	}
+
+	/// Add elements to one chunk. Elements are copied from s or, when s is
+	/// NULL, set to v.
+	void AddToChunk(int chunk, Sci_Position offset, const T *s, Sci_Position positionFrom,
+		Sci_Position insertLength, T v) {
+		SplitVector<T> *pv = Materialize(chunk);
+		if (s)
+			pv->InsertFromArray(offset, s, positionFrom, insertLength);
+		else
+			pv->InsertValue(offset, insertLength, v);
+		starts.InsertText(chunk, insertLength);
+	}
+
+	void InsertElements(Sci_Position position, const T *s, Sci_Position positionFrom,
+		Sci_Position insertLength, T v) {
+		PLATFORM_ASSERT((position >= 0) && (position <= Length()));
+		if ((insertLength <= 0) || (position < 0) || (position > Length())) {
+			return;
+		}
+		int chunk = ChunkFromPosition(position);
+		if (ChunkLength(chunk) > chunkSize * 2) {
+			Fragment(chunk);
+			chunk = ChunkFromPosition(position);
+		}
+		Sci_Position offset = position - ChunkStart(chunk);
+		if (ChunkLength(chunk) + insertLength <= chunkSize * 2) {
+			AddToChunk(chunk, offset, s, positionFrom, insertLength, v);
+			return;
+		}
+		// Too much for this chunk so divide it at position and place the new
+		// elements after the first part in chunks of chunkSize.
+		if ((offset > 0) && (offset < ChunkLength(chunk)))
+			SplitChunk(chunk, offset);
+		Sci_Position inserted = 0;
+		int chunkInsert = chunk;
+		if ((offset > 0) || (ChunkLength(chunk) == 0)) {
+			Sci_Position room = chunkSize - offset;
+			if (room > insertLength)
+				room = insertLength;
+			if (room > 0) {
+				AddToChunk(chunk, offset, s, positionFrom, room, v);
+				inserted = room;
+			}
+			chunkInsert = chunk + 1;
+		}
+		while (inserted < insertLength) {
+			Sci_Position lengthPiece = insertLength - inserted;
+			if (lengthPiece > chunkSize)
+				lengthPiece = chunkSize;
+			InsertChunk(chunkInsert, position + inserted);
+			chunks.ValueAt(chunkInsert)->ReAllocate(lengthPiece + 1);
+			AddToChunk(chunkInsert, 0, s, positionFrom + inserted, lengthPiece, v);
+			inserted += lengthPiece;
+			chunkInsert++;
+		}
+	}
+
+	void Init() {
+		chunkLast = 0;
+		chunks.Insert(0, new SplitVector<T>());
+		views.Insert(0, NULL);
+		owners.Insert(0, NULL);
+	}
+
+public:
+	/// Construct a chunked buffer.
+	explicit ChunkedVector(Sci_Position chunkSize_=0x10000) :
+		starts(8), chunkSize(chunkSize_), lookupCache(true), zeros(0) {
+		Init();
+	}
+
+	~ChunkedVector() {
+		for (int chunk = 0; chunk < chunks.Length(); chunk++)
+			delete chunks.ValueAt(chunk);
+		ReleaseOwners();
+		if (zeros)
+			zeros->Release();
+	}
+
+	/// Chunks are allocated as needed so only the chunk lists are sized here.
+	void ReAllocate(Sci_Position newSize) {
+		chunks.ReAllocate(newSize / chunkSize + 2);
+		views.ReAllocate(newSize / chunkSize + 2);
+		owners.ReAllocate(newSize / chunkSize + 2);
+	}
+
+	/// Retrieve the element at a particular position.
+	/// Retrieving positions outside the range of the buffer returns 0.
+	T ValueAt(Sci_Position position) const {
+		if ((position < 0) || (position >= Length()))
+			return 0;
+		const int chunk = ChunkFromPosition(position);
+		const T *view = views.ValueAt(chunk);
+		if (view)
+			return view[position - ChunkStart(chunk)];
+		return chunks.ValueAt(chunk)->ValueAt(position - ChunkStart(chunk));
+	}
+
+	void SetValueAt(Sci_Position position, T v) {
+		PLATFORM_ASSERT((position >= 0) && (position < Length()));
+		if ((position < 0) || (position >= Length()))
+			return;
+		const int chunk = ChunkFromPosition(position);
+		Materialize(chunk)->SetValueAt(position - ChunkStart(chunk), v);
+	}
+
+	/// Retrieve the length of the buffer.
+	Sci_Position Length() const {
+		return starts.PositionFromPartition(Chunks());
+	}
+
+	/// Bytes allocated for owned chunks and the chunk lists. Viewed memory, such as
+	/// a mapped file or chunks shared with snapshots, is not counted.
+	size_t Memory() const {
+		size_t memory = chunks.Memory() + views.Memory() + owners.Memory() + starts.Memory();
+		for (int chunk = 0; chunk < Chunks(); chunk++) {
+			if (!views.ValueAt(chunk))
+				memory += chunks.ValueAt(chunk)->Memory();
+		}
+		return memory;
+	}
+
+	/// Bytes allocated for owned chunks but not used, which is their gaps.
+	size_t Unused() const {
+		size_t unused = 0;
+		for (int chunk = 0; chunk < Chunks(); chunk++) {
+			if (!views.ValueAt(chunk))
+				unused += chunks.ValueAt(chunk)->Unused();
+		}
+		return unused;
+	}
+
+	/// Release the gaps of owned chunks and the space for more chunks than there are.
+	void Shrink() {
+		for (int chunk = 0; chunk < Chunks(); chunk++) {
+			if (!views.ValueAt(chunk))
+				chunks.ValueAt(chunk)->Shrink();
+		}
+		chunks.Shrink();
+		views.Shrink();
+		owners.Shrink();
+		starts.Shrink();
+	}
+
+	/// Insert a number of elements into the buffer setting their value.
+	/// Inserting at positions outside the current range fails.
+	/// Large zero filled ranges share one block of memory until modified.
+	void InsertValue(Sci_Position position, Sci_Position insertLength, T v) {
+		if ((v == 0) && (insertLength > chunkSize * 2)) {
+			if (!zeros) {
+				SplitVector<T> *block = new SplitVector<T>();
+				block->InsertValue(0, chunkSize, 0);
+				zeros = new SharedArray<T>(block);
+			}
+			InsertViews(position, zeros->Data(), insertLength, true, zeros);
+		} else {
+			InsertElements(position, NULL, 0, insertLength, v);
+		}
+	}
+
+	/// Insert text into the buffer from an array.
+	void InsertFromArray(Sci_Position positionToInsert, const T s[], Sci_Position positionFrom, Sci_Position insertLength) {
+		InsertElements(positionToInsert, s, positionFrom, insertLength, 0);
+	}
+
+	/// Insert elements that are read from data without copying. The memory must
+	/// not change or be freed while this buffer, or a copy made by Share, exists.
+	/// Otherwise an owner can be given that is referenced for as long as data is viewed.
+	void InsertView(Sci_Position position, const T *data, Sci_Position insertLength,
+		SharedMemory *owner=0) {
+		InsertViews(position, data, insertLength, false, owner);
+	}
+
+	/// Delete a range from the buffer.
+	/// Deleting positions outside the current range fails.
+	void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
+		PLATFORM_ASSERT((position >= 0) && (position + deleteLength <= Length()));
+		if ((position < 0) || ((position + deleteLength) > Length())) {
+			return;
+		}
+		if ((position == 0) && (deleteLength == Length())) {
+			DeleteAll();
+			return;
+		}
+		while (deleteLength > 0) {
+			int chunk = ChunkFromPosition(position);
+			const Sci_Position offset = position - ChunkStart(chunk);
+			const Sci_Position lengthChunk = ChunkLength(chunk);
+			Sci_Position lengthDelete = lengthChunk - offset;
+			if (lengthDelete > deleteLength)
+				lengthDelete = deleteLength;
+			if (lengthDelete == lengthChunk) {
+				starts.InsertText(chunk, -lengthDelete);
+				RemoveChunk(chunk);
+			} else if (lengthChunk > chunkSize * 2) {
+				Fragment(chunk);
+				continue;
+			} else {
+				Materialize(chunk)->DeleteRange(offset, lengthDelete);
+				starts.InsertText(chunk, -lengthDelete);
+				if (ChunkLength(chunk) < chunkSize / 4)
+					Coalesce(chunk);
+			}
+			deleteLength -= lengthDelete;
+		}
+	}
+
+	/// Delete all the buffer contents.
+	void DeleteAll() {
+		for (int chunk = 0; chunk < chunks.Length(); chunk++)
+			delete chunks.ValueAt(chunk);
+		ReleaseOwners();
+		chunks.DeleteAll();
+		views.DeleteAll();
+		owners.DeleteAll();
+		starts.DeleteAll();
+		Init();
+	}
+
+	/// Retrieve a range of elements into an array
+	void GetRange(T *buffer, Sci_Position position, Sci_Position retrieveLength) const {
+		while (retrieveLength > 0) {
+			const int chunk = ChunkFromPosition(position);
+			const Sci_Position offset = position - ChunkStart(chunk);
+			Sci_Position lengthPart = ChunkLength(chunk) - offset;
+			if (lengthPart > retrieveLength)
+				lengthPart = retrieveLength;
+			if (lengthPart <= 0)
+				break;
+			const T *view = views.ValueAt(chunk);
+			if (view)
+				memcpy(buffer, view + offset, lengthPart * sizeof(T));
+			else
+				chunks.ValueAt(chunk)->GetRange(buffer, offset, lengthPart);
+			buffer += lengthPart;
+			position += lengthPart;
+			retrieveLength -= lengthPart;
+		}
+	}
+
+	/// Retrieve the contiguous elements starting at position without joining chunks.
+	/// lengthSegment is set to how many elements follow position within its segment.
+	const T *SegmentAt(Sci_Position position, Sci_Position &lengthSegment) const {
+		lengthSegment = 0;
+		if ((position < 0) || (position >= Length()))
+			return 0;
+		const int chunk = ChunkFromPosition(position);
+		const Sci_Position offset = position - ChunkStart(chunk);
+		const T *view = views.ValueAt(chunk);
+		if (view) {
+			lengthSegment = ChunkLength(chunk) - offset;
+			return view + offset;
+		}
+		return chunks.ValueAt(chunk)->SegmentAt(offset, lengthSegment);
+	}
+
+	/// Join all the chunks into one so the whole buffer is contiguous.
+	/// The next edit breaks the buffer up into chunks again.
+	T *BufferPointer() {
+		if (Chunks() > 1) {
+			const Sci_Position lengthAll = Length();
+			SplitVector<T> *all = new SplitVector<T>();
+			all->ReAllocate(lengthAll + 1);
+			for (int chunk = 0; chunk < chunks.Length(); chunk++) {
+				const T *view = views.ValueAt(chunk);
+				SplitVector<T> *pv = chunks.ValueAt(chunk);
+				all->InsertFromArray(all->Length(), view ? view : pv->BufferPointer(), 0, ChunkLength(chunk));
+				delete pv;
+			}
+			ReleaseOwners();
+			chunks.DeleteAll();
+			views.DeleteAll();
+			owners.DeleteAll();
+			chunks.Insert(0, all);
+			views.Insert(0, NULL);
+			owners.Insert(0, NULL);
+			starts.DeleteAll();
+			starts.InsertText(0, lengthAll);
+			chunkLast = 0;
+		}
+		return Materialize(0)->BufferPointer();
+	}
+
+	/// Make copy, which must be empty, hold the same elements without copying them.
+	/// Chunks owned by this vector are frozen into SharedArrays that both vectors then
+	/// view so that later changes to either are not seen by the other. A chunk is only
+	/// copied again when it is next modified. The copy may be read by several threads.
+	void Share(ChunkedVector<T> &copy) {
+		PLATFORM_ASSERT(copy.Length() == 0);
+		copy.lookupCache = false;
+		for (int chunk = 0; chunk < Chunks(); chunk++) {
+			SplitVector<T> *pv = chunks.ValueAt(chunk);
+			if (pv) {
+				// The new array starts with one reference which is held by this chunk
+				SharedArray<T> *frozen = new SharedArray<T>(pv);
+				chunks.SetValueAt(chunk, NULL);
+				views.SetValueAt(chunk, frozen->Data());
+				owners.SetValueAt(chunk, frozen);
+			}
+			copy.InsertView(copy.Length(), views.ValueAt(chunk), ChunkLength(chunk), owners.ValueAt(chunk));
+		}
+	}
+};
+
+#endif
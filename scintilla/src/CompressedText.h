@@ -0,0 +1,180 @@
+// Scintilla source code edit control
+/** @file CompressedText.h
+ ** Holds text compressed in independent blocks.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef COMPRESSEDTEXT_H
+#define COMPRESSEDTEXT_H
+
+/**
+ * Text is compressed a block at a time with a simple LZ77 scheme. Each sequence is a
+ * token byte with the number of literal bytes, which follow it, in the high 4 bits and
+ * the length of a match less 4 in the low 4 bits, followed by a 2 byte offset back to the
+ * match. A 4 bit value of 15 continues in following bytes, each added until one is less
+ * than 255. The last sequence of a block has only literals. This compresses source code
+ * less than general purpose compressors but is quick enough in both directions to be
+ * unnoticed when a hibernating document is brought back.
+ */
+class CompressedText {
+public:
+	enum { blockSize = 0x10000 };
+private:
+	enum { minMatch = 4, hashBits = 12 };
+	SplitVector<char> data;
+	/// The end of each block in data
+	SplitVector<Sci_Position> blockEnds;
+	Sci_Position length;
+
+	static unsigned int Read32(const unsigned char *s) {
+		unsigned int value;
+		memcpy(&value, s, sizeof(value));
+		return value;
+	}
+
+	static unsigned int Hash(unsigned int sequence) {
+		return (sequence * 2654435761U) >> (32 - hashBits);
+	}
+
+	static unsigned char *WriteCount(unsigned char *out, Sci_Position count) {
+		while (count >= 255) {
+			*out++ = 255;
+			count -= 255;
+		}
+		*out++ = static_cast<unsigned char>(count);
+		return out;
+	}
+
+	static unsigned char *WriteSequence(unsigned char *out, const unsigned char *literals,
+		Sci_Position lengthLiterals, Sci_Position lengthMatch) {
+		const Sci_Position matchCount = (lengthMatch > 0) ? lengthMatch - minMatch : 0;
+		*out++ = static_cast<unsigned char>(((lengthLiterals < 15 ? lengthLiterals : 15) << 4) |
+			(matchCount < 15 ? matchCount : 15));
+		if (lengthLiterals >= 15)
+			out = WriteCount(out, lengthLiterals - 15);
+		memcpy(out, literals, lengthLiterals);
+		return out + lengthLiterals;
+	}
+
+	static const unsigned char *ReadCount(const unsigned char *in, Sci_Position &count) {
+		unsigned char more;
+		do {
+			more = *in++;
+			count += more;
+		} while (more == 255);
+		return in;
+	}
+
+	/// Compress lengthBlock bytes, at most blockSize, into out. @return the compressed length.
+	static Sci_Position CompressBlock(const unsigned char *s, Sci_Position lengthBlock, unsigned char *out) {
+		unsigned short table[1 << hashBits];
+		memset(table, 0, sizeof(table));
+		unsigned char *start = out;
+		Sci_Position anchor = 0;
+		Sci_Position i = 0;
+		while (i + minMatch <= lengthBlock) {
+			const unsigned int sequence = Read32(s + i);
+			const unsigned int hash = Hash(sequence);
+			const Sci_Position candidate = table[hash];
+			table[hash] = static_cast<unsigned short>(i);
+			if ((candidate < i) && (Read32(s + candidate) == sequence)) {
+				Sci_Position lengthMatch = minMatch;
+				while ((i + lengthMatch < lengthBlock) && (s[candidate + lengthMatch] == s[i + lengthMatch]))
+					lengthMatch++;
+				out = WriteSequence(out, s + anchor, i - anchor, lengthMatch);
+				const Sci_Position offset = i - candidate;
+				*out++ = static_cast<unsigned char>(offset & 0xFF);
+				*out++ = static_cast<unsigned char>(offset >> 8);
+				if (lengthMatch - minMatch >= 15)
+					out = WriteCount(out, lengthMatch - minMatch - 15);
+				i += lengthMatch;
+				anchor = i;
+			} else {
+				i++;
+			}
+		}
+		out = WriteSequence(out, s + anchor, lengthBlock - anchor, 0);
+		return out - start;
+	}
+
+	// Private so CompressedText objects can not be copied
+	CompressedText(const CompressedText &);
+	CompressedText &operator=(const CompressedText &);
+public:
+	CompressedText() : length(0) {
+	}
+
+	/// Add a block of at most blockSize bytes. Only the last block may be shorter.
+	void AppendBlock(const char *s, Sci_Position lengthBlock) {
+		PLATFORM_ASSERT((lengthBlock > 0) && (lengthBlock <= blockSize));
+		// Incompressible text grows by a byte for each 255 of literals and the token
+		const Sci_Position worst = lengthBlock + lengthBlock / 255 + 16;
+		const Sci_Position start = data.Length();
+		data.InsertValue(start, worst, 0);
+		const Sci_Position lengthCompressed = CompressBlock(reinterpret_cast<const unsigned char *>(s),
+			lengthBlock, reinterpret_cast<unsigned char *>(data.BufferPointer()) + start);
+		data.DeleteRange(start + lengthCompressed, worst - lengthCompressed);
+		blockEnds.Insert(blockEnds.Length(), start + lengthCompressed);
+		length += lengthBlock;
+	}
+
+	/// Release space allocated beyond the compressed data once all the blocks are added.
+	void Shrink() {
+		data.Shrink();
+		blockEnds.Shrink();
+	}
+
+	Sci_Position Length() const {
+		return length;
+	}
+
+	int Blocks() const {
+		return static_cast<int>(blockEnds.Length());
+	}
+
+	Sci_Position BlockLength(int block) const {
+		return (block < Blocks() - 1) ? blockSize : length - static_cast<Sci_Position>(block) * blockSize;
+	}
+
+	/// Expand a block into buffer which has room for BlockLength(block) bytes.
+	void ExpandBlock(int block, char *buffer) const {
+		const Sci_Position start = (block > 0) ? blockEnds.ValueAt(block - 1) : 0;
+		Sci_Position lengthSegment = 0;
+		const unsigned char *in = reinterpret_cast<const unsigned char *>(data.SegmentAt(start, lengthSegment));
+		unsigned char *out = reinterpret_cast<unsigned char *>(buffer);
+		unsigned char *end = out + BlockLength(block);
+		for (;;) {
+			const unsigned char token = *in++;
+			Sci_Position lengthLiterals = token >> 4;
+			if (lengthLiterals == 15)
+				in = ReadCount(in, lengthLiterals);
+			memcpy(out, in, lengthLiterals);
+			in += lengthLiterals;
+			out += lengthLiterals;
+			if (out >= end)
+				break;
+			const Sci_Position offset = in[0] | (in[1] << 8);
+			in += 2;
+			Sci_Position lengthMatch = token & 0xF;
+			if (lengthMatch == 15)
+				in = ReadCount(in, lengthMatch);
+			lengthMatch += minMatch;
+			const unsigned char *match = out - offset;
+			if (offset >= lengthMatch) {
+				memcpy(out, match, lengthMatch);
+				out += lengthMatch;
+			} else {
+				// Overlapping matches repeat the bytes just written
+				for (Sci_Position i = 0; i < lengthMatch; i++)
+					*out++ = *match++;
+			}
+		}
+	}
+
+	/// Bytes allocated for the compressed data.
+	size_t Memory() const {
+		return data.Memory() + blockEnds.Memory();
+	}
+};
+
+#endif
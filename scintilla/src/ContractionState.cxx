@@ -9,6 +9,8 @@
 
 #include "Platform.h"
 
+#include "Sci_Position.h"
+
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
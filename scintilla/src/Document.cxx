@@ -13,6 +13,7 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include "Platform.h"
 
@@ -23,10 +24,12 @@
 #include "Partitioning.h"
 #include "RunStyles.h"
 #include "CellBuffer.h"
+#include "Arena.h"
 #include "PerLine.h"
 #include "CharClassify.h"
 #include "CharacterSet.h"
 #include "Decoration.h"
+#include "RestartPoints.h"
 #include "Document.h"
 #include "RESearch.h"
 #include "UniConversion.h"
@@ -56,12 +59,46 @@ static inline bool IsUpperCase(char ch) {
 	return isascii(ch) && isupper(ch);
 }
 
+static int NextTab(int pos, int tabSize) {
+	return ((pos / tabSize) + 1) * tabSize;
+}
+
+static bool IsDBCSLeadByteInCodePage(int codePage, char ch) {
+	// Byte ranges found in Wikipedia articles with relevant search strings in each case
+	unsigned char uch = static_cast<unsigned char>(ch);
+	switch (codePage) {
+		case 932:
+			// Shift_jis
+			return ((uch >= 0x81) && (uch <= 0x9F)) ||
+				((uch >= 0xE0) && (uch <= 0xFC));
+				// Lead bytes F0 to FC may be a Microsoft addition. 
+		case 936:
+			// GBK
+			return (uch >= 0x81) && (uch <= 0xFE);
+		case 949:
+			// Korean Wansung KS C-5601-1987
+			return (uch >= 0x81) && (uch <= 0xFE);
+		case 950:
+			// Big5
+			return (uch >= 0x81) && (uch <= 0xFE);
+		case 1361:
+			// Korean Johab KS C-5601-1992
+			return
+				((uch >= 0x84) && (uch <= 0xD3)) ||
+				((uch >= 0xD8) && (uch <= 0xDE)) ||
+				((uch >= 0xE0) && (uch <= 0xF9));
+	}
+	return false;
+}
+
 void LexInterface::Colourise(int start, int end) {
 	if (pdoc && instance && !performingStyle) {
 		// Protect against reentrance, which may occur, for example, when
 		// fold points are discovered while performing styling and the folding
 		// code looks for child lines which may trigger styling.
 		performingStyle = true;
+		// The worker may be using the instance
+		StopBackground();
 
 		int lengthDoc = pdoc->Length();
 		if (end == -1)
@@ -71,20 +108,788 @@ void LexInterface::Colourise(int start, int end) {
 		PLATFORM_ASSERT(len >= 0);
 		PLATFORM_ASSERT(start + len <= lengthDoc);
 
-		int styleStart = 0;
-		if (start > 0)
-			styleStart = pdoc->StyleAt(start - 1) & pdoc->stylingBitsMask;
+		// Lexers only start at a line start or at a restart point they declared
+		start = pdoc->RestartPosition(start);
+		if ((len > 0) && (start <= pdoc->GetEndStyled()) && (start < pdoc->StylesKeptEnd()))
+			start = LexUntilConverged(start, end);
+		if (start < end)
+			LexRange(start, end);
+
+		performingStyle = false;
+	}
+}
+
+void LexInterface::LexRange(int start, int end) {
+	int styleStart = 0;
+	if (start > 0)
+		styleStart = pdoc->StyleAt(start - 1) & pdoc->stylingBitsMask;
+	pdoc->RemoveRestartPoints(start, end);
+	instance->Lex(start, end - start, styleStart, pdoc);
+	FoldRange(start, end);
+}
 
-		if (len > 0) {
-			instance->Lex(start, len, styleStart, pdoc);
-			instance->Fold(start, len, styleStart, pdoc);
+void LexInterface::FoldRange(int start, int end) {
+	// Fold levels are found for whole lines so folding starts at the line start even when
+	// lexing started at a restart point
+	start = pdoc->LineStart(pdoc->LineFromPosition(start));
+	int styleStart = 0;
+	if (start > 0)
+		styleStart = pdoc->StyleAt(start - 1) & pdoc->stylingBitsMask;
+	instance->Fold(start, end - start, styleStart, pdoc);
+}
+
+/// Lines lexed first after a change to see whether the state converges, doubling each time
+/// it does not.
+static const int convergeLines = 4;
+/// Bytes after the change lexed first when the lines are long, doubling up to
+/// convergeBytesMost, so a change to a very long line is restyled in pieces.
+static const int convergeBytes = 0x1000;
+static const int convergeBytesMost = 0x100000;
+
+/// What the lexer continues from at the start of the next line.
+struct LineEndState {
+	int style;
+	int lineState;
+	int level;
+	LineEndState(const Document *pdoc, int line) :
+		style(pdoc->StyleAt(pdoc->LineStart(line + 1) - 1) & pdoc->stylingBitsMask),
+		lineState(pdoc->GetLineState(line)), level(pdoc->GetLevel(line)) {
+	}
+	bool operator==(const LineEndState &other) const {
+		return (style == other.style) && (lineState == other.lineState) && (level == other.level);
+	}
+};
+
+/// What the lexer continues from at a restart point: the style before it and the state of
+/// the line before. The line before may already have been restyled so its state from when
+/// the point was declared is used.
+struct RestartState {
+	int position;
+	int style;
+	int lineState;
+	RestartState(const Document *pdoc, int position_) : position(position_),
+		style(pdoc->StyleAt(position_ - 1) & pdoc->stylingBitsMask),
+		lineState(pdoc->RestartPointLineState(position_)) {
+	}
+	bool Continues(const Document *pdoc) const {
+		return pdoc->RestartPointDeclared(position) &&
+			(style == (pdoc->StyleAt(position - 1) & pdoc->stylingBitsMask)) &&
+			(lineState == pdoc->GetLineState(pdoc->LineFromPosition(position) - 1));
+	}
+};
+
+// After a change, lex a few lines at a time while comparing the state at the end of each
+// line beyond the change with the state it ended in before. Once they are the same, the
+// following text, which has not changed, would be styled as it was before so the styles
+// kept from before are used instead. Within long lines, pieces end inside the line and the
+// restart points beyond the change are compared in the same way when the lexer declares
+// them again. @return where lexing should continue from.
+int LexInterface::LexUntilConverged(int start, int end) {
+	std::vector<LineEndState> before;
+	std::vector<RestartState> restartsBefore;
+	int lines = convergeLines;
+	int bytes = convergeBytes;
+	bool withinLines = true;
+	while (start < end) {
+		// Lines up to the end of the change and any restyled since have lost their state
+		const int changesEnd = pdoc->ChangesEnd();
+		const int lineCompared = pdoc->LineFromPosition(changesEnd) + 1;
+		const int lineFirst = Platform::Maximum(pdoc->LineFromPosition(start), lineCompared);
+		int pieceEnd = Platform::Minimum(pdoc->LineStart(lineFirst + lines), end);
+		if (withinLines)
+			pieceEnd = Platform::Minimum(pieceEnd, Platform::Maximum(start, changesEnd) + bytes);
+		const int keptEnd = pdoc->StylesKeptEnd();
+		before.clear();
+		for (int line = lineFirst; (pdoc->LineStart(line + 1) <= pieceEnd) &&
+			(pdoc->LineStart(line + 1) < keptEnd); line++) {
+			before.push_back(LineEndState(pdoc, line));
+		}
+		restartsBefore.clear();
+		for (int restart = pdoc->RestartPointAfter(changesEnd);
+			(restart >= 0) && (restart < Platform::Minimum(pieceEnd, keptEnd));
+			restart = pdoc->RestartPointAfter(restart)) {
+			restartsBefore.push_back(RestartState(pdoc, restart));
+		}
+		pdoc->RecordRestartPoints(true);
+		LexRange(start, pieceEnd);
+		pdoc->RecordRestartPoints(false);
+		// A lexer that called ChangeLexerState has discarded the styles kept from before
+		bool converged = false;
+		if (pdoc->StylesKeptEnd() == 0) {
+			before.clear();
+			restartsBefore.clear();
+		}
+		for (size_t i = 0; !converged && (i < before.size()); i++) {
+			converged = LineEndState(pdoc, lineFirst + static_cast<int>(i)) == before[i];
+		}
+		for (size_t i = 0; !converged && (i < restartsBefore.size()); i++) {
+			converged = restartsBefore[i].Continues(pdoc);
+		}
+		if (converged) {
+			pdoc->RestyledTo(pieceEnd, true);
+			FoldUntilConverged(pieceEnd);
+			const int endStyled = pdoc->GetEndStyled();
+			return (endStyled < end) ? pdoc->RestartPosition(endStyled) : end;
+		}
+		pdoc->RestyledTo(pieceEnd, false);
+		if (pieceEnd >= end)
+			return end;
+		// The next piece starts at the last restart point in this one, or this one is lexed
+		// again to the end of its lines when it has none
+		const int restart = pdoc->RestartPosition(pieceEnd);
+		if (restart > start)
+			start = restart;
+		else
+			withinLines = false;
+		if (pieceEnd >= pdoc->StylesKeptEnd())
+			break;
+		lines *= 2;
+		bytes = Platform::Minimum(bytes * 2, static_cast<int>(convergeBytesMost));
+	}
+	return start;
+}
+
+// Once styling has converged within or at the end of a line, the fold levels of the line
+// it converged in and of some lines after may still change as each level continues from
+// the one before. Fold lines a few at a time, doubling each time, until a line whose level
+// was not only partly found is given the level it had before.
+void LexInterface::FoldUntilConverged(int pos) {
+	const int endStyled = pdoc->GetEndStyled();
+	// Only lines styled to their end can be folded
+	const int linesStyled = (endStyled >= pdoc->Length()) ?
+		pdoc->LinesTotal() : pdoc->LineFromPosition(endStyled);
+	int lineFold = pdoc->LineFromPosition(pos);
+	// The level of a line folded up to pos within it was only partly found
+	const int lineCompared = (pdoc->LineStart(lineFold) == pos) ? lineFold : lineFold + 1;
+	std::vector<int> levelsBefore;
+	int lines = convergeLines;
+	while (lineFold < linesStyled) {
+		const int lineEnd = Platform::Minimum(lineFold + lines, linesStyled);
+		levelsBefore.clear();
+		for (int line = Platform::Maximum(lineFold, lineCompared); line < lineEnd; line++)
+			levelsBefore.push_back(pdoc->GetLevel(line));
+		FoldRange(pdoc->LineStart(lineFold), pdoc->LineStart(lineEnd));
+		const int lineFirst = lineEnd - static_cast<int>(levelsBefore.size());
+		for (size_t i = 0; i < levelsBefore.size(); i++) {
+			if (pdoc->GetLevel(lineFirst + static_cast<int>(i)) == levelsBefore[i])
+				return;
+		}
+		lineFold = lineEnd;
+		lines *= 2;
+	}
+}
+
+// Lexing on a worker thread
+//
+// The worker lexes a snapshot of the document from the end of the styled text onwards,
+// a chunk of lines at a time, presenting the snapshot to the lexer as an IDocument that
+// keeps the styles, fold levels and line states it is given. Each finished chunk is
+// merged into the document on the main thread unless text before its end has changed
+// since the snapshot was taken. The worker uses the document's own lexer instance, so the
+// instance sees the text in the same order as when lexing on the main thread, and the
+// main thread stops the worker before using the instance itself.
+
+/// Lexing a chunk of this size takes a few milliseconds so the worker stops soon after
+/// being asked and its results are merged in pieces. Chunks end at a line start.
+static const int backgroundChunk = 0x10000;
+/// Positions, fold levels and line states of this many lines before the start of lexing
+/// are copied from the document for lexers that look back at earlier lines.
+static const int backgroundLinesBefore = 1000;
+
+/// Lines given a value by a lexer, from low to high, empty when low > high.
+struct LineSpan {
+	int low;
+	int high;
+	LineSpan() : low(1), high(0) {
+	}
+	void Add(int line) {
+		if (low > high) {
+			low = line;
+			high = line;
+		} else if (line < low) {
+			low = line;
+		} else if (line > high) {
+			high = line;
+		}
+	}
+};
+
+struct DecorationFill {
+	int indicator;
+	int position;
+	int value;
+	int fillLength;
+};
+
+/// The results of lexing one chunk on the worker.
+class LexedChunk {
+public:
+	int start;
+	int end;
+	/// Lexers may back up and restyle earlier lines so styles may start before start
+	int styledFrom;
+	char stylingMask;
+	std::vector<char> styles;
+	/// Fold levels and line states from lineLevels and lineStates, empty when none were set
+	int lineLevels;
+	std::vector<int> levels;
+	int lineStates;
+	std::vector<int> states;
+	std::vector<DecorationFill> decorations;
+	/// Restart points declared at least RestartPoints::spacing apart
+	std::vector<int> restarts;
+	/// Range passed to ChangeLexerState, start is -1 when it was not called
+	int lexerStateStart;
+	int lexerStateEnd;
+	int errorStatus;
+
+	LexedChunk(int start_, int end_) : start(start_), end(end_), styledFrom(start_), stylingMask(0),
+		lineLevels(0), lineStates(0), lexerStateStart(-1), lexerStateEnd(-1), errorStatus(0) {
+	}
+
+	void Apply(Document *pdoc) const {
+		if (!styles.empty()) {
+			pdoc->StartStyling(styledFrom, stylingMask);
+			pdoc->SetStyles(static_cast<int>(styles.size()), &styles[0]);
+		}
+		for (size_t i = 0; i < levels.size(); i++)
+			pdoc->SetLevel(lineLevels + static_cast<int>(i), levels[i]);
+		for (size_t i = 0; i < states.size(); i++)
+			pdoc->SetLineState(lineStates + static_cast<int>(i), states[i]);
+		pdoc->RemoveRestartPoints(start, end);
+		for (size_t i = 0; i < restarts.size(); i++)
+			pdoc->SetRestartPoint(restarts[i]);
+		for (size_t i = 0; i < decorations.size(); i++) {
+			pdoc->DecorationSetCurrentIndicator(decorations[i].indicator);
+			pdoc->DecorationFillRange(decorations[i].position, decorations[i].value,
+				decorations[i].fillLength);
 		}
+		if (lexerStateStart >= 0)
+			pdoc->ChangeLexerState(lexerStateStart, lexerStateEnd);
+		if (errorStatus)
+			pdoc->SetErrorStatus(errorStatus);
+	}
+};
+
+/**
+ * A lexing job on a worker thread. The IDocument methods are only called by the worker
+ * while the constructor and the public methods are called by the main thread.
+ */
+class BackgroundLexer : public IDocumentWithTextSegments {
+	// Set by the main thread before the worker starts
+	ILexer *instance;
+	ISnapshot *snapshot;
+	int lengthDoc;
+	int start;
+	int initStyle;
+	int stylingBitsMask;
+	int codePage;
+	int tabInChars;
+	/// First line copied from the document
+	int lineBefore;
+	/// Start, fold level and line state of each line from lineBefore. The worker finds
+	/// the starts of lines after start and extends levels and states as they are set.
+	std::vector<int> lineStarts;
+	std::vector<int> levels;
+	std::vector<int> states;
+
+	// Used only by the worker
+	/// Styles from origin which is start unless a lexer has backed up before it
+	int origin;
+	std::vector<char> styles;
+	int endStyled;
+	char stylingMask;
+	int decorationIndicator;
+	/// The chunk being lexed and what it has set
+	LexedChunk *chunk;
+	int styledFrom;
+	char stylingMasks;
+	LineSpan spanLevels;
+	LineSpan spanStates;
+
+	// Shared by both threads and guarded by lock
+	Mutex *lock;
+	bool cancelled;
+	bool finished;
+	/// Chunks ending after this position are stale
+	int invalidFrom;
+	std::vector<LexedChunk *> lexed;
+
+	/// Held by the worker while it uses the lexer instance
+	Mutex *lexing;
+	/// One for the LexInterface and one for the worker
+	int references;
+
+	// Private so BackgroundLexer objects can not be copied
+	BackgroundLexer(const BackgroundLexer &);
+	BackgroundLexer &operator=(const BackgroundLexer &);
+
+	void FindLines();
+	int ChunkEnd(int position) const;
+	bool Wanted(int end);
+	void EnsureStyles(int upTo);
+	void Finish(LexedChunk *lc);
+	void Run();
+public:
+	BackgroundLexer(ILexer *instance_, Document *pdoc, int start_, int initStyle_);
+	virtual ~BackgroundLexer();
+	static void Work(void *work);
+	void AddRef();
+	void Release();
+	/// Stop the worker and wait until it no longer uses the lexer instance.
+	void Stop();
+	void Invalidate(int position);
+	/// Apply the chunks lexed so far. @return false when there will be no more.
+	bool Merge(Document *pdoc);
+
+	int SCI_METHOD Version() const {
+		return dvTextSegments;
+	}
+	void SCI_METHOD SetErrorStatus(int status) {
+		chunk->errorStatus = status;
+	}
+	int SCI_METHOD Length() const {
+		return lengthDoc;
+	}
+	void SCI_METHOD GetCharRange(char *buffer, int position, int lengthRetrieve) const {
+		snapshot->GetCharRange(buffer, position, lengthRetrieve);
+	}
+	char SCI_METHOD StyleAt(int position) const;
+	int SCI_METHOD LineFromPosition(int position) const;
+	int SCI_METHOD LineStart(int line) const;
+	int SCI_METHOD GetLevel(int line) const;
+	int SCI_METHOD SetLevel(int line, int level);
+	int SCI_METHOD GetLineState(int line) const;
+	int SCI_METHOD SetLineState(int line, int state);
+	void SCI_METHOD StartStyling(int position, char mask);
+	bool SCI_METHOD SetStyleFor(int length, char style);
+	bool SCI_METHOD SetStyles(int length, const char *styles);
+	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) {
+		decorationIndicator = indicator;
+	}
+	void SCI_METHOD DecorationFillRange(int position, int value, int fillLength);
+	void SCI_METHOD ChangeLexerState(int start, int end);
+	int SCI_METHOD CodePage() const {
+		return codePage;
+	}
+	bool SCI_METHOD IsDBCSLeadByte(char ch) const {
+		return IsDBCSLeadByteInCodePage(codePage, ch);
+	}
+	const char * SCI_METHOD BufferPointer() {
+		// A snapshot is not contiguous and the lexers do not need the whole text at once
+		return 0;
+	}
+	int SCI_METHOD GetLineIndentation(int line);
+	void SCI_METHOD SetRestartPoint(int position);
+	const char * SCI_METHOD TextSegment(int position, int *lengthSegment) const;
+};
+
+BackgroundLexer::BackgroundLexer(ILexer *instance_, Document *pdoc, int start_, int initStyle_) :
+	instance(instance_), snapshot(pdoc->CreateSnapshot()), lengthDoc(pdoc->Length()),
+	start(start_), initStyle(initStyle_), stylingBitsMask(pdoc->stylingBitsMask),
+	codePage(pdoc->dbcsCodePage), tabInChars(pdoc->tabInChars), lineBefore(0),
+	origin(start_), endStyled(start_), stylingMask(0), decorationIndicator(0),
+	chunk(0), styledFrom(start_), stylingMasks(0),
+	lock(Mutex::Create()), cancelled(false), finished(false), invalidFrom(pdoc->Length()),
+	lexing(Mutex::Create()), references(2) {
+	const int line = pdoc->LineFromPosition(start);
+	lineBefore = Platform::Maximum(line - backgroundLinesBefore, 0);
+	for (int lineCopy = lineBefore; lineCopy < line; lineCopy++) {
+		lineStarts.push_back(pdoc->LineStart(lineCopy));
+		levels.push_back(pdoc->GetLevel(lineCopy));
+		states.push_back(pdoc->GetLineState(lineCopy));
+	}
+	lineStarts.push_back(start);
+}
+
+BackgroundLexer::~BackgroundLexer() {
+	for (size_t i = 0; i < lexed.size(); i++)
+		delete lexed[i];
+	delete chunk;
+	snapshot->Release();
+	delete lock;
+	delete lexing;
+}
+
+void BackgroundLexer::Work(void *work) {
+	BackgroundLexer *lexer = static_cast<BackgroundLexer *>(work);
+	try {
+		lexer->Run();
+	} catch (...) {
+		// Whatever was lexed before the failure is still merged
+	}
+	lexer->lock->Lock();
+	lexer->finished = true;
+	lexer->lock->Unlock();
+	lexer->Release();
+}
 
+void BackgroundLexer::AddRef() {
+	AtomicCount::Increment(&references);
+}
+
+void BackgroundLexer::Release() {
+	if (AtomicCount::Decrement(&references))
+		delete this;
+}
+
+void BackgroundLexer::Stop() {
+	lock->Lock();
+	cancelled = true;
+	lock->Unlock();
+	lexing->Lock();
+	lexing->Unlock();
+}
+
+void BackgroundLexer::Invalidate(int position) {
+	lock->Lock();
+	if (invalidFrom > position)
+		invalidFrom = position;
+	lock->Unlock();
+}
+
+bool BackgroundLexer::Wanted(int end) {
+	lock->Lock();
+	const bool wanted = !cancelled && (end <= invalidFrom);
+	lock->Unlock();
+	return wanted;
+}
+
+bool BackgroundLexer::Merge(Document *pdoc) {
+	std::vector<LexedChunk *> chunks;
+	lock->Lock();
+	chunks.swap(lexed);
+	const bool done = finished;
+	lock->Unlock();
+	bool current = true;
+	for (size_t i = 0; i < chunks.size(); i++) {
+		const LexedChunk *lc = chunks[i];
+		// Applying a chunk notifies watchers which may change the text so check each
+		if (current && (!Wanted(lc->end) || (lc->start > pdoc->GetEndStyled())))
+			current = false;
+		if (current && (lc->end > pdoc->GetEndStyled()))
+			lc->Apply(pdoc);
+		delete lc;
+	}
+	return current && !done;
+}
+
+void BackgroundLexer::FindLines() {
+	// A CR ends a line unless the next byte is an LF, as in the line index
+	bool afterCR = false;
+	int position = start;
+	while (position < lengthDoc) {
+		long lengthSegment = 0;
+		const char *segment = snapshot->TextSegment(position, &lengthSegment);
+		if (lengthSegment <= 0)
+			break;
+		if (lengthSegment > lengthDoc - position)
+			lengthSegment = lengthDoc - position;
+		for (int i = 0; i < lengthSegment; i++) {
+			const char ch = segment[i];
+			if (afterCR && (ch != '\n'))
+				lineStarts.push_back(position + i);
+			if (ch == '\n')
+				lineStarts.push_back(position + i + 1);
+			afterCR = ch == '\r';
+		}
+		position += lengthSegment;
+	}
+	if (afterCR)
+		lineStarts.push_back(lengthDoc);
+}
+
+int BackgroundLexer::ChunkEnd(int position) const {
+	if (lengthDoc - position <= backgroundChunk)
+		return lengthDoc;
+	return LineStart(LineFromPosition(position + backgroundChunk) + 1);
+}
+
+void BackgroundLexer::EnsureStyles(int upTo) {
+	if (upTo > lengthDoc)
+		upTo = lengthDoc;
+	const int styled = origin + static_cast<int>(styles.size());
+	if (upTo > styled) {
+		styles.resize(upTo - origin);
+		snapshot->GetStyleRange(&styles[styled - origin], styled, upTo - styled);
+	}
+}
+
+void BackgroundLexer::Finish(LexedChunk *lc) {
+	lc->styledFrom = styledFrom;
+	lc->stylingMask = stylingMasks;
+	lc->styles.assign(styles.begin() + (styledFrom - origin), styles.begin() + (lc->end - origin));
+	if (spanLevels.low <= spanLevels.high) {
+		lc->lineLevels = spanLevels.low;
+		lc->levels.assign(levels.begin() + (spanLevels.low - lineBefore),
+			levels.begin() + (spanLevels.high - lineBefore + 1));
+	}
+	if (spanStates.low <= spanStates.high) {
+		lc->lineStates = spanStates.low;
+		lc->states.assign(states.begin() + (spanStates.low - lineBefore),
+			states.begin() + (spanStates.high - lineBefore + 1));
+	}
+	lock->Lock();
+	lexed.push_back(lc);
+	lock->Unlock();
+}
+
+void BackgroundLexer::Run() {
+	FindLines();
+	int position = start;
+	int styleStart = initStyle;
+	while (position < lengthDoc) {
+		const int end = ChunkEnd(position);
+		lexing->Lock();
+		if (!Wanted(end)) {
+			lexing->Unlock();
+			break;
+		}
+		chunk = new LexedChunk(position, end);
+		styledFrom = position;
+		stylingMasks = 0;
+		spanLevels = LineSpan();
+		spanStates = LineSpan();
+		EnsureStyles(end);
+		try {
+			instance->Lex(position, end - position, styleStart, this);
+			instance->Fold(position, end - position, styleStart, this);
+		} catch (...) {
+			lexing->Unlock();
+			throw;
+		}
+		lexing->Unlock();
+		LexedChunk *lc = chunk;
+		chunk = 0;
+		Finish(lc);
+		styleStart = StyleAt(end - 1) & stylingBitsMask;
+		position = end;
+	}
+}
+
+char SCI_METHOD BackgroundLexer::StyleAt(int position) const {
+	const int index = position - origin;
+	if ((index >= 0) && (index < static_cast<int>(styles.size())))
+		return styles[index];
+	return snapshot->StyleAt(position);
+}
+
+int SCI_METHOD BackgroundLexer::LineFromPosition(int position) const {
+	// Positions before the lines copied are treated as being on the first of them
+	const std::vector<int>::const_iterator after =
+		std::upper_bound(lineStarts.begin(), lineStarts.end(), position);
+	if (after == lineStarts.begin())
+		return lineBefore;
+	return lineBefore + static_cast<int>(after - lineStarts.begin()) - 1;
+}
+
+int SCI_METHOD BackgroundLexer::LineStart(int line) const {
+	if (line < 0)
+		return 0;
+	if (line < lineBefore)
+		return lineStarts[0];
+	const size_t index = line - lineBefore;
+	if (index >= lineStarts.size())
+		return lengthDoc;
+	return lineStarts[index];
+}
+
+int SCI_METHOD BackgroundLexer::GetLevel(int line) const {
+	const int index = line - lineBefore;
+	if ((index >= 0) && (index < static_cast<int>(levels.size())))
+		return levels[index];
+	return SC_FOLDLEVELBASE;
+}
+
+int SCI_METHOD BackgroundLexer::SetLevel(int line, int level) {
+	const int index = line - lineBefore;
+	if (index < 0)
+		return SC_FOLDLEVELBASE;
+	if (index >= static_cast<int>(levels.size()))
+		levels.resize(index + 1, SC_FOLDLEVELBASE);
+	const int prev = levels[index];
+	levels[index] = level;
+	spanLevels.Add(line);
+	return prev;
+}
+
+int SCI_METHOD BackgroundLexer::GetLineState(int line) const {
+	const int index = line - lineBefore;
+	if ((index >= 0) && (index < static_cast<int>(states.size())))
+		return states[index];
+	return 0;
+}
+
+int SCI_METHOD BackgroundLexer::SetLineState(int line, int state) {
+	const int index = line - lineBefore;
+	if (index < 0)
+		return 0;
+	if (index >= static_cast<int>(states.size()))
+		states.resize(index + 1, 0);
+	const int statePrevious = states[index];
+	states[index] = state;
+	spanStates.Add(line);
+	return statePrevious;
+}
+
+void SCI_METHOD BackgroundLexer::StartStyling(int position, char mask) {
+	if (position < 0)
+		position = 0;
+	if (position < origin) {
+		std::vector<char> before(origin - position);
+		snapshot->GetStyleRange(&before[0], position, origin - position);
+		styles.insert(styles.begin(), before.begin(), before.end());
+		origin = position;
+	}
+	if (styledFrom > position)
+		styledFrom = position;
+	stylingMask = mask;
+	stylingMasks |= mask;
+	endStyled = position;
+}
+
+bool SCI_METHOD BackgroundLexer::SetStyleFor(int length, char style) {
+	EnsureStyles(endStyled + length);
+	style &= stylingMask;
+	for (int i = 0; (i < length) && (endStyled < lengthDoc); i++, endStyled++) {
+		char &styleAt = styles[endStyled - origin];
+		styleAt = static_cast<char>((styleAt & ~stylingMask) | style);
+	}
+	return true;
+}
+
+bool SCI_METHOD BackgroundLexer::SetStyles(int length, const char *stylesSet) {
+	EnsureStyles(endStyled + length);
+	for (int i = 0; (i < length) && (endStyled < lengthDoc); i++, endStyled++) {
+		char &styleAt = styles[endStyled - origin];
+		styleAt = static_cast<char>((styleAt & ~stylingMask) | (stylesSet[i] & stylingMask));
+	}
+	return true;
+}
+
+void SCI_METHOD BackgroundLexer::DecorationFillRange(int position, int value, int fillLength) {
+	DecorationFill fill = { decorationIndicator, position, value, fillLength };
+	chunk->decorations.push_back(fill);
+}
+
+void SCI_METHOD BackgroundLexer::ChangeLexerState(int startChange, int endChange) {
+	if ((chunk->lexerStateStart < 0) || (chunk->lexerStateStart > startChange))
+		chunk->lexerStateStart = startChange;
+	if (chunk->lexerStateEnd < endChange)
+		chunk->lexerStateEnd = endChange;
+}
+
+void SCI_METHOD BackgroundLexer::SetRestartPoint(int position) {
+	// The document would not keep points closer together
+	if (chunk->restarts.empty() || (position - chunk->restarts.back() >= RestartPoints::spacing))
+		chunk->restarts.push_back(position);
+}
+
+int SCI_METHOD BackgroundLexer::GetLineIndentation(int line) {
+	int indent = 0;
+	if ((line >= 0) && (line < lineBefore + static_cast<int>(lineStarts.size()))) {
+		for (int i = LineStart(line); i < lengthDoc; i++) {
+			const char ch = snapshot->CharAt(i);
+			if (ch == ' ')
+				indent++;
+			else if (ch == '\t')
+				indent = NextTab(indent, tabInChars);
+			else
+				return indent;
+		}
+	}
+	return indent;
+}
+
+const char * SCI_METHOD BackgroundLexer::TextSegment(int position, int *lengthSegment) const {
+	*lengthSegment = 0;
+	if (position >= lengthDoc)
+		return 0;
+	long length = 0;
+	const char *segment = snapshot->TextSegment(position, &length);
+	*lengthSegment = Platform::Minimum(static_cast<int>(length), lengthDoc - position);
+	return segment;
+}
+
+void LexInterface::SetBackground(bool background_) {
+	// Each worker snapshots the document, which for a gap buffer means the next edit
+	// copies all of its text and styles, so only chunked documents lex in the background
+	background = background_ && (pdoc->DocumentOptions() & SC_DOCUMENTOPTION_TEXT_CHUNKED);
+	if (!background)
+		StopBackground();
+}
+
+void LexInterface::StartBackground() {
+	const int start = pdoc->LineStart(pdoc->LineFromPosition(pdoc->GetEndStyled()));
+	int styleStart = 0;
+	if (start > 0)
+		styleStart = pdoc->StyleAt(start - 1) & pdoc->stylingBitsMask;
+	BackgroundLexer *lexer = new BackgroundLexer(instance, pdoc, start, styleStart);
+	if (Workers::Start(BackgroundLexer::Work, lexer)) {
+		job = lexer;
+	} else {
+		// Without threads all styling is done on the main thread
+		background = false;
+		delete lexer;
+	}
+}
+
+bool LexInterface::StyleInBackground() {
+	MergeBackground();
+	if (!job && background && instance && !performingStyle &&
+		(pdoc->GetEndStyled() < pdoc->Length()) &&
+		(pdoc->IndexedTo() >= pdoc->Length()) && !pdoc->IsHibernating()) {
+		// After a change, restyling may converge within a few lines and leave nothing for
+		// a worker to do
+		const int endStyled = pdoc->GetEndStyled();
+		if (endStyled < pdoc->StylesKeptEnd()) {
+			Colourise(pdoc->RestartPosition(endStyled),
+				Platform::Minimum(pdoc->StylesKeptEnd(), endStyled + backgroundChunk));
+		}
+		if (pdoc->GetEndStyled() < pdoc->Length())
+			StartBackground();
+	}
+	return job != 0;
+}
+
+void LexInterface::MergeBackground() {
+	if (job && !performingStyle) {
+		// Watchers notified of the changes may look for fold children, which would
+		// otherwise style on this thread, as when lexing in Colourise.
+		performingStyle = true;
+		BackgroundLexer *merging = job;
+		merging->AddRef();
+		const bool more = merging->Merge(pdoc);
 		performingStyle = false;
+		if (!more && (job == merging))
+			StopBackground();
+		merging->Release();
 	}
 }
 
-Document::Document() {
+void LexInterface::StopBackground() {
+	if (job) {
+		BackgroundLexer *stopping = job;
+		job = 0;
+		stopping->Stop();
+		stopping->Release();
+	}
+}
+
+void LexInterface::InvalidateBackground(int pos) const {
+	if (job)
+		job->Invalidate(pos);
+}
+
+// A log is appended to at its end and deleted from at its start, which only a chunked
+// text store and a tree of line starts do without moving everything in between.
+static int StorageOptions(int documentOptions) {
+	if (documentOptions & SC_DOCUMENTOPTION_LOG)
+		documentOptions |= SC_DOCUMENTOPTION_TEXT_CHUNKED | SC_DOCUMENTOPTION_LINES_TREE;
+	return documentOptions;
+}
+
+Document::Document(int documentOptions) : cb(StorageOptions(documentOptions)) {
 	refCount = 0;
 #ifdef _WIN32
 	eolMode = SC_EOL_CRLF;
@@ -100,6 +905,14 @@ Document::Document() {
 	enteredModification = 0;
 	enteredStyling = 0;
 	enteredReadOnlyCount = 0;
+	logLineLimit = 0;
+	logLinesTrimmed = 0;
+	stylesKeptEnd = 0;
+	changesEnd = 0;
+	restarts = new RestartPoints();
+	recordingRestarts = false;
+	if (documentOptions & SC_DOCUMENTOPTION_LOG)
+		cb.SetUndoCollection(false);
 	tabInChars = 8;
 	indentInChars = 0;
 	actualIndentInChars = 8;
@@ -138,6 +951,8 @@ Document::~Document() {
 	regex = 0;
 	delete pli;
 	pli = 0;
+	delete restarts;
+	restarts = 0;
 }
 
 void Document::Init() {
@@ -154,6 +969,13 @@ void Document::InsertLine(int line) {
 	}
 }
 
+void Document::InsertLines(int line, int lines) {
+	for (int j=0; j<ldSize; j++) {
+		if (perLineData[j])
+			perLineData[j]->InsertLines(line, lines);
+	}
+}
+
 void Document::RemoveLine(int line) {
 	for (int j=0; j<ldSize; j++) {
 		if (perLineData[j])
@@ -161,6 +983,51 @@ void Document::RemoveLine(int line) {
 	}
 }
 
+size_t Document::Memory() const {
+	size_t memory = 0;
+	for (int j=0; j<ldSize; j++) {
+		if (perLineData[j])
+			memory += perLineData[j]->Memory();
+	}
+	return memory + restarts->Memory();
+}
+
+void Document::Shrink() {
+	for (int j=0; j<ldSize; j++) {
+		if (perLineData[j])
+			perLineData[j]->Shrink();
+	}
+	restarts->Shrink();
+}
+
+void Document::Hibernate() {
+	if (cb.IsHibernating() || enteredModification || enteredStyling)
+		return;
+	// A worker would keep a snapshot of the text
+	if (pli)
+		pli->StopBackground();
+	cb.Hibernate();
+	Shrink();
+	// The styles have gone so the whole document is styled again when shown
+	endStyled = 0;
+	stylesKeptEnd = 0;
+	changesEnd = 0;
+	restarts->DeleteAll();
+	DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER, 0, Length());
+	NotifyModified(mh);
+}
+
+void Document::GetMemoryUsage(Sci_MemoryUsage *usage) const {
+	size_t unused = 0;
+	usage->text = cb.TextMemory(unused);
+	usage->textUnused = unused;
+	usage->styles = cb.StyleMemory();
+	usage->lineIndex = cb.LineIndexMemory();
+	usage->perLine = Memory();
+	usage->undo = cb.UndoMemory();
+	usage->decorations = decorations.Memory();
+}
+
 // Increase reference count and return its previous value.
 int Document::AddRef() {
 	return refCount++;
@@ -188,6 +1055,10 @@ int Document::MarkerNext(int lineStart, int mask) const {
 	return static_cast<LineMarkers *>(perLineData[ldMarkers])->MarkerNext(lineStart, mask);
 }
 
+int Document::MarkerPrevious(int lineStart, int mask) const {
+	return static_cast<LineMarkers *>(perLineData[ldMarkers])->MarkerPrevious(lineStart, mask);
+}
+
 int Document::AddMark(int line, int markerNum) {
 	if (line >= 0 && line <= LinesTotal()) {
 		int prev = static_cast<LineMarkers *>(perLineData[ldMarkers])->
@@ -227,12 +1098,25 @@ void Document::DeleteMarkFromHandle(int markerHandle) {
 }
 
 void Document::DeleteAllMarks(int markerNum) {
+	if (static_cast<LineMarkers *>(perLineData[ldMarkers])->DeleteAllMarks(markerNum)) {
+		DocModification mh(SC_MOD_CHANGEMARKER, 0, 0, 0, 0);
+		mh.line = -1;
+		NotifyModified(mh);
+	}
+}
+
+void Document::SetMarkMasks(int count, const Sci_MarkerMask *masks) {
 	bool someChanges = false;
-	for (int line = 0; line < LinesTotal(); line++) {
-		if (static_cast<LineMarkers *>(perLineData[ldMarkers])->DeleteMark(line, markerNum, true))
-			someChanges = true;
+	for (int i = 0; i < count; i++) {
+		const int line = masks[i].line;
+		if (line >= 0 && line < LinesTotal()) {
+			if (static_cast<LineMarkers *>(perLineData[ldMarkers])->
+				SetMarkSet(line, masks[i].mask, LinesTotal()))
+				someChanges = true;
+		}
 	}
 	if (someChanges) {
+		// One notification for all the lines so the margin is only redrawn once
 		DocModification mh(SC_MOD_CHANGEMARKER, 0, 0, 0, 0);
 		mh.line = -1;
 		NotifyModified(mh);
@@ -659,31 +1543,7 @@ int SCI_METHOD Document::CodePage() const {
 }
 
 bool SCI_METHOD Document::IsDBCSLeadByte(char ch) const {
-	// Byte ranges found in Wikipedia articles with relevant search strings in each case
-	unsigned char uch = static_cast<unsigned char>(ch);
-	switch (dbcsCodePage) {
-		case 932:
-			// Shift_jis
-			return ((uch >= 0x81) && (uch <= 0x9F)) ||
-				((uch >= 0xE0) && (uch <= 0xFC));
-				// Lead bytes F0 to FC may be a Microsoft addition. 
-		case 936:
-			// GBK
-			return (uch >= 0x81) && (uch <= 0xFE);
-		case 949:
-			// Korean Wansung KS C-5601-1987
-			return (uch >= 0x81) && (uch <= 0xFE);
-		case 950:
-			// Big5
-			return (uch >= 0x81) && (uch <= 0xFE);
-		case 1361:
-			// Korean Johab KS C-5601-1992
-			return
-				((uch >= 0x84) && (uch <= 0xD3)) ||
-				((uch >= 0xD8) && (uch <= 0xDE)) ||
-				((uch >= 0xE0) && (uch <= 0xF9));
-	}
-	return false;
+	return IsDBCSLeadByteInCodePage(dbcsCodePage, ch);
 }
 
 static inline bool IsSpaceOrTab(int ch) {
@@ -740,9 +1600,49 @@ int Document::SafeSegment(const char *text, int length, int lengthSegment) {
 	return lastEncodingAllowedBreak;
 }
 
+// Where position moves to when lengthDeleted bytes at pos are replaced by lengthInserted.
+static int MovedPosition(int position, int pos, int lengthInserted, int lengthDeleted) {
+	if (position <= pos)
+		return position;
+	else if (position - pos < lengthDeleted)
+		return pos;
+	else
+		return position + lengthInserted - lengthDeleted;
+}
+
+void Document::TextChanged(int pos, int lengthInserted, int lengthDeleted) {
+	// The styles beyond the change are kept in case restyling converges before it reaches
+	// their end. Changes made before restyling has converged extend the changed range.
+	if (stylesKeptEnd <= endStyled) {
+		stylesKeptEnd = endStyled;
+		changesEnd = 0;
+	}
+	if (pos < stylesKeptEnd) {
+		stylesKeptEnd = MovedPosition(stylesKeptEnd, pos, lengthInserted, lengthDeleted);
+		changesEnd = Platform::Maximum(MovedPosition(changesEnd, pos, lengthInserted, lengthDeleted),
+			pos + lengthInserted);
+		if (changesEnd >= stylesKeptEnd) {
+			stylesKeptEnd = 0;
+			changesEnd = 0;
+		}
+	}
+	restarts->TextChanged(pos, lengthInserted, lengthDeleted, Length() - lengthInserted + lengthDeleted);
+	const int posStyle = ((pos < Length()) || (pos == 0)) ? pos : pos - 1;
+	if (endStyled > posStyle)
+		endStyled = posStyle;
+	if (pli)
+		pli->InvalidateBackground(posStyle);
+}
+
 void Document::ModifiedAt(int pos) {
 	if (endStyled > pos)
 		endStyled = pos;
+	// The lexer has been changed so the styles after pos are wrong
+	stylesKeptEnd = 0;
+	changesEnd = 0;
+	restarts->Remove(pos, Length());
+	if (pli)
+		pli->InvalidateBackground(pos);
 }
 
 void Document::CheckReadOnly() {
@@ -753,6 +1653,15 @@ void Document::CheckReadOnly() {
 	}
 }
 
+// The lines of a mapped file are found as they are needed. Watchers see the new lines
+// as lines added at the end of the text that was already indexed.
+void Document::IndexLines(int upTo) {
+	const int indexedTo = cb.IndexedTo();
+	const int linesAdded = cb.IndexLines(upTo);
+	if (linesAdded > 0)
+		NotifyModified(DocModification(SC_MOD_LINESINDEXED, indexedTo, 0, linesAdded));
+}
+
 // Document only modified by gateways DeleteChars, InsertString, Undo, Redo, and SetStyleAt.
 // SetStyleAt does not change the persistent state of a document
 
@@ -767,6 +1676,7 @@ bool Document::DeleteChars(int pos, int len) {
 	} else {
 		enteredModification++;
 		if (!cb.IsReadOnly()) {
+			IndexLines(pos + len + 1);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_BEFOREDELETE | SC_PERFORMED_USER,
@@ -778,10 +1688,7 @@ bool Document::DeleteChars(int pos, int len) {
 			const char *text = cb.DeleteChars(pos, len, startSequence);
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
-			if ((pos < Length()) || (pos == 0))
-				ModifiedAt(pos);
-			else
-				ModifiedAt(pos-1);
+			TextChanged(pos, 0, len);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_DELETETEXT | SC_PERFORMED_USER | (startSequence?SC_STARTACTION:0),
@@ -806,6 +1713,7 @@ bool Document::InsertString(int position, const char *s, int insertLength) {
 	} else {
 		enteredModification++;
 		if (!cb.IsReadOnly()) {
+			IndexLines(position + 1);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_BEFOREINSERT | SC_PERFORMED_USER,
@@ -817,7 +1725,7 @@ bool Document::InsertString(int position, const char *s, int insertLength) {
 			const char *text = cb.InsertString(position, s, insertLength, startSequence);
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
-			ModifiedAt(position);
+			TextChanged(position, insertLength, 0);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_INSERTTEXT | SC_PERFORMED_USER | (startSequence?SC_STARTACTION:0),
@@ -826,13 +1734,117 @@ bool Document::InsertString(int position, const char *s, int insertLength) {
 		}
 		enteredModification--;
 	}
+	if (logLineLimit > 0)
+		TrimLog();
+	return !cb.IsReadOnly();
+}
+
+void Document::SetLogLineLimit(int lines) {
+	logLineLimit = (lines > 0) ? lines : 0;
+	TrimLog();
+}
+
+void Document::TrimLog() {
+	const int linesExcess = LinesTotal() - logLineLimit;
+	if ((logLineLimit <= 0) || (linesExcess <= 0) || (enteredModification != 0))
+		return;
+	// Trimming is not undone and leaves any undo history pointing at the wrong text
+	const bool collectingUndo = cb.IsCollectingUndo();
+	if (collectingUndo)
+		cb.SetUndoCollection(false);
+	const int lengthTrim = LineStart(linesExcess);
+	// The remaining lines keep their styles so are not styled again
+	const int endStyledKept = endStyled - lengthTrim;
+	if (DeleteChars(0, lengthTrim)) {
+		logLinesTrimmed += linesExcess;
+		if (endStyled < endStyledKept)
+			endStyled = endStyledKept;
+	}
+	if (collectingUndo) {
+		cb.SetUndoCollection(true);
+		cb.DeleteUndoHistory();
+	}
+}
+
+/**
+ * Replace ranges, sorted by position and not overlapping, with their texts. Working
+ * forward through the document moves the gap and the line starts at most once past each
+ * position. The changes are one undo group and watchers see a single modification
+ * covering the text from the start of the first range to the end of the last, with the
+ * lines each replacement removed and added so views can adjust their lines one
+ * replacement at a time. Each replacement must have its length set rather than -1.
+ */
+bool Document::ReplaceRanges(const Sci_Replacement *replacements, int count) {
+	if (count <= 0)
+		return false;
+	int endPrevious = 0;
+	for (int i = 0; i < count; i++) {
+		const Sci_CharacterRange &chrg = replacements[i].chrg;
+		if ((chrg.cpMin < endPrevious) || (chrg.cpMax < chrg.cpMin) ||
+			(chrg.cpMax > Length()) || (replacements[i].length < 0) ||
+			(!replacements[i].text && (replacements[i].length > 0)))
+			return false;
+		endPrevious = static_cast<int>(chrg.cpMax);
+	}
+	CheckReadOnly();
+	if (enteredModification != 0) {
+		return false;
+	} else {
+		enteredModification++;
+		if (!cb.IsReadOnly()) {
+			const int start = static_cast<int>(replacements[0].chrg.cpMin);
+			IndexLines(endPrevious + 1);
+			int prevLinesTotal = LinesTotal();
+			bool startSavePoint = cb.IsSavePoint();
+			bool startAction = false;
+			int delta = 0;
+			std::vector<ReplacementLines> replacementLines(count);
+			cb.BeginUndoAction();
+			for (int i = 0; i < count; i++) {
+				const int position = static_cast<int>(replacements[i].chrg.cpMin) + delta;
+				const int lengthDelete = static_cast<int>(replacements[i].chrg.cpMax - replacements[i].chrg.cpMin);
+				const int lengthInsert = static_cast<int>(replacements[i].length);
+				bool startSequence = false;
+				const int linesBefore = LinesTotal();
+				if (lengthDelete > 0) {
+					cb.DeleteChars(position, lengthDelete, startSequence);
+					decorations.DeleteRange(position, lengthDelete);
+					startAction = startAction || startSequence;
+				}
+				const int linesAfterDelete = LinesTotal();
+				if (lengthInsert > 0) {
+					cb.InsertString(position, replacements[i].text, lengthInsert, startSequence);
+					decorations.InsertSpace(position, lengthInsert);
+					startAction = startAction || startSequence;
+				}
+				replacementLines[i].removed = linesBefore - linesAfterDelete;
+				replacementLines[i].added = LinesTotal() - linesAfterDelete;
+				TextChanged(position, lengthInsert, lengthDelete);
+				delta += lengthInsert - lengthDelete;
+			}
+			cb.EndUndoAction();
+			if (startSavePoint && cb.IsCollectingUndo())
+				NotifySavePoint(!startSavePoint);
+			DocModification mh(
+			    SC_MOD_REPLACERANGES | SC_PERFORMED_USER | (startAction?SC_STARTACTION:0),
+			    start, endPrevious + delta - start,
+			    LinesTotal() - prevLinesTotal, 0);
+			mh.replacements = replacements;
+			mh.countReplacements = count;
+			mh.replacementLines = &replacementLines[0];
+			NotifyModified(mh);
+		}
+		enteredModification--;
+	}
+	if (logLineLimit > 0)
+		TrimLog();
 	return !cb.IsReadOnly();
 }
 
 int SCI_METHOD Document::AddData(char *data, int length) {
 	try {
-		int position = Length();
-		InsertString(position,data, length);
+		// Lines are found for all the data at once by ConvertToDocument
+		cb.AppendWithoutLines(data, length);
 	} catch (std::bad_alloc &) {
 		return SC_STATUS_BADALLOC;
 	} catch (...) {
@@ -842,9 +1854,63 @@ int SCI_METHOD Document::AddData(char *data, int length) {
 }
 
 void * SCI_METHOD Document::ConvertToDocument() {
+	try {
+		cb.IndexLines(cb.Length());
+	} catch (std::bad_alloc &) {
+		Release();
+		return 0;
+	}
 	return this;
 }
 
+/// Presents a CellSnapshot as an ISnapshot with a reference count that may be
+/// changed from any thread.
+class DocumentSnapshot : public ISnapshot {
+	int references;
+	CellSnapshot *cs;
+public:
+	explicit DocumentSnapshot(CellSnapshot *cs_) : references(1), cs(cs_) {
+	}
+	virtual ~DocumentSnapshot() {
+		delete cs;
+	}
+	void SCI_METHOD AddRef() {
+		AtomicCount::Increment(&references);
+	}
+	void SCI_METHOD Release() {
+		if (AtomicCount::Decrement(&references))
+			delete this;
+	}
+	int SCI_METHOD Version() const {
+		return cs->Version();
+	}
+	long SCI_METHOD Length() const {
+		return static_cast<long>(cs->Length());
+	}
+	char SCI_METHOD CharAt(long position) const {
+		return cs->CharAt(position);
+	}
+	void SCI_METHOD GetCharRange(char *buffer, long position, long lengthRetrieve) const {
+		cs->GetCharRange(buffer, position, lengthRetrieve);
+	}
+	char SCI_METHOD StyleAt(long position) const {
+		return cs->StyleAt(position);
+	}
+	void SCI_METHOD GetStyleRange(char *buffer, long position, long lengthRetrieve) const {
+		cs->GetStyleRange(reinterpret_cast<unsigned char *>(buffer), position, lengthRetrieve);
+	}
+	const char * SCI_METHOD TextSegment(long position, long *lengthSegment) const {
+		Sci_Position length = 0;
+		const char *segment = cs->TextSegment(position, length);
+		*lengthSegment = static_cast<long>(length);
+		return segment;
+	}
+};
+
+ISnapshot *Document::CreateSnapshot(bool withStyles) {
+	return new DocumentSnapshot(cb.CreateSnapshot(withStyles));
+}
+
 int Document::Undo() {
 	int newPos = -1;
 	CheckReadOnly();
@@ -872,7 +1938,10 @@ int Document::Undo() {
 				cb.PerformUndoStep();
 				int cellPosition = action.position;
 				if (action.at != containerAction) {
-					ModifiedAt(cellPosition);
+					if (action.at == removeAction)
+						TextChanged(cellPosition, action.lenData, 0);
+					else
+						TextChanged(cellPosition, 0, action.lenData);
 					newPos = cellPosition;
 				}
 
@@ -932,7 +2001,10 @@ int Document::Redo() {
 				}
 				cb.PerformRedoStep();
 				if (action.at != containerAction) {
-					ModifiedAt(action.position);
+					if (action.at == insertAction)
+						TextChanged(action.position, action.lenData, 0);
+					else
+						TextChanged(action.position, 0, action.lenData);
 					newPos = action.position;
 				}
 
@@ -1005,10 +2077,6 @@ void Document::DelCharBack(int pos) {
 	}
 }
 
-static int NextTab(int pos, int tabSize) {
-	return ((pos / tabSize) + 1) * tabSize;
-}
-
 static void CreateIndentation(char *linebuf, int length, int indent, int tabSize, bool insertSpaces) {
 	length--;	// ensure space for \0
 	if (!insertSpaces) {
@@ -1679,12 +2747,16 @@ bool SCI_METHOD Document::SetStyles(int length, const char *styles) {
 }
 
 void Document::EnsureStyledTo(int pos) {
+	if (pli && (enteredStyling == 0) && (pos > GetEndStyled())) {
+		// A worker may already have styled far enough
+		pli->MergeBackground();
+	}
 	if ((enteredStyling == 0) && (pos > GetEndStyled())) {
+		// Lexers read the text throughout so it is expanded once first
+		Rehydrate();
 		IncrementStyleClock();
 		if (pli && !pli->UseContainerLexing()) {
-			int lineEndStyled = LineFromPosition(GetEndStyled());
-			int endStyledTo = LineStart(lineEndStyled);
-			pli->Colourise(endStyledTo, pos);
+			pli->Colourise(RestartPosition(GetEndStyled()), pos);
 		} else {
 			// Ask the watchers to style, and stop as soon as one responds.
 			for (int i = 0; pos > GetEndStyled() && i < lenWatchers; i++) {
@@ -1694,7 +2766,82 @@ void Document::EnsureStyledTo(int pos) {
 	}
 }
 
+void Document::RestyledTo(int pos, bool converged) {
+	if (converged) {
+		if (endStyled < stylesKeptEnd)
+			endStyled = stylesKeptEnd;
+		stylesKeptEnd = 0;
+		changesEnd = 0;
+	} else if (pos > changesEnd) {
+		changesEnd = pos;
+		if (changesEnd >= stylesKeptEnd) {
+			stylesKeptEnd = 0;
+			changesEnd = 0;
+		}
+	}
+}
+
+int Document::RestartPointAfter(int pos) const {
+	return restarts->After(pos);
+}
+
+int Document::RestartPointLineState(int position) const {
+	return restarts->LineStateBefore(position);
+}
+
+void Document::RemoveRestartPoints(int start, int end) {
+	restarts->Remove(start, end);
+}
+
+int Document::RestartPosition(int pos) const {
+	return Platform::Maximum(LineStart(LineFromPosition(pos)), restarts->Before(pos));
+}
+
+void SCI_METHOD Document::SetRestartPoint(int position) {
+	if (recordingRestarts && (restartsDeclared.empty() || (restartsDeclared.back() < position)))
+		restartsDeclared.push_back(position);
+	if (!restarts->Close(position))
+		restarts->Add(position, LineStart(LineFromPosition(position)),
+			GetLineState(LineFromPosition(position) - 1));
+}
+
+void Document::RecordRestartPoints(bool record) {
+	if (record)
+		restartsDeclared.clear();
+	recordingRestarts = record;
+}
+
+bool Document::RestartPointDeclared(int position) const {
+	return std::binary_search(restartsDeclared.begin(), restartsDeclared.end(), position);
+}
+
+bool Document::StyleInBackground() {
+	return pli && pli->StyleInBackground();
+}
+
+bool Document::StyleWhileIdle(double duration, int step) {
+	// A hibernating document is styled again once shown and a worker thread
+	// lexing the document does not need help
+	if (IsHibernating() || StyleInBackground())
+		return false;
+	ElapsedTime et;
+	while (GetEndStyled() < Length()) {
+		const int endStyledBefore = GetEndStyled();
+		EnsureStyledTo(Platform::Minimum(endStyledBefore + step, Length()));
+		// A container that does not style when asked stops idle styling
+		if (GetEndStyled() <= endStyledBefore)
+			return false;
+		if (et.Duration() >= duration)
+			break;
+	}
+	return GetEndStyled() < Length();
+}
+
 void Document::LexerChanged() {
+	// Styles and restart points kept from before were made by the previous lexer
+	stylesKeptEnd = 0;
+	changesEnd = 0;
+	restarts->DeleteAll();
 	// Tell the watchers the lexer has changed.
 	for (int i = 0; i < lenWatchers; i++) {
 		watchers[i].watcher->NotifyLexerChanged(this, watchers[i].userData);
@@ -1719,6 +2866,10 @@ int Document::GetMaxLineState() {
 }
 
 void SCI_METHOD Document::ChangeLexerState(int start, int end) {
+	// State the lexer carries beyond end has changed, so the text after it would not be
+	// styled as before even where the line states are the same
+	stylesKeptEnd = 0;
+	changesEnd = 0;
 	DocModification mh(SC_MOD_LEXERSTATE, start, end-start, 0, 0, 0);
 	NotifyModified(mh);
 }
@@ -1755,6 +2906,19 @@ void Document::MarginClearAll() {
 	static_cast<LineAnnotation *>(perLineData[ldMargin])->ClearAll();
 }
 
+void Document::MarginSetTexts(int count, const Sci_LineText *texts) {
+	LineAnnotation *pla = static_cast<LineAnnotation *>(perLineData[ldMargin]);
+	for (int i = 0; i < count; i++) {
+		if (texts[i].line >= 0 && texts[i].line < LinesTotal())
+			pla->SetText(texts[i].line, texts[i].text);
+	}
+	// One notification for all the lines so the margin is only redrawn once
+	DocModification mh(SC_MOD_CHANGEMARGIN, 0, 0, 0, 0, -1);
+	mh.lineTexts = texts;
+	mh.countLineTexts = count;
+	NotifyModified(mh);
+}
+
 bool Document::AnnotationAny() const {
 	return static_cast<LineAnnotation *>(perLineData[ldAnnotation])->AnySet();
 }
@@ -1804,14 +2968,35 @@ void Document::AnnotationClearAll() {
 	static_cast<LineAnnotation *>(perLineData[ldAnnotation])->ClearAll();
 }
 
+void Document::AnnotationSetTexts(int count, const Sci_LineText *texts) {
+	LineAnnotation *pla = static_cast<LineAnnotation *>(perLineData[ldAnnotation]);
+	int linesAdded = 0;
+	for (int i = 0; i < count; i++) {
+		const int line = texts[i].line;
+		if (line >= 0 && line < LinesTotal()) {
+			const int linesBefore = pla->Lines(line);
+			pla->SetText(line, texts[i].text);
+			linesAdded += pla->Lines(line) - linesBefore;
+		}
+	}
+	// One notification for all the lines which views use to update the height of each
+	DocModification mh(SC_MOD_CHANGEANNOTATION, 0, 0, 0, 0, -1);
+	mh.annotationLinesAdded = linesAdded;
+	mh.lineTexts = texts;
+	mh.countLineTexts = count;
+	NotifyModified(mh);
+}
+
 void Document::IncrementStyleClock() {
 	styleClock = (styleClock + 1) % 0x100000;
 }
 
 void SCI_METHOD Document::DecorationFillRange(int position, int value, int fillLength) {
-	if (decorations.FillRange(position, value, fillLength)) {
+	Sci_Position fillStart = position;
+	Sci_Position fillRemaining = fillLength;
+	if (decorations.FillRange(fillStart, value, fillRemaining)) {
 		DocModification mh(SC_MOD_CHANGEINDICATOR | SC_PERFORMED_USER,
-							position, fillLength);
+							fillStart, fillRemaining);
 		NotifyModified(mh);
 	}
 }
@@ -16,7 +16,7 @@ namespace Scintilla {
  * A Position is a position within a document between two characters or at the beginning or end.
  * Sometimes used as a character index where it identifies the character after the position.
  */
-typedef int Position;
+typedef Sci_Position Position;
 const Position invalidPosition = -1;
 
 /**
@@ -173,27 +173,54 @@ public:
 	void StandardASCII();
 };
 
+class RestartPoints;
 class Document;
+class BackgroundLexer;
 
 class LexInterface {
 protected:
 	Document *pdoc;
 	ILexer *instance;
 	bool performingStyle;	///< Prevent reentrance
+	/// Whether text beyond what has been styled is lexed on a worker thread
+	bool background;
+	/// The worker lexing a snapshot of the document, or 0 when none is running
+	BackgroundLexer *job;
+	void StartBackground();
+	void LexRange(int start, int end);
+	void FoldRange(int start, int end);
+	int LexUntilConverged(int start, int end);
+	void FoldUntilConverged(int pos);
 public:
-	LexInterface(Document *pdoc_) : pdoc(pdoc_), instance(0), performingStyle(false) {
+	LexInterface(Document *pdoc_) : pdoc(pdoc_), instance(0), performingStyle(false),
+		background(false), job(0) {
 	}
 	virtual ~LexInterface() {
+		StopBackground();
 	}
 	void Colourise(int start, int end);
 	bool UseContainerLexing() const {
 		return instance == 0;
 	}
+	void SetBackground(bool background_);
+	bool Background() const {
+		return background;
+	}
+	/// Merge what the worker has finished and start a worker for any text not yet
+	/// styled. @return true while a worker is running.
+	bool StyleInBackground();
+	/// Apply the chunks the worker has finished to the document.
+	void MergeBackground();
+	/// Discard the worker and its unmerged results. Waits for the lexer instance to be
+	/// released by the worker, so must be called before the instance is used or changed.
+	void StopBackground();
+	/// Text from pos on has changed so worker results beyond pos are stale.
+	void InvalidateBackground(int pos) const;
 };
 
 /**
  */
-class Document : PerLine, public IDocument, public ILoader {
+class Document : PerLine, public IDocumentWithTextSegments, public ILoader {
 
 public:
 	/** Used to pair watcher pointer with user data. */
@@ -218,6 +245,22 @@ private:
 	int enteredModification;
 	int enteredStyling;
 	int enteredReadOnlyCount;
+	/// Lines kept when text is inserted, 0 for no limit
+	int logLineLimit;
+	/// Lines deleted from the start to stay within logLineLimit
+	int logLinesTrimmed;
+	/// After the text changes, the styles it had before run on to stylesKeptEnd, moving
+	/// with the text. Restyling may stop at a line after changesEnd that it reaches in the
+	/// same state as before and keep them. None are kept unless it is beyond endStyled.
+	int stylesKeptEnd;
+	/// The end of the changed text and of any restyled since, whose line states and
+	/// fold levels from before are gone
+	int changesEnd;
+	/// Positions within lines where the lexer can start again
+	RestartPoints *restarts;
+	/// While recording, the restart points the lexer declares, kept in ascending order
+	bool recordingRestarts;
+	std::vector<int> restartsDeclared;
 
 	WatcherWithUserData *watchers;
 	int lenWatchers;
@@ -248,7 +291,7 @@ public:
 
 	DecorationList decorations;
 
-	Document();
+	explicit Document(int documentOptions=SC_DOCUMENTOPTION_DEFAULT);
 	virtual ~Document();
 
 	int AddRef();
@@ -256,10 +299,13 @@ public:
 
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
+	virtual size_t Memory() const;
+	virtual void Shrink();
 
 	int SCI_METHOD Version() const {
-		return dvOriginal;
+		return dvTextSegments;
 	}
 
 	void SCI_METHOD SetErrorStatus(int status);
@@ -281,6 +327,7 @@ public:
 	void CheckReadOnly();
 	bool DeleteChars(int pos, int len);
 	bool InsertString(int position, const char *s, int insertLength);
+	bool ReplaceRanges(const Sci_Replacement *replacements, int count);
 	int SCI_METHOD AddData(char *data, int length);
 	void * SCI_METHOD ConvertToDocument();
 	int Undo();
@@ -288,6 +335,22 @@ public:
 	bool CanUndo() { return cb.CanUndo(); }
 	bool CanRedo() { return cb.CanRedo(); }
 	void DeleteUndoHistory() { cb.DeleteUndoHistory(); }
+	void SetUndoMemoryLimit(Sci_Position limit) { cb.SetUndoMemoryLimit(limit); }
+	Sci_Position UndoMemoryLimit() const { return cb.UndoMemoryLimit(); }
+	size_t UndoMemory() const { return cb.UndoMemory(); }
+	/// Fill in the memory used by the document, leaving the members for view caches alone.
+	void GetMemoryUsage(Sci_MemoryUsage *usage) const;
+	/// Compress the text and discard the styles until the document is used again.
+	void Hibernate();
+	void Rehydrate() { cb.Rehydrate(); }
+	bool IsHibernating() const { return cb.IsHibernating(); }
+	/// Keep only the last lines lines, as for a log, or all of them when lines is 0.
+	void SetLogLineLimit(int lines);
+	int LogLineLimit() const { return logLineLimit; }
+	/// Lines deleted by the line limit, which is added to line numbers shown so they stay the same.
+	int LogLinesTrimmed() const { return logLinesTrimmed; }
+	void TrimLog();
+	int UndoActions() const { return cb.UndoActions(); }
 	bool SetUndoCollection(bool collectUndo) {
 		return cb.SetUndoCollection(collectUndo);
 	}
@@ -297,7 +360,24 @@ public:
 	void AddUndoAction(int token, bool mayCoalesce) { cb.AddUndoAction(token, mayCoalesce); }
 	void SetSavePoint();
 	bool IsSavePoint() { return cb.IsSavePoint(); }
+	int DocumentOptions() const { return cb.DocumentOptions(); }
+	bool SetMappedFile(MappedFile *mappedFile) { return cb.SetMappedFile(mappedFile); }
+	int IndexedTo() const { return cb.IndexedTo(); }
+	void IndexLines(int upTo);
 	const char * SCI_METHOD BufferPointer() { return cb.BufferPointer(); }
+	const char *TextSegment(Sci_Position position, Sci_Position &lengthSegment) const {
+		return cb.TextSegment(position, lengthSegment);
+	}
+	const char * SCI_METHOD TextSegment(int position, int *lengthSegment) const {
+		Sci_Position length = 0;
+		const char *segment = cb.TextSegment(position, length);
+		*lengthSegment = static_cast<int>(length);
+		return segment;
+	}
+	int TextVersion() const { return cb.TextVersion(); }
+	/// A snapshot of the text and styles with one reference for the caller.
+	/// Freeze the text and, unless withStyles is false, the styles. See CellBuffer::CreateSnapshot.
+	ISnapshot *CreateSnapshot(bool withStyles=true);
 
 	int SCI_METHOD GetLineIndentation(int line);
 	void SetLineIndentation(int line, int indent);
@@ -327,11 +407,13 @@ public:
 	}
 	int GetMark(int line);
 	int MarkerNext(int lineStart, int mask) const;
+	int MarkerPrevious(int lineStart, int mask) const;
 	int AddMark(int line, int markerNum);
 	void AddMarkSet(int line, int valueSet);
 	void DeleteMark(int line, int markerNum);
 	void DeleteMarkFromHandle(int markerHandle);
 	void DeleteAllMarks(int markerNum);
+	void SetMarkMasks(int count, const Sci_MarkerMask *masks);
 	int LineFromHandle(int markerHandle);
 	int SCI_METHOD LineStart(int line) const;
 	int LineEnd(int line) const;
@@ -368,7 +450,31 @@ public:
 	bool SCI_METHOD SetStyleFor(int length, char style);
 	bool SCI_METHOD SetStyles(int length, const char *styles);
 	int GetEndStyled() { return endStyled; }
+	int StylesKeptEnd() const { return stylesKeptEnd; }
+	int ChangesEnd() const { return changesEnd; }
+	/// Restyling after a change reached pos. When converged, it found the lexer in the
+	/// same state as before so the kept styles are used, otherwise they are kept only
+	/// beyond pos.
+	void RestyledTo(int pos, bool converged);
+	/// Where lexing starts to style the text from pos: the last restart point at or
+	/// before pos on its line, otherwise the line start.
+	int RestartPosition(int pos) const;
+	/// The first restart point after pos or -1 when there is none.
+	int RestartPointAfter(int pos) const;
+	/// The state of the line before the restart point at position from when it was declared.
+	int RestartPointLineState(int position) const;
+	/// Remove the restart points after start up to and including end before restyling.
+	void RemoveRestartPoints(int start, int end);
+	void SCI_METHOD SetRestartPoint(int position);
+	/// Start or stop listing the restart points the lexer declares, clearing the list on start.
+	void RecordRestartPoints(bool record);
+	bool RestartPointDeclared(int position) const;
 	void EnsureStyledTo(int pos);
+	/// Continue styling on a worker thread. @return true while there is more to do.
+	bool StyleInBackground();
+	/// Style and fold the text after the styled region for about duration seconds, step
+	/// bytes at a time. @return true when there is more to style.
+	bool StyleWhileIdle(double duration, int step);
 	void LexerChanged();
 	int GetStyleClock() { return styleClock; }
 	void IncrementStyleClock();
@@ -388,6 +494,7 @@ public:
 	void MarginSetText(int line, const char *text);
 	int MarginLength(int line) const;
 	void MarginClearAll();
+	void MarginSetTexts(int count, const Sci_LineText *texts);
 
 	bool AnnotationAny() const;
 	StyledText AnnotationStyledText(int line);
@@ -397,6 +504,7 @@ public:
 	int AnnotationLength(int line) const;
 	int AnnotationLines(int line) const;
 	void AnnotationClearAll();
+	void AnnotationSetTexts(int count, const Sci_LineText *texts);
 
 	bool AddWatcher(DocWatcher *watcher, void *userData);
 	bool RemoveWatcher(DocWatcher *watcher, void *userData);
@@ -419,6 +527,7 @@ private:
 	bool IsWordEndAt(int pos);
 	bool IsWordAt(int start, int end);
 
+	void TextChanged(int pos, int lengthInserted, int lengthDeleted);
 	void NotifyModifyAttempt();
 	void NotifySavePoint(bool atSavePoint);
 	void NotifyModified(DocModification mh);
@@ -445,6 +554,13 @@ public:
 };
 
 
+/// The lines that a replacement of SC_MOD_REPLACERANGES removed by deleting its range
+/// and then added by inserting its text.
+struct ReplacementLines {
+	int removed;
+	int added;
+};
+
 /**
  * To optimise processing of document modifications by DocWatchers, a hint is passed indicating the
  * scope of the change.
@@ -462,6 +578,14 @@ public:
 	int foldLevelPrev;
 	int annotationLinesAdded;
 	int token;
+	/// For SC_MOD_REPLACERANGES, the replacements in their positions before the change.
+	const Sci_Replacement *replacements;
+	int countReplacements;
+	/// For SC_MOD_REPLACERANGES, the lines changed by each replacement in the same order.
+	const ReplacementLines *replacementLines;
+	/// For SC_MOD_CHANGEMARGIN and SC_MOD_CHANGEANNOTATION from setting many lines, the lines set.
+	const Sci_LineText *lineTexts;
+	int countLineTexts;
 
 	DocModification(int modificationType_, int position_=0, int length_=0,
 		int linesAdded_=0, const char *text_=0, int line_=0) :
@@ -474,7 +598,12 @@ public:
 		foldLevelNow(0),
 		foldLevelPrev(0),
 		annotationLinesAdded(0),
-		token(0) {}
+		token(0),
+		replacements(0),
+		countReplacements(0),
+		replacementLines(0),
+		lineTexts(0),
+		countLineTexts(0) {}
 
 	DocModification(int modificationType_, const Action &act, int linesAdded_=0) :
 		modificationType(modificationType_),
@@ -486,7 +615,12 @@ public:
 		foldLevelNow(0),
 		foldLevelPrev(0),
 		annotationLinesAdded(0),
-		token(0) {}
+		token(0),
+		replacements(0),
+		countReplacements(0),
+		replacementLines(0),
+		lineTexts(0),
+		countLineTexts(0) {}
 };
 
 /**
@@ -195,6 +195,7 @@ Editor::Editor() {
 
 	paintState = notPainting;
 	willRedrawAll = false;
+	idleStyling = false;
 
 	modEventMask = SC_MODEVENTMASKALL;
 
@@ -1941,7 +1942,7 @@ void Editor::PaintSelMargin(Surface *surfWindow, PRectangle &rc) {
 				if (vs.ms[margin].style == SC_MARGIN_NUMBER) {
 					if (firstSubLine) {
 						char number[100];
-						sprintf(number, "%d", lineDoc + 1);
+						sprintf(number, "%d", lineDoc + 1 + pdoc->LogLinesTrimmed());
 						if (foldFlags & SC_FOLDFLAG_LEVELNUMBERS) {
 							int lev = pdoc->GetLevel(lineDoc);
 							sprintf(number, "%c%c %03X %03X",
@@ -3511,10 +3512,14 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 	//	paintingAllText, rcArea.left, rcArea.top, rcArea.right, rcArea.bottom);
 	AllocateGraphics();
 
+	// Showing a hibernating document is the moment to bring it back
+	pdoc->Rehydrate();
+
 	RefreshStyleData();
 	RefreshPixMaps(surfaceWindow);
 
 	StyleToPositionInView(PositionAfterArea(rcArea));
+	StartIdleStyling();
 
 	PRectangle rcClient = GetClientRectangle();
 	//Platform::DebugPrintf("Client: (%3d,%3d) ... (%3d,%3d)   %d\n",
@@ -3902,7 +3907,7 @@ long Editor::FormatRange(bool draw, Sci_RangeToFormat *pfr) {
 		        (ypos + vsPrint.lineHeight <= pfr->rc.bottom) &&
 		        (visibleLine >= 0)) {
 			char number[100];
-			sprintf(number, "%d" lineNumberPrintSpace, lineDoc + 1);
+			sprintf(number, "%d" lineNumberPrintSpace, lineDoc + 1 + pdoc->LogLinesTrimmed());
 			PRectangle rcNumber = rcLine;
 			rcNumber.right = rcNumber.left + lineNumberWidth;
 			// Right justify
@@ -4555,10 +4560,14 @@ void Editor::NotifySavePoint(Document *, void *, bool atSavePoint) {
 }
 
 void Editor::CheckModificationForWrap(DocModification mh) {
-	if (mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) {
+	if (mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT | SC_MOD_REPLACERANGES)) {
 		llc.Invalidate(LineLayout::llCheckTextAndStyle);
 		int lineDoc = pdoc->LineFromPosition(mh.position);
 		int lines = Platform::Maximum(0, mh.linesAdded);
+		if (mh.modificationType & SC_MOD_REPLACERANGES) {
+			// Replacements may have changed any of the lines they span
+			lines = pdoc->LineFromPosition(mh.position + mh.length) - lineDoc;
+		}
 		if (wrapState != eWrapNone) {
 			NeedWrapping(lineDoc, lineDoc + lines + 1);
 		}
@@ -4591,6 +4600,22 @@ static inline int MovePositionForDeletion(int position, int startDeletion, int l
 	}
 }
 
+// Move a position as the replacements of a SC_MOD_REPLACERANGES modification moved it:
+// along by the change in length of the replacements before it and to the start of any
+// replacement that it was inside.
+static int MovePositionForReplacements(int position, const DocModification &mh) {
+	int delta = 0;
+	for (int i = 0; i < mh.countReplacements; i++) {
+		const Sci_Replacement &replacement = mh.replacements[i];
+		if (position <= replacement.chrg.cpMin)
+			break;
+		if (position <= replacement.chrg.cpMax)
+			return static_cast<int>(replacement.chrg.cpMin) + delta;
+		delta += static_cast<int>(replacement.length - (replacement.chrg.cpMax - replacement.chrg.cpMin));
+	}
+	return position + delta;
+}
+
 void Editor::NotifyModified(Document *, DocModification mh, void *) {
 	ContainerNeedsUpdate(SC_UPDATE_CONTENT);
 	if (paintState == painting) {
@@ -4638,6 +4663,35 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 			sel.MovePositions(false, mh.position, mh.length);
 			braces[0] = MovePositionForDeletion(braces[0], mh.position, mh.length);
 			braces[1] = MovePositionForDeletion(braces[1], mh.position, mh.length);
+		} else if (mh.modificationType & SC_MOD_REPLACERANGES) {
+			for (size_t r=0; r<sel.Count(); r++) {
+				SelectionRange &range = sel.Range(r);
+				const int caret = MovePositionForReplacements(range.caret.Position(), mh);
+				if (caret != range.caret.Position())
+					range.caret.SetPosition(caret);
+				const int anchor = MovePositionForReplacements(range.anchor.Position(), mh);
+				if (anchor != range.anchor.Position())
+					range.anchor.SetPosition(anchor);
+			}
+			braces[0] = MovePositionForReplacements(braces[0], mh);
+			braces[1] = MovePositionForReplacements(braces[1], mh);
+			// Update contraction state as if each replacement were a deletion then an
+			// insertion, at its line which the later replacements do not move
+			int delta = 0;
+			for (int i = 0; i < mh.countReplacements; i++) {
+				const Sci_Replacement &replacement = mh.replacements[i];
+				const ReplacementLines &lines = mh.replacementLines[i];
+				if (lines.removed || lines.added) {
+					const int lineOfPos = pdoc->LineFromPosition(static_cast<int>(replacement.chrg.cpMin) + delta);
+					cs.DeleteLines(lineOfPos, lines.removed);
+					cs.InsertLines(lineOfPos, lines.added);
+				}
+				delta += static_cast<int>(replacement.length - (replacement.chrg.cpMax - replacement.chrg.cpMin));
+			}
+			if (cs.HiddenLines()) {
+				// Replacements are only reported afterwards so show the lines they reached
+				NotifyNeedShown(mh.position, mh.length);
+			}
 		}
 		if ((mh.modificationType & (SC_MOD_BEFOREINSERT | SC_MOD_BEFOREDELETE)) && cs.HiddenLines()) {
 			// Some lines are hidden so may need shown.
@@ -4657,7 +4711,7 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 				NotifyNeedShown(mh.position, mh.length);
 			}
 		}
-		if (mh.linesAdded != 0) {
+		if ((mh.linesAdded != 0) && !(mh.modificationType & SC_MOD_REPLACERANGES)) {
 			// Update contraction state for inserted and removed lines
 			// lineOfPos should be calculated in context of state before modification, shouldn't it
 			int lineOfPos = pdoc->LineFromPosition(mh.position);
@@ -4667,7 +4721,14 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 				cs.DeleteLines(lineOfPos, -mh.linesAdded);
 			}
 		}
-		if (mh.modificationType & SC_MOD_CHANGEANNOTATION) {
+		if ((mh.modificationType & SC_MOD_CHANGEANNOTATION) && mh.lineTexts) {
+			// Many lines changed so work out each height again rather than adjusting it
+			for (int i=0; i<mh.countLineTexts; i++) {
+				const int lineDoc = mh.lineTexts[i].line;
+				if (lineDoc >= 0)
+					SetAnnotationHeights(lineDoc, lineDoc + 1);
+			}
+		} else if (mh.modificationType & SC_MOD_CHANGEANNOTATION) {
 			int lineDoc = pdoc->LineFromPosition(mh.position);
 			if (vs.annotationVisible) {
 				cs.SetHeight(lineDoc, cs.GetHeight(lineDoc) + mh.annotationLinesAdded);
@@ -6641,6 +6702,8 @@ void Editor::Tick() {
 			NotifyDwelling(ptMouseLast, dwelling);
 		}
 	}
+	// Merge what a worker thread has lexed, or start one for text not yet styled
+	pdoc->StyleInBackground();
 }
 
 bool Editor::Idle() {
@@ -6662,7 +6725,22 @@ bool Editor::Idle() {
 	// false will stop calling this idle funtion until SetIdle() is
 	// called again.
 
-	idleDone = wrappingDone; // && thatDone && theOtherThingDone...
+	bool indexingDone = pdoc->IndexedTo() >= pdoc->Length();
+
+	if (!indexingDone) {
+		// Find the lines of a mapped file a few megabytes at a time.
+		pdoc->IndexLines(pdoc->IndexedTo() + 0x400000);
+		indexingDone = pdoc->IndexedTo() >= pdoc->Length();
+	}
+
+	bool stylingDone = !idleStyling;
+
+	if (!stylingDone) {
+		// Style the rest of the document a slice at a time.
+		stylingDone = !StyleWhileIdle();
+	}
+
+	idleDone = wrappingDone && indexingDone && stylingDone; // && thatDone && theOtherThingDone...
 
 	return !idleDone;
 }
@@ -6720,6 +6798,23 @@ void Editor::QueueStyling(int upTo) {
 	styleNeeded.NeedUpTo(upTo);
 }
 
+/// Each idle call styles for about this many seconds before returning to the event loop.
+static const double idleStylingSlice = 0.005;
+/// Styling is asked for this much text at a time until the slice has been used.
+static const int idleStylingStep = 0x2000;
+
+void Editor::StartIdleStyling() {
+	if (idleStyling && (pdoc->GetEndStyled() < pdoc->Length()))
+		SetIdle(true);
+}
+
+// Style and fold the text after what has been styled for display so that moving
+// to any part of the document later does not wait for it to be lexed.
+// Returns true when there is more to style.
+bool Editor::StyleWhileIdle() {
+	return pdoc->StyleWhileIdle(idleStylingSlice, idleStylingStep);
+}
+
 bool Editor::PaintContains(PRectangle rc) {
 	if (rc.Empty()) {
 		return true;
@@ -6825,6 +6920,8 @@ void Editor::SetDocPointer(Document *document) {
 	pdoc->AddWatcher(this, 0);
 	SetScrollBars();
 	Redraw();
+	if (pdoc->IndexedTo() < pdoc->Length())
+		SetIdle(true);
 }
 
 void Editor::SetAnnotationVisible(int visible) {
@@ -7002,6 +7099,27 @@ int Editor::ReplaceTarget(bool replacePatterns, const char *text, int length) {
 	return length;
 }
 
+int Editor::ReplaceRanges(const Sci_Replacement *replacements, int count) {
+	if (count <= 0)
+		return 0;
+	// The document wants the length of every text so count any that are zero terminated
+	std::vector<Sci_Replacement> counted;
+	for (int i = 0; i < count; i++) {
+		if (replacements[i].length == -1) {
+			counted.assign(replacements, replacements + count);
+			for (size_t j = i; j < counted.size(); j++) {
+				if (counted[j].length == -1)
+					counted[j].length = counted[j].text ? istrlen(counted[j].text) : 0;
+			}
+			replacements = &counted[0];
+			break;
+		}
+	}
+	if (!pdoc->ReplaceRanges(replacements, count))
+		return -1;
+	return count;
+}
+
 bool Editor::IsUnicodeMode() const {
 	return pdoc && (SC_CP_UTF8 == pdoc->dbcsCodePage);
 }
@@ -7051,6 +7169,32 @@ static char *CharPtrFromSPtr(sptr_t lParam) {
 	return reinterpret_cast<char *>(lParam);
 }
 
+/// Messages about the document as a whole, which leave a hibernating document asleep.
+static bool LeavesHibernating(unsigned int iMessage) {
+	switch (iMessage) {
+	case SCI_HIBERNATE:
+	case SCI_REHYDRATE:
+	case SCI_ISHIBERNATING:
+	case SCI_GETMEMORYUSAGE:
+	case SCI_GETLENGTH:
+	case SCI_GETTEXTLENGTH:
+	case SCI_GETLINECOUNT:
+	case SCI_GETMODIFY:
+	case SCI_GETREADONLY:
+	case SCI_GETDOCUMENTOPTIONS:
+	case SCI_GETLOGLINELIMIT:
+	case SCI_GETLOGLINESTRIMMED:
+	case SCI_GETDOCPOINTER:
+	case SCI_SETDOCPOINTER:
+	case SCI_CREATEDOCUMENT:
+	case SCI_ADDREFDOCUMENT:
+	case SCI_RELEASEDOCUMENT:
+		return true;
+	default:
+		return false;
+	}
+}
+
 void Editor::StyleSetMessage(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	vs.EnsureStyle(wParam);
 	switch (iMessage) {
@@ -7162,6 +7306,11 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	if (recordingMacro)
 		NotifyMacroRecord(iMessage, wParam, lParam);
 
+	// Bring a hibernating document back once, here, rather than have each read of its
+	// text expand the compressed blocks again
+	if (pdoc->IsHibernating() && !LeavesHibernating(iMessage))
+		pdoc->Rehydrate();
+
 	switch (iMessage) {
 
 	case SCI_GETTEXT: {
@@ -7249,6 +7398,19 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->DeleteUndoHistory();
 		return 0;
 
+	case SCI_SETUNDOMEMORYLIMIT:
+		pdoc->SetUndoMemoryLimit(static_cast<Sci_Position>(wParam));
+		return 0;
+
+	case SCI_GETUNDOMEMORYLIMIT:
+		return pdoc->UndoMemoryLimit();
+
+	case SCI_GETUNDOMEMORY:
+		return static_cast<sptr_t>(pdoc->UndoMemory());
+
+	case SCI_GETUNDOACTIONS:
+		return pdoc->UndoActions();
+
 	case SCI_GETFIRSTVISIBLELINE:
 		return topLine;
 
@@ -7379,6 +7541,10 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		PLATFORM_ASSERT(lParam);
 		return ReplaceTarget(true, CharPtrFromSPtr(lParam), wParam);
 
+	case SCI_REPLACERANGES:
+		PLATFORM_ASSERT(lParam);
+		return ReplaceRanges(reinterpret_cast<const Sci_Replacement *>(lParam), wParam);
+
 	case SCI_SEARCHINTARGET:
 		PLATFORM_ASSERT(lParam);
 		return SearchInTarget(CharPtrFromSPtr(lParam), wParam);
@@ -7928,6 +8094,14 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		llc.SetLevel(wParam);
 		break;
 
+	case SCI_SETIDLESTYLING:
+		idleStyling = wParam != 0;
+		StartIdleStyling();
+		break;
+
+	case SCI_GETIDLESTYLING:
+		return idleStyling;
+
 	case SCI_GETLAYOUTCACHE:
 		return llc.GetLevel();
 
@@ -8132,13 +8306,13 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_MARKERNEXT: 
 		return pdoc->MarkerNext(wParam, lParam);
 
-	case SCI_MARKERPREVIOUS: {
-			for (int iLine = wParam; iLine >= 0; iLine--) {
-				if ((pdoc->GetMark(iLine) & lParam) != 0)
-					return iLine;
-			}
-		}
-		return -1;
+	case SCI_MARKERPREVIOUS:
+		return pdoc->MarkerPrevious(wParam, lParam);
+
+	case SCI_MARKERSETMASKS:
+		if (lParam != 0)
+			pdoc->SetMarkMasks(wParam, reinterpret_cast<const Sci_MarkerMask *>(lParam));
+		break;
 
 	case SCI_MARKERDEFINEPIXMAP:
 		if (wParam <= MARKER_MAX) {
@@ -8753,9 +8927,11 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		return 0;
 
 	case SCI_CREATEDOCUMENT: {
-			Document *doc = new Document();
+			Document *doc = new Document(lParam);
 			if (doc) {
 				doc->AddRef();
+				if (wParam > 0)
+					doc->Allocate(wParam);
 			}
 			return reinterpret_cast<sptr_t>(doc);
 		}
@@ -8768,8 +8944,28 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		(reinterpret_cast<Document *>(lParam))->Release();
 		break;
 
+	case SCI_CREATEMAPPEDDOCUMENT: {
+			if (!lParam)
+				return 0;
+			MappedFile *mappedFile = MappedFile::Map(reinterpret_cast<const char *>(lParam));
+			if (!mappedFile)
+				return 0;
+			Document *doc = 0;
+			if (mappedFile->IsValid()) {
+				doc = new Document(wParam | SC_DOCUMENTOPTION_TEXT_CHUNKED);
+				doc->AddRef();
+				if (!doc->SetMappedFile(mappedFile)) {
+					doc->Release();
+					doc = 0;
+				}
+			}
+			if (!doc)
+				delete mappedFile;
+			return reinterpret_cast<sptr_t>(doc);
+		}
+
 	case SCI_CREATELOADER: {
-			Document *doc = new Document();
+			Document *doc = new Document(lParam);
 			if (doc) {
 				doc->AddRef();
 				doc->Allocate(wParam);
@@ -8785,6 +8981,44 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETMODEVENTMASK:
 		return modEventMask;
 
+	case SCI_GETDOCUMENTOPTIONS:
+		return pdoc->DocumentOptions();
+
+	case SCI_GETMEMORYUSAGE: {
+			if (lParam == 0)
+				return 0;
+			Sci_MemoryUsage *usage = reinterpret_cast<Sci_MemoryUsage *>(lParam);
+			pdoc->GetMemoryUsage(usage);
+			usage->layoutCache = llc.Memory();
+			usage->positionCache = posCache.Memory();
+			return static_cast<sptr_t>(usage->text + usage->styles + usage->lineIndex +
+				usage->perLine + usage->undo + usage->decorations +
+				usage->layoutCache + usage->positionCache);
+		}
+
+	case SCI_HIBERNATE:
+		llc.Deallocate();
+		posCache.Clear();
+		pdoc->Hibernate();
+		return 0;
+
+	case SCI_REHYDRATE:
+		pdoc->Rehydrate();
+		return 0;
+
+	case SCI_ISHIBERNATING:
+		return pdoc->IsHibernating();
+
+	case SCI_SETLOGLINELIMIT:
+		pdoc->SetLogLineLimit(wParam);
+		return 0;
+
+	case SCI_GETLOGLINELIMIT:
+		return pdoc->LogLineLimit();
+
+	case SCI_GETLOGLINESTRIMMED:
+		return pdoc->LogLinesTrimmed();
+
 	case SCI_CONVERTEOLS:
 		pdoc->ConvertLineEnds(wParam);
 		SetSelection(sel.MainCaret(), sel.MainAnchor());	// Ensure selection inside document
@@ -8958,6 +9192,22 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETCHARACTERPOINTER:
 		return reinterpret_cast<sptr_t>(pdoc->BufferPointer());
 
+	case SCI_GETDOCUMENTVERSION:
+		return pdoc->TextVersion();
+
+	case SCI_GETTEXTSEGMENT: {
+			if (lParam == 0)
+				return 0;
+			Sci_TextSegment *segment = reinterpret_cast<Sci_TextSegment *>(lParam);
+			Sci_Position lengthSegment = 0;
+			segment->text = pdoc->TextSegment(wParam, lengthSegment);
+			segment->length = lengthSegment;
+			return lengthSegment;
+		}
+
+	case SCI_CREATESNAPSHOT:
+		return reinterpret_cast<sptr_t>(pdoc->CreateSnapshot(wParam == 0));
+
 	case SCI_SETEXTRAASCENT:
 		vs.extraAscent = wParam;
 		InvalidateStyleRedraw();
@@ -9032,6 +9282,11 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->MarginClearAll();
 		break;
 
+	case SCI_MARGINSETTEXTS:
+		if (lParam != 0)
+			pdoc->MarginSetTexts(wParam, reinterpret_cast<const Sci_LineText *>(lParam));
+		break;
+
 	case SCI_ANNOTATIONSETTEXT:
 		pdoc->AnnotationSetText(wParam, CharPtrFromSPtr(lParam));
 		break;
@@ -9078,6 +9333,11 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->AnnotationClearAll();
 		break;
 
+	case SCI_ANNOTATIONSETTEXTS:
+		if (lParam != 0)
+			pdoc->AnnotationSetTexts(wParam, reinterpret_cast<const Sci_LineText *>(lParam));
+		break;
+
 	case SCI_ANNOTATIONSETVISIBLE:
 		SetAnnotationVisible(wParam);
 		break;
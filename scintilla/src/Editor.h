@@ -228,6 +228,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	bool paintingAllText;
 	bool willRedrawAll;
 	StyleNeeded styleNeeded;
+	/// Whether the text not shown is styled in slices while the application is idle
+	bool idleStyling;
 
 	int modEventMask;
 
@@ -513,6 +515,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void StyleToPositionInView(Position pos);
 	void IdleStyling();
 	virtual void QueueStyling(int upTo);
+	void StartIdleStyling();
+	bool StyleWhileIdle();
 
 	virtual bool PaintContains(PRectangle rc);
 	bool PaintContainsMargin();
@@ -530,6 +534,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void EnsureLineVisible(int lineDoc, bool enforcePolicy);
 	int GetTag(char *tagValue, int tagNumber);
 	int ReplaceTarget(bool replacePatterns, const char *text, int length=-1);
+	int ReplaceRanges(const Sci_Replacement *replacements, int count);
 
 	bool PositionIsHotspot(int position);
 	bool PointIsHotspot(Point pt);
@@ -0,0 +1,391 @@
+// Scintilla source code edit control
+/** @file PartitionTree.h
+ ** Partitioning held in a balanced tree so that changes anywhere cost the same.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef PARTITIONTREE_H
+#define PARTITIONTREE_H
+
+/// Divide an interval into multiple partitions with the same behaviour as Partitioning.
+/// Partitioning keeps every start position and moves them lazily from a single step so
+/// changes that alternate between distant partitions update all the starts between them.
+/// PartitionTree is a B+ tree of partition lengths where each node knows the number of
+/// partitions and the length beneath it, so inserting, removing, moving and finding a
+/// partition are O(log n) wherever they are. Leaves hold the starts of their partitions
+/// relative to the leaf so the position of a partition is found without summing a leaf.
+/// Finding a position is slower than with Partitioning so this suits large documents
+/// that are edited at many separated lines.
+
+class PartitionTree {
+private:
+	enum { sizeLeaf = 128, sizeInner = 64, maxDepth = 12 };
+
+	struct Node {
+		bool leaf;
+		int count;	///< Partitions in a leaf or children of an inner node
+	};
+	struct Leaf : public Node {
+		Sci_Position length;
+		Sci_Position starts[sizeLeaf];	///< Relative to the leaf, starts[0] is always 0
+	};
+	struct Inner : public Node {
+		Node *children[sizeInner];
+		int partitions[sizeInner];
+		Sci_Position lengths[sizeInner];
+	};
+	/// A step on the way down to a leaf.
+	struct Step {
+		Inner *node;
+		int child;
+	};
+
+	Node *root;
+	int partitions;
+	Sci_Position length;
+
+	// Private so PartitionTree objects can not be copied
+	PartitionTree(const PartitionTree &);
+	PartitionTree &operator=(const PartitionTree &);
+
+	static Leaf *NewLeaf() {
+		Leaf *leaf = new Leaf();
+		leaf->leaf = true;
+		leaf->count = 0;
+		leaf->length = 0;
+		return leaf;
+	}
+
+	static Inner *NewInner() {
+		Inner *inner = new Inner();
+		inner->leaf = false;
+		inner->count = 0;
+		return inner;
+	}
+
+	static void FreeNode(Node *node) {
+		if (node->leaf) {
+			delete static_cast<Leaf *>(node);
+		} else {
+			Inner *inner = static_cast<Inner *>(node);
+			for (int child = 0; child < inner->count; child++)
+				FreeNode(inner->children[child]);
+			delete inner;
+		}
+	}
+
+	static size_t NodeMemory(const Node *node) {
+		if (node->leaf)
+			return sizeof(Leaf);
+		const Inner *inner = static_cast<const Inner *>(node);
+		size_t memory = sizeof(Inner);
+		for (int child = 0; child < inner->count; child++)
+			memory += NodeMemory(inner->children[child]);
+		return memory;
+	}
+
+	/// Length of partition index of leaf.
+	static Sci_Position LeafPartitionLength(const Leaf *leaf, int index) {
+		const Sci_Position end = (index + 1 < leaf->count) ? leaf->starts[index + 1] : leaf->length;
+		return end - leaf->starts[index];
+	}
+
+	/// Split child of inner, which has room for another child, into two at its element
+	/// split, moving the elements from split on into a new node after it.
+	static void SplitChild(Inner *inner, int child, int split) {
+		Node *node = inner->children[child];
+		Node *nodeAfter = 0;
+		int partitionsAfter = 0;
+		Sci_Position lengthAfter = 0;
+		if (node->leaf) {
+			Leaf *leaf = static_cast<Leaf *>(node);
+			Leaf *leafAfter = NewLeaf();
+			const Sci_Position startSplit = leaf->starts[split];
+			for (int i = split; i < leaf->count; i++)
+				leafAfter->starts[i - split] = leaf->starts[i] - startSplit;
+			leafAfter->count = leaf->count - split;
+			leafAfter->length = leaf->length - startSplit;
+			leaf->count = split;
+			leaf->length = startSplit;
+			nodeAfter = leafAfter;
+			partitionsAfter = leafAfter->count;
+			lengthAfter = leafAfter->length;
+		} else {
+			Inner *node2 = static_cast<Inner *>(node);
+			Inner *innerAfter = NewInner();
+			for (int i = split; i < node2->count; i++) {
+				innerAfter->children[i - split] = node2->children[i];
+				innerAfter->partitions[i - split] = node2->partitions[i];
+				innerAfter->lengths[i - split] = node2->lengths[i];
+				partitionsAfter += node2->partitions[i];
+				lengthAfter += node2->lengths[i];
+			}
+			innerAfter->count = node2->count - split;
+			node2->count = split;
+			nodeAfter = innerAfter;
+		}
+		for (int i = inner->count; i > child + 1; i--) {
+			inner->children[i] = inner->children[i - 1];
+			inner->partitions[i] = inner->partitions[i - 1];
+			inner->lengths[i] = inner->lengths[i - 1];
+		}
+		inner->count++;
+		inner->children[child + 1] = nodeAfter;
+		inner->partitions[child + 1] = partitionsAfter;
+		inner->lengths[child + 1] = lengthAfter;
+		inner->partitions[child] -= partitionsAfter;
+		inner->lengths[child] -= lengthAfter;
+	}
+
+	static bool Full(const Node *node) {
+		return node->count >= (node->leaf ? static_cast<int>(sizeLeaf) : static_cast<int>(sizeInner));
+	}
+
+	/// Split point that leaves the node being appended to full when adding at its end.
+	static int SplitPoint(const Node *node, bool atEnd) {
+		return atEnd ? node->count - 1 : node->count / 2;
+	}
+
+	/// Descend to the leaf holding partition, recording the path and the position of the leaf.
+	/// @return the leaf with partition changed to be its index within the leaf.
+	Leaf *Find(int &partition, Sci_Position &position, Step *path, int &depth) const {
+		Node *node = root;
+		depth = 0;
+		position = 0;
+		while (!node->leaf) {
+			Inner *inner = static_cast<Inner *>(node);
+			int child = 0;
+			while ((child < inner->count - 1) && (partition >= inner->partitions[child])) {
+				partition -= inner->partitions[child];
+				position += inner->lengths[child];
+				child++;
+			}
+			if (path) {
+				path[depth].node = inner;
+				path[depth].child = child;
+			}
+			depth++;
+			node = inner->children[child];
+		}
+		return static_cast<Leaf *>(node);
+	}
+
+	/// Add partitionsDelta and lengthDelta to the counts on the path down to a leaf.
+	void Adjust(Step *path, int depth, int partitionsDelta, Sci_Position lengthDelta) {
+		for (int level = 0; level < depth; level++) {
+			path[level].node->partitions[path[level].child] += partitionsDelta;
+			path[level].node->lengths[path[level].child] += lengthDelta;
+		}
+		partitions += partitionsDelta;
+		length += lengthDelta;
+	}
+
+	/// Remove partition and its length, leaving the starts of later partitions moved back.
+	/// @return the length of the removed partition.
+	Sci_Position RemoveElement(int partition) {
+		Step path[maxDepth];
+		int depth = 0;
+		Sci_Position position = 0;
+		int index = partition;
+		Leaf *leaf = Find(index, position, path, depth);
+		const Sci_Position lengthRemoved = LeafPartitionLength(leaf, index);
+		for (int i = index; i < leaf->count - 1; i++)
+			leaf->starts[i] = leaf->starts[i + 1] - lengthRemoved;
+		leaf->count--;
+		leaf->length -= lengthRemoved;
+		if (leaf->count > 0)
+			leaf->starts[0] = 0;
+		Adjust(path, depth, -1, -lengthRemoved);
+		// Remove nodes that have become empty
+		Node *node = leaf;
+		for (int level = depth - 1; (level >= 0) && (node->count == 0); level--) {
+			Inner *parent = path[level].node;
+			FreeNode(node);
+			for (int i = path[level].child; i < parent->count - 1; i++) {
+				parent->children[i] = parent->children[i + 1];
+				parent->partitions[i] = parent->partitions[i + 1];
+				parent->lengths[i] = parent->lengths[i + 1];
+			}
+			parent->count--;
+			node = parent;
+		}
+		// A root with a single child is replaced by the child
+		while (!root->leaf && (root->count == 1)) {
+			Inner *inner = static_cast<Inner *>(root);
+			root = inner->children[0];
+			inner->count = 0;
+			FreeNode(inner);
+		}
+		return lengthRemoved;
+	}
+
+	void Allocate() {
+		Leaf *leaf = NewLeaf();
+		leaf->count = 1;
+		leaf->starts[0] = 0;
+		root = leaf;
+		partitions = 1;
+		length = 0;
+	}
+
+public:
+	PartitionTree() {
+		Allocate();
+	}
+
+	~PartitionTree() {
+		FreeNode(root);
+		root = 0;
+	}
+
+	int Partitions() const {
+		return partitions;
+	}
+
+	size_t Memory() const {
+		return NodeMemory(root);
+	}
+
+	/// Nodes are allocated as they are needed so there is no spare space to release.
+	void Shrink() {
+	}
+
+	void InsertPartition(int partition, Sci_Position pos) {
+		PLATFORM_ASSERT((partition > 0) && (partition <= partitions));
+		if ((partition <= 0) || (partition > partitions))
+			return;
+		const bool atEnd = partition == partitions;
+		if (Full(root)) {
+			Inner *inner = NewInner();
+			inner->count = 1;
+			inner->children[0] = root;
+			inner->partitions[0] = partitions;
+			inner->lengths[0] = length;
+			SplitChild(inner, 0, SplitPoint(root, atEnd));
+			root = inner;
+		}
+		// Descend to the partition before the new one, splitting full nodes on the way
+		// so that there is room for the new partition and any splits of its leaf.
+		int index = partition - 1;
+		Sci_Position position = 0;
+		Node *node = root;
+		while (!node->leaf) {
+			Inner *inner = static_cast<Inner *>(node);
+			int child = 0;
+			while ((child < inner->count - 1) && (index >= inner->partitions[child])) {
+				index -= inner->partitions[child];
+				position += inner->lengths[child];
+				child++;
+			}
+			if (Full(inner->children[child])) {
+				SplitChild(inner, child, SplitPoint(inner->children[child], atEnd));
+				if (index >= inner->partitions[child]) {
+					index -= inner->partitions[child];
+					position += inner->lengths[child];
+					child++;
+				}
+			}
+			inner->partitions[child]++;
+			node = inner->children[child];
+		}
+		Leaf *leaf = static_cast<Leaf *>(node);
+		for (int i = leaf->count; i > index + 1; i--)
+			leaf->starts[i] = leaf->starts[i - 1];
+		leaf->starts[index + 1] = pos - position;
+		leaf->count++;
+		partitions++;
+	}
+
+	/// Insert count partitions at once, positions must be ascending.
+	void InsertPartitions(int partition, const Sci_Position *positions, int count) {
+		for (int i = 0; i < count; i++)
+			InsertPartition(partition + i, positions[i]);
+	}
+
+	void SetPartitionStartPosition(int partition, Sci_Position pos) {
+		if ((partition <= 0) || (partition > partitions))
+			return;
+		const Sci_Position delta = pos - PositionFromPartition(partition);
+		InsertText(partition - 1, delta);
+		if (partition < partitions)
+			InsertText(partition, -delta);
+	}
+
+	void InsertText(int partitionInsert, Sci_Position delta) {
+		// Point all the partitions after the insertion point further along in the buffer
+		if (partitionInsert >= partitions)
+			partitionInsert = partitions - 1;
+		if (partitionInsert < 0)
+			partitionInsert = 0;
+		Step path[maxDepth];
+		int depth = 0;
+		Sci_Position position = 0;
+		Leaf *leaf = Find(partitionInsert, position, path, depth);
+		for (int i = partitionInsert + 1; i < leaf->count; i++)
+			leaf->starts[i] += delta;
+		leaf->length += delta;
+		Adjust(path, depth, 0, delta);
+	}
+
+	void RemovePartition(int partition) {
+		PLATFORM_ASSERT((partition > 0) && (partition < partitions));
+		if ((partition <= 0) || (partition >= partitions))
+			return;
+		// The removed partition becomes part of the one before it
+		const Sci_Position lengthRemoved = RemoveElement(partition);
+		InsertText(partition - 1, lengthRemoved);
+	}
+
+	Sci_Position PositionFromPartition(int partition) const {
+		PLATFORM_ASSERT(partition >= 0);
+		PLATFORM_ASSERT(partition <= partitions);
+		if ((partition < 0) || (partition > partitions)) {
+			return 0;
+		}
+		if (partition == partitions)
+			return length;
+		int depth = 0;
+		Sci_Position position = 0;
+		const Leaf *leaf = Find(partition, position, 0, depth);
+		return position + leaf->starts[partition];
+	}
+
+	/// Return value in range [0 .. Partitions() - 1] even for arguments outside interval
+	int PartitionFromPosition(Sci_Position pos) const {
+		if (pos >= length)
+			return partitions - 1;
+		int partition = 0;
+		const Node *node = root;
+		while (!node->leaf) {
+			const Inner *inner = static_cast<const Inner *>(node);
+			int child = 0;
+			// A partition starting at the end of a child is in a later child
+			while ((child < inner->count - 1) && (pos >= inner->lengths[child])) {
+				pos -= inner->lengths[child];
+				partition += inner->partitions[child];
+				child++;
+			}
+			node = inner->children[child];
+		}
+		// Last partition of the leaf that starts at or before pos
+		const Leaf *leaf = static_cast<const Leaf *>(node);
+		int lower = 0;
+		int upper = leaf->count - 1;
+		while (lower < upper) {
+			const int middle = (upper + lower + 1) / 2; 	// Round high
+			if (pos < leaf->starts[middle]) {
+				upper = middle - 1;
+			} else {
+				lower = middle;
+			}
+		}
+		return partition + lower;
+	}
+
+	void DeleteAll() {
+		FreeNode(root);
+		Allocate();
+	}
+};
+
+#endif
@@ -12,7 +12,9 @@
 #include "Scintilla.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "RunStyles.h"
 #include "CellBuffer.h"
+#include "Arena.h"
 #include "PerLine.h"
 
 #ifdef SCI_NAMESPACE
@@ -124,41 +126,152 @@ void MarkerHandleSet::CombineWith(MarkerHandleSet *other) {
 	other->root = 0;
 }
 
+// Runs of lines with a value, where only the lines with the marker or handles are
+// counted so finding the next or previous marked line skips unmarked lines at once.
+
+static int NextNonZero(const RunStyles *rs, int line) {
+	const int length = static_cast<int>(rs->Length());
+	if (line < 0)
+		line = 0;
+	while (line < length) {
+		if (rs->ValueAt(line))
+			return line;
+		line = static_cast<int>(rs->EndRun(line));
+	}
+	return -1;
+}
+
+static int PreviousNonZero(const RunStyles *rs, int line) {
+	const int length = static_cast<int>(rs->Length());
+	if (line >= length)
+		line = length - 1;
+	while (line >= 0) {
+		if (rs->ValueAt(line))
+			return line;
+		line = static_cast<int>(rs->StartRun(line)) - 1;
+	}
+	return -1;
+}
+
+// Inserted lines are unmarked even when inserted inside or after a run of marked lines.
+static void InsertUnmarked(RunStyles *rs, int line, int lines) {
+	rs->InsertSpace(line, lines);
+	Sci_Position position = line;
+	Sci_Position fillLength = lines;
+	rs->FillRange(position, 0, fillLength);
+}
+
+LineMarkers::LineMarkers() : lines(0), lineSets(0), handleCurrent(0) {
+	for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++)
+		numbers[markerNum] = 0;
+}
+
 LineMarkers::~LineMarkers() {
 	Init();
 }
 
 void LineMarkers::Init() {
-	for (int line = 0; line < markers.Length(); line++) {
-		delete markers[line];
-		markers[line] = 0;
+	for (int set = 0; set < handleSets.Length(); set++) {
+		delete handleSets[set];
+		handleSets[set] = 0;
+	}
+	handleSets.DeleteAll();
+	setsFree.DeleteAll();
+	for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+		delete numbers[markerNum];
+		numbers[markerNum] = 0;
+	}
+	delete lineSets;
+	lineSets = 0;
+	lines = 0;
+}
+
+void LineMarkers::Allocate(int lines_) {
+	if (!lineSets) {
+		// No existing markers so start covering the lines
+		lines = lines_;
+		lineSets = new RunStyles();
+		lineSets->InsertSpace(0, lines);
+		handleSets.Insert(0, 0);
+	}
+}
+
+RunStyles *LineMarkers::Number(int markerNum) {
+	if (!numbers[markerNum]) {
+		numbers[markerNum] = new RunStyles();
+		numbers[markerNum]->InsertSpace(0, lines);
+	}
+	return numbers[markerNum];
+}
+
+int LineMarkers::SetOfLine(int line) const {
+	if (!lineSets || (line < 0) || (line >= lines))
+		return 0;
+	return lineSets->ValueAt(line);
+}
+
+void LineMarkers::SetLineSet(int line, int set) {
+	Sci_Position position = line;
+	Sci_Position fillLength = 1;
+	lineSets->FillRange(position, set, fillLength);
+}
+
+void LineMarkers::SetNumber(int line, int markerNum, bool on) {
+	if (on || numbers[markerNum]) {
+		Sci_Position position = line;
+		Sci_Position fillLength = 1;
+		Number(markerNum)->FillRange(position, on ? 1 : 0, fillLength);
+	}
+}
+
+void LineMarkers::FreeSet(int line) {
+	const int set = SetOfLine(line);
+	if (set) {
+		delete handleSets[set];
+		handleSets[set] = 0;
+		setsFree.Insert(setsFree.Length(), set);
+		SetLineSet(line, 0);
 	}
-	markers.DeleteAll();
 }
 
 void LineMarkers::InsertLine(int line) {
-	if (markers.Length()) {
-		markers.Insert(line, 0);
+	InsertLines(line, 1);
+}
+
+void LineMarkers::InsertLines(int line, int lines_) {
+	if (lineSets) {
+		InsertUnmarked(lineSets, line, lines_);
+		for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+			if (numbers[markerNum])
+				InsertUnmarked(numbers[markerNum], line, lines_);
+		}
+		lines += lines_;
 	}
 }
 
 void LineMarkers::RemoveLine(int line) {
 	// Retain the markers from the deleted line by oring them into the previous line
-	if (markers.Length()) {
+	if (lineSets) {
 		if (line > 0) {
 			MergeMarkers(line - 1);
+		} else {
+			FreeSet(line);
+		}
+		lineSets->DeleteRange(line, 1);
+		for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+			if (numbers[markerNum])
+				numbers[markerNum]->DeleteRange(line, 1);
 		}
-		markers.Delete(line);
+		lines--;
 	}
 }
 
 int LineMarkers::LineFromHandle(int markerHandle) {
-	if (markers.Length()) {
-		for (int line = 0; line < markers.Length(); line++) {
-			if (markers[line]) {
-				if (markers[line]->Contains(markerHandle)) {
-					return line;
-				}
+	if (lineSets) {
+		// Only the sets are searched, not every line
+		for (int set = 1; set < handleSets.Length(); set++) {
+			if (handleSets[set] && handleSets[set]->Contains(markerHandle)) {
+				return static_cast<int>(lineSets->Find(set, 0));
 			}
 		}
 	}
@@ -166,89 +279,181 @@ int LineMarkers::LineFromHandle(int markerHandle) {
 }
 
 void LineMarkers::MergeMarkers(int pos) {
-	if (markers[pos + 1] != NULL) {
-		if (markers[pos] == NULL)
-			markers[pos] = new MarkerHandleSet;
-		markers[pos]->CombineWith(markers[pos + 1]);
-		delete markers[pos + 1];
-		markers[pos + 1] = NULL;
+	const int setNext = SetOfLine(pos + 1);
+	if (setNext) {
+		const int set = SetOfLine(pos);
+		if (set) {
+			handleSets[set]->CombineWith(handleSets[setNext]);
+			FreeSet(pos + 1);
+		} else {
+			SetLineSet(pos + 1, 0);
+			SetLineSet(pos, setNext);
+		}
+		const int markValue = handleSets[SetOfLine(pos)]->MarkValue();
+		for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+			if (markValue & (1 << markerNum))
+				SetNumber(pos, markerNum, true);
+			SetNumber(pos + 1, markerNum, false);
+		}
 	}
 }
 
 int LineMarkers::MarkValue(int line) {
-	if (markers.Length() && (line >= 0) && (line < markers.Length()) && markers[line])
-		return markers[line]->MarkValue();
-	else
-		return 0;
+	const int set = SetOfLine(line);
+	return set ? handleSets[set]->MarkValue() : 0;
 }
 
 int LineMarkers::MarkerNext(int lineStart, int mask) const {
-	if (lineStart < 0)
-		lineStart = 0;
-	int length = markers.Length();
-	for (int iLine = lineStart; iLine < length; iLine++) {
-		MarkerHandleSet *onLine = markers[iLine];
-		if (onLine && ((onLine->MarkValue() & mask) != 0))
-		//if ((pdoc->GetMark(iLine) & lParam) != 0)
-			return iLine;
+	int lineNext = -1;
+	for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+		if ((mask & (1 << markerNum)) && numbers[markerNum]) {
+			const int line = NextNonZero(numbers[markerNum], lineStart);
+			if ((line >= 0) && ((lineNext < 0) || (line < lineNext)))
+				lineNext = line;
+		}
 	}
-	return -1;
+	return lineNext;
 }
 
-int LineMarkers::AddMark(int line, int markerNum, int lines) {
-	handleCurrent++;
-	if (!markers.Length()) {
-		// No existing markers so allocate one element per line
-		markers.InsertValue(0, lines, 0);
+int LineMarkers::MarkerPrevious(int lineStart, int mask) const {
+	int linePrevious = -1;
+	for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+		if ((mask & (1 << markerNum)) && numbers[markerNum]) {
+			const int line = PreviousNonZero(numbers[markerNum], lineStart);
+			if (line > linePrevious)
+				linePrevious = line;
+		}
 	}
-	if (line >= markers.Length()) {
+	return linePrevious;
+}
+
+int LineMarkers::AddMark(int line, int markerNum, int lines_) {
+	handleCurrent++;
+	Allocate(lines_);
+	if ((line < 0) || (line >= lines) || (markerNum < 0) || (markerNum > MARKER_MAX)) {
 		return -1;
 	}
-	if (!markers[line]) {
-		// Need new structure to hold marker handle
-		markers[line] = new MarkerHandleSet();
-		if (!markers[line])
-			return -1;
+	int set = SetOfLine(line);
+	if (!set) {
+		// Need new structure to hold marker handle, reusing a free slot if possible
+		if (setsFree.Length()) {
+			set = setsFree[setsFree.Length() - 1];
+			setsFree.Delete(setsFree.Length() - 1);
+		} else {
+			set = handleSets.Length();
+			handleSets.Insert(set, 0);
+		}
+		handleSets[set] = new MarkerHandleSet();
+		SetLineSet(line, set);
 	}
-	markers[line]->InsertHandle(handleCurrent, markerNum);
+	handleSets[set]->InsertHandle(handleCurrent, markerNum);
+	SetNumber(line, markerNum, true);
 
 	return handleCurrent;
 }
 
+bool LineMarkers::SetMarkSet(int line, int valueSet, int lines_) {
+	const unsigned int markValue = MarkValue(line);
+	const unsigned int wanted = valueSet;
+	if (markValue == wanted)
+		return false;
+	for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+		const unsigned int bit = 1U << markerNum;
+		if ((markValue & bit) && !(wanted & bit))
+			DeleteMark(line, markerNum, true);
+		else if (!(markValue & bit) && (wanted & bit))
+			AddMark(line, markerNum, lines_);
+	}
+	return true;
+}
+
 bool LineMarkers::DeleteMark(int line, int markerNum, bool all) {
 	bool someChanges = false;
-	if (markers.Length() && (line >= 0) && (line < markers.Length()) && markers[line]) {
+	const int set = SetOfLine(line);
+	if (set) {
 		if (markerNum == -1) {
 			someChanges = true;
-			delete markers[line];
-			markers[line] = NULL;
+			FreeSet(line);
+			for (int number = 0; number <= MARKER_MAX; number++)
+				SetNumber(line, number, false);
 		} else {
-			bool performedDeletion = markers[line]->RemoveNumber(markerNum);
+			bool performedDeletion = handleSets[set]->RemoveNumber(markerNum);
 			someChanges = someChanges || performedDeletion;
 			while (all && performedDeletion) {
-				performedDeletion = markers[line]->RemoveNumber(markerNum);
+				performedDeletion = handleSets[set]->RemoveNumber(markerNum);
 				someChanges = someChanges || performedDeletion;
 			}
-			if (markers[line]->Length() == 0) {
-				delete markers[line];
-				markers[line] = NULL;
+			if (someChanges && (markerNum >= 0) && (markerNum <= MARKER_MAX))
+				SetNumber(line, markerNum, false);
+			if (handleSets[set]->Length() == 0) {
+				FreeSet(line);
 			}
 		}
 	}
 	return someChanges;
 }
 
+bool LineMarkers::DeleteAllMarks(int markerNum) {
+	if (!lineSets)
+		return false;
+	if (markerNum == -1) {
+		// Every marker so simply forget them all
+		const bool someMarkers = NextNonZero(lineSets, 0) >= 0;
+		Init();
+		return someMarkers;
+	}
+	if ((markerNum < 0) || (markerNum > MARKER_MAX) || !numbers[markerNum])
+		return false;
+	bool someChanges = false;
+	for (int line = NextNonZero(numbers[markerNum], 0); line >= 0;
+		line = NextNonZero(numbers[markerNum], line + 1)) {
+		if (DeleteMark(line, markerNum, true))
+			someChanges = true;
+	}
+	return someChanges;
+}
+
 void LineMarkers::DeleteMarkFromHandle(int markerHandle) {
 	int line = LineFromHandle(markerHandle);
 	if (line >= 0) {
-		markers[line]->RemoveHandle(markerHandle);
-		if (markers[line]->Length() == 0) {
-			delete markers[line];
-			markers[line] = NULL;
+		const int set = SetOfLine(line);
+		const int markerNum = handleSets[set]->NumberFromHandle(markerHandle);
+		handleSets[set]->RemoveHandle(markerHandle);
+		if ((markerNum >= 0) && (markerNum <= MARKER_MAX) &&
+			!(handleSets[set]->MarkValue() & (1 << markerNum)))
+			SetNumber(line, markerNum, false);
+		if (handleSets[set]->Length() == 0) {
+			FreeSet(line);
 		}
 	}
 }
 
+size_t LineMarkers::Memory() const {
+	size_t memory = handleSets.Memory() + setsFree.Memory();
+	if (lineSets)
+		memory += lineSets->Memory();
+	for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+		if (numbers[markerNum])
+			memory += numbers[markerNum]->Memory();
+	}
+	for (int set = 1; set < handleSets.Length(); set++) {
+		if (handleSets[set])
+			memory += sizeof(MarkerHandleSet) + handleSets[set]->Length() * sizeof(MarkerHandleNumber);
+	}
+	return memory;
+}
+
+void LineMarkers::Shrink() {
+	handleSets.Shrink();
+	setsFree.Shrink();
+	if (lineSets)
+		lineSets->Shrink();
+	for (int markerNum = 0; markerNum <= MARKER_MAX; markerNum++) {
+		if (numbers[markerNum])
+			numbers[markerNum]->Shrink();
+	}
+}
+
 LineLevels::~LineLevels() {
 }
 
@@ -263,16 +468,25 @@ void LineLevels::InsertLine(int line) {
 	}
 }
 
+void LineLevels::InsertLines(int line, int lines) {
+	if (levels.Length()) {
+		int level = (line < levels.Length()) ? levels[line] : SC_FOLDLEVELBASE;
+		levels.InsertValue(line, lines, level);
+	}
+}
+
 void LineLevels::RemoveLine(int line) {
 	if (levels.Length()) {
 		// Move up following lines but merge header flag from this line
 		// to line before to avoid a temporary disappearence causing expansion.
 		int firstHeader = levels[line] & SC_FOLDLEVELHEADERFLAG;
 		levels.Delete(line);
-		if (line == levels.Length()-1) // Last line loses the header flag
-			levels[line-1] &= ~SC_FOLDLEVELHEADERFLAG;
-		else if (line > 0)
-			levels[line-1] |= firstHeader;
+		if (line > 0) {	// The first line of a trimmed log has no line before it
+			if (line == levels.Length()-1) // Last line loses the header flag
+				levels[line-1] &= ~SC_FOLDLEVELHEADERFLAG;
+			else
+				levels[line-1] |= firstHeader;
+		}
 	}
 }
 
@@ -306,6 +520,14 @@ int LineLevels::GetLevel(int line) {
 	}
 }
 
+size_t LineLevels::Memory() const {
+	return levels.Memory();
+}
+
+void LineLevels::Shrink() {
+	levels.Shrink();
+}
+
 LineState::~LineState() {
 }
 
@@ -321,6 +543,14 @@ void LineState::InsertLine(int line) {
 	}
 }
 
+void LineState::InsertLines(int line, int lines) {
+	if (lineStates.Length()) {
+		lineStates.EnsureLength(line);
+		int val = (line < lineStates.Length()) ? lineStates[line] : 0;
+		lineStates.InsertValue(line, lines, val);
+	}
+}
+
 void LineState::RemoveLine(int line) {
 	if (lineStates.Length() > line) {
 		lineStates.Delete(line);
@@ -345,6 +575,14 @@ int LineState::GetMaxLineState() {
 	return lineStates.Length();
 }
 
+size_t LineState::Memory() const {
+	return lineStates.Memory();
+}
+
+void LineState::Shrink() {
+	lineStates.Shrink();
+}
+
 static int NumberLines(const char *text) {
 	if (text) {
 		int newLines = 0;
@@ -370,6 +608,11 @@ struct AnnotationHeader {
 	int length;
 };
 
+static size_t PieceSize(const char *annotation) {
+	const AnnotationHeader *pah = reinterpret_cast<const AnnotationHeader *>(annotation);
+	return sizeof(AnnotationHeader) + pah->length + ((pah->style == IndividualStyles) ? pah->length : 0);
+}
+
 LineAnnotation::~LineAnnotation() {
 	ClearAll();
 }
@@ -378,6 +621,35 @@ void LineAnnotation::Init() {
 	ClearAll();
 }
 
+char *LineAnnotation::Allocate(int length, int style) {
+	if (!arena)
+		arena = new Arena();
+	return arena->Allocate(sizeof(AnnotationHeader) + length + ((style == IndividualStyles) ? length : 0));
+}
+
+void LineAnnotation::Free(int line) {
+	if (annotations[line]) {
+		arena->Free(PieceSize(annotations[line]));
+		annotations[line] = 0;
+	}
+}
+
+void LineAnnotation::CompactIfWasteful() {
+	if (!arena || !arena->Wasteful())
+		return;
+	Arena *compacted = new Arena();
+	for (int line = 0; line < annotations.Length(); line++) {
+		if (annotations[line]) {
+			const size_t size = PieceSize(annotations[line]);
+			char *piece = compacted->Allocate(size);
+			memcpy(piece, annotations[line], size);
+			annotations[line] = piece;
+		}
+	}
+	delete arena;
+	arena = compacted;
+}
+
 void LineAnnotation::InsertLine(int line) {
 	if (annotations.Length()) {
 		annotations.EnsureLength(line);
@@ -385,10 +657,18 @@ void LineAnnotation::InsertLine(int line) {
 	}
 }
 
+void LineAnnotation::InsertLines(int line, int lines) {
+	if (annotations.Length()) {
+		annotations.EnsureLength(line);
+		annotations.InsertValue(line, lines, 0);
+	}
+}
+
 void LineAnnotation::RemoveLine(int line) {
 	if (annotations.Length() && (line < annotations.Length())) {
-		delete []annotations[line];
+		Free(line);
 		annotations.Delete(line);
+		CompactIfWasteful();
 	}
 }
 
@@ -424,46 +704,37 @@ const unsigned char *LineAnnotation::Styles(int line) const {
 		return 0;
 }
 
-static char *AllocateAnnotation(int length, int style) {
-	size_t len = sizeof(AnnotationHeader) + length + ((style == IndividualStyles) ? length : 0);
-	char *ret = new char[len];
-	memset(ret, 0, len);
-	return ret;
-}
-
 void LineAnnotation::SetText(int line, const char *text) {
 	if (text && (line >= 0)) {
 		annotations.EnsureLength(line+1);
 		int style = Style(line);
-		if (annotations[line]) {
-			delete []annotations[line];
-		}
-		annotations[line] = AllocateAnnotation(static_cast<int>(strlen(text)), style);
+		const int length = static_cast<int>(strlen(text));
+		char *annotation = Allocate(length, style);
+		Free(line);
+		annotations[line] = annotation;
 		AnnotationHeader *pah = reinterpret_cast<AnnotationHeader *>(annotations[line]);
 		pah->style = static_cast<short>(style);
-		pah->length = static_cast<int>(strlen(text));
+		pah->length = length;
 		pah->lines = static_cast<short>(NumberLines(text));
 		memcpy(annotations[line]+sizeof(AnnotationHeader), text, pah->length);
 	} else {
 		if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line]) {
-			delete []annotations[line];
-			annotations[line] = 0;
+			Free(line);
 		}
 	}
+	CompactIfWasteful();
 }
 
 void LineAnnotation::ClearAll() {
-	for (int line = 0; line < annotations.Length(); line++) {
-		delete []annotations[line];
-		annotations[line] = 0;
-	}
 	annotations.DeleteAll();
+	delete arena;
+	arena = 0;
 }
 
 void LineAnnotation::SetStyle(int line, int style) {
 	annotations.EnsureLength(line+1);
 	if (!annotations[line]) {
-		annotations[line] = AllocateAnnotation(0, style);
+		annotations[line] = Allocate(0, style);
 	}
 	reinterpret_cast<AnnotationHeader *>(annotations[line])->style = static_cast<short>(style);
 }
@@ -472,22 +743,23 @@ void LineAnnotation::SetStyles(int line, const unsigned char *styles) {
 	if (line >= 0) {
 		annotations.EnsureLength(line+1);
 		if (!annotations[line]) {
-			annotations[line] = AllocateAnnotation(0, IndividualStyles);
+			annotations[line] = Allocate(0, IndividualStyles);
 		} else {
 			AnnotationHeader *pahSource = reinterpret_cast<AnnotationHeader *>(annotations[line]);
 			if (pahSource->style != IndividualStyles) {
-				char *allocation = AllocateAnnotation(pahSource->length, IndividualStyles);
+				char *allocation = Allocate(pahSource->length, IndividualStyles);
 				AnnotationHeader *pahAlloc = reinterpret_cast<AnnotationHeader *>(allocation);
 				pahAlloc->length = pahSource->length;
 				pahAlloc->lines = pahSource->lines;
 				memcpy(allocation + sizeof(AnnotationHeader), annotations[line] + sizeof(AnnotationHeader), pahSource->length);
-				delete []annotations[line];
+				Free(line);
 				annotations[line] = allocation;
 			}
 		}
 		AnnotationHeader *pah = reinterpret_cast<AnnotationHeader *>(annotations[line]);
 		pah->style = IndividualStyles;
 		memcpy(annotations[line] + sizeof(AnnotationHeader) + pah->length, styles, pah->length);
+		CompactIfWasteful();
 	}
 }
 
@@ -504,3 +776,11 @@ int LineAnnotation::Lines(int line) const {
 	else
 		return 0;
 }
+
+size_t LineAnnotation::Memory() const {
+	return annotations.Memory() + (arena ? arena->Allocated() : 0);
+}
+
+void LineAnnotation::Shrink() {
+	annotations.Shrink();
+}
@@ -41,25 +41,58 @@ public:
 	void CombineWith(MarkerHandleSet *other);
 };
 
+class RunStyles;
+
+/**
+ * Markers are held so that documents with many lines and many markers stay small
+ * and quick to navigate. For each marker number in use a RunStyles over the lines
+ * is 1 on lines with that marker so the next or previous marked line is found in
+ * logarithmic time. The handles of the markers on a line are in a MarkerHandleSet
+ * which another RunStyles over the lines indexes, so unmarked lines cost nothing.
+ */
 class LineMarkers : public PerLine {
-	SplitVector<MarkerHandleSet *> markers;
+	/// Lines covered, 0 until the first marker is added
+	int lines;
+	/// For each marker number, 1 on lines with that marker or NULL when never used
+	RunStyles *numbers[MARKER_MAX+1];
+	/// For each line, the index in handleSets of the line's handles or 0 for none
+	RunStyles *lineSets;
+	/// Element 0 is not used and removed sets are NULL until reused
+	SplitVector<MarkerHandleSet *> handleSets;
+	SplitVector<int> setsFree;
 	/// Handles are allocated sequentially and should never have to be reused as 32 bit ints are very big.
 	int handleCurrent;
+
+	RunStyles *Number(int markerNum);
+	int SetOfLine(int line) const;
+	void SetLineSet(int line, int set);
+	void FreeSet(int line);
+	void SetNumber(int line, int markerNum, bool on);
+	void Allocate(int lines_);
 public:
-	LineMarkers() : handleCurrent(0) {
-	}
+	LineMarkers();
 	virtual ~LineMarkers();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	int MarkValue(int line);
 	int MarkerNext(int lineStart, int mask) const;
+	int MarkerPrevious(int lineStart, int mask) const;
 	int AddMark(int line, int marker, int lines);
+	/// Make the markers of line exactly those in valueSet, keeping the handles of those it has.
+	/// @return true if the line's markers changed.
+	bool SetMarkSet(int line, int valueSet, int lines);
 	void MergeMarkers(int pos);
 	bool DeleteMark(int line, int markerNum, bool all);
+	/// Delete a marker number, or every marker for -1, from every line.
+	/// @return true if any marker was deleted.
+	bool DeleteAllMarks(int markerNum);
 	void DeleteMarkFromHandle(int markerHandle);
 	int LineFromHandle(int markerHandle);
+	virtual size_t Memory() const;
+	virtual void Shrink();
 };
 
 class LineLevels : public PerLine {
@@ -68,12 +101,15 @@ public:
 	virtual ~LineLevels();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	void ExpandLevels(int sizeNew=-1);
 	void ClearLevels();
 	int SetLevel(int line, int level, int lines);
 	int GetLevel(int line);
+	virtual size_t Memory() const;
+	virtual void Shrink();
 };
 
 class LineState : public PerLine {
@@ -84,21 +120,34 @@ public:
 	virtual ~LineState();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	int SetLineState(int line, int state);
 	int GetLineState(int line);
 	int GetMaxLineState();
+	virtual size_t Memory() const;
+	virtual void Shrink();
 };
 
+/**
+ * Annotations and margin text are held as pieces of an Arena, so setting the text of
+ * many lines does not make many small heap allocations. When replaced or removed text
+ * leaves the arena mostly wasted, the live pieces are copied into a new arena.
+ */
 class LineAnnotation : public PerLine {
 	SplitVector<char *> annotations;
+	Arena *arena;
+	char *Allocate(int length, int style);
+	void Free(int line);
+	void CompactIfWasteful();
 public:
-	LineAnnotation() {
+	LineAnnotation() : arena(0) {
 	}
 	virtual ~LineAnnotation();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	bool AnySet() const;
@@ -112,6 +161,8 @@ public:
 	void SetStyles(int line, const unsigned char *styles);
 	int Length(int line) const;
 	int Lines(int line) const;
+	virtual size_t Memory() const;
+	virtual void Shrink();
 };
 
 #ifdef SCI_NAMESPACE
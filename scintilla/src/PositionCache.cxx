@@ -109,6 +109,15 @@ void LineLayout::Invalidate(validLevel validity_) {
 		validity = validity_;
 }
 
+size_t LineLayout::Memory() const {
+	size_t memory = sizeof(LineLayout) + lenLineStarts * sizeof(int);
+	if (chars) {
+		memory += (maxLineLength + 1) * (sizeof(char) + sizeof(unsigned char) + sizeof(char)) +
+			(maxLineLength + 1 + 1) * sizeof(XYPOSITION);
+	}
+	return memory;
+}
+
 int LineLayout::LineStart(int line) const {
 	if (line <= 0) {
 		return 0;
@@ -339,6 +348,15 @@ LineLayout *LineLayoutCache::Retrieve(int lineNumber, int lineCaret, int maxChar
 	return ret;
 }
 
+size_t LineLayoutCache::Memory() const {
+	size_t memory = size * sizeof(LineLayout *);
+	for (int i = 0; i < length; i++) {
+		if (cache[i])
+			memory += cache[i]->Memory();
+	}
+	return memory;
+}
+
 void LineLayoutCache::Dispose(LineLayout *ll) {
 	allInvalidated = false;
 	if (ll) {
@@ -559,6 +577,10 @@ bool PositionCacheEntry::NewerThan(const PositionCacheEntry &other) const {
 	return clock > other.clock;
 }
 
+size_t PositionCacheEntry::Memory() const {
+	return positions ? (len + (len + 1) / 2) * sizeof(XYPOSITION) : 0;
+}
+
 void PositionCacheEntry::ResetClock() {
 	if (clock > 0) {
 		clock = 1;
@@ -587,6 +609,14 @@ void PositionCache::Clear() {
 	allClear = true;
 }
 
+size_t PositionCache::Memory() const {
+	size_t memory = size * sizeof(PositionCacheEntry);
+	for (size_t i = 0; i < size; i++) {
+		memory += pces[i].Memory();
+	}
+	return memory;
+}
+
 void PositionCache::SetSize(size_t size_) {
 	Clear();
 	delete []pces;
@@ -57,6 +57,8 @@ public:
 	virtual ~LineLayout();
 	void Resize(int maxLineLength_);
 	void Free();
+	/// Bytes allocated for the layout.
+	size_t Memory() const;
 	void Invalidate(validLevel validity_);
 	int LineStart(int line) const;
 	int LineLastVisible(int line) const;
@@ -97,6 +99,8 @@ public:
 	LineLayout *Retrieve(int lineNumber, int lineCaret, int maxChars, int styleClock_,
 		int linesOnScreen, int linesInDoc);
 	void Dispose(LineLayout *ll);
+	/// Bytes allocated for the cache and the layouts in it.
+	size_t Memory() const;
 };
 
 class PositionCacheEntry {
@@ -113,6 +117,8 @@ public:
 	static int Hash(unsigned int styleNumber_, const char *s, unsigned int len);
 	bool NewerThan(const PositionCacheEntry &other) const;
 	void ResetClock();
+	/// Bytes allocated for the positions and text, not including the entry itself.
+	size_t Memory() const;
 };
 
 // Class to break a line of text into shorter runs at sensible places.
@@ -154,6 +160,8 @@ public:
 	void Clear();
 	void SetSize(size_t size_);
 	size_t GetSize() const { return size; }
+	/// Bytes allocated for the entries and their positions.
+	size_t Memory() const;
 	void MeasureWidths(Surface *surface, ViewStyle &vstyle, unsigned int styleNumber,
 		const char *s, unsigned int len, XYPOSITION *positions, Document *pdoc);
 };
@@ -0,0 +1,116 @@
+// Scintilla source code edit control
+/** @file RestartPoints.h
+ ** Positions within lines where a lexer can start again.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef RESTARTPOINTS_H
+#define RESTARTPOINTS_H
+
+/**
+ * Restart points declared by the lexer, kept at least spacing apart and away from line
+ * starts, which move with the text. They are the starts of the partitions after the first
+ * in a Partitioning whose last partition ends beyond all of them. Each has the line state
+ * of the line before it from when it was declared, so restyling can tell whether the lexer
+ * reaches it again in the same state after that line has been restyled.
+ */
+class RestartPoints {
+public:
+	enum { spacing = 0x400 };
+private:
+	Partitioning points;
+	/// The line state for the point starting partition i + 1 is at i
+	SplitVector<int> states;
+	/// The point or line start found for the last position added, which positions soon
+	/// after it are too close to. Forgotten whenever points are removed or moved.
+	int last;
+
+	void Extend(int position) {
+		const int partitions = points.Partitions();
+		const int end = static_cast<int>(points.PositionFromPartition(partitions));
+		if (end < position)
+			points.InsertText(partitions - 1, position - end);
+	}
+
+	// Private so RestartPoints objects can not be copied
+	RestartPoints(const RestartPoints &);
+	RestartPoints &operator=(const RestartPoints &);
+public:
+	RestartPoints() : points(8), last(-spacing) {
+	}
+
+	/// Whether position is too close to the point or line start found for the last
+	/// position added to be kept, which is quicker to tell than for Add.
+	bool Close(int position) const {
+		return (position >= last) && (position - last < spacing);
+	}
+
+	void Add(int position, int lineStart, int lineStateBefore) {
+		const int partition = points.PartitionFromPosition(position);
+		last = lineStart;
+		if ((partition > 0) && (points.PositionFromPartition(partition) > lineStart))
+			last = static_cast<int>(points.PositionFromPartition(partition));
+		if (position - last >= spacing) {
+			Extend(position + 1);
+			points.InsertPartition(partition + 1, position);
+			states.Insert(partition, lineStateBefore);
+			last = position;
+		}
+	}
+
+	/// The line state of the line before the point at position, 0 when there is no point.
+	int LineStateBefore(int position) const {
+		const int partition = points.PartitionFromPosition(position);
+		if ((partition > 0) && (points.PositionFromPartition(partition) == position))
+			return states.ValueAt(partition - 1);
+		return 0;
+	}
+
+	/// The last point at or before position or -1 when there is none.
+	int Before(int position) const {
+		const int partition = points.PartitionFromPosition(position);
+		return (partition > 0) ? static_cast<int>(points.PositionFromPartition(partition)) : -1;
+	}
+
+	/// The first point after position or -1 when there is none.
+	int After(int position) const {
+		const int partition = points.PartitionFromPosition(position) + 1;
+		return (partition < points.Partitions()) ?
+			static_cast<int>(points.PositionFromPartition(partition)) : -1;
+	}
+
+	/// Remove the points after start up to and including end.
+	void Remove(int start, int end) {
+		const int partition = points.PartitionFromPosition(start) + 1;
+		while ((partition < points.Partitions()) && (points.PositionFromPartition(partition) <= end)) {
+			points.RemovePartition(partition);
+			states.Delete(partition - 1);
+		}
+		last = -spacing;
+	}
+
+	/// Text of lengthBefore had lengthDeleted bytes at pos replaced by lengthInserted so
+	/// the points in the deleted text go and those after it move.
+	void TextChanged(int pos, int lengthInserted, int lengthDeleted, int lengthBefore) {
+		Extend(lengthBefore + 1);
+		Remove(pos, pos + lengthDeleted);
+		points.InsertText(points.PartitionFromPosition(pos), lengthInserted - lengthDeleted);
+	}
+
+	void DeleteAll() {
+		points.DeleteAll();
+		states.DeleteAll();
+		last = -spacing;
+	}
+
+	size_t Memory() const {
+		return points.Memory() + states.Memory();
+	}
+
+	void Shrink() {
+		points.Shrink();
+		states.Shrink();
+	}
+};
+
+#endif
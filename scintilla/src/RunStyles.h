@@ -18,29 +18,33 @@ class RunStyles {
 private:
 	Partitioning *starts;
 	SplitVector<int> *styles;
-	int RunFromPosition(int position) const;
-	int SplitRun(int position);
+	int RunFromPosition(Sci_Position position) const;
+	int SplitRun(Sci_Position position);
 	void RemoveRun(int run);
 	void RemoveRunIfEmpty(int run);
 	void RemoveRunIfSameAsPrevious(int run);
 public:
 	RunStyles();
 	~RunStyles();
-	int Length() const;
-	int ValueAt(int position) const;
-	int FindNextChange(int position, int end);
-	int StartRun(int position);
-	int EndRun(int position);
+	Sci_Position Length() const;
+	int ValueAt(Sci_Position position) const;
+	Sci_Position FindNextChange(Sci_Position position, Sci_Position end) const;
+	Sci_Position StartRun(Sci_Position position) const;
+	Sci_Position EndRun(Sci_Position position) const;
 	// Returns true if some values may have changed
-	bool FillRange(int &position, int value, int &fillLength);
-	void SetValueAt(int position, int value);
-	void InsertSpace(int position, int insertLength);
+	bool FillRange(Sci_Position &position, int value, Sci_Position &fillLength);
+	void SetValueAt(Sci_Position position, int value);
+	void InsertSpace(Sci_Position position, Sci_Position insertLength);
 	void DeleteAll();
-	void DeleteRange(int position, int deleteLength);
+	void DeleteRange(Sci_Position position, Sci_Position deleteLength);
 	int Runs() const;
+	/// Bytes allocated for the runs.
+	size_t Memory() const;
+	/// Release space allocated for more runs than there are.
+	void Shrink();
 	bool AllSame() const;
 	bool AllSameAs(int value) const;
-	int Find(int value, int start) const;
+	Sci_Position Find(int value, Sci_Position start) const;
 };
 
 #ifdef SCI_NAMESPACE
@@ -513,6 +513,7 @@ LexState::LexState(Document *pdoc_) : LexInterface(pdoc_) {
 }
 
 LexState::~LexState() {
+	StopBackground();
 	if (instance) {
 		instance->Release();
 		instance = 0;
@@ -528,6 +529,7 @@ LexState *ScintillaBase::DocumentLexState() {
 
 void LexState::SetLexerModule(const LexerModule *lex) {
 	if (lex != lexCurrent) {
+		StopBackground();
 		if (instance) {
 			instance->Release();
 			instance = 0;
@@ -570,6 +572,7 @@ const char *LexState::DescribeWordListSets() {
 
 void LexState::SetWordList(int n, const char *wl) {
 	if (instance) {
+		StopBackground();
 		int firstModification = instance->WordListSet(n, wl);
 		if (firstModification >= 0) {
 			pdoc->ModifiedAt(firstModification);
@@ -587,6 +590,7 @@ const char *LexState::GetName() const {
 
 void *LexState::PrivateCall(int operation, void *pointer) {
 	if (pdoc && instance) {
+		StopBackground();
 		return instance->PrivateCall(operation, pointer);
 	} else {
 		return 0;
@@ -620,6 +624,7 @@ const char *LexState::DescribeProperty(const char *name) {
 void LexState::PropSet(const char *key, const char *val) {
 	props.Set(key, val);
 	if (instance) {
+		StopBackground();
 		int firstModification = instance->PropertySet(key, val);
 		if (firstModification >= 0) {
 			pdoc->ModifiedAt(firstModification);
@@ -844,6 +849,13 @@ sptr_t ScintillaBase::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lPara
 	case SCI_GETLEXER:
 		return DocumentLexState()->lexLanguage;
 
+	case SCI_SETBACKGROUNDLEXING:
+		DocumentLexState()->SetBackground(wParam != 0);
+		break;
+
+	case SCI_GETBACKGROUNDLEXING:
+		return DocumentLexState()->Background();
+
 	case SCI_COLOURISE:
 		if (DocumentLexState()->lexLanguage == SCLEX_CONTAINER) {
 			pdoc->ModifiedAt(wParam);
@@ -0,0 +1,40 @@
+// Scintilla source code edit control
+/** @file SharedMemory.h
+ ** Reference counted memory shared between a document and its snapshots.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+/**
+ * Base for memory that lives for as long as anything holds a reference to it.
+ * It is created with one reference and deleted when the last one is released.
+ * References may be added and released from any thread.
+ */
+class SharedMemory {
+	int references;
+	// Private so SharedMemory objects can not be copied
+	SharedMemory(const SharedMemory &);
+	SharedMemory &operator=(const SharedMemory &);
+protected:
+	virtual ~SharedMemory() {}
+public:
+	SharedMemory() : references(1) {}
+
+	void AddRef() {
+		AtomicCount::Increment(&references);
+	}
+
+	void Release() {
+		if (AtomicCount::Decrement(&references))
+			delete this;
+	}
+
+	/// @return true when the only reference is the caller's so no one else can read the memory.
+	bool Unique() {
+		return AtomicCount::Get(&references) == 1;
+	}
+};
+
+#endif
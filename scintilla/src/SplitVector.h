@@ -9,20 +9,33 @@
 #ifndef SPLITVECTOR_H
 #define SPLITVECTOR_H
 
+/// Set count elements to v. Bytes, such as the style of every inserted
+/// character, use memset as a loop over each is far slower.
+template <typename T>
+inline void FillElements(T *elements, Sci_Position count, T v) {
+	for (Sci_Position i = 0; i < count; i++)
+		elements[i] = v;
+}
+
+inline void FillElements(char *elements, Sci_Position count, char v) {
+	memset(elements, v, count);
+}
+
 template <typename T>
 class SplitVector {
 protected:
 	T *body;
-	int size;
-	int lengthBody;
-	int part1Length;
-	int gapLength;	/// invariant: gapLength == size - lengthBody
-	int growSize;
+	Sci_Position headLength;	/// elements dropped from the front of the allocation before body
+	Sci_Position size;
+	Sci_Position lengthBody;
+	Sci_Position part1Length;
+	Sci_Position gapLength;	/// invariant: gapLength == size - lengthBody
+	Sci_Position growSize;
 
 	/// Move the gap to a particular position so that insertion and
 	/// deletion at that point will not require much copying and
 	/// hence be fast.
-	void GapTo(int position) {
+	void GapTo(Sci_Position position) {
 		if (position != part1Length) {
 			if (position < part1Length) {
 				memmove(
@@ -41,7 +54,7 @@ protected:
 
 	/// Check that there is room in the buffer for an insertion,
 	/// reallocating if more space needed.
-	void RoomFor(int insertionLength) {
+	void RoomFor(Sci_Position insertionLength) {
 		if (gapLength <= insertionLength) {
 			while (growSize < size / 6)
 				growSize *= 2;
@@ -51,6 +64,7 @@ protected:
 
 	void Init() {
 		body = NULL;
+		headLength = 0;
 		growSize = 8;
 		size = 0;
 		lengthBody = 0;
@@ -65,41 +79,60 @@ public:
 	}
 
 	~SplitVector() {
-		delete []body;
+		delete [](body - headLength);
 		body = 0;
 	}
 
-	int GetGrowSize() const {
+	Sci_Position GetGrowSize() const {
 		return growSize;
 	}
 
-	void SetGrowSize(int growSize_) {
+	void SetGrowSize(Sci_Position growSize_) {
 		growSize = growSize_;
 	}
 
 	/// Reallocate the storage for the buffer to be newSize and
 	/// copy exisiting contents to the new buffer.
 	/// Must not be used to decrease the size of the buffer.
-	void ReAllocate(int newSize) {
+	void ReAllocate(Sci_Position newSize) {
 		if (newSize > size) {
 			// Move the gap to the end
 			GapTo(lengthBody);
 			T *newBody = new T[newSize];
 			if ((size != 0) && (body != 0)) {
 				memmove(newBody, body, sizeof(T) * lengthBody);
-				delete []body;
+				delete [](body - headLength);
 			}
 			body = newBody;
+			headLength = 0;
 			gapLength += newSize - size;
 			size = newSize;
 		}
 	}
 
+	/// Reallocate the storage to hold just the current contents, releasing the gap.
+	/// The next insertion grows the buffer again.
+	void Shrink() {
+		if ((gapLength > 0) || (headLength > 0)) {
+			GapTo(lengthBody);
+			T *newBody = NULL;
+			if (lengthBody > 0) {
+				newBody = new T[lengthBody];
+				memmove(newBody, body, sizeof(T) * lengthBody);
+			}
+			delete [](body - headLength);
+			body = newBody;
+			headLength = 0;
+			size = lengthBody;
+			gapLength = 0;
+		}
+	}
+
 	/// Retrieve the character at a particular position.
 	/// Retrieving positions outside the range of the buffer returns 0.
 	/// The assertions here are disabled since calling code can be
 	/// simpler if out of range access works and returns 0.
-	T ValueAt(int position) const {
+	T ValueAt(Sci_Position position) const {
 		if (position < part1Length) {
 			//PLATFORM_ASSERT(position >= 0);
 			if (position < 0) {
@@ -117,7 +150,7 @@ public:
 		}
 	}
 
-	void SetValueAt(int position, T v) {
+	void SetValueAt(Sci_Position position, T v) {
 		if (position < part1Length) {
 			PLATFORM_ASSERT(position >= 0);
 			if (position < 0) {
@@ -135,7 +168,7 @@ public:
 		}
 	}
 
-	T &operator[](int position) const {
+	T &operator[](Sci_Position position) const {
 		PLATFORM_ASSERT(position >= 0 && position < lengthBody);
 		if (position < part1Length) {
 			return body[position];
@@ -145,13 +178,23 @@ public:
 	}
 
 	/// Retrieve the length of the buffer.
-	int Length() const {
+	Sci_Position Length() const {
 		return lengthBody;
 	}
 
+	/// Bytes allocated for elements, including the gap and any dropped from the front.
+	size_t Memory() const {
+		return static_cast<size_t>(headLength + size) * sizeof(T);
+	}
+
+	/// Bytes allocated for elements but not used, which is the gap and the dropped front.
+	size_t Unused() const {
+		return static_cast<size_t>(headLength + gapLength) * sizeof(T);
+	}
+
 	/// Insert a single value into the buffer.
 	/// Inserting at positions outside the current range fails.
-	void Insert(int position, T v) {
+	void Insert(Sci_Position position, T v) {
 		PLATFORM_ASSERT((position >= 0) && (position <= lengthBody));
 		if ((position < 0) || (position > lengthBody)) {
 			return;
@@ -166,7 +209,7 @@ public:
 
 	/// Insert a number of elements into the buffer setting their value.
 	/// Inserting at positions outside the current range fails.
-	void InsertValue(int position, int insertLength, T v) {
+	void InsertValue(Sci_Position position, Sci_Position insertLength, T v) {
 		PLATFORM_ASSERT((position >= 0) && (position <= lengthBody));
 		if (insertLength > 0) {
 			if ((position < 0) || (position > lengthBody)) {
@@ -174,8 +217,7 @@ public:
 			}
 			RoomFor(insertLength);
 			GapTo(position);
-			for (int i = 0; i < insertLength; i++)
-				body[part1Length + i] = v;
+			FillElements(body + part1Length, insertLength, v);
 			lengthBody += insertLength;
 			part1Length += insertLength;
 			gapLength -= insertLength;
@@ -184,14 +226,14 @@ public:
 
 	/// Ensure at least length elements allocated,
 	/// appending zero valued elements if needed.
-	void EnsureLength(int wantedLength) {
+	void EnsureLength(Sci_Position wantedLength) {
 		if (Length() < wantedLength) {
 			InsertValue(Length(), wantedLength - Length(), 0);
 		}
 	}
 
 	/// Insert text into the buffer from an array.
-	void InsertFromArray(int positionToInsert, const T s[], int positionFrom, int insertLength) {
+	void InsertFromArray(Sci_Position positionToInsert, const T s[], Sci_Position positionFrom, Sci_Position insertLength) {
 		PLATFORM_ASSERT((positionToInsert >= 0) && (positionToInsert <= lengthBody));
 		if (insertLength > 0) {
 			if ((positionToInsert < 0) || (positionToInsert > lengthBody)) {
@@ -207,7 +249,7 @@ public:
 	}
 
 	/// Delete one element from the buffer.
-	void Delete(int position) {
+	void Delete(Sci_Position position) {
 		PLATFORM_ASSERT((position >= 0) && (position < lengthBody));
 		if ((position < 0) || (position >= lengthBody)) {
 			return;
@@ -217,15 +259,26 @@ public:
 
 	/// Delete a range from the buffer.
 	/// Deleting positions outside the current range fails.
-	void DeleteRange(int position, int deleteLength) {
+	void DeleteRange(Sci_Position position, Sci_Position deleteLength) {
 		PLATFORM_ASSERT((position >= 0) && (position + deleteLength <= lengthBody));
 		if ((position < 0) || ((position + deleteLength) > lengthBody)) {
 			return;
 		}
 		if ((position == 0) && (deleteLength == lengthBody)) {
 			// Full deallocation returns storage and is faster
-			delete []body;
+			delete [](body - headLength);
 			Init();
+		} else if ((deleteLength > 0) && (position + deleteLength <= part1Length) &&
+			(position < part1Length - position - deleteLength)) {
+			// Nearer the front than the gap, as when the first lines of a log are
+			// trimmed, so move the few elements before the range up over it and drop
+			// the front of the allocation. It is reclaimed when the buffer next grows.
+			memmove(body + deleteLength, body, sizeof(T) * position);
+			body += deleteLength;
+			headLength += deleteLength;
+			size -= deleteLength;
+			part1Length -= deleteLength;
+			lengthBody -= deleteLength;
 		} else if (deleteLength > 0) {
 			GapTo(position);
 			lengthBody -= deleteLength;
@@ -239,11 +292,11 @@ public:
 	}
 
 	// Retrieve a range of elements into an array
-	void GetRange(T *buffer, int position, int retrieveLength) const {
+	void GetRange(T *buffer, Sci_Position position, Sci_Position retrieveLength) const {
 		// Split into up to 2 ranges, before and after the split then use memcpy on each.
-		int range1Length = 0;
+		Sci_Position range1Length = 0;
 		if (position < part1Length) {
-			int part1AfterPosition = part1Length - position;
+			Sci_Position part1AfterPosition = part1Length - position;
 			range1Length = retrieveLength;
 			if (range1Length > part1AfterPosition)
 				range1Length = part1AfterPosition;
@@ -251,10 +304,21 @@ public:
 		memcpy(buffer, body + position, range1Length * sizeof(T));
 		buffer += range1Length;
 		position = position + range1Length + gapLength;
-		int range2Length = retrieveLength - range1Length;
+		Sci_Position range2Length = retrieveLength - range1Length;
 		memcpy(buffer, body + position, range2Length * sizeof(T));
 	}
 
+	/// Retrieve the contiguous elements starting at position without moving the gap.
+	/// lengthSegment is set to how many elements follow position before the gap or end.
+	const T *SegmentAt(Sci_Position position, Sci_Position &lengthSegment) const {
+		if (position < part1Length) {
+			lengthSegment = part1Length - position;
+			return body + position;
+		}
+		lengthSegment = lengthBody - position;
+		return body + gapLength + position;
+	}
+
 	T *BufferPointer() {
 		RoomFor(1);
 		GapTo(lengthBody);
@@ -0,0 +1,699 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+
+#include "Sci_Position.h"
+#include "Scintilla.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "CellBuffer.h"
+
+#include <gtest/gtest.h>
+
+// Test CellBuffer.
+
+class CellBufferTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pcb = new CellBuffer();
+		pcb->SetUndoCollection(false);
+	}
+
+	virtual void TearDown() {
+		delete pcb;
+		pcb = 0;
+	}
+
+	void Insert(Sci_Position position, const char *s) {
+		bool startSequence = false;
+		pcb->InsertString(position, s, static_cast<Sci_Position>(strlen(s)), startSequence);
+	}
+
+	void Delete(Sci_Position position, Sci_Position deleteLength) {
+		bool startSequence = false;
+		pcb->DeleteChars(position, deleteLength, startSequence);
+	}
+
+	// Check the line starts against those found by a simple scan of the text.
+	void CheckLines() {
+		std::vector<Sci_Position> starts(1, 0);
+		const Sci_Position length = pcb->Length();
+		for (Sci_Position i = 0; i < length; i++) {
+			const char ch = pcb->CharAt(i);
+			if ((ch == '\n') || ((ch == '\r') && (pcb->CharAt(i + 1) != '\n')))
+				starts.push_back(i + 1);
+		}
+		ASSERT_EQ(static_cast<int>(starts.size()), pcb->Lines());
+		for (size_t line = 0; line < starts.size(); line++) {
+			ASSERT_EQ(starts[line], pcb->LineStart(static_cast<int>(line)));
+		}
+	}
+
+	CellBuffer *pcb;
+};
+
+TEST_F(CellBufferTest, IsEmptyInitially) {
+	EXPECT_EQ(0, pcb->Length());
+	EXPECT_EQ(1, pcb->Lines());
+}
+
+TEST_F(CellBufferTest, InsertLineEnds) {
+	Insert(0, "a\nb\r\nc\rd");
+	EXPECT_EQ(4, pcb->Lines());
+	EXPECT_EQ(2, pcb->LineStart(1));
+	EXPECT_EQ(5, pcb->LineStart(2));
+	EXPECT_EQ(7, pcb->LineStart(3));
+	CheckLines();
+}
+
+TEST_F(CellBufferTest, SplitAndJoinCrLf) {
+	Insert(0, "ab\r\ncd");
+	EXPECT_EQ(2, pcb->Lines());
+	// Splitting the pair makes two line ends
+	Insert(3, "x");
+	EXPECT_EQ(3, pcb->Lines());
+	CheckLines();
+	// Removing the character between them joins the pair again
+	Delete(3, 1);
+	EXPECT_EQ(2, pcb->Lines());
+	CheckLines();
+	// Inserting a cr before an lf or an lf after a cr completes a pair
+	Insert(0, "\n");
+	Insert(pcb->Length(), "\r");
+	Insert(0, "\r");
+	Insert(pcb->Length(), "\n");
+	CheckLines();
+	EXPECT_EQ(4, pcb->Lines());
+}
+
+TEST_F(CellBufferTest, LongInsertions) {
+	// Long enough to use every path of the line end scanner
+	std::string text;
+	for (int i = 0; i < 300; i++) {
+		text += std::string(i % 40, 'x');
+		text += (i % 3 == 0) ? "\r\n" : ((i % 3 == 1) ? "\n" : "\r");
+	}
+	Insert(0, text.c_str());
+	CheckLines();
+	Insert(1000, text.c_str());
+	CheckLines();
+	Insert(pcb->Length(), text.c_str());
+	CheckLines();
+}
+
+TEST_F(CellBufferTest, ScatteredLineEnds) {
+	const char *pieces[] = {"\r", "\n", "\r\n", "ab", "c\rd", "\n\n\r\r", "e\r\nf\n"};
+	const int countPieces = sizeof(pieces) / sizeof(pieces[0]);
+	unsigned int seed = 1;
+	for (int step = 0; step < 2000; step++) {
+		seed = seed * 1103515245 + 12345;
+		const Sci_Position length = pcb->Length();
+		const Sci_Position position = static_cast<Sci_Position>((seed >> 8) % (length + 1));
+		if (((seed >> 4) % 4 == 0) && (position < length)) {
+			Sci_Position deleteLength = (seed >> 12) % 5 + 1;
+			if (deleteLength > length - position)
+				deleteLength = length - position;
+			Delete(position, deleteLength);
+		} else {
+			Insert(position, pieces[(seed >> 16) % countPieces]);
+		}
+	}
+	CheckLines();
+}
+
+TEST_F(CellBufferTest, ScatteredLineEndsTree) {
+	// The same edits with the line starts in a PartitionTree, over enough lines to split it
+	delete pcb;
+	pcb = new CellBuffer(SC_DOCUMENTOPTION_LINES_TREE);
+	pcb->SetUndoCollection(false);
+	for (int line = 0; line < 5000; line++) {
+		Insert(pcb->Length(), (line % 2) ? "ab\r\n" : "c\n");
+	}
+	CheckLines();
+	const char *pieces[] = {"\r", "\n", "\r\n", "ab", "c\rd", "\n\n\r\r", "e\r\nf\n"};
+	const int countPieces = sizeof(pieces) / sizeof(pieces[0]);
+	unsigned int seed = 1;
+	for (int step = 0; step < 5000; step++) {
+		seed = seed * 1103515245 + 12345;
+		const Sci_Position length = pcb->Length();
+		const Sci_Position position = static_cast<Sci_Position>((seed >> 8) % (length + 1));
+		if (((seed >> 4) % 3 == 0) && (position < length)) {
+			Sci_Position deleteLength = (seed >> 12) % 8 + 1;
+			if (deleteLength > length - position)
+				deleteLength = length - position;
+			Delete(position, deleteLength);
+		} else {
+			Insert(position, pieces[(seed >> 16) % countPieces]);
+		}
+	}
+	CheckLines();
+	for (Sci_Position position = 0; position < pcb->Length(); position += 7) {
+		const int line = pcb->LineFromPosition(position);
+		ASSERT_LE(pcb->LineStart(line), position);
+		ASSERT_GT(pcb->LineStart(line + 1), position);
+	}
+	Delete(0, pcb->Length());
+	EXPECT_EQ(1, pcb->Lines());
+}
+
+// Long enough that several threads find the line starts.
+static std::string ManyLineEnds(Sci_Position length, unsigned int seed) {
+	const char *pieces[] = {"\r", "\n", "\r\n", "ab", "c\rd", "\n\n\r\r", "e\r\nf\n", "ghijklmnopqrstuvwxyz"};
+	const int countPieces = sizeof(pieces) / sizeof(pieces[0]);
+	std::string text;
+	while (static_cast<Sci_Position>(text.length()) < length) {
+		seed = seed * 1103515245 + 12345;
+		text += pieces[(seed >> 16) % countPieces];
+	}
+	text.resize(length);
+	return text;
+}
+
+TEST_F(CellBufferTest, HugeInsertions) {
+	const std::string text = ManyLineEnds(5 * 1024 * 1024 + 7, 1);
+	Insert(0, text.c_str());
+	CheckLines();
+	// Inserting between a cr and an lf and then completing pairs at both ends
+	Insert(0, "a\r\nb");
+	Insert(2, text.c_str());
+	CheckLines();
+	Insert(0, "\r");
+	Insert(1, ("\n" + text + "\r").c_str());
+	CheckLines();
+}
+
+TEST_F(CellBufferTest, AppendWithoutLines) {
+	const std::string text = ManyLineEnds(3 * 1024 * 1024 + 3, 2);
+	for (size_t position = 0; position < text.length(); position += 100000) {
+		const size_t lengthAppend = (text.length() - position < 100000) ? text.length() - position : 100000;
+		pcb->AppendWithoutLines(text.c_str() + position, static_cast<Sci_Position>(lengthAppend));
+	}
+	EXPECT_EQ(1, pcb->Lines());
+	EXPECT_EQ(0, pcb->IndexedTo());
+	pcb->IndexLines(pcb->Length());
+	EXPECT_EQ(pcb->Length(), pcb->IndexedTo());
+	CheckLines();
+}
+
+TEST_F(CellBufferTest, TextSegments) {
+	const int options[] = { 0, SC_DOCUMENTOPTION_TEXT_CHUNKED };
+	for (size_t option = 0; option < sizeof(options) / sizeof(options[0]); option++) {
+		delete pcb;
+		pcb = new CellBuffer(options[option]);
+		const std::string text = ManyLineEnds(300000, 1);
+		Insert(0, text.c_str());
+		Insert(100000, "abc");
+		Delete(250000, 10);
+		const int version = pcb->TextVersion();
+		std::string all(pcb->Length(), '\0');
+		pcb->GetCharRange(&all[0], 0, pcb->Length());
+		// Reading segments neither copies nor moves the text
+		std::string segments;
+		Sci_Position position = 0;
+		while (position < pcb->Length()) {
+			Sci_Position lengthSegment = 0;
+			const char *segment = pcb->TextSegment(position, lengthSegment);
+			ASSERT_TRUE(segment != 0);
+			ASSERT_GT(lengthSegment, 0);
+			segments.append(segment, lengthSegment);
+			position += lengthSegment;
+		}
+		EXPECT_EQ(all, segments);
+		EXPECT_EQ(version, pcb->TextVersion());
+		Sci_Position lengthSegment = 1;
+		EXPECT_EQ(0, pcb->TextSegment(pcb->Length(), lengthSegment));
+		EXPECT_EQ(0, lengthSegment);
+		// Modifying or compacting the text changes the version
+		Insert(5, "d");
+		EXPECT_NE(version, pcb->TextVersion());
+		const int versionInserted = pcb->TextVersion();
+		pcb->BufferPointer();
+		EXPECT_NE(versionInserted, pcb->TextVersion());
+		// Once compacted the whole text is one segment
+		const char *whole = pcb->TextSegment(0, lengthSegment);
+		EXPECT_EQ(pcb->Length(), lengthSegment);
+		EXPECT_EQ(pcb->BufferPointer(), whole);
+	}
+}
+
+namespace {
+
+class StringFile : public MappedFile {
+	std::string text;
+public:
+	explicit StringFile(const std::string &text_) : text(text_) {
+	}
+	virtual const char *Data() {
+		return text.c_str();
+	}
+	virtual size_t Length() {
+		return text.length();
+	}
+	virtual bool IsValid() {
+		return true;
+	}
+};
+
+std::string SnapshotText(const CellSnapshot *snapshot) {
+	std::string text(snapshot->Length(), '\0');
+	snapshot->GetCharRange(&text[0], 0, snapshot->Length());
+	return text;
+}
+
+std::string SnapshotStyles(const CellSnapshot *snapshot) {
+	std::string styles(snapshot->Length(), '\0');
+	snapshot->GetStyleRange(reinterpret_cast<unsigned char *>(&styles[0]), 0, snapshot->Length());
+	return styles;
+}
+
+// Either edits the buffer or repeatedly reads the snapshot, checking it still holds text.
+struct SnapshotWork {
+	CellBuffer *pcb;
+	const CellSnapshot *snapshot;
+	std::string text;
+	bool matched;
+};
+
+void SnapshotWorker(void *work) {
+	SnapshotWork *item = static_cast<SnapshotWork *>(work);
+	if (item->pcb) {
+		CellBuffer *pcb = item->pcb;
+		bool startSequence = false;
+		for (int edit = 0; edit < 200; edit++) {
+			const Sci_Position position = (edit * 7919) % pcb->Length();
+			pcb->InsertString(position, "edit", 4, startSequence);
+			pcb->SetStyleFor(position, 4, 3, '\xff');
+			pcb->DeleteChars((position * 3) % (pcb->Length() - 10), 6, startSequence);
+		}
+		return;
+	}
+	item->matched = true;
+	for (int pass = 0; pass < 20; pass++) {
+		std::string segments;
+		Sci_Position position = 0;
+		while (position < item->snapshot->Length()) {
+			Sci_Position lengthSegment = 0;
+			const char *segment = item->snapshot->TextSegment(position, lengthSegment);
+			segments.append(segment, lengthSegment);
+			position += lengthSegment;
+		}
+		if ((segments != item->text) || (SnapshotText(item->snapshot) != item->text))
+			item->matched = false;
+	}
+}
+
+}
+
+TEST_F(CellBufferTest, Snapshots) {
+	const int options[] = { 0, SC_DOCUMENTOPTION_TEXT_CHUNKED };
+	for (size_t option = 0; option < sizeof(options) / sizeof(options[0]); option++) {
+		delete pcb;
+		pcb = new CellBuffer(options[option]);
+		Insert(0, ManyLineEnds(300000, 3).c_str());
+		pcb->SetStyleFor(1000, 50000, 5, '\xff');
+		std::string text(pcb->Length(), '\0');
+		pcb->GetCharRange(&text[0], 0, pcb->Length());
+		CellSnapshot *snapshot = pcb->CreateSnapshot();
+		EXPECT_EQ(pcb->TextVersion(), snapshot->Version());
+		EXPECT_EQ(pcb->Length(), snapshot->Length());
+		const std::string styles = SnapshotStyles(snapshot);
+		EXPECT_EQ(5, snapshot->StyleAt(1000));
+		EXPECT_EQ(0, snapshot->StyleAt(51000));
+		// A second snapshot without changes in between shares the same text
+		CellSnapshot *again = pcb->CreateSnapshot();
+		EXPECT_EQ(text, SnapshotText(again));
+		delete again;
+		// Changes to the buffer are not seen by the snapshot
+		Insert(10, "inserted");
+		Delete(200000, 5000);
+		pcb->SetStyleFor(0, 100, 7, '\xff');
+		pcb->SetStyleAt(60000, 9);
+		pcb->BufferPointer();
+		EXPECT_NE(snapshot->Version(), pcb->TextVersion());
+		EXPECT_EQ('i', pcb->CharAt(10));
+		EXPECT_EQ(7, pcb->StyleAt(0));
+		EXPECT_EQ(text, SnapshotText(snapshot));
+		EXPECT_EQ(styles, SnapshotStyles(snapshot));
+		EXPECT_EQ(text[10], snapshot->CharAt(10));
+		EXPECT_EQ(0, snapshot->CharAt(snapshot->Length()));
+		// Snapshots may outlive their buffer
+		CellSnapshot *later = pcb->CreateSnapshot();
+		std::string textLater(pcb->Length(), '\0');
+		pcb->GetCharRange(&textLater[0], 0, pcb->Length());
+		delete pcb;
+		pcb = 0;
+		EXPECT_EQ(text, SnapshotText(snapshot));
+		EXPECT_EQ(textLater, SnapshotText(later));
+		delete snapshot;
+		delete later;
+		pcb = new CellBuffer();
+	}
+}
+
+TEST_F(CellBufferTest, SnapshotWithoutStyles) {
+	const int options[] = { 0, SC_DOCUMENTOPTION_TEXT_CHUNKED };
+	for (size_t option = 0; option < sizeof(options) / sizeof(options[0]); option++) {
+		delete pcb;
+		pcb = new CellBuffer(options[option]);
+		Insert(0, ManyLineEnds(100000, 3).c_str());
+		pcb->SetStyleFor(1000, 50000, 5, '\xff');
+		std::string text(pcb->Length(), '\0');
+		pcb->GetCharRange(&text[0], 0, pcb->Length());
+		CellSnapshot *snapshot = pcb->CreateSnapshot(false);
+		EXPECT_EQ(pcb->Length(), snapshot->Length());
+		EXPECT_EQ(0, snapshot->StyleAt(1000));
+		// Styling goes on in the buffer while the text stays frozen
+		pcb->SetStyleFor(0, 100, 7, '\xff');
+		Insert(10, "inserted");
+		EXPECT_EQ(7, pcb->StyleAt(0));
+		EXPECT_EQ(5, pcb->StyleAt(1010));
+		EXPECT_EQ(text, SnapshotText(snapshot));
+		EXPECT_EQ(std::string(text.length(), '\0'), SnapshotStyles(snapshot));
+		delete snapshot;
+	}
+}
+
+TEST_F(CellBufferTest, SnapshotOfMappedFile) {
+	delete pcb;
+	pcb = new CellBuffer(SC_DOCUMENTOPTION_TEXT_CHUNKED);
+	const std::string text = ManyLineEnds(200000, 4);
+	EXPECT_TRUE(pcb->SetMappedFile(new StringFile(text)));
+	CellSnapshot *snapshot = pcb->CreateSnapshot();
+	Insert(0, "abc");
+	// The snapshot keeps the mapping open after the buffer has gone
+	delete pcb;
+	pcb = 0;
+	EXPECT_EQ(text, SnapshotText(snapshot));
+	delete snapshot;
+	pcb = new CellBuffer();
+}
+
+TEST_F(CellBufferTest, SnapshotReadWhileEditing) {
+	const int options[] = { 0, SC_DOCUMENTOPTION_TEXT_CHUNKED };
+	for (size_t option = 0; option < sizeof(options) / sizeof(options[0]); option++) {
+		delete pcb;
+		pcb = new CellBuffer(options[option]);
+		pcb->SetUndoCollection(false);
+		Insert(0, ManyLineEnds(500000, 5).c_str());
+		CellSnapshot *snapshot = pcb->CreateSnapshot();
+		SnapshotWork editor = { pcb, 0, std::string(), false };
+		SnapshotWork reader = { 0, snapshot, SnapshotText(snapshot), false };
+		void *work[2] = { &editor, &reader };
+		Workers::Run(SnapshotWorker, work, 2);
+		EXPECT_TRUE(reader.matched);
+		delete snapshot;
+	}
+}
+
+TEST_F(CellBufferTest, StylesStartUnstyled) {
+	Insert(0, "abc\ndef");
+	for (Sci_Position i = 0; i < pcb->Length(); i++) {
+		EXPECT_EQ(0, pcb->StyleAt(i));
+	}
+	EXPECT_EQ(0, pcb->StyleAt(-1));
+	EXPECT_EQ(0, pcb->StyleAt(pcb->Length()));
+	EXPECT_TRUE(pcb->SetStyleFor(2, 3, '\x85', '\xff'));
+	EXPECT_FALSE(pcb->SetStyleFor(2, 3, '\x85', '\xff'));
+	unsigned char styles[7] = {0};
+	pcb->GetStyleRange(styles, 0, 7);
+	const unsigned char expected[7] = {0, 0, 0x85, 0x85, 0x85, 0, 0};
+	EXPECT_EQ(0, memcmp(expected, styles, 7));
+	// Text inserted into styled text is unstyled
+	Insert(3, "xy");
+	EXPECT_EQ('\x85', pcb->StyleAt(2));
+	EXPECT_EQ(0, pcb->StyleAt(3));
+	EXPECT_EQ(0, pcb->StyleAt(4));
+	EXPECT_EQ('\x85', pcb->StyleAt(5));
+	EXPECT_EQ(0, pcb->StyleAt(pcb->Length()));
+}
+
+TEST_F(CellBufferTest, StylesMatchBytes) {
+	// Styles, kept as runs until they become dense, compared with a byte for each character
+	std::string text(200000, 'a');
+	std::string styles(text.length(), '\0');
+	Insert(0, text.c_str());
+	unsigned int seed = 1;
+	for (int step = 0; step < 4000; step++) {
+		seed = seed * 1103515245 + 12345;
+		const Sci_Position length = pcb->Length();
+		const Sci_Position position = static_cast<Sci_Position>((seed >> 8) % (length + 1));
+		Sci_Position lengthRange = (seed >> 12) % 40 + 1;
+		if (lengthRange > length - position)
+			lengthRange = length - position;
+		const int action = (seed >> 4) % 8;
+		if ((action == 0) && (lengthRange > 0)) {
+			Delete(position, lengthRange);
+			text.erase(position, lengthRange);
+			styles.erase(position, lengthRange);
+		} else if (action < 3) {
+			const std::string piece(lengthRange + 1, 'a');
+			Insert(position, piece.c_str());
+			text.insert(position, piece);
+			styles.insert(position, std::string(piece.length(), '\0'));
+		} else if (lengthRange > 0) {
+			const char mask = (action == 3) ? '\x1f' : '\xff';
+			const char value = static_cast<char>((seed >> 20) & mask);
+			pcb->SetStyleFor(position, lengthRange, value, mask);
+			for (Sci_Position i = position; i < position + lengthRange; i++)
+				styles[i] = static_cast<char>((styles[i] & ~mask) | value);
+		}
+		if (step == 2000) {
+			// Emptying the buffer discards the styles
+			Delete(0, pcb->Length());
+			text.clear();
+			styles.clear();
+		}
+		ASSERT_EQ(static_cast<Sci_Position>(styles.length()), pcb->Length());
+	}
+	std::vector<unsigned char> retrieved(styles.length() + 1);
+	pcb->GetStyleRange(&retrieved[0], 0, pcb->Length());
+	for (size_t i = 0; i < styles.length(); i++) {
+		ASSERT_EQ(static_cast<unsigned char>(styles[i]), retrieved[i]);
+		ASSERT_EQ(styles[i], pcb->StyleAt(static_cast<Sci_Position>(i)));
+	}
+}
+
+// Test the undo history of CellBuffer.
+
+static std::string Text(CellBuffer *pcb) {
+	std::string text(pcb->Length(), '\0');
+	if (pcb->Length())
+		pcb->GetCharRange(&text[0], 0, pcb->Length());
+	return text;
+}
+
+static void UndoSequence(CellBuffer *pcb) {
+	const int steps = pcb->StartUndo();
+	for (int step = 0; step < steps; step++)
+		pcb->PerformUndoStep();
+}
+
+static void RedoSequence(CellBuffer *pcb) {
+	const int steps = pcb->StartRedo();
+	for (int step = 0; step < steps; step++)
+		pcb->PerformRedoStep();
+}
+
+TEST_F(CellBufferTest, UndoRedo) {
+	pcb->SetUndoCollection(true);
+	Insert(0, "abcdef");
+	pcb->BeginUndoAction();
+	Delete(1, 2);
+	Insert(2, "xyz");
+	pcb->EndUndoAction();
+	EXPECT_EQ("adxyzef", Text(pcb));
+	EXPECT_EQ(3, pcb->UndoActions());
+	UndoSequence(pcb);
+	EXPECT_EQ("abcdef", Text(pcb));
+	UndoSequence(pcb);
+	EXPECT_EQ("", Text(pcb));
+	EXPECT_FALSE(pcb->CanUndo());
+	RedoSequence(pcb);
+	RedoSequence(pcb);
+	EXPECT_EQ("adxyzef", Text(pcb));
+	// A new action after undoing discards the actions that could be redone
+	UndoSequence(pcb);
+	Insert(0, "12");
+	EXPECT_FALSE(pcb->CanRedo());
+	EXPECT_EQ(2, pcb->UndoActions());
+	pcb->DeleteUndoHistory();
+	EXPECT_EQ(0, pcb->UndoActions());
+	EXPECT_EQ("12abcdef", Text(pcb));
+}
+
+TEST_F(CellBufferTest, UndoTextReturned) {
+	pcb->SetUndoCollection(true);
+	bool startSequence = false;
+	const char *inserted = pcb->InsertString(0, "hello world", 11, startSequence);
+	EXPECT_EQ(0, memcmp(inserted, "hello world", 11));
+	const char *deleted = pcb->DeleteChars(5, 6, startSequence);
+	EXPECT_EQ(0, memcmp(deleted, " world", 6));
+	// A large action is held in its own block
+	const std::string text = ManyLineEnds(200000, 3);
+	inserted = pcb->InsertString(5, text.c_str(), static_cast<Sci_Position>(text.length()), startSequence);
+	EXPECT_EQ(0, memcmp(inserted, text.c_str(), text.length()));
+	EXPECT_EQ(0, memcmp(deleted, " world", 6));
+	UndoSequence(pcb);
+	UndoSequence(pcb);
+	EXPECT_EQ("hello world", Text(pcb));
+}
+
+TEST_F(CellBufferTest, UndoMemoryLimit) {
+	pcb->SetUndoCollection(true);
+	const std::string piece(1000, 'a');
+	for (int sequence = 0; sequence < 50; sequence++) {
+		pcb->BeginUndoAction();
+		Insert(pcb->Length(), piece.c_str());
+		Insert(0, piece.c_str());
+		pcb->EndUndoAction();
+	}
+	EXPECT_EQ(100, pcb->UndoActions());
+	const size_t memoryAll = pcb->UndoMemory();
+	EXPECT_GE(memoryAll, static_cast<size_t>(100000));
+	// Each sequence holds 2000 bytes of text and 3 actions so 9 fit within the limit less 1/16
+	pcb->SetUndoMemoryLimit(20500);
+	EXPECT_EQ(20500, pcb->UndoMemoryLimit());
+	EXPECT_EQ(18, pcb->UndoActions());
+	EXPECT_LT(pcb->UndoMemory(), memoryAll);
+	Insert(0, "b");
+	EXPECT_EQ(19, pcb->UndoActions());
+	int sequences = 0;
+	while (pcb->CanUndo()) {
+		UndoSequence(pcb);
+		sequences++;
+	}
+	// The insertion of "b" and the 9 newest sequences
+	EXPECT_EQ(10, sequences);
+	EXPECT_EQ(static_cast<Sci_Position>(piece.length() * 82), pcb->Length());
+	EXPECT_FALSE(pcb->IsSavePoint());
+	// The current sequence is kept even when it alone is over the limit
+	const std::string large(30000, 'c');
+	Insert(0, large.c_str());
+	EXPECT_EQ(1, pcb->UndoActions());
+	UndoSequence(pcb);
+	EXPECT_EQ(static_cast<Sci_Position>(piece.length() * 82), pcb->Length());
+}
+
+TEST_F(CellBufferTest, MemoryUsage) {
+	const int options[] = { 0, SC_DOCUMENTOPTION_TEXT_CHUNKED };
+	for (size_t option = 0; option < sizeof(options) / sizeof(options[0]); option++) {
+		delete pcb;
+		pcb = new CellBuffer(options[option]);
+		pcb->SetUndoCollection(false);
+		const std::string text = ManyLineEnds(1000, 4);
+		Insert(0, text.c_str());
+		size_t unused = 0;
+		const size_t memoryText = pcb->TextMemory(unused);
+		EXPECT_GE(memoryText, text.length());
+		EXPECT_LE(unused, memoryText);
+		EXPECT_GT(pcb->StyleMemory(), 0u);
+		EXPECT_GT(pcb->LineIndexMemory(), 0u);
+	}
+}
+
+TEST_F(CellBufferTest, HibernateAndRehydrate) {
+	const int options[] = { 0, SC_DOCUMENTOPTION_TEXT_CHUNKED };
+	for (size_t option = 0; option < sizeof(options) / sizeof(options[0]); option++) {
+		delete pcb;
+		pcb = new CellBuffer(options[option]);
+		pcb->SetUndoCollection(false);
+		// Repetitive text with long runs and bytes that do not repeat, over several blocks
+		std::string text = ManyLineEnds(300000, 5) + std::string(70000, 'x');
+		unsigned int seed = 7;
+		for (int i = 0; i < 1000; i++) {
+			seed = seed * 1103515245 + 12345;
+			text += static_cast<char>((seed >> 16) | 1);
+		}
+		Insert(0, text.c_str());
+		pcb->SetStyleFor(0, 100, 3, '\377');
+		const int lines = pcb->Lines();
+		size_t unused = 0;
+		const size_t memoryAwake = pcb->TextMemory(unused);
+		pcb->Hibernate();
+		EXPECT_TRUE(pcb->IsHibernating());
+		EXPECT_LT(pcb->TextMemory(unused), memoryAwake / 2);
+		EXPECT_EQ(static_cast<Sci_Position>(text.length()), pcb->Length());
+		EXPECT_EQ(lines, pcb->Lines());
+		EXPECT_EQ(0, pcb->StyleAt(50));
+		// Reading works while hibernating without keeping the text expanded
+		EXPECT_EQ(text, Text(pcb));
+		EXPECT_EQ(text[300000], pcb->CharAt(300000));
+		Sci_Position lengthSegment = 1;
+		EXPECT_TRUE(pcb->TextSegment(0, lengthSegment) == 0);
+		EXPECT_EQ(0, lengthSegment);
+		EXPECT_TRUE(pcb->IsHibernating());
+		EXPECT_LT(pcb->TextMemory(unused), memoryAwake / 2);
+		// Changing it rehydrates
+		Insert(0, "abc");
+		EXPECT_FALSE(pcb->IsHibernating());
+		EXPECT_EQ("abc" + text, Text(pcb));
+		CheckLines();
+	}
+}
+
+TEST_F(CellBufferTest, HibernateShrinksMappedText) {
+	// Mapped text is not compressed but the chunks edited still give back their gaps
+	delete pcb;
+	pcb = new CellBuffer(SC_DOCUMENTOPTION_TEXT_CHUNKED);
+	const std::string text = ManyLineEnds(200000, 4);
+	EXPECT_TRUE(pcb->SetMappedFile(new StringFile(text)));
+	Insert(1000, "inserted");
+	Insert(150000, "inserted");
+	size_t unused = 0;
+	pcb->TextMemory(unused);
+	EXPECT_GT(unused, 0u);
+	pcb->Hibernate();
+	pcb->TextMemory(unused);
+	EXPECT_EQ(0u, unused);
+	EXPECT_EQ(static_cast<Sci_Position>(text.length() + 16), pcb->Length());
+}
+
+TEST_F(CellBufferTest, RehydrateExpandsOnce) {
+	const std::string text = ManyLineEnds(300000, 5);
+	Insert(0, text.c_str());
+	size_t unused = 0;
+	const size_t memoryAwake = pcb->TextMemory(unused);
+	pcb->Hibernate();
+	pcb->Rehydrate();
+	EXPECT_FALSE(pcb->IsHibernating());
+	// The compressed copy is gone once expanded
+	EXPECT_LE(pcb->TextMemory(unused), memoryAwake);
+	Sci_Position lengthSegment = 0;
+	EXPECT_TRUE(pcb->TextSegment(0, lengthSegment) != 0);
+	EXPECT_GT(lengthSegment, 0);
+	EXPECT_EQ(text, Text(pcb));
+}
+
+TEST_F(CellBufferTest, HibernateEmpty) {
+	pcb->Hibernate();
+	EXPECT_TRUE(pcb->IsHibernating());
+	EXPECT_EQ(0, pcb->Length());
+	pcb->Rehydrate();
+	EXPECT_FALSE(pcb->IsHibernating());
+	Insert(0, "a\nb");
+	EXPECT_EQ(2, pcb->Lines());
+}
+
+TEST_F(CellBufferTest, AppendAndTrimHead) {
+	// The storage used by SC_DOCUMENTOPTION_LOG as it appends lines and deletes the oldest
+	delete pcb;
+	pcb = new CellBuffer(SC_DOCUMENTOPTION_TEXT_CHUNKED | SC_DOCUMENTOPTION_LINES_TREE);
+	pcb->SetUndoCollection(false);
+	const std::string text = ManyLineEnds(200000, 6);
+	Insert(0, text.c_str());
+	const int lines = pcb->Lines();
+	for (int i = 0; i < 2000; i++) {
+		Insert(pcb->Length(), "a log line\n");
+		Delete(0, pcb->LineStart(1));
+		if ((i % 500) == 0)
+			CheckLines();
+	}
+	EXPECT_EQ(lines, pcb->Lines());
+	CheckLines();
+}
@@ -0,0 +1,292 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+
+#include "Platform.h"
+
+#include "Sci_Position.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "SharedMemory.h"
+#include "ChunkedVector.h"
+
+#include <gtest/gtest.h>
+
+// Test ChunkedVector.
+
+// Small chunks so that the tests cross chunk boundaries.
+const int sizeTestChunk = 4;
+
+class ChunkedVectorTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pcv = new ChunkedVector<int>(sizeTestChunk);
+	}
+
+	virtual void TearDown() {
+		delete pcv;
+		pcv = 0;
+	}
+
+	ChunkedVector<int> *pcv;
+};
+
+const int lengthTestArray = 20;
+static const int testArray[lengthTestArray] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19
+};
+
+TEST_F(ChunkedVectorTest, IsEmptyInitially) {
+	EXPECT_EQ(0, pcv->Length());
+	EXPECT_EQ(0, pcv->ValueAt(0));
+}
+
+TEST_F(ChunkedVectorTest, InsertValue) {
+	pcv->InsertValue(0, 10, 7);
+	EXPECT_EQ(10, pcv->Length());
+	for (int i=0; i<pcv->Length(); i++) {
+		EXPECT_EQ(7, pcv->ValueAt(i));
+	}
+}
+
+TEST_F(ChunkedVectorTest, InsertFromArray) {
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	EXPECT_EQ(lengthTestArray, pcv->Length());
+	for (int i=0; i<pcv->Length(); i++) {
+		EXPECT_EQ(i, pcv->ValueAt(i));
+	}
+}
+
+TEST_F(ChunkedVectorTest, InsertOneAtATime) {
+	for (int i=0; i<lengthTestArray; i++) {
+		pcv->InsertFromArray(i, testArray, i, 1);
+	}
+	EXPECT_EQ(lengthTestArray, pcv->Length());
+	for (int i=0; i<pcv->Length(); i++) {
+		EXPECT_EQ(i, pcv->ValueAt(i));
+	}
+}
+
+TEST_F(ChunkedVectorTest, InsertInMiddle) {
+	pcv->InsertValue(0, 10, 0);
+	pcv->InsertFromArray(5, testArray, 0, lengthTestArray);
+	EXPECT_EQ(10 + lengthTestArray, pcv->Length());
+	for (int i=0; i<pcv->Length(); i++) {
+		const int expected = ((i >= 5) && (i < 5 + lengthTestArray)) ? i - 5 : 0;
+		EXPECT_EQ(expected, pcv->ValueAt(i));
+	}
+}
+
+TEST_F(ChunkedVectorTest, SetValue) {
+	pcv->InsertValue(0, 10, 0);
+	pcv->SetValueAt(5, 3);
+	pcv->SetValueAt(9, 4);
+	EXPECT_EQ(10, pcv->Length());
+	for (int i=0; i<pcv->Length(); i++) {
+		EXPECT_EQ((i == 5) ? 3 : ((i == 9) ? 4 : 0), pcv->ValueAt(i));
+	}
+}
+
+TEST_F(ChunkedVectorTest, GetRange) {
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	int retrieveArray[11] = {0};
+	pcv->GetRange(retrieveArray, 3, 11);
+	for (int i=0; i<11; i++) {
+		EXPECT_EQ(i + 3, retrieveArray[i]);
+	}
+}
+
+TEST_F(ChunkedVectorTest, DeleteRange) {
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	pcv->DeleteRange(3, 11);
+	EXPECT_EQ(lengthTestArray - 11, pcv->Length());
+	for (int i=0; i<pcv->Length(); i++) {
+		EXPECT_EQ((i < 3) ? i : i + 11, pcv->ValueAt(i));
+	}
+}
+
+TEST_F(ChunkedVectorTest, DeleteWholeChunks) {
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	pcv->DeleteRange(0, sizeTestChunk * 2);
+	pcv->DeleteRange(pcv->Length() - sizeTestChunk, sizeTestChunk);
+	EXPECT_EQ(lengthTestArray - sizeTestChunk * 3, pcv->Length());
+	for (int i=0; i<pcv->Length(); i++) {
+		EXPECT_EQ(i + sizeTestChunk * 2, pcv->ValueAt(i));
+	}
+}
+
+TEST_F(ChunkedVectorTest, DeleteAll) {
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	pcv->DeleteRange(0, lengthTestArray);
+	EXPECT_EQ(0, pcv->Length());
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	pcv->DeleteAll();
+	EXPECT_EQ(0, pcv->Length());
+	pcv->InsertValue(0, 3, 2);
+	EXPECT_EQ(3, pcv->Length());
+	EXPECT_EQ(2, pcv->ValueAt(2));
+}
+
+TEST_F(ChunkedVectorTest, BufferPointer) {
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	int *retrievePointer = pcv->BufferPointer();
+	for (int i=0; i<lengthTestArray; i++) {
+		EXPECT_EQ(i, retrievePointer[i]);
+	}
+	EXPECT_EQ(0, retrievePointer[lengthTestArray]);
+	// Editing the joined buffer breaks it into chunks again
+	pcv->InsertValue(10, 1, 99);
+	pcv->DeleteRange(2, 1);
+	EXPECT_EQ(lengthTestArray, pcv->Length());
+	EXPECT_EQ(99, pcv->ValueAt(9));
+	EXPECT_EQ(3, pcv->ValueAt(2));
+	EXPECT_EQ(19, pcv->ValueAt(19));
+}
+
+TEST_F(ChunkedVectorTest, SegmentAt) {
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	pcv->InsertView(3, testArray, 2);
+	// Walking the segments retrieves every element without joining chunks
+	int retrieveArray[lengthTestArray + 2] = {0};
+	Sci_Position position = 0;
+	while (position < pcv->Length()) {
+		Sci_Position lengthSegment = 0;
+		const int *segment = pcv->SegmentAt(position, lengthSegment);
+		ASSERT_TRUE(segment != 0);
+		ASSERT_GT(lengthSegment, 0);
+		ASSERT_LE(lengthSegment, 2 * sizeTestChunk);
+		memcpy(retrieveArray + position, segment, lengthSegment * sizeof(int));
+		position += lengthSegment;
+	}
+	EXPECT_EQ(lengthTestArray + 2, position);
+	int expected[lengthTestArray + 2] = {0};
+	pcv->GetRange(expected, 0, lengthTestArray + 2);
+	EXPECT_EQ(0, memcmp(expected, retrieveArray, sizeof(expected)));
+	// The view is returned rather than a copy
+	Sci_Position lengthSegment = 0;
+	EXPECT_EQ(testArray + 1, pcv->SegmentAt(4, lengthSegment));
+	EXPECT_EQ(1, lengthSegment);
+	EXPECT_EQ(0, pcv->SegmentAt(lengthTestArray + 2, lengthSegment));
+	EXPECT_EQ(0, lengthSegment);
+}
+
+TEST_F(ChunkedVectorTest, MatchesSplitVector) {
+	// Scattered insertions and deletions compared with a SplitVector
+	SplitVector<int> sv;
+	unsigned int seed = 1;
+	for (int step=0; step<2000; step++) {
+		seed = seed * 1103515245 + 12345;
+		const int length = static_cast<int>(sv.Length());
+		const int position = (length > 0) ? static_cast<int>((seed >> 8) % (length + 1)) : 0;
+		const int count = static_cast<int>((seed >> 4) % lengthTestArray) + 1;
+		if ((seed & 0x3) || (position + count > length)) {
+			sv.InsertFromArray(position, testArray, lengthTestArray - count, count);
+			pcv->InsertFromArray(position, testArray, lengthTestArray - count, count);
+		} else {
+			sv.DeleteRange(position, count);
+			pcv->DeleteRange(position, count);
+		}
+		ASSERT_EQ(sv.Length(), pcv->Length());
+	}
+	for (int i=0; i<sv.Length(); i++) {
+		ASSERT_EQ(sv.ValueAt(i), pcv->ValueAt(i));
+	}
+}
+
+TEST_F(ChunkedVectorTest, InsertView) {
+	pcv->InsertValue(0, 2, 7);
+	pcv->InsertView(1, testArray, lengthTestArray);
+	EXPECT_EQ(lengthTestArray + 2, pcv->Length());
+	EXPECT_EQ(7, pcv->ValueAt(0));
+	for (int i=0; i<lengthTestArray; i++) {
+		EXPECT_EQ(i, pcv->ValueAt(i + 1));
+	}
+	EXPECT_EQ(7, pcv->ValueAt(lengthTestArray + 1));
+	int retrieveArray[lengthTestArray] = {0};
+	pcv->GetRange(retrieveArray, 1, lengthTestArray);
+	EXPECT_EQ(0, memcmp(testArray, retrieveArray, sizeof(testArray)));
+}
+
+TEST_F(ChunkedVectorTest, ModifyView) {
+	// Modifications copy the viewed memory rather than changing it
+	pcv->InsertView(0, testArray, lengthTestArray);
+	pcv->SetValueAt(2, 99);
+	pcv->InsertValue(9, 2, 98);
+	pcv->DeleteRange(15, 3);
+	EXPECT_EQ(lengthTestArray - 1, pcv->Length());
+	EXPECT_EQ(99, pcv->ValueAt(2));
+	EXPECT_EQ(8, pcv->ValueAt(8));
+	EXPECT_EQ(98, pcv->ValueAt(9));
+	EXPECT_EQ(98, pcv->ValueAt(10));
+	EXPECT_EQ(9, pcv->ValueAt(11));
+	EXPECT_EQ(12, pcv->ValueAt(14));
+	EXPECT_EQ(16, pcv->ValueAt(15));
+	EXPECT_EQ(2, testArray[2]);
+}
+
+TEST_F(ChunkedVectorTest, BufferPointerOfView) {
+	pcv->InsertView(0, testArray, 3);
+	int *retrievePointer = pcv->BufferPointer();
+	EXPECT_NE(testArray, retrievePointer);
+	EXPECT_EQ(2, retrievePointer[2]);
+	EXPECT_EQ(0, retrievePointer[3]);
+}
+
+TEST_F(ChunkedVectorTest, InsertZeros) {
+	pcv->InsertFromArray(0, testArray, 0, 4);
+	pcv->InsertValue(2, 100, 0);
+	EXPECT_EQ(104, pcv->Length());
+	pcv->SetValueAt(50, 5);
+	for (int i=0; i<pcv->Length(); i++) {
+		const int expected = (i < 2) ? i : ((i >= 102) ? i - 100 : ((i == 50) ? 5 : 0));
+		EXPECT_EQ(expected, pcv->ValueAt(i));
+	}
+	EXPECT_EQ(0, pcv->ValueAt(51));
+}
+
+TEST_F(ChunkedVectorTest, Share) {
+	pcv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	pcv->InsertValue(5, 20, 0);
+	const int lengthAll = lengthTestArray + 20;
+	int original[lengthAll];
+	pcv->GetRange(original, 0, lengthAll);
+	ChunkedVector<int> *copy = new ChunkedVector<int>(sizeTestChunk);
+	pcv->Share(*copy);
+	EXPECT_EQ(lengthAll, copy->Length());
+	// Changes to the vector are not seen by the copy
+	pcv->SetValueAt(2, 99);
+	pcv->DeleteRange(8, 20);
+	pcv->InsertFromArray(1, testArray, 0, 3);
+	EXPECT_EQ(99, pcv->ValueAt(5));
+	int retrieveArray[lengthAll] = {0};
+	copy->GetRange(retrieveArray, 0, lengthAll);
+	EXPECT_EQ(0, memcmp(original, retrieveArray, sizeof(original)));
+	// The copy keeps the shared elements alive
+	delete pcv;
+	pcv = 0;
+	for (int i=0; i<lengthAll; i++) {
+		EXPECT_EQ(original[i], copy->ValueAt(i));
+	}
+	// And can itself be modified
+	copy->SetValueAt(0, 98);
+	copy->DeleteRange(1, 30);
+	EXPECT_EQ(98, copy->ValueAt(0));
+	EXPECT_EQ(original[31], copy->ValueAt(1));
+	delete copy;
+}
+
+TEST_F(ChunkedVectorTest, ShareViewWithOwner) {
+	SplitVector<int> *body = new SplitVector<int>();
+	body->InsertFromArray(0, testArray, 0, lengthTestArray);
+	SharedArray<int> *owner = new SharedArray<int>(body);
+	pcv->InsertView(0, owner->Data(), lengthTestArray, owner);
+	ChunkedVector<int> copy(sizeTestChunk);
+	pcv->Share(copy);
+	// Both vectors reference the owner so it outlives the creator's reference
+	owner->Release();
+	pcv->DeleteAll();
+	for (int i=0; i<lengthTestArray; i++) {
+		EXPECT_EQ(i, copy.ValueAt(i));
+	}
+}
@@ -0,0 +1,99 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <errno.h>
+#include <iconv.h>
+
+#include <string>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+// Converter.h is written for GLib's wrappers of iconv, which are the same as iconv
+typedef iconv_t GIConv;
+#define g_iconv_open iconv_open
+#define g_iconv_close iconv_close
+#define g_iconv iconv
+
+#include "Converter.h"
+
+// Converts text a few bytes at a time into a small buffer, writing it out when full.
+static bool ConvertInPieces(ChunkConverter &conv, const std::string &text, size_t piece,
+	std::string &converted) {
+	char buffer[8];
+	char *out = buffer;
+	size_t outLeft = sizeof(buffer);
+	for (size_t start = 0; start < text.length(); start += piece) {
+		const char *src = text.c_str() + start;
+		size_t srcLeft = std::min(piece, text.length() - start);
+		for (;;) {
+			const ChunkConverter::Status status = conv.Convert(&src, &srcLeft, &out, &outLeft);
+			if (status == ChunkConverter::convertInvalid)
+				return false;
+			if (status == ChunkConverter::convertOK)
+				break;
+			converted.append(buffer, out - buffer);
+			out = buffer;
+			outLeft = sizeof(buffer);
+		}
+	}
+	if (!conv.Complete())
+		return false;
+	for (;;) {
+		const ChunkConverter::Status status = conv.Finish(&out, &outLeft);
+		if (status == ChunkConverter::convertInvalid)
+			return false;
+		converted.append(buffer, out - buffer);
+		out = buffer;
+		outLeft = sizeof(buffer);
+		if (status == ChunkConverter::convertOK)
+			return true;
+	}
+}
+
+// "Japanese text" then plain ASCII, so ISO-2022-JP shifts in and out
+static const char japanese[] = "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e text \xe6\x97\xa5";
+
+TEST(ChunkConverter, StatefulCharSetReturnsToInitialState) {
+	for (size_t piece = 1; piece <= 8; piece++) {
+		SCOPED_TRACE(piece);
+		ChunkConverter conv("ISO-2022-JP", "UTF-8", false);
+		ASSERT_TRUE(conv);
+		std::string converted;
+		EXPECT_TRUE(ConvertInPieces(conv, japanese, piece, converted));
+		// Shifted back to ASCII at the end
+		ASSERT_GT(converted.length(), 3u);
+		EXPECT_EQ("\x1b(B", converted.substr(converted.length() - 3));
+		// And the same as converting all at once
+		ChunkConverter whole("UTF-8", "ISO-2022-JP", false);
+		std::string back;
+		EXPECT_TRUE(ConvertInPieces(whole, converted, converted.length(), back));
+		EXPECT_EQ(std::string(japanese), back);
+	}
+}
+
+TEST(ChunkConverter, FinishWaitsForRoom) {
+	ChunkConverter conv("ISO-2022-JP", "UTF-8", false);
+	ASSERT_TRUE(conv);
+	const char *src = "\xe6\x97\xa5";
+	size_t srcLeft = strlen(src);
+	char buffer[20];
+	char *out = buffer;
+	size_t outLeft = sizeof(buffer);
+	EXPECT_EQ(ChunkConverter::convertOK, conv.Convert(&src, &srcLeft, &out, &outLeft));
+	// No room for the 3 byte shift so nothing is written until there is
+	size_t tooSmall = 2;
+	char *outSmall = out;
+	EXPECT_EQ(ChunkConverter::convertOutputFull, conv.Finish(&outSmall, &tooSmall));
+	EXPECT_EQ(out, outSmall);
+	EXPECT_EQ(ChunkConverter::convertOK, conv.Finish(&out, &outLeft));
+	EXPECT_EQ("\x1b$BF|\x1b(B", std::string(buffer, out - buffer));
+}
+
+TEST(ChunkConverter, StatelessCharSetFinishesWithNothing) {
+	ChunkConverter conv("ISO-8859-1", "UTF-8", false);
+	ASSERT_TRUE(conv);
+	std::string converted;
+	EXPECT_TRUE(ConvertInPieces(conv, "caf\xc3\xa9", 1, converted));
+	EXPECT_EQ("caf\xe9", converted);
+}
@@ -0,0 +1,329 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "ContractionState.h"
+#include "CellBuffer.h"
+#include "Arena.h"
+#include "PerLine.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "Document.h"
+
+#include <gtest/gtest.h>
+
+// Records the modifications made to a document.
+
+class ModificationRecorder : public DocWatcher {
+public:
+	std::vector<DocModification> modifications;
+	std::vector<std::vector<ReplacementLines> > replacementLines;
+
+	virtual void NotifyModifyAttempt(Document *, void *) {
+	}
+	virtual void NotifySavePoint(Document *, void *, bool) {
+	}
+	virtual void NotifyModified(Document *, DocModification mh, void *) {
+		modifications.push_back(mh);
+		// The lines of each replacement are only valid during the notification
+		std::vector<ReplacementLines> lines;
+		if (mh.replacementLines)
+			lines.assign(mh.replacementLines, mh.replacementLines + mh.countReplacements);
+		replacementLines.push_back(lines);
+	}
+	virtual void NotifyDeleted(Document *, void *) {
+	}
+	virtual void NotifyStyleNeeded(Document *, void *, int) {
+	}
+	virtual void NotifyLexerChanged(Document *, void *) {
+	}
+	virtual void NotifyErrorOccurred(Document *, void *, int) {
+	}
+};
+
+// Test Document.
+
+class DocumentTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pdoc = new Document();
+		pdoc->AddRef();
+	}
+
+	virtual void TearDown() {
+		pdoc->Release();
+		pdoc = 0;
+	}
+
+	void Set(const char *s) {
+		pdoc->InsertString(0, s, static_cast<int>(strlen(s)));
+	}
+
+	std::string Text() const {
+		std::string text;
+		for (int i = 0; i < pdoc->Length(); i++)
+			text += pdoc->CharAt(i);
+		return text;
+	}
+
+	Document *pdoc;
+};
+
+static Sci_Replacement Replacement(long cpMin, long cpMax, const char *text) {
+	Sci_Replacement replacement;
+	replacement.chrg.cpMin = cpMin;
+	replacement.chrg.cpMax = cpMax;
+	replacement.text = text;
+	replacement.length = text ? static_cast<long>(strlen(text)) : 0;
+	return replacement;
+}
+
+TEST_F(DocumentTest, ReplaceRanges) {
+	Set("one two three");
+	Sci_Replacement replacements[] = {
+		Replacement(0, 3, "1"),
+		Replacement(4, 4, "and "),
+		Replacement(8, 13, "3"),
+	};
+	EXPECT_TRUE(pdoc->ReplaceRanges(replacements, 3));
+	EXPECT_EQ("1 and two 3", Text());
+	pdoc->Undo();
+	EXPECT_EQ("one two three", Text());
+}
+
+TEST_F(DocumentTest, ReplaceRangesRejectsInvalid) {
+	Set("one two three");
+	Sci_Replacement overlapping[] = {
+		Replacement(0, 5, "1"),
+		Replacement(4, 7, "2"),
+	};
+	EXPECT_FALSE(pdoc->ReplaceRanges(overlapping, 2));
+	Sci_Replacement beyondEnd[] = {
+		Replacement(8, 14, "3"),
+	};
+	EXPECT_FALSE(pdoc->ReplaceRanges(beyondEnd, 1));
+	Sci_Replacement noText[] = {
+		Replacement(0, 3, "1"),
+		Replacement(4, 7, 0),
+	};
+	noText[1].length = 2;
+	EXPECT_FALSE(pdoc->ReplaceRanges(noText, 2));
+	EXPECT_EQ("one two three", Text());
+	// No text is fine when nothing is inserted
+	noText[1].length = 0;
+	EXPECT_TRUE(pdoc->ReplaceRanges(noText, 2));
+	EXPECT_EQ("1  three", Text());
+}
+
+TEST_F(DocumentTest, ReplaceRangesReportsLinesOfEachReplacement) {
+	Set("a\nb\nc\nd\ne\n");
+	ModificationRecorder recorder;
+	pdoc->AddWatcher(&recorder, 0);
+	// Join the first two lines and split the fourth so the number of lines stays the same
+	Sci_Replacement replacements[] = {
+		Replacement(1, 2, ""),
+		Replacement(7, 7, "x\n"),
+	};
+	EXPECT_TRUE(pdoc->ReplaceRanges(replacements, 2));
+	pdoc->RemoveWatcher(&recorder, 0);
+	EXPECT_EQ("ab\nc\ndx\n\ne\n", Text());
+	ASSERT_EQ(1u, recorder.modifications.size());
+	const DocModification &mh = recorder.modifications[0];
+	EXPECT_TRUE((mh.modificationType & SC_MOD_REPLACERANGES) != 0);
+	EXPECT_EQ(0, mh.linesAdded);
+	ASSERT_EQ(2u, recorder.replacementLines[0].size());
+	EXPECT_EQ(1, recorder.replacementLines[0][0].removed);
+	EXPECT_EQ(0, recorder.replacementLines[0][0].added);
+	EXPECT_EQ(0, recorder.replacementLines[0][1].removed);
+	EXPECT_EQ(1, recorder.replacementLines[0][1].added);
+}
+
+TEST_F(DocumentTest, ReplaceRangesLinesKeepHiddenLinesInPlace) {
+	Set("a\nb\nc\nd\ne\n");
+	ContractionState cs;
+	cs.InsertLines(0, pdoc->LinesTotal() - 1);
+	// Hide "c" and "e"
+	cs.SetVisible(2, 2, false);
+	cs.SetVisible(4, 4, false);
+	ModificationRecorder recorder;
+	pdoc->AddWatcher(&recorder, 0);
+	Sci_Replacement replacements[] = {
+		Replacement(1, 2, ""),
+		Replacement(7, 7, "x\n"),
+	};
+	EXPECT_TRUE(pdoc->ReplaceRanges(replacements, 2));
+	pdoc->RemoveWatcher(&recorder, 0);
+	// Adjust the lines as a view does, one replacement at a time
+	const DocModification &mh = recorder.modifications[0];
+	int delta = 0;
+	for (int i = 0; i < mh.countReplacements; i++) {
+		const ReplacementLines &lines = recorder.replacementLines[0][i];
+		const int line = pdoc->LineFromPosition(static_cast<int>(replacements[i].chrg.cpMin) + delta);
+		cs.DeleteLines(line, lines.removed);
+		cs.InsertLines(line, lines.added);
+		delta += static_cast<int>(replacements[i].length -
+			(replacements[i].chrg.cpMax - replacements[i].chrg.cpMin));
+	}
+	// "ab", "c", "dx", "", "e", ""
+	EXPECT_EQ(pdoc->LinesTotal(), cs.LinesInDoc());
+	EXPECT_TRUE(cs.GetVisible(0));
+	EXPECT_FALSE(cs.GetVisible(1));
+	EXPECT_TRUE(cs.GetVisible(2));
+	EXPECT_TRUE(cs.GetVisible(3));
+	EXPECT_FALSE(cs.GetVisible(4));
+	EXPECT_TRUE(cs.GetVisible(5));
+}
+
+TEST_F(DocumentTest, TrimLogKeepsLastLines) {
+	pdoc->SetLogLineLimit(3);
+	Set("a\nb\nc\nd\ne\n");
+	EXPECT_EQ("d\ne\n", Text());
+	EXPECT_EQ(3, pdoc->LinesTotal());
+	EXPECT_EQ(3, pdoc->LogLinesTrimmed());
+	pdoc->InsertString(pdoc->Length(), "f\n", 2);
+	EXPECT_EQ("e\nf\n", Text());
+	EXPECT_EQ(4, pdoc->LogLinesTrimmed());
+	// Raising the limit keeps the text and the count of trimmed lines
+	pdoc->SetLogLineLimit(10);
+	pdoc->InsertString(pdoc->Length(), "g\n", 2);
+	EXPECT_EQ("e\nf\ng\n", Text());
+	EXPECT_EQ(4, pdoc->LogLinesTrimmed());
+}
+
+TEST_F(DocumentTest, TrimLogKeepsStyles) {
+	Set("a\nb\nc\n");
+	pdoc->StartStyling(0, '\377');
+	pdoc->SetStyleFor(pdoc->Length(), 1);
+	EXPECT_EQ(6, pdoc->GetEndStyled());
+	pdoc->SetLogLineLimit(3);
+	EXPECT_EQ("b\nc\n", Text());
+	// The lines that remain are still styled
+	EXPECT_EQ(4, pdoc->GetEndStyled());
+	EXPECT_EQ(1, pdoc->StyleAt(0));
+	pdoc->InsertString(pdoc->Length(), "d\n", 2);
+	EXPECT_EQ("c\nd\n", Text());
+	EXPECT_EQ(2, pdoc->GetEndStyled());
+}
+
+TEST_F(DocumentTest, TrimLogAfterReplaceRanges) {
+	pdoc->SetLogLineLimit(3);
+	Set("a\nb\n");
+	// Replacements that add lines trim the log as inserts do
+	const Sci_Replacement replacements[] = {
+		Replacement(0, 1, "x\ny"),
+		Replacement(2, 3, "z\nw"),
+	};
+	EXPECT_TRUE(pdoc->ReplaceRanges(replacements, 2));
+	EXPECT_EQ("z\nw\n", Text());
+	EXPECT_EQ(3, pdoc->LinesTotal());
+	EXPECT_EQ(2, pdoc->LogLinesTrimmed());
+}
+
+TEST_F(DocumentTest, TrimLogIsNotUndone) {
+	Set("a\nb\n");
+	EXPECT_TRUE(pdoc->CanUndo());
+	pdoc->SetLogLineLimit(2);
+	EXPECT_EQ("b\n", Text());
+	// The undo history referred to the trimmed text so is gone
+	EXPECT_FALSE(pdoc->CanUndo());
+	EXPECT_TRUE(pdoc->IsCollectingUndo());
+	pdoc->InsertString(pdoc->Length(), "c\n", 2);
+	EXPECT_EQ("c\n", Text());
+	EXPECT_FALSE(pdoc->CanUndo());
+}
+
+TEST(DocumentLog, TrimKeepsLineStatesAndLevelsWithTheirLines) {
+	Document *pdoc = new Document(SC_DOCUMENTOPTION_LOG);
+	pdoc->AddRef();
+	pdoc->SetLogLineLimit(100);
+	char line[20];
+	for (int i = 0; i < 1000; i++) {
+		sprintf(line, "%d\n", i);
+		pdoc->InsertString(pdoc->Length(), line, static_cast<int>(strlen(line)));
+		// The line just appended is the one before the empty last line
+		const int lineAppended = pdoc->LinesTotal() - 2;
+		pdoc->SetLineState(lineAppended, i);
+		pdoc->SetLevel(lineAppended, SC_FOLDLEVELBASE + i % 7);
+	}
+	EXPECT_EQ(100, pdoc->LinesTotal());
+	EXPECT_EQ(901, pdoc->LogLinesTrimmed());
+	int firstWrong = -1;
+	for (int lineCheck = 0; (lineCheck < pdoc->LinesTotal() - 1) && (firstWrong < 0); lineCheck++) {
+		const int start = pdoc->LineStart(lineCheck);
+		std::string text(pdoc->LineEnd(lineCheck) - start, '\0');
+		pdoc->GetCharRange(&text[0], start, static_cast<int>(text.length()));
+		const int number = atoi(text.c_str());
+		if ((pdoc->GetLineState(lineCheck) != number) ||
+			(pdoc->GetLevel(lineCheck) != SC_FOLDLEVELBASE + number % 7))
+			firstWrong = lineCheck;
+	}
+	EXPECT_EQ(-1, firstWrong);
+	pdoc->Release();
+}
+
+TEST(DocumentHibernate, IncompressibleTextIsShrunk) {
+	const int options[] = { SC_DOCUMENTOPTION_DEFAULT, SC_DOCUMENTOPTION_TEXT_CHUNKED };
+	for (size_t option = 0; option < sizeof(options) / sizeof(options[0]); option++) {
+		Document *pdoc = new Document(options[option]);
+		pdoc->AddRef();
+		// Bytes that do not repeat are not worth compressing
+		std::string text;
+		unsigned int seed = 11;
+		for (int i = 0; i < 200000; i++) {
+			seed = seed * 1103515245 + 12345;
+			text += static_cast<char>(seed >> 16);
+		}
+		pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+		pdoc->InsertString(1000, "gap", 3);
+		Sci_MemoryUsage usage;
+		pdoc->GetMemoryUsage(&usage);
+		EXPECT_GT(usage.textUnused, 0u);
+		pdoc->Hibernate();
+		EXPECT_TRUE(pdoc->IsHibernating());
+		pdoc->GetMemoryUsage(&usage);
+		EXPECT_EQ(0u, usage.textUnused);
+		EXPECT_GE(usage.text, text.length());
+		pdoc->Release();
+	}
+}
+
+TEST(DocumentLog, LogDocumentDoesNotCollectUndo) {
+	Document *pdoc = new Document(SC_DOCUMENTOPTION_LOG);
+	pdoc->AddRef();
+	pdoc->InsertString(0, "a\n", 2);
+	EXPECT_FALSE(pdoc->IsCollectingUndo());
+	EXPECT_FALSE(pdoc->CanUndo());
+	pdoc->Release();
+}
+
+TEST_F(DocumentTest, SnapshotUnchangedByAppendsAndTrims) {
+	Set("a\nb\nc\n");
+	ISnapshot *snapshot = pdoc->CreateSnapshot();
+	// Append to a log as the queue does while a save reads the snapshot
+	pdoc->SetLogLineLimit(3);
+	pdoc->InsertString(pdoc->Length(), "d\ne\n", 4);
+	EXPECT_EQ("d\ne\n", Text());
+	std::string text;
+	long position = 0;
+	long lengthSegment = 0;
+	while (const char *segment = snapshot->TextSegment(position, &lengthSegment)) {
+		text.append(segment, lengthSegment);
+		position += lengthSegment;
+	}
+	EXPECT_EQ("a\nb\nc\n", text);
+	snapshot->Release();
+}
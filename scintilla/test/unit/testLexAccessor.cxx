@@ -0,0 +1,254 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "PropSetSimple.h"
+#include "WordList.h"
+#include "LexerModule.h"
+#include "LexAccessor.h"
+
+#include <gtest/gtest.h>
+
+extern LexerModule lmCPP;
+
+// A document held in a string whose text segments end at the given positions, as
+// the text of a real document ends at its gap or at the ends of its chunks. Giving it
+// the original version makes lexers copy the text through GetCharRange instead.
+
+class SegmentedDocument : public IDocumentWithTextSegments {
+	int version;
+	std::string text;
+	std::vector<int> segmentEnds;
+	std::vector<int> lineStarts;
+	std::string styles;
+	std::vector<int> levels;
+	std::vector<int> lineStates;
+	int endStyled;
+	char stylingMask;
+public:
+	mutable int segmentsRequested;
+	mutable int rangesRequested;
+
+	SegmentedDocument(int version_, const std::string &text_, const std::vector<int> &segmentEnds_) :
+		version(version_), text(text_), segmentEnds(segmentEnds_), styles(text_.length(), '\0'),
+		endStyled(0), stylingMask(0), segmentsRequested(0), rangesRequested(0) {
+		segmentEnds.push_back(Length());
+		lineStarts.push_back(0);
+		for (int i = 0; i < Length(); i++) {
+			if (text[i] == '\n')
+				lineStarts.push_back(i + 1);
+		}
+		levels.assign(lineStarts.size(), SC_FOLDLEVELBASE);
+		lineStates.assign(lineStarts.size(), 0);
+	}
+	virtual ~SegmentedDocument() {
+	}
+	const std::string &Styles() const {
+		return styles;
+	}
+	const std::vector<int> &LineStates() const {
+		return lineStates;
+	}
+
+	int SCI_METHOD Version() const {
+		return version;
+	}
+	void SCI_METHOD SetErrorStatus(int) {
+	}
+	int SCI_METHOD Length() const {
+		return static_cast<int>(text.length());
+	}
+	void SCI_METHOD GetCharRange(char *buffer, int position, int lengthRetrieve) const {
+		rangesRequested++;
+		memcpy(buffer, text.c_str() + position, lengthRetrieve);
+	}
+	char SCI_METHOD StyleAt(int position) const {
+		return styles[position];
+	}
+	int SCI_METHOD LineFromPosition(int position) const {
+		return static_cast<int>(std::upper_bound(lineStarts.begin(), lineStarts.end(), position) -
+			lineStarts.begin()) - 1;
+	}
+	int SCI_METHOD LineStart(int line) const {
+		if (line < 0)
+			return 0;
+		if (line >= static_cast<int>(lineStarts.size()))
+			return Length();
+		return lineStarts[line];
+	}
+	int SCI_METHOD GetLevel(int line) const {
+		return levels[line];
+	}
+	int SCI_METHOD SetLevel(int line, int level) {
+		const int levelPrevious = levels[line];
+		levels[line] = level;
+		return levelPrevious;
+	}
+	int SCI_METHOD GetLineState(int line) const {
+		return (line < static_cast<int>(lineStates.size())) ? lineStates[line] : 0;
+	}
+	int SCI_METHOD SetLineState(int line, int state) {
+		const int statePrevious = lineStates[line];
+		lineStates[line] = state;
+		return statePrevious;
+	}
+	void SCI_METHOD StartStyling(int position, char mask) {
+		endStyled = position;
+		stylingMask = mask;
+	}
+	bool SCI_METHOD SetStyleFor(int length, char style) {
+		for (int i = 0; i < length; i++)
+			styles[endStyled++] = style & stylingMask;
+		return true;
+	}
+	bool SCI_METHOD SetStyles(int length, const char *stylesSet) {
+		for (int i = 0; i < length; i++)
+			styles[endStyled++] = stylesSet[i] & stylingMask;
+		return true;
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator(int) {
+	}
+	void SCI_METHOD DecorationFillRange(int, int, int) {
+	}
+	void SCI_METHOD ChangeLexerState(int, int) {
+	}
+	int SCI_METHOD CodePage() const {
+		return SC_CP_UTF8;
+	}
+	bool SCI_METHOD IsDBCSLeadByte(char) const {
+		return false;
+	}
+	const char * SCI_METHOD BufferPointer() {
+		return text.c_str();
+	}
+	int SCI_METHOD GetLineIndentation(int) {
+		return 0;
+	}
+	void SCI_METHOD SetRestartPoint(int) {
+	}
+	const char * SCI_METHOD TextSegment(int position, int *lengthSegment) const {
+		segmentsRequested++;
+		if ((position < 0) || (position >= Length())) {
+			*lengthSegment = 0;
+			return 0;
+		}
+		const int end = *std::upper_bound(segmentEnds.begin(), segmentEnds.end(), position);
+		*lengthSegment = end - position;
+		return text.c_str() + position;
+	}
+};
+
+static std::string SourceText() {
+	std::string text;
+	char line[200];
+	for (int i = 0; i < 1500; i++) {
+		sprintf(line, "/* %d */ int f%d(int a) { return a * %d; } // \"%d\"\n", i, i, i % 97, i);
+		text += line;
+		if (i % 20 == 0)
+			text += "const char *s = \"a string that is \\\n continued on the next line\";\n";
+	}
+	return text;
+}
+
+// Where the segments of a document end: none, a gap in the middle, gaps closer
+// together than the accessor's buffer and ends of chunks of several sizes.
+static std::vector<std::vector<int> > SegmentLayouts(int length) {
+	std::vector<std::vector<int> > layouts;
+	layouts.push_back(std::vector<int>());
+	layouts.push_back(std::vector<int>(1, length / 2));
+	std::vector<int> close;
+	close.push_back(3000);
+	close.push_back(3001);
+	close.push_back(5000);
+	close.push_back(length / 2);
+	close.push_back(length / 2 + 100);
+	close.push_back(length - 10);
+	layouts.push_back(close);
+	for (int chunk = 1000; chunk <= 0x4000; chunk *= 4) {
+		std::vector<int> chunks;
+		for (int end = chunk; end < length; end += chunk)
+			chunks.push_back(end);
+		layouts.push_back(chunks);
+	}
+	return layouts;
+}
+
+TEST(LexAccessor, ReadsTextInSegments) {
+	const std::string text = SourceText();
+	const int length = static_cast<int>(text.length());
+	const std::vector<std::vector<int> > layouts = SegmentLayouts(length);
+	for (size_t layout = 0; layout < layouts.size(); layout++) {
+		SCOPED_TRACE(layout);
+		SegmentedDocument doc(dvTextSegments, text, layouts[layout]);
+		LexAccessor styler(&doc);
+		int firstWrong = -1;
+		// Forwards, backwards and jumping about
+		for (int i = 0; (i < length) && (firstWrong < 0); i++) {
+			if (styler[i] != text[i])
+				firstWrong = i;
+		}
+		for (int i = length - 1; (i >= 0) && (firstWrong < 0); i--) {
+			if (styler.SafeGetCharAt(i) != text[i])
+				firstWrong = i;
+		}
+		for (int i = 0; (i < 20000) && (firstWrong < 0); i++) {
+			const int position = static_cast<int>((i * 7919L) % length);
+			if (styler[position] != text[position])
+				firstWrong = position;
+		}
+		EXPECT_EQ(-1, firstWrong);
+		EXPECT_EQ('!', styler.SafeGetCharAt(-1, '!'));
+		EXPECT_EQ('!', styler.SafeGetCharAt(length, '!'));
+		EXPECT_TRUE(styler.Match(length / 2 - 2, text.substr(length / 2 - 2, 5).c_str()));
+		EXPECT_GT(doc.segmentsRequested, 0);
+	}
+}
+
+TEST(LexAccessor, ReadsInPlaceWithoutCopying) {
+	const std::string text = SourceText();
+	SegmentedDocument doc(dvTextSegments, text, std::vector<int>(1, static_cast<int>(text.length()) / 2));
+	LexAccessor styler(&doc);
+	for (int i = 0; i < doc.Length(); i++)
+		styler[i];
+	// Only the text near the gap is copied
+	EXPECT_LE(doc.rangesRequested, 2);
+	SegmentedDocument original(dvOriginal, text, std::vector<int>());
+	LexAccessor stylerOriginal(&original);
+	for (int i = 0; i < original.Length(); i++)
+		stylerOriginal[i];
+	EXPECT_EQ(0, original.segmentsRequested);
+	EXPECT_GT(original.rangesRequested, original.Length() / 4000);
+}
+
+TEST(LexAccessor, LexesAsWhenCopying) {
+	const std::string text = SourceText();
+	SegmentedDocument expected(dvOriginal, text, std::vector<int>());
+	ILexer *lexer = lmCPP.Create();
+	lexer->WordListSet(0, "char const int return");
+	lexer->Lex(0, expected.Length(), 0, &expected);
+	const std::vector<std::vector<int> > layouts = SegmentLayouts(expected.Length());
+	for (size_t layout = 0; layout < layouts.size(); layout++) {
+		SCOPED_TRACE(layout);
+		SegmentedDocument doc(dvTextSegments, text, layouts[layout]);
+		lexer->Lex(0, doc.Length(), 0, &doc);
+		EXPECT_TRUE(expected.Styles() == doc.Styles());
+		EXPECT_TRUE(expected.LineStates() == doc.LineStates());
+		// Starting again in the middle of a segment and at the end of one
+		const int line = doc.LineFromPosition(doc.Length() / 2);
+		lexer->Lex(doc.LineStart(line), doc.Length() - doc.LineStart(line),
+			doc.StyleAt(doc.LineStart(line) - 1), &doc);
+		EXPECT_TRUE(expected.Styles() == doc.Styles());
+	}
+	lexer->Release();
+}
@@ -0,0 +1,280 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "PropSetSimple.h"
+#include "WordList.h"
+#include "LexerModule.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "Arena.h"
+#include "PerLine.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "Document.h"
+
+#include <gtest/gtest.h>
+
+extern LexerModule lmCPP;
+
+// Added by the C++ lexer to the styles of text in inactive preprocessor blocks
+static const int inactiveFlag = 0x40;
+
+// Lexes a document with the C++ lexer, folding as well.
+
+class CPPLexInterface : public LexInterface {
+public:
+	explicit CPPLexInterface(Document *pdoc_) : LexInterface(pdoc_) {
+		instance = lmCPP.Create();
+		instance->PropertySet("fold", "1");
+		instance->PropertySet("fold.preprocessor", "1");
+		instance->WordListSet(0, "char class const else for if int return struct void while");
+	}
+	virtual ~CPPLexInterface() {
+		StopBackground();
+		instance->Release();
+	}
+};
+
+static Document *NewLexedDocument(const std::string &text, int options=SC_DOCUMENTOPTION_DEFAULT) {
+	Document *pdoc = new Document(options);
+	pdoc->AddRef();
+	pdoc->SetStylingBits(8);
+	pdoc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	pdoc->pli = new CPPLexInterface(pdoc);
+	return pdoc;
+}
+
+// C++ with comments, strings and preprocessor blocks spanning lines, so that the lexer
+// carries state from line to line and folds nest.
+static std::string CPPText(int functions) {
+	std::string text;
+	char line[200];
+	for (int i = 0; i < functions; i++) {
+		sprintf(line, "/* Function %d\n   counts to %d */\n", i, i * 7);
+		text += line;
+		if (i % 5 == 0)
+			text += "#if 0\nint unused;\n#endif\n";
+		sprintf(line, "int f%d(int a) {\n\tconst char *s = \"text %d\";\n", i, i);
+		text += line;
+		sprintf(line, "\tfor (int j = 0; j < %d; j++) {\n\t\ta += j; // add\n\t}\n", i);
+		text += line;
+		text += "\treturn a;\n}\n\n";
+	}
+	return text;
+}
+
+// Expects the styles, fold levels and line states of two documents to be the same.
+static void ExpectSameLexing(Document *expected, Document *actual) {
+	ASSERT_EQ(expected->Length(), actual->Length());
+	int firstStyle = -1;
+	for (int i = 0; (i < expected->Length()) && (firstStyle < 0); i++) {
+		if (expected->StyleAt(i) != actual->StyleAt(i))
+			firstStyle = i;
+	}
+	EXPECT_EQ(-1, firstStyle);
+	int firstLine = -1;
+	for (int line = 0; (line < expected->LinesTotal()) && (firstLine < 0); line++) {
+		if ((expected->GetLevel(line) != actual->GetLevel(line)) ||
+			(expected->GetLineState(line) != actual->GetLineState(line)))
+			firstLine = line;
+	}
+	EXPECT_EQ(-1, firstLine);
+}
+
+// Calls StyleInBackground as an idle handler would until the document is styled, or
+// returns false if that takes too long.
+static bool StyleInBackgroundToEnd(Document *pdoc) {
+	for (int tick = 0; tick < 10000; tick++) {
+		const bool running = pdoc->StyleInBackground();
+		if (!running && (pdoc->GetEndStyled() >= pdoc->Length()))
+			return true;
+#ifndef _WIN32
+		usleep(1000);
+#endif
+	}
+	return false;
+}
+
+TEST(LexInterface, StyleInBackground) {
+	// Several chunks for the worker
+	const std::string text = CPPText(2000);
+	Document *expected = NewLexedDocument(text);
+	expected->EnsureStyledTo(expected->Length());
+	Document *pdoc = NewLexedDocument(text, SC_DOCUMENTOPTION_TEXT_CHUNKED);
+	pdoc->pli->SetBackground(true);
+	EXPECT_TRUE(pdoc->pli->Background());
+	// Style what would be shown then leave the rest to the worker
+	pdoc->EnsureStyledTo(1000);
+	EXPECT_LT(pdoc->GetEndStyled(), pdoc->Length());
+	EXPECT_TRUE(pdoc->StyleInBackground());
+	EXPECT_TRUE(StyleInBackgroundToEnd(pdoc));
+	ExpectSameLexing(expected, pdoc);
+	pdoc->Release();
+	expected->Release();
+}
+
+TEST(LexInterface, StyleInBackgroundWithEdit) {
+	std::string text = CPPText(2000);
+	Document *pdoc = NewLexedDocument(text, SC_DOCUMENTOPTION_TEXT_CHUNKED);
+	pdoc->pli->SetBackground(true);
+	EXPECT_TRUE(pdoc->pli->Background());
+	pdoc->EnsureStyledTo(1000);
+	EXPECT_TRUE(pdoc->StyleInBackground());
+	// An edit while the worker runs opens a comment that runs to the next one so the
+	// results for the text after it are discarded
+	const int position = static_cast<int>(text.length() / 3);
+	text.insert(position, "/*");
+	pdoc->InsertString(position, "/*", 2);
+	EXPECT_TRUE(StyleInBackgroundToEnd(pdoc));
+	Document *expected = NewLexedDocument(text);
+	expected->EnsureStyledTo(expected->Length());
+	ExpectSameLexing(expected, pdoc);
+	pdoc->Release();
+	expected->Release();
+}
+
+TEST(LexInterface, StyleInBackgroundOnlyWhenChunked) {
+	// A worker's snapshot would have the next edit copy all of a gap buffer
+	Document *pdoc = NewLexedDocument(CPPText(2000));
+	pdoc->pli->SetBackground(true);
+	EXPECT_FALSE(pdoc->pli->Background());
+	pdoc->EnsureStyledTo(1000);
+	EXPECT_FALSE(pdoc->StyleInBackground());
+	EXPECT_LT(pdoc->GetEndStyled(), pdoc->Length());
+	pdoc->Release();
+}
+
+// Styles as a view would when showing a few lines after position.
+static void StyleShown(Document *pdoc, int position) {
+	pdoc->EnsureStyledTo(std::min(pdoc->LineStart(pdoc->LineFromPosition(position) + 20),
+		pdoc->Length()));
+}
+
+TEST(LexInterface, RestylingStopsWhenConverged) {
+	std::string text = CPPText(500);
+	Document *pdoc = NewLexedDocument(text);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	// Typing within a function leaves the state at the end of its lines as it was so
+	// the styles after it are kept
+	const int position = static_cast<int>(text.find("a += j;", text.length() / 2));
+	text.insert(position, "b = 0; ");
+	pdoc->InsertString(position, "b = 0; ", 7);
+	StyleShown(pdoc, position);
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	Document *expected = NewLexedDocument(text);
+	expected->EnsureStyledTo(expected->Length());
+	ExpectSameLexing(expected, pdoc);
+	expected->Release();
+	pdoc->Release();
+}
+
+TEST(LexInterface, RestylingContinuesWhenStateDiffers) {
+	std::string text = CPPText(500);
+	Document *pdoc = NewLexedDocument(text);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	// Opening a comment changes the state at the end of every line up to the next
+	// comment end
+	const int position = static_cast<int>(text.find("return", text.length() / 2));
+	text.insert(position, "/*");
+	pdoc->InsertString(position, "/*", 2);
+	StyleShown(pdoc, position);
+	EXPECT_LT(pdoc->GetEndStyled(), pdoc->Length());
+	pdoc->EnsureStyledTo(pdoc->Length());
+	Document *expected = NewLexedDocument(text);
+	expected->EnsureStyledTo(expected->Length());
+	ExpectSameLexing(expected, pdoc);
+	expected->Release();
+	pdoc->Release();
+}
+
+TEST(LexInterface, RestylingContinuesAfterLexerStateChanges) {
+	// Changing a definition changes the activity of a preprocessor block far below it,
+	// which the lexer reports through ChangeLexerState, even though the line states
+	// converge straight after the change
+	std::string text = "#define X 1\n";
+	for (int i = 0; i < 300; i++)
+		text += "int a;\n";
+	text += "#if X\nint b;\n#endif\n";
+	Document *pdoc = NewLexedDocument(text);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	const int positionB = static_cast<int>(text.find("b;"));
+	EXPECT_EQ(SCE_C_IDENTIFIER, pdoc->StyleAt(positionB));
+	pdoc->DeleteChars(10, 1);
+	pdoc->InsertString(10, "0", 1);
+	text[10] = '0';
+	StyleShown(pdoc, 10);
+	EXPECT_LT(pdoc->GetEndStyled(), pdoc->Length());
+	pdoc->EnsureStyledTo(pdoc->Length());
+	EXPECT_EQ(SCE_C_IDENTIFIER | inactiveFlag, pdoc->StyleAt(positionB));
+	Document *expected = NewLexedDocument(text);
+	expected->EnsureStyledTo(expected->Length());
+	ExpectSameLexing(expected, pdoc);
+	expected->Release();
+	pdoc->Release();
+}
+
+TEST(LexInterface, StyleWhileIdle) {
+	const std::string text = CPPText(2000);
+	Document *expected = NewLexedDocument(text);
+	expected->EnsureStyledTo(expected->Length());
+	Document *pdoc = NewLexedDocument(text);
+	pdoc->EnsureStyledTo(1000);
+	// With no time at all each slice styles one step
+	EXPECT_TRUE(pdoc->StyleWhileIdle(0.0, 0x1000));
+	EXPECT_GE(pdoc->GetEndStyled(), 1000 + 0x1000);
+	EXPECT_LT(pdoc->GetEndStyled(), 1000 + 0x2000);
+	int slices = 1;
+	while (pdoc->StyleWhileIdle(0.0, 0x1000))
+		slices++;
+	EXPECT_EQ(pdoc->Length(), pdoc->GetEndStyled());
+	EXPECT_GE(slices, static_cast<int>(text.length() / 0x2000));
+	ExpectSameLexing(expected, pdoc);
+	// Once styled there is nothing more to do
+	EXPECT_FALSE(pdoc->StyleWhileIdle(0.005, 0x1000));
+	pdoc->Release();
+	expected->Release();
+}
+
+TEST(LexInterface, StyleWhileIdleAfterEdit) {
+	std::string text = CPPText(2000);
+	Document *pdoc = NewLexedDocument(text);
+	pdoc->EnsureStyledTo(pdoc->Length());
+	const int position = static_cast<int>(text.length() / 3);
+	text.insert(position, "/*");
+	pdoc->InsertString(position, "/*", 2);
+	while (pdoc->StyleWhileIdle(0.005, 0x2000)) {
+	}
+	Document *expected = NewLexedDocument(text);
+	expected->EnsureStyledTo(expected->Length());
+	ExpectSameLexing(expected, pdoc);
+	pdoc->Release();
+	expected->Release();
+}
+
+TEST(LexInterface, StyleWhileIdleStopsForContainer) {
+	// Without a lexer the container is asked to style and this one never does
+	Document *pdoc = new Document();
+	pdoc->AddRef();
+	pdoc->InsertString(0, "int a;\n", 7);
+	EXPECT_FALSE(pdoc->StyleWhileIdle(0.005, 0x2000));
+	EXPECT_EQ(0, pdoc->GetEndStyled());
+	pdoc->Release();
+}
@@ -0,0 +1,200 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+
+#include "Platform.h"
+
+#include "Sci_Position.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "PartitionTree.h"
+
+#include <gtest/gtest.h>
+
+// Test PartitionTree.
+
+class PartitionTreeTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		ppt = new PartitionTree();
+	}
+
+	virtual void TearDown() {
+		delete ppt;
+		ppt = 0;
+	}
+
+	PartitionTree *ppt;
+
+	// Checks every partition start and a position in each partition against a Partitioning.
+	void ExpectSame(const Partitioning &p) {
+		ASSERT_EQ(p.Partitions(), ppt->Partitions());
+		for (int partition=0; partition<=p.Partitions(); partition++) {
+			ASSERT_EQ(p.PositionFromPartition(partition), ppt->PositionFromPartition(partition));
+		}
+		const Sci_Position length = p.PositionFromPartition(p.Partitions());
+		for (Sci_Position pos=-1; pos<=length+1; pos++) {
+			ASSERT_EQ(p.PartitionFromPosition(pos), ppt->PartitionFromPosition(pos));
+		}
+	}
+};
+
+TEST_F(PartitionTreeTest, IsEmptyInitially) {
+	EXPECT_EQ(1, ppt->Partitions());
+	EXPECT_EQ(0, ppt->PositionFromPartition(ppt->Partitions()));
+	EXPECT_EQ(0, ppt->PartitionFromPosition(0));
+}
+
+TEST_F(PartitionTreeTest, SimpleInsert) {
+	ppt->InsertText(0, 1);
+	EXPECT_EQ(1, ppt->Partitions());
+	EXPECT_EQ(1, ppt->PositionFromPartition(ppt->Partitions()));
+}
+
+TEST_F(PartitionTreeTest, TwoPartitions) {
+	ppt->InsertText(0, 2);
+	ppt->InsertPartition(1, 1);
+	EXPECT_EQ(2, ppt->Partitions());
+	EXPECT_EQ(0, ppt->PositionFromPartition(0));
+	EXPECT_EQ(1, ppt->PositionFromPartition(1));
+	EXPECT_EQ(2, ppt->PositionFromPartition(2));
+	EXPECT_EQ(0, ppt->PartitionFromPosition(0));
+	EXPECT_EQ(1, ppt->PartitionFromPosition(1));
+	EXPECT_EQ(1, ppt->PartitionFromPosition(2));
+}
+
+TEST_F(PartitionTreeTest, MoveStart) {
+	ppt->InsertText(0, 3);
+	ppt->InsertPartition(1, 2);
+	ppt->SetPartitionStartPosition(1, 1);
+	EXPECT_EQ(2, ppt->Partitions());
+	EXPECT_EQ(1, ppt->PositionFromPartition(1));
+	EXPECT_EQ(3, ppt->PositionFromPartition(2));
+	ppt->SetPartitionStartPosition(2, 5);
+	EXPECT_EQ(1, ppt->PositionFromPartition(1));
+	EXPECT_EQ(5, ppt->PositionFromPartition(2));
+}
+
+TEST_F(PartitionTreeTest, InsertAgain) {
+	ppt->InsertText(0, 3);
+	ppt->InsertPartition(1, 2);
+	ppt->InsertText(0, 3);
+	ppt->InsertText(1, 2);
+	EXPECT_EQ(2, ppt->Partitions());
+	EXPECT_EQ(0, ppt->PositionFromPartition(0));
+	EXPECT_EQ(5, ppt->PositionFromPartition(1));
+	EXPECT_EQ(8, ppt->PositionFromPartition(2));
+}
+
+TEST_F(PartitionTreeTest, RemovePartition) {
+	ppt->InsertText(0, 2);
+	ppt->InsertPartition(1, 1);
+	ppt->RemovePartition(1);
+	EXPECT_EQ(1, ppt->Partitions());
+	EXPECT_EQ(2, ppt->PositionFromPartition(1));
+}
+
+TEST_F(PartitionTreeTest, ManyPartitions) {
+	// Enough partitions to need several levels of the tree
+	const int lines = 100000;
+	for (int line=1; line<=lines; line++) {
+		ppt->InsertText(line - 1, 3);
+		ppt->InsertPartition(line, line * 3);
+	}
+	EXPECT_EQ(lines + 1, ppt->Partitions());
+	for (int line=0; line<=lines; line++) {
+		ASSERT_EQ(line * 3, ppt->PositionFromPartition(line));
+		ASSERT_EQ(line, ppt->PartitionFromPosition(line * 3 + 1));
+	}
+	// Remove every other partition then all the rest
+	for (int line=lines-1; line>0; line-=2) {
+		ppt->RemovePartition(line);
+	}
+	EXPECT_EQ(lines / 2 + 1, ppt->Partitions());
+	EXPECT_EQ(12, ppt->PositionFromPartition(2));
+	while (ppt->Partitions() > 1) {
+		ppt->RemovePartition(1);
+	}
+	EXPECT_EQ(lines * 3, ppt->PositionFromPartition(1));
+	ppt->DeleteAll();
+	EXPECT_EQ(1, ppt->Partitions());
+	EXPECT_EQ(0, ppt->PositionFromPartition(1));
+}
+
+TEST_F(PartitionTreeTest, MatchesPartitioning) {
+	// Scattered edits, including empty partitions, compared with a Partitioning
+	Partitioning p(8);
+	unsigned int seed = 1;
+	for (int step=0; step<50000; step++) {
+		seed = seed * 1103515245 + 12345;
+		const int partitions = p.Partitions();
+		const int partition = static_cast<int>((seed >> 8) % partitions);
+		const Sci_Position start = p.PositionFromPartition(partition);
+		const Sci_Position end = p.PositionFromPartition(partition + 1);
+		switch ((seed >> 4) % 8) {
+		case 0:
+		case 1:
+		case 2: {
+				const Sci_Position delta = (seed >> 20) % 5;
+				p.InsertText(partition, delta);
+				ppt->InsertText(partition, delta);
+			}
+			break;
+		case 3:
+		case 4: {
+				const Sci_Position pos = start + (seed >> 16) % (end - start + 1);
+				p.InsertPartition(partition + 1, pos);
+				ppt->InsertPartition(partition + 1, pos);
+			}
+			break;
+		case 5:
+			if (end > start) {
+				p.InsertText(partition, -1);
+				ppt->InsertText(partition, -1);
+			}
+			break;
+		case 6:
+			if ((partition > 0) && (partitions > 1)) {
+				p.RemovePartition(partition);
+				ppt->RemovePartition(partition);
+			}
+			break;
+		case 7:
+			// Partitioning only moves starts correctly when its step is before them
+			// so, as LineVector does, just move the start of the last partition
+			if (partitions > 1) {
+				const Sci_Position before = p.PositionFromPartition(partitions - 2);
+				const Sci_Position after = p.PositionFromPartition(partitions);
+				const Sci_Position pos = before + (seed >> 16) % (after - before + 1);
+				p.SetPartitionStartPosition(partitions - 1, pos);
+				ppt->SetPartitionStartPosition(partitions - 1, pos);
+			}
+			break;
+		}
+		ASSERT_EQ(p.Partitions(), ppt->Partitions());
+		ASSERT_EQ(p.PositionFromPartition(partition), ppt->PositionFromPartition(partition));
+		if ((step % 5000) == 0) {
+			ExpectSame(p);
+		}
+	}
+	ExpectSame(p);
+}
+
+TEST_F(PartitionTreeTest, InsertPartitions) {
+	Partitioning p(8);
+	const int count = 1000;
+	Sci_Position positions[count];
+	for (int i=0; i<count; i++) {
+		positions[i] = (i + 1) * 2;
+	}
+	p.InsertText(0, count * 2 + 2);
+	ppt->InsertText(0, count * 2 + 2);
+	p.InsertPartitions(1, positions, count);
+	ppt->InsertPartitions(1, positions, count);
+	ExpectSame(p);
+	const Sci_Position positionsMiddle[2] = {999, 999};
+	p.InsertPartitions(500, positionsMiddle, 2);
+	ppt->InsertPartitions(500, positionsMiddle, 2);
+	ExpectSame(p);
+}
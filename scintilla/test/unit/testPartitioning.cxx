@@ -4,6 +4,8 @@
 
 #include "Platform.h"
 
+#include "Sci_Position.h"
+
 #include "SplitVector.h"
 #include "Partitioning.h"
 
@@ -12,7 +14,7 @@
 const int growSize = 4;
 
 const int lengthTestArray = 8;
-static const int testArray[lengthTestArray] = {3, 4, 5, 6, 7, 8, 9, 10};
+static const Sci_Position testArray[lengthTestArray] = {3, 4, 5, 6, 7, 8, 9, 10};
 
 // Test SplitVectorWithRangeAdd.
 
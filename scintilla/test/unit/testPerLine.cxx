@@ -0,0 +1,325 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "Platform.h"
+
+#include "Sci_Position.h"
+#include "Scintilla.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "Arena.h"
+#include "PerLine.h"
+
+#include <gtest/gtest.h>
+
+// Test LineMarkers.
+
+class LineMarkersTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		plm = new LineMarkers();
+	}
+
+	virtual void TearDown() {
+		delete plm;
+		plm = 0;
+	}
+
+	LineMarkers *plm;
+
+	// Checks the mark of every line and the searches from every line against a simple model.
+	void ExpectSame(const std::vector<int> &marks) {
+		const int lines = static_cast<int>(marks.size());
+		for (int line=0; line<lines; line++) {
+			ASSERT_EQ(marks[line], plm->MarkValue(line));
+		}
+		const int masks[] = {1, 2, 0x5, static_cast<int>(0x80000001), -1};
+		for (size_t m=0; m<sizeof(masks)/sizeof(masks[0]); m++) {
+			const int mask = masks[m];
+			int next = -1;
+			for (int line=lines-1; line>=-1; line--) {
+				if ((line >= 0) && (marks[line] & mask))
+					next = line;
+				ASSERT_EQ(next, plm->MarkerNext(line, mask));
+			}
+			int previous = -1;
+			for (int line=0; line<=lines; line++) {
+				if ((line < lines) && (marks[line] & mask))
+					previous = line;
+				ASSERT_EQ(previous, plm->MarkerPrevious(line, mask));
+			}
+		}
+	}
+};
+
+TEST_F(LineMarkersTest, IsEmptyInitially) {
+	EXPECT_EQ(0, plm->MarkValue(0));
+	EXPECT_EQ(-1, plm->MarkerNext(0, -1));
+	EXPECT_EQ(-1, plm->MarkerPrevious(10, -1));
+	EXPECT_EQ(-1, plm->LineFromHandle(1));
+}
+
+TEST_F(LineMarkersTest, AddAndDelete) {
+	const int handle = plm->AddMark(5, 2, 10);
+	EXPECT_GT(handle, 0);
+	EXPECT_EQ(4, plm->MarkValue(5));
+	EXPECT_EQ(5, plm->LineFromHandle(handle));
+	EXPECT_EQ(5, plm->MarkerNext(0, 4));
+	EXPECT_EQ(-1, plm->MarkerNext(6, 4));
+	EXPECT_EQ(5, plm->MarkerPrevious(9, 4));
+	EXPECT_EQ(-1, plm->MarkerPrevious(4, 4));
+	EXPECT_EQ(-1, plm->MarkerNext(0, 1));
+	EXPECT_EQ(-1, plm->AddMark(10, 2, 10));
+	EXPECT_TRUE(plm->DeleteMark(5, 2, false));
+	EXPECT_EQ(0, plm->MarkValue(5));
+	EXPECT_EQ(-1, plm->MarkerNext(0, 4));
+	EXPECT_EQ(-1, plm->LineFromHandle(handle));
+	EXPECT_FALSE(plm->DeleteMark(5, 2, false));
+}
+
+TEST_F(LineMarkersTest, DeleteFromHandle) {
+	const int first = plm->AddMark(3, 1, 10);
+	const int second = plm->AddMark(3, 1, 10);
+	plm->AddMark(3, 4, 10);
+	plm->DeleteMarkFromHandle(first);
+	EXPECT_EQ(0x12, plm->MarkValue(3));
+	EXPECT_EQ(3, plm->MarkerNext(0, 2));
+	plm->DeleteMarkFromHandle(second);
+	EXPECT_EQ(0x10, plm->MarkValue(3));
+	EXPECT_EQ(-1, plm->MarkerNext(0, 2));
+	EXPECT_EQ(3, plm->MarkerNext(0, 0x10));
+}
+
+TEST_F(LineMarkersTest, InsertAndRemoveLines) {
+	plm->AddMark(2, 0, 5);
+	plm->AddMark(3, 1, 5);
+	plm->InsertLines(3, 2);
+	EXPECT_EQ(1, plm->MarkValue(2));
+	EXPECT_EQ(0, plm->MarkValue(3));
+	EXPECT_EQ(0, plm->MarkValue(4));
+	EXPECT_EQ(2, plm->MarkValue(5));
+	EXPECT_EQ(5, plm->MarkerNext(3, 3));
+	// Removing a line moves its markers to the previous line
+	plm->RemoveLine(5);
+	EXPECT_EQ(2, plm->MarkValue(4));
+	plm->RemoveLine(3);
+	plm->RemoveLine(3);
+	EXPECT_EQ(3, plm->MarkValue(2));
+	EXPECT_EQ(2, plm->MarkerNext(0, 2));
+	EXPECT_EQ(2, plm->MarkerPrevious(4, 1));
+}
+
+TEST_F(LineMarkersTest, SetMarkSet) {
+	const int handle = plm->AddMark(4, 1, 8);
+	plm->AddMark(4, 0, 8);
+	EXPECT_TRUE(plm->SetMarkSet(4, 0x6, 8));
+	EXPECT_EQ(0x6, plm->MarkValue(4));
+	// The handle of a marker that is kept stays valid
+	EXPECT_EQ(4, plm->LineFromHandle(handle));
+	EXPECT_FALSE(plm->SetMarkSet(4, 0x6, 8));
+	EXPECT_TRUE(plm->SetMarkSet(6, 0x1, 8));
+	EXPECT_EQ(6, plm->MarkerNext(5, 1));
+	EXPECT_TRUE(plm->SetMarkSet(4, 0, 8));
+	EXPECT_EQ(-1, plm->MarkerNext(0, 0x6));
+}
+
+TEST_F(LineMarkersTest, DeleteAllMarks) {
+	for (int line=0; line<100; line+=3) {
+		plm->AddMark(line, 1, 100);
+		plm->AddMark(line, 2, 100);
+	}
+	EXPECT_TRUE(plm->DeleteAllMarks(1));
+	EXPECT_FALSE(plm->DeleteAllMarks(1));
+	EXPECT_EQ(-1, plm->MarkerNext(0, 2));
+	EXPECT_EQ(99, plm->MarkerPrevious(99, 4));
+	EXPECT_TRUE(plm->DeleteAllMarks(-1));
+	EXPECT_EQ(-1, plm->MarkerNext(0, -1));
+	EXPECT_FALSE(plm->DeleteAllMarks(-1));
+}
+
+TEST_F(LineMarkersTest, MatchesModel) {
+	// Scattered marker changes and line changes compared with a mark per line
+	std::vector<int> marks(200, 0);
+	std::vector<int> handles;
+	unsigned int seed = 1;
+	for (int step=0; step<20000; step++) {
+		seed = seed * 1103515245 + 12345;
+		const int lines = static_cast<int>(marks.size());
+		const int line = static_cast<int>((seed >> 8) % lines);
+		const int markerNum = static_cast<int>((seed >> 20) % 4) * 10 + 1;
+		switch ((seed >> 4) % 8) {
+		case 0:
+		case 1: {
+				const int handle = plm->AddMark(line, markerNum, lines);
+				ASSERT_GT(handle, 0);
+				handles.push_back(handle);
+				marks[line] |= 1 << markerNum;
+			}
+			break;
+		case 2:
+			plm->DeleteMark(line, markerNum, true);
+			marks[line] &= ~(1 << markerNum);
+			break;
+		case 3:
+			if (!handles.empty()) {
+				const size_t h = (seed >> 12) % handles.size();
+				const int lineHandle = plm->LineFromHandle(handles[h]);
+				plm->DeleteMarkFromHandle(handles[h]);
+				handles.erase(handles.begin() + h);
+				if (lineHandle >= 0) {
+					// The line keeps the number when it has another handle with it
+					marks[lineHandle] = plm->MarkValue(lineHandle);
+				}
+			}
+			break;
+		case 4:
+			plm->InsertLines(line, 3);
+			marks.insert(marks.begin() + line, 3, 0);
+			break;
+		case 5:
+			if (lines > 1) {
+				plm->RemoveLine(line);
+				if (line > 0)
+					marks[line - 1] |= marks[line];
+				marks.erase(marks.begin() + line);
+			}
+			break;
+		case 6: {
+				const int mask = static_cast<int>((seed >> 12) & 0x00200402);
+				plm->SetMarkSet(line, mask, lines);
+				marks[line] = mask;
+			}
+			break;
+		case 7:
+			if ((step % 2000) == 7) {
+				plm->DeleteAllMarks(markerNum);
+				for (size_t l=0; l<marks.size(); l++)
+					marks[l] &= ~(1 << markerNum);
+			}
+			break;
+		}
+		ASSERT_EQ(marks[line < static_cast<int>(marks.size()) ? line : 0],
+			plm->MarkValue(line < static_cast<int>(marks.size()) ? line : 0));
+		if ((step % 1000) == 0) {
+			ExpectSame(marks);
+		}
+	}
+	ExpectSame(marks);
+}
+
+// Test LineAnnotation.
+
+class LineAnnotationTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pla = new LineAnnotation();
+	}
+
+	virtual void TearDown() {
+		delete pla;
+		pla = 0;
+	}
+
+	LineAnnotation *pla;
+};
+
+TEST_F(LineAnnotationTest, IsEmptyInitially) {
+	EXPECT_FALSE(pla->AnySet());
+	EXPECT_EQ(0, pla->Text(0));
+	EXPECT_EQ(0, pla->Length(0));
+	EXPECT_EQ(0, pla->Lines(0));
+}
+
+TEST_F(LineAnnotationTest, SetText) {
+	pla->SetText(3, "ab\ncd");
+	EXPECT_TRUE(pla->AnySet());
+	EXPECT_EQ(5, pla->Length(3));
+	EXPECT_EQ(2, pla->Lines(3));
+	EXPECT_EQ(0, memcmp("ab\ncd", pla->Text(3), 5));
+	EXPECT_EQ(0, pla->Text(2));
+	pla->SetText(3, "x");
+	EXPECT_EQ(1, pla->Length(3));
+	EXPECT_EQ(1, pla->Lines(3));
+	pla->SetText(3, 0);
+	EXPECT_EQ(0, pla->Text(3));
+}
+
+TEST_F(LineAnnotationTest, Styles) {
+	pla->SetText(1, "abc");
+	pla->SetStyle(1, 4);
+	EXPECT_EQ(4, pla->Style(1));
+	EXPECT_FALSE(pla->MultipleStyles(1));
+	const unsigned char styles[] = {1, 2, 3};
+	pla->SetStyles(1, styles);
+	EXPECT_TRUE(pla->MultipleStyles(1));
+	EXPECT_EQ(0, memcmp("abc", pla->Text(1), 3));
+	EXPECT_EQ(0, memcmp(styles, pla->Styles(1), 3));
+}
+
+TEST_F(LineAnnotationTest, InsertAndRemoveLines) {
+	pla->SetText(1, "one");
+	pla->SetText(2, "two");
+	pla->InsertLines(2, 3);
+	EXPECT_EQ(0, memcmp("one", pla->Text(1), 3));
+	EXPECT_EQ(0, pla->Text(2));
+	EXPECT_EQ(0, memcmp("two", pla->Text(5), 3));
+	pla->RemoveLine(1);
+	EXPECT_EQ(0, pla->Text(1));
+	EXPECT_EQ(0, memcmp("two", pla->Text(4), 3));
+}
+
+TEST_F(LineAnnotationTest, ReplaceManyTimes) {
+	// Replacing text many times wastes arena space so the live text is compacted
+	const int lines = 1000;
+	char text[40];
+	for (int round=0; round<20; round++) {
+		for (int line=0; line<lines; line++) {
+			sprintf(text, "%d:%d", round, line);
+			pla->SetText(line, text);
+			if ((line % 7) == 0) {
+				const unsigned char styles[40] = {5};
+				pla->SetStyles(line, styles);
+			}
+		}
+	}
+	for (int line=0; line<lines; line++) {
+		sprintf(text, "%d:%d", 19, line);
+		ASSERT_EQ(static_cast<int>(strlen(text)), pla->Length(line));
+		ASSERT_EQ(0, memcmp(text, pla->Text(line), strlen(text)));
+		ASSERT_EQ((line % 7) == 0, pla->MultipleStyles(line));
+		if ((line % 7) == 0) {
+			ASSERT_EQ(5, pla->Styles(line)[0]);
+		}
+	}
+	pla->ClearAll();
+	EXPECT_FALSE(pla->AnySet());
+}
+
+// Test Arena.
+
+TEST(ArenaTest, AllocateAndFree) {
+	Arena arena;
+	char *first = arena.Allocate(3);
+	char *second = arena.Allocate(5);
+	EXPECT_EQ(0, first[0]);
+	EXPECT_EQ(0, reinterpret_cast<size_t>(second) % 8);
+	EXPECT_EQ(16u, arena.Used());
+	char *large = arena.Allocate(0x8000);
+	EXPECT_NE(static_cast<char *>(0), large);
+	EXPECT_FALSE(arena.Wasteful());
+	for (int i=0; i<100; i++) {
+		arena.Free(0x8000);
+		arena.Allocate(0x8000);
+	}
+	EXPECT_TRUE(arena.Wasteful());
+	arena.DeleteAll();
+	EXPECT_EQ(0u, arena.Allocated());
+	EXPECT_EQ(0u, arena.Used());
+}
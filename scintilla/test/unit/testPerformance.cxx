@@ -0,0 +1,436 @@
+// Performance measurements for Scintilla internal data structures
+
+/*
+    These tests load or edit very large amounts of data so they are disabled by
+    default. Run them with:
+        ./unitTest --gtest_also_run_disabled_tests --gtest_filter=Performance*
+    Each test prints its timings to stdout.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include "Platform.h"
+
+#include "Sci_Position.h"
+#include "Scintilla.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "PartitionTree.h"
+#include "CellBuffer.h"
+
+#include <gtest/gtest.h>
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+namespace {
+
+// Wall clock time in seconds.
+double Now() {
+#ifdef _WIN32
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+// Peak resident memory of the process in bytes or 0 when not known.
+double PeakMemory() {
+#ifdef _WIN32
+	return 0.0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return static_cast<double>(usage.ru_maxrss);
+#else
+	return usage.ru_maxrss * 1024.0;
+#endif
+#endif
+}
+
+const char lineOfText[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789\n";
+const Sci_Position lengthLine = sizeof(lineOfText) - 1;
+
+// Fill a block with whole lines of text.
+void FillLines(char *block, Sci_Position lengthBlock) {
+	for (Sci_Position i = 0; i < lengthBlock; i++)
+		block[i] = lineOfText[i % lengthLine];
+}
+
+// Load lengthDocument bytes of synthetic text into a CellBuffer in 1 megabyte
+// blocks, the way ILoader::AddData receives a file, and report the cost.
+void LoadSynthetic(Sci_Position lengthDocument, const char *name) {
+	const Sci_Position lengthBlock = lengthLine * 16384;
+	char *block = new char[lengthBlock];
+	FillLines(block, lengthBlock);
+	const double memoryBefore = PeakMemory();
+	const double start = Now();
+	CellBuffer *pcb = new CellBuffer();
+	pcb->SetUndoCollection(false);
+	pcb->Allocate(lengthDocument);
+	bool startSequence = false;
+	for (Sci_Position loaded = 0; loaded < lengthDocument; loaded += lengthBlock) {
+		Sci_Position lengthAdd = lengthBlock;
+		if (lengthAdd > lengthDocument - loaded)
+			lengthAdd = lengthDocument - loaded;
+		pcb->InsertString(pcb->Length(), block, lengthAdd, startSequence);
+	}
+	const double duration = Now() - start;
+	EXPECT_EQ(lengthDocument, pcb->Length());
+	EXPECT_EQ(lineOfText[0], pcb->CharAt(0));
+	EXPECT_EQ(lineOfText[(lengthDocument - 1) % lengthLine], pcb->CharAt(lengthDocument - 1));
+	const double memoryUsed = PeakMemory() - memoryBefore;
+	printf("%6.3f %s load %.0f MB, %d lines, %.2f bytes of memory per byte\n",
+		duration, name, lengthDocument / 1048576.0, pcb->Lines(),
+		memoryUsed / lengthDocument);
+	delete pcb;
+	delete []block;
+}
+
+CellBuffer *CreateFilled(int documentOptions, Sci_Position lengthDocument) {
+	const Sci_Position lengthBlock = lengthLine * 16384;
+	char *block = new char[lengthBlock];
+	FillLines(block, lengthBlock);
+	CellBuffer *pcb = new CellBuffer(documentOptions);
+	pcb->SetUndoCollection(false);
+	bool startSequence = false;
+	for (Sci_Position loaded = 0; loaded < lengthDocument; loaded += lengthBlock) {
+		Sci_Position lengthAdd = lengthBlock;
+		if (lengthAdd > lengthDocument - loaded)
+			lengthAdd = lengthDocument - loaded;
+		pcb->InsertString(pcb->Length(), block, lengthAdd, startSequence);
+	}
+	delete []block;
+	return pcb;
+}
+
+// Insert and then delete a short string at edits positions. When scattered, each edit
+// alternates between the top and bottom halves of the document, otherwise the edits
+// advance through the document a line at a time.
+double EditAt(CellBuffer *pcb, int edits, bool scattered) {
+	const char insertion[] = "edit";
+	const Sci_Position lengthInsertion = sizeof(insertion) - 1;
+	const Sci_Position lengthDocument = pcb->Length();
+	bool startSequence = false;
+	const double start = Now();
+	for (int edit = 0; edit < edits; edit++) {
+		Sci_Position position = (lengthDocument / 2 + edit * lengthLine) % lengthDocument;
+		if (scattered) {
+			position = (static_cast<Sci_Position>(edit) * 7919 * lengthLine) % (lengthDocument / 2);
+			if (edit % 2)
+				position = lengthDocument - 1 - position;
+		}
+		pcb->InsertString(position, insertion, lengthInsertion, startSequence);
+		pcb->DeleteChars(position + 1, lengthInsertion, startSequence);
+	}
+	return Now() - start;
+}
+
+// Random edits to partitions the way scattered editing changes the lines of a document:
+// text typed into a line, lines added and removed, and the line of a position found.
+// Returns a checksum of the positions found so that implementations can be compared.
+template <typename P>
+unsigned long EditPartitions(P &partitions, int lines, int edits, double &duration) {
+	for (int line = 1; line <= lines; line++) {
+		partitions.InsertText(line - 1, lengthLine);
+		partitions.InsertPartition(line, line * lengthLine);
+	}
+	unsigned long check = 0;
+	unsigned int seed = 1;
+	const double start = Now();
+	for (int edit = 0; edit < edits; edit++) {
+		seed = seed * 1103515245 + 12345;
+		const int partition = static_cast<int>((seed >> 4) % partitions.Partitions());
+		switch (edit % 4) {
+		case 0:
+			partitions.InsertText(partition, 1);
+			break;
+		case 1:
+			if (partition > 0)
+				partitions.RemovePartition(partition);
+			break;
+		case 2: {
+				const Sci_Position position = partitions.PositionFromPartition(partition) + 1;
+				if (position < partitions.PositionFromPartition(partition + 1))
+					partitions.InsertPartition(partition + 1, position);
+			}
+			break;
+		default:
+			check = check * 31 + partitions.PartitionFromPosition(
+				partitions.PositionFromPartition(partition) + 1);
+			break;
+		}
+	}
+	duration = Now() - start;
+	return check;
+}
+
+// Memory standing in for a mapped file so that the platform layer is not needed.
+class MemoryFile : public MappedFile {
+	char *data;
+	size_t length;
+public:
+	explicit MemoryFile(size_t length_) : data(new char[length_]), length(length_) {
+		FillLines(data, length);
+	}
+	virtual ~MemoryFile() {
+		delete []data;
+	}
+	virtual const char *Data() {
+		return data;
+	}
+	virtual size_t Length() {
+		return length;
+	}
+	virtual bool IsValid() {
+		return true;
+	}
+};
+
+}
+
+TEST(Performance, DISABLED_LoadLargeDocuments) {
+	const Sci_Position gigabyte = 1024 * 1024 * 1024;
+#ifdef SCI_LARGE_DOCUMENTS
+	LoadSynthetic(gigabyte * 4, "LoadLargeDocuments");
+	LoadSynthetic(gigabyte * 8, "LoadLargeDocuments");
+#else
+	printf("Documents over 2GB need a build with SCI_LARGE_DOCUMENTS defined\n");
+	LoadSynthetic(gigabyte, "LoadLargeDocuments");
+#endif
+}
+
+TEST(Performance, DISABLED_ScatteredEdits) {
+	const Sci_Position lengthDocument = 256 * 1024 * 1024;
+	const int editsLocal = 100000;
+	const int editsScattered = 200;
+	const int documentOptions[] = {SC_DOCUMENTOPTION_DEFAULT, SC_DOCUMENTOPTION_TEXT_CHUNKED};
+	const char *names[] = {"gap buffer", "chunked"};
+	unsigned long checks[2] = {0, 0};
+	for (int store = 0; store < 2; store++) {
+		CellBuffer *pcb = CreateFilled(documentOptions[store], lengthDocument);
+		const double durationLocal = EditAt(pcb, editsLocal, false);
+		const double durationScattered = EditAt(pcb, editsScattered, true);
+		printf("%-10s %d local edits %.3fs, %d scattered edits %.3fs, %.3f ms per scattered edit\n",
+			names[store], editsLocal, durationLocal, editsScattered, durationScattered,
+			durationScattered * 1000.0 / editsScattered);
+		EXPECT_EQ(lengthDocument, pcb->Length());
+		char sample[4096];
+		for (Sci_Position position = 0; position + 4096 <= pcb->Length(); position += 1024 * 1024) {
+			pcb->GetCharRange(sample, position, sizeof(sample));
+			for (size_t i = 0; i < sizeof(sample); i++)
+				checks[store] = checks[store] * 31 + static_cast<unsigned char>(sample[i]);
+		}
+		delete pcb;
+	}
+	EXPECT_EQ(checks[0], checks[1]);
+}
+
+TEST(Performance, DISABLED_OpenMappedDocument) {
+	const Sci_Position lengthDocument = 1024 * 1024 * 1024;
+	MappedFile *mappedFile = new MemoryFile(lengthDocument);
+	const double memoryBefore = PeakMemory();
+	double start = Now();
+	CellBuffer *pcb = new CellBuffer(SC_DOCUMENTOPTION_TEXT_CHUNKED);
+	pcb->SetUndoCollection(false);
+	EXPECT_TRUE(pcb->SetMappedFile(mappedFile));
+	const double durationOpen = Now() - start;
+	start = Now();
+	pcb->IndexLines(1024 * 1024);
+	const double durationFirstLines = Now() - start;
+	const double memoryOpen = PeakMemory() - memoryBefore;
+	start = Now();
+	while (pcb->IndexedTo() < pcb->Length())
+		pcb->IndexLines(pcb->IndexedTo() + 0x400000);
+	const double durationIndex = Now() - start;
+	printf("%6.3f open mapped %.0f MB, %.3f to index 1 MB, %.3f to index all %d lines\n",
+		durationOpen, lengthDocument / 1048576.0, durationFirstLines, durationIndex, pcb->Lines());
+	printf("%.3f bytes of memory per byte when opened\n", memoryOpen / lengthDocument);
+	EXPECT_EQ(lengthDocument, pcb->Length());
+	EXPECT_EQ(lengthDocument / lengthLine + 1, pcb->Lines());
+	EXPECT_EQ(lengthLine, pcb->LineStart(1));
+	const char insertion[] = "edit\n";
+	bool startSequence = false;
+	pcb->InsertString(lengthDocument / 2, insertion, 5, startSequence);
+	EXPECT_EQ(lengthDocument / lengthLine + 2, pcb->Lines());
+	EXPECT_EQ(lineOfText[0], pcb->CharAt(pcb->LineStart(pcb->Lines() - 1)));
+	EXPECT_EQ(lengthDocument / 2 + 5, pcb->LineStart(pcb->LineFromPosition(lengthDocument / 2) + 1));
+	delete pcb;
+}
+
+// Like testHuge in performanceTests.py: one insertion of 100 megabytes of lines
+// ending with each line end type, and of lines long enough that scanning dominates.
+TEST(Performance, DISABLED_InsertHuge) {
+	const Sci_Position lengthDocument = 100 * 1024 * 1024;
+	const char *lineEnds[] = {"\n", "\r\n", "\r", "\n"};
+	const Sci_Position lengthLines[] = {lengthLine, lengthLine + 1, lengthLine, 1000};
+	const char *names[] = {"lf", "crlf", "cr", "long lf"};
+	char *data = new char[lengthDocument];
+	for (int kind = 0; kind < 4; kind++) {
+		const Sci_Position lengthEnd = static_cast<Sci_Position>(strlen(lineEnds[kind]));
+		const Sci_Position lengthText = lengthLines[kind] - lengthEnd;
+		int lines = 1;
+		for (Sci_Position i = 0; i < lengthDocument; i++) {
+			const Sci_Position column = i % lengthLines[kind];
+			if (column < lengthText) {
+				data[i] = lineOfText[column % (lengthLine - 1)];
+			} else {
+				data[i] = lineEnds[kind][column - lengthText];
+				if (column == lengthLines[kind] - 1)
+					lines++;
+			}
+		}
+		CellBuffer *pcb = new CellBuffer();
+		pcb->SetUndoCollection(false);
+		bool startSequence = false;
+		const double start = Now();
+		pcb->InsertString(0, data, lengthDocument, startSequence);
+		const double duration = Now() - start;
+		printf("%6.3f testHuge %s %d lines\n", duration, names[kind], pcb->Lines());
+		EXPECT_EQ(lines, pcb->Lines());
+		delete pcb;
+	}
+	delete []data;
+}
+
+// Load the way a loader does, adding the text in blocks and then finding all the lines
+// at once on Workers::Count() threads.
+TEST(Performance, DISABLED_LoaderIndexLines) {
+	const Sci_Position lengthDocument = 1024 * 1024 * 1024;
+	const Sci_Position lengthBlock = lengthLine * 16384;
+	char *block = new char[lengthBlock];
+	FillLines(block, lengthBlock);
+	CellBuffer *pcb = new CellBuffer();
+	pcb->SetUndoCollection(false);
+	pcb->Allocate(lengthDocument + 1);
+	double start = Now();
+	for (Sci_Position loaded = 0; loaded < lengthDocument; loaded += lengthBlock) {
+		Sci_Position lengthAdd = lengthBlock;
+		if (lengthAdd > lengthDocument - loaded)
+			lengthAdd = lengthDocument - loaded;
+		pcb->AppendWithoutLines(block, lengthAdd);
+	}
+	const double durationAdd = Now() - start;
+	start = Now();
+	pcb->IndexLines(pcb->Length());
+	const double durationIndex = Now() - start;
+	printf("%6.3f add %.0f MB, %.3f to index %d lines with %d threads\n",
+		durationAdd, lengthDocument / 1048576.0, durationIndex, pcb->Lines(), Workers::Count());
+	EXPECT_EQ(lengthDocument / lengthLine + 1, pcb->Lines());
+	EXPECT_EQ(lengthLine * 1000, pcb->LineStart(1000));
+	delete pcb;
+	delete []block;
+}
+
+// A plain text document, or one styled only where it has been displayed, keeps its
+// styles as runs rather than a byte for each character.
+TEST(Performance, DISABLED_StyleVisibleText) {
+	const Sci_Position lengthDocument = 1024 * 1024 * 1024;
+	const double memoryBefore = PeakMemory();
+	CellBuffer *pcb = CreateFilled(0, lengthDocument);
+	const double memoryPlain = PeakMemory() - memoryBefore;
+	double start = Now();
+	// A screen of lines near the end, styled one word at a time as a lexer would
+	const Sci_Position startVisible = pcb->LineStart(pcb->Lines() - 100);
+	for (Sci_Position position = startVisible; position < pcb->Length(); position += 8)
+		pcb->SetStyleFor(position, 4, static_cast<char>(1 + position % 3), '\xff');
+	const double durationVisible = Now() - start;
+	const double memoryVisible = PeakMemory() - memoryBefore;
+	EXPECT_EQ(0, pcb->StyleAt(0));
+	EXPECT_EQ(0, pcb->StyleAt(startVisible - 1));
+	EXPECT_NE(0, pcb->StyleAt(startVisible));
+	printf("%6.3f style visible text, %.2f bytes of memory per byte, %.2f unstyled\n",
+		durationVisible, memoryVisible / lengthDocument, memoryPlain / lengthDocument);
+	start = Now();
+	pcb->SetStyleFor(0, pcb->Length(), 1, '\xff');
+	printf("%6.3f style all text, %.2f bytes of memory per byte\n",
+		Now() - start, (PeakMemory() - memoryBefore) / lengthDocument);
+	EXPECT_EQ(1, pcb->StyleAt(lengthDocument / 2));
+	delete pcb;
+}
+
+// A script making many small edits, each its own undo sequence, and the memory
+// kept by the undo history with and without a limit.
+TEST(Performance, DISABLED_UndoBulkEdits) {
+	const int edits = 4000000;
+	const Sci_Position limits[] = {0, 16 * 1024 * 1024};
+	for (size_t test = 0; test < sizeof(limits) / sizeof(limits[0]); test++) {
+		CellBuffer *pcb = CreateFilled(0, 64 * 1024 * 1024);
+		pcb->SetUndoCollection(true);
+		pcb->SetUndoMemoryLimit(limits[test]);
+		const double memoryBefore = PeakMemory();
+		bool startSequence = false;
+		const double start = Now();
+		Sci_Position position = 0;
+		for (int edit = 0; edit < edits; edit++) {
+			position = (position + 7919) % (pcb->Length() - 2);
+			pcb->BeginUndoAction();
+			pcb->InsertString(position, "edit", 4, startSequence);
+			pcb->DeleteChars(position + 1, 2, startSequence);
+			pcb->EndUndoAction();
+		}
+		const double duration = Now() - start;
+		printf("%6.3f %d edits with limit %.0f MB, %d undo actions using %.0f MB, peak grew %.0f MB\n",
+			duration, edits, limits[test] / 1048576.0, pcb->UndoActions(),
+			pcb->UndoMemory() / 1048576.0, (PeakMemory() - memoryBefore) / 1048576.0);
+		EXPECT_TRUE(pcb->CanUndo());
+		delete pcb;
+	}
+}
+
+// Lines added and removed at random through a large document, comparing the line
+// starts held by Partitioning with those held by PartitionTree.
+TEST(Performance, DISABLED_ScatteredLineEdits) {
+	const int lines = 4000000;
+	const int edits = 40000;
+	double durationPartitioning = 0.0;
+	Partitioning partitioning(256);
+	const unsigned long checkPartitioning = EditPartitions(partitioning, lines, edits, durationPartitioning);
+	double durationTree = 0.0;
+	PartitionTree tree;
+	const unsigned long checkTree = EditPartitions(tree, lines, edits, durationTree);
+	printf("%6.3f Partitioning %d edits of %d lines, %.3f us per edit\n",
+		durationPartitioning, edits, lines, durationPartitioning * 1000000.0 / edits);
+	printf("%6.3f PartitionTree %d edits of %d lines, %.3f us per edit\n",
+		durationTree, edits, lines, durationTree * 1000000.0 / edits);
+	EXPECT_EQ(checkPartitioning, checkTree);
+	EXPECT_EQ(partitioning.Partitions(), tree.Partitions());
+
+	// The same through CellBuffer, splitting and joining lines at scattered positions
+	const int documentOptions[] = {SC_DOCUMENTOPTION_TEXT_CHUNKED,
+		SC_DOCUMENTOPTION_TEXT_CHUNKED | SC_DOCUMENTOPTION_LINES_TREE};
+	const char *names[] = {"chunked", "chunked with lines tree"};
+	const int editsDocument = 20000;
+	int linesAfter[2] = {0, 0};
+	for (int store = 0; store < 2; store++) {
+		CellBuffer *pcb = CreateFilled(documentOptions[store], lengthLine * lines);
+		bool startSequence = false;
+		unsigned int seed = 1;
+		const double start = Now();
+		for (int edit = 0; edit < editsDocument; edit++) {
+			seed = seed * 1103515245 + 12345;
+			const Sci_Position position = (seed >> 4) % (pcb->Length() - 2);
+			pcb->InsertString(position, "\n", 1, startSequence);
+			if (edit % 2)
+				pcb->DeleteChars(position + 1, 1, startSequence);
+		}
+		const double duration = Now() - start;
+		linesAfter[store] = pcb->Lines();
+		printf("%6.3f %s %d line edits, %.3f us per edit\n",
+			duration, names[store], editsDocument, duration * 1000000.0 / editsDocument);
+		delete pcb;
+	}
+	EXPECT_EQ(linesAfter[0], linesAfter[1]);
+}
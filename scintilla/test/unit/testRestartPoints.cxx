@@ -0,0 +1,138 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+
+#include "Platform.h"
+
+#include "Sci_Position.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RestartPoints.h"
+
+#include <gtest/gtest.h>
+
+const int spacing = RestartPoints::spacing;
+const int lengthDocument = 20000;
+
+// Test RestartPoints.
+
+class RestartPointsTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		prp = new RestartPoints();
+	}
+
+	virtual void TearDown() {
+		delete prp;
+		prp = 0;
+	}
+
+	RestartPoints *prp;
+};
+
+TEST_F(RestartPointsTest, IsEmptyInitially) {
+	EXPECT_EQ(-1, prp->Before(lengthDocument));
+	EXPECT_EQ(-1, prp->After(0));
+}
+
+TEST_F(RestartPointsTest, Add) {
+	prp->Add(2000, 0, 0);
+	EXPECT_EQ(-1, prp->Before(1999));
+	EXPECT_EQ(2000, prp->Before(2000));
+	EXPECT_EQ(2000, prp->Before(lengthDocument));
+	EXPECT_EQ(2000, prp->After(0));
+	EXPECT_EQ(-1, prp->After(2000));
+}
+
+TEST_F(RestartPointsTest, AddKeepsSpacing) {
+	prp->Add(2000, 0, 0);
+	prp->Add(2000 + spacing - 1, 0, 0);
+	EXPECT_EQ(-1, prp->After(2000));
+	prp->Add(2000 + spacing, 0, 0);
+	EXPECT_EQ(2000 + spacing, prp->After(2000));
+	// Before a point but too close to it
+	prp->Add(2000 - spacing + 1, 0, 0);
+	EXPECT_EQ(2000, prp->After(0));
+}
+
+TEST_F(RestartPointsTest, AddAwayFromLineStart) {
+	prp->Add(100, 0, 0);
+	prp->Add(5000, 4500, 0);
+	EXPECT_EQ(-1, prp->After(0));
+	prp->Add(4500 + spacing, 4500, 0);
+	EXPECT_EQ(4500 + spacing, prp->After(0));
+}
+
+TEST_F(RestartPointsTest, LineStateBefore) {
+	prp->Add(2000, 0, 1);
+	prp->Add(4000, 2500, 2);
+	prp->Add(6000, 2500, 3);
+	EXPECT_EQ(1, prp->LineStateBefore(2000));
+	EXPECT_EQ(2, prp->LineStateBefore(4000));
+	EXPECT_EQ(0, prp->LineStateBefore(4001));
+	prp->Remove(2000, 4000);
+	EXPECT_EQ(1, prp->LineStateBefore(2000));
+	EXPECT_EQ(0, prp->LineStateBefore(4000));
+	EXPECT_EQ(3, prp->LineStateBefore(6000));
+}
+
+TEST_F(RestartPointsTest, Close) {
+	prp->Add(2000, 0, 0);
+	EXPECT_TRUE(prp->Close(2000));
+	EXPECT_TRUE(prp->Close(2000 + spacing - 1));
+	EXPECT_FALSE(prp->Close(2000 + spacing));
+	EXPECT_FALSE(prp->Close(1999));
+}
+
+TEST_F(RestartPointsTest, Remove) {
+	prp->Add(2000, 0, 0);
+	prp->Add(4000, 0, 0);
+	prp->Add(6000, 0, 0);
+	prp->Remove(2000, 4000);
+	EXPECT_EQ(2000, prp->After(0));
+	EXPECT_EQ(6000, prp->After(2000));
+	EXPECT_FALSE(prp->Close(2100));
+	prp->Remove(0, lengthDocument);
+	EXPECT_EQ(-1, prp->After(0));
+}
+
+TEST_F(RestartPointsTest, InsertMovesLaterPoints) {
+	prp->Add(2000, 0, 0);
+	prp->Add(4000, 0, 0);
+	prp->TextChanged(3000, 10, 0, lengthDocument);
+	EXPECT_EQ(2000, prp->After(0));
+	EXPECT_EQ(4010, prp->After(2000));
+	// A point at the insertion is still where the text before it ends
+	prp->TextChanged(2000, 5, 0, lengthDocument + 10);
+	EXPECT_EQ(2000, prp->After(0));
+	EXPECT_EQ(4015, prp->After(2000));
+}
+
+TEST_F(RestartPointsTest, DeleteRemovesPointsWithin) {
+	prp->Add(2000, 0, 0);
+	prp->Add(4000, 0, 0);
+	prp->Add(6000, 0, 0);
+	prp->TextChanged(3000, 0, 1000, lengthDocument);
+	EXPECT_EQ(2000, prp->After(0));
+	EXPECT_EQ(5000, prp->After(2000));
+	EXPECT_EQ(-1, prp->After(5000));
+}
+
+TEST_F(RestartPointsTest, ChangeAtEnd) {
+	prp->Add(2000, 0, 0);
+	prp->TextChanged(1500, 0, 1000, 2500);
+	EXPECT_EQ(-1, prp->After(0));
+	prp->TextChanged(1500, 3000, 0, 1500);
+	prp->Add(4000, 0, 0);
+	EXPECT_EQ(4000, prp->Before(lengthDocument));
+}
+
+TEST_F(RestartPointsTest, DeleteAll) {
+	prp->Add(2000, 0, 0);
+	prp->Add(4000, 0, 0);
+	prp->DeleteAll();
+	EXPECT_EQ(-1, prp->After(0));
+	prp->Add(3000, 0, 0);
+	EXPECT_EQ(3000, prp->After(0));
+}
@@ -4,6 +4,8 @@
 
 #include "Platform.h"
 
+#include "Sci_Position.h"
+
 #include "SplitVector.h"
 
 #include <gtest/gtest.h>
@@ -201,11 +203,81 @@ TEST_F(SplitVectorTest, DeleteBackAndForth) {
 	}
 }
 
+TEST_F(SplitVectorTest, SegmentAt) {
+	psv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	psv->InsertValue(2, 1, 99);
+	Sci_Position lengthSegment = 0;
+	// The gap follows the inserted value so there are two segments
+	const int *segment = psv->SegmentAt(0, lengthSegment);
+	EXPECT_EQ(3, lengthSegment);
+	EXPECT_EQ(3, segment[0]);
+	EXPECT_EQ(99, segment[2]);
+	segment = psv->SegmentAt(1, lengthSegment);
+	EXPECT_EQ(2, lengthSegment);
+	EXPECT_EQ(4, segment[0]);
+	segment = psv->SegmentAt(3, lengthSegment);
+	EXPECT_EQ(2, lengthSegment);
+	EXPECT_EQ(5, segment[0]);
+	EXPECT_EQ(6, segment[1]);
+	psv->SegmentAt(5, lengthSegment);
+	EXPECT_EQ(0, lengthSegment);
+}
+
 TEST_F(SplitVectorTest, GrowSize) {
 	psv->SetGrowSize(5);
 	EXPECT_EQ(5, psv->GetGrowSize());
 }
 
+TEST_F(SplitVectorTest, Memory) {
+	EXPECT_EQ(0u, psv->Memory());
+	psv->InsertValue(0, 10, 0);
+	EXPECT_GE(psv->Memory(), 10 * sizeof(int));
+	EXPECT_EQ(psv->Memory() - 10 * sizeof(int), psv->Unused());
+	psv->DeleteRange(0, 4);
+	EXPECT_EQ(psv->Memory() - 6 * sizeof(int), psv->Unused());
+}
+
+TEST_F(SplitVectorTest, Shrink) {
+	psv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	psv->InsertValue(2, 10, 1);
+	psv->DeleteRange(2, 10);
+	psv->Shrink();
+	EXPECT_EQ(0u, psv->Unused());
+	EXPECT_EQ(lengthTestArray * sizeof(int), psv->Memory());
+	for (int i=0; i<lengthTestArray; i++) {
+		EXPECT_EQ(testArray[i], psv->ValueAt(i));
+	}
+	psv->Insert(4, 7);
+	EXPECT_EQ(7, psv->ValueAt(4));
+	psv->DeleteRange(0, 5);
+	psv->Shrink();
+	EXPECT_EQ(0u, psv->Memory());
+}
+
+TEST_F(SplitVectorTest, DeleteNearFront) {
+	// As a log drops its first lines while appending, the gap stays at the end
+	for (int i=0; i<1000; i++) {
+		psv->Insert(i, i);
+	}
+	for (int i=1000; i<5000; i++) {
+		psv->Delete(1);
+		Sci_Position lengthSegment = 0;
+		psv->SegmentAt(0, lengthSegment);
+		EXPECT_EQ(psv->Length(), lengthSegment);
+		psv->Insert(psv->Length(), i);
+	}
+	EXPECT_EQ(1000, psv->Length());
+	EXPECT_EQ(0, psv->ValueAt(0));
+	for (int i=1; i<psv->Length(); i++) {
+		EXPECT_EQ(4000 + i, psv->ValueAt(i));
+	}
+	// The dropped front is reclaimed as the buffer grows
+	EXPECT_LT(psv->Memory(), 2000 * sizeof(int));
+	psv->Shrink();
+	EXPECT_EQ(0u, psv->Unused());
+	EXPECT_EQ(4001, psv->ValueAt(1));
+}
+
 TEST_F(SplitVectorTest, OutsideBounds) {
 	psv->InsertValue(0, 10, 87);
 	EXPECT_EQ(0, psv->ValueAt(-1));
@@ -6,16 +6,20 @@
         Partitioning
         RunStyles
         ContractionState
+        ChunkedVector
+        CellBuffer
+        Document
+        LexInterface
+        LexAccessor
+        ChunkConverter
 
     To do:
         Decoration
         DecorationList
         PerLine *
-        CellBuffer *
         Range
         StyledText
         CaseFolder ...
-        Document
         RESearch
         Selection
         UniConversion
@@ -23,7 +27,6 @@
 
         lexlib:
         Accessor
-        LexAccessor
         CharacterSet
         OptionSet
         PropSetSimple
@@ -32,6 +35,13 @@
 */
 
 #include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 #include "Platform.h"
 
@@ -44,6 +54,175 @@ void Platform::Assert(const char *c, const char *file, int line) {
 	abort();
 }
 
+void Platform::DebugPrintf(const char *format, ...) {
+	va_list pArguments;
+	va_start(pArguments, format);
+	vfprintf(stderr, format, pArguments);
+	va_end(pArguments);
+}
+
+int Platform::Minimum(int a, int b) {
+	return (a < b) ? a : b;
+}
+
+int Platform::Maximum(int a, int b) {
+	return (a > b) ? a : b;
+}
+
+int Platform::Clamp(int val, int minVal, int maxVal) {
+	if (val > maxVal)
+		val = maxVal;
+	if (val < minVal)
+		val = minVal;
+	return val;
+}
+
+// Processor time is close enough for the time budgets of the code being tested
+
+ElapsedTime::ElapsedTime() {
+	bigBit = static_cast<long>(clock());
+	littleBit = 0;
+}
+
+double ElapsedTime::Duration(bool reset) {
+	const long now = static_cast<long>(clock());
+	const double duration = static_cast<double>(now - bigBit) / CLOCKS_PER_SEC;
+	if (reset)
+		bigBit = now;
+	return duration;
+}
+
+// Threads for the parallel paths of the code being tested. At least 4 are
+// reported so that those paths are always exercised.
+
+#ifndef _WIN32
+struct WorkItem {
+	Workers::WorkFunction fn;
+	void *work;
+};
+
+static void *WorkerThread(void *data) {
+	WorkItem *item = static_cast<WorkItem *>(data);
+	item->fn(item->work);
+	return NULL;
+}
+#endif
+
+int Workers::Count() {
+#ifndef _WIN32
+	const long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	return (processors > 4) ? static_cast<int>(processors) : 4;
+#else
+	return 1;
+#endif
+}
+
+void Workers::Run(WorkFunction fn, void **work, int count) {
+#ifndef _WIN32
+	WorkItem *items = new WorkItem[count];
+	pthread_t *threads = new pthread_t[count];
+	bool *started = new bool[count];
+	for (int i = 1; i < count; i++) {
+		items[i].fn = fn;
+		items[i].work = work[i];
+		started[i] = pthread_create(&threads[i], NULL, WorkerThread, &items[i]) == 0;
+		if (!started[i])
+			fn(work[i]);
+	}
+	if (count > 0)
+		fn(work[0]);
+	for (int i = 1; i < count; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+	}
+	delete []started;
+	delete []threads;
+	delete []items;
+#else
+	for (int i = 0; i < count; i++)
+		fn(work[i]);
+#endif
+}
+
+#ifndef _WIN32
+static void *DetachedThread(void *data) {
+	WorkItem *item = static_cast<WorkItem *>(data);
+	item->fn(item->work);
+	delete item;
+	return NULL;
+}
+#endif
+
+bool Workers::Start(WorkFunction fn, void *work) {
+#ifndef _WIN32
+	WorkItem *item = new WorkItem;
+	item->fn = fn;
+	item->work = work;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, DetachedThread, item) != 0) {
+		delete item;
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+#else
+	return false;
+#endif
+}
+
+class MutexImpl : public Mutex {
+#ifndef _WIN32
+	pthread_mutex_t mutex;
+public:
+	MutexImpl() {
+		pthread_mutex_init(&mutex, NULL);
+	}
+	virtual ~MutexImpl() {
+		pthread_mutex_destroy(&mutex);
+	}
+	virtual void Lock() {
+		pthread_mutex_lock(&mutex);
+	}
+	virtual void Unlock() {
+		pthread_mutex_unlock(&mutex);
+	}
+#else
+public:
+	virtual void Lock() {
+	}
+	virtual void Unlock() {
+	}
+#endif
+};
+
+Mutex *Mutex::Create() {
+	return new MutexImpl();
+}
+
+void AtomicCount::Increment(int *count) {
+#ifndef _WIN32
+	__sync_add_and_fetch(count, 1);
+#else
+	++*count;
+#endif
+}
+
+bool AtomicCount::Decrement(int *count) {
+#ifndef _WIN32
+	return __sync_sub_and_fetch(count, 1) == 0;
+#else
+	return --*count == 0;
+#endif
+}
+
+int AtomicCount::Get(int *count) {
+#ifndef _WIN32
+	return __sync_fetch_and_add(count, 0);
+#else
+	return *count;
+#endif
+}
+
 int main(int argc, char **argv) {
 	testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
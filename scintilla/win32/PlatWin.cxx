@@ -3076,6 +3076,147 @@ DynamicLibrary *DynamicLibrary::Load(const char *modulePath) {
 	return static_cast<DynamicLibrary *>(new DynamicLibraryImpl(modulePath));
 }
 
+class MappedFileImpl : public MappedFile {
+protected:
+	const char *data;
+	size_t length;
+public:
+	MappedFileImpl(const char *path) : data(NULL), length(0) {
+		HANDLE hFile = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hFile == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER size;
+		if (::GetFileSizeEx(hFile, &size) && (size.QuadPart > 0) &&
+			(static_cast<unsigned __int64>(size.QuadPart) <= static_cast<size_t>(-1))) {
+			HANDLE hMapping = ::CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (hMapping != NULL) {
+				data = static_cast<const char *>(::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+				if (data)
+					length = static_cast<size_t>(size.QuadPart);
+				// The view keeps the mapping alive
+				::CloseHandle(hMapping);
+			}
+		}
+		::CloseHandle(hFile);
+	}
+
+	virtual ~MappedFileImpl() {
+		if (data != NULL)
+			::UnmapViewOfFile(data);
+	}
+
+	virtual const char *Data() {
+		return data;
+	}
+
+	virtual size_t Length() {
+		return length;
+	}
+
+	virtual bool IsValid() {
+		return data != NULL;
+	}
+};
+
+MappedFile *MappedFile::Map(const char *path) {
+	return static_cast<MappedFile *>(new MappedFileImpl(path));
+}
+
+struct WorkItem {
+	Workers::WorkFunction fn;
+	void *work;
+};
+
+static DWORD WINAPI WorkerThread(LPVOID data) {
+	WorkItem *item = static_cast<WorkItem *>(data);
+	item->fn(item->work);
+	return 0;
+}
+
+int Workers::Count() {
+	SYSTEM_INFO info;
+	::GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0) ? static_cast<int>(info.dwNumberOfProcessors) : 1;
+}
+
+void Workers::Run(WorkFunction fn, void **work, int count) {
+	WorkItem *items = new WorkItem[count];
+	HANDLE *threads = new HANDLE[count];
+	// The first piece of work is done on this thread while the others run
+	for (int i = 1; i < count; i++) {
+		items[i].fn = fn;
+		items[i].work = work[i];
+		threads[i] = ::CreateThread(NULL, 0, WorkerThread, &items[i], 0, NULL);
+		if (!threads[i])
+			fn(work[i]);
+	}
+	if (count > 0)
+		fn(work[0]);
+	for (int i = 1; i < count; i++) {
+		if (threads[i]) {
+			::WaitForSingleObject(threads[i], INFINITE);
+			::CloseHandle(threads[i]);
+		}
+	}
+	delete []threads;
+	delete []items;
+}
+
+static DWORD WINAPI DetachedThread(LPVOID data) {
+	WorkItem *item = static_cast<WorkItem *>(data);
+	item->fn(item->work);
+	delete item;
+	return 0;
+}
+
+bool Workers::Start(WorkFunction fn, void *work) {
+	WorkItem *item = new WorkItem;
+	item->fn = fn;
+	item->work = work;
+	HANDLE thread = ::CreateThread(NULL, 0, DetachedThread, item, 0, NULL);
+	if (!thread) {
+		delete item;
+		return false;
+	}
+	::CloseHandle(thread);
+	return true;
+}
+
+class MutexImpl : public Mutex {
+	CRITICAL_SECTION cs;
+public:
+	MutexImpl() {
+		::InitializeCriticalSection(&cs);
+	}
+	virtual ~MutexImpl() {
+		::DeleteCriticalSection(&cs);
+	}
+	virtual void Lock() {
+		::EnterCriticalSection(&cs);
+	}
+	virtual void Unlock() {
+		::LeaveCriticalSection(&cs);
+	}
+};
+
+Mutex *Mutex::Create() {
+	return new MutexImpl();
+}
+
+// LONG and int are both 32 bits on Windows
+void AtomicCount::Increment(int *count) {
+	::InterlockedIncrement(reinterpret_cast<LONG volatile *>(count));
+}
+
+bool AtomicCount::Decrement(int *count) {
+	return ::InterlockedDecrement(reinterpret_cast<LONG volatile *>(count)) == 0;
+}
+
+int AtomicCount::Get(int *count) {
+	return ::InterlockedCompareExchange(reinterpret_cast<LONG volatile *>(count), 0, 0);
+}
+
 ColourDesired Platform::Chrome() {
 	return ::GetSysColor(COLOR_3DFACE);
 }
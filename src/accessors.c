@@ -328,6 +328,9 @@ void gtk_scintilla_get_property(GObject *object, guint property_id, GValue *valu
     case PROP_CASE_SENSITIVE_BEHAVIOUR:
       g_value_set_enum(value, gtk_scintilla_get_case_sensitive_behaviour(self));
       break;
+		case PROP_UNDO_MEMORY_LIMIT:
+			g_value_set_int64(value, gtk_scintilla_get_undo_memory_limit(self));
+			break;
 		/* non-scintilla properties */
 		case PROP_LINE_NUMBERS_VISIBLE:
 			g_value_set_boolean(value, gtk_scintilla_get_line_numbers_visible(self));
@@ -654,6 +657,9 @@ void gtk_scintilla_set_property(GObject *object, guint property_id, const GValue
     case PROP_CASE_SENSITIVE_BEHAVIOUR:
       gtk_scintilla_set_case_sensitive_behaviour(self, g_value_get_enum(value));
       break;
+		case PROP_UNDO_MEMORY_LIMIT:
+			gtk_scintilla_set_undo_memory_limit(self, (GtkScintillaPosition) g_value_get_int64(value));
+			break;
 			/* non-scintilla properties */
 		case PROP_LINE_NUMBERS_VISIBLE:
 			gtk_scintilla_set_line_numbers_visible(self, g_value_get_boolean(value));
@@ -40,7 +40,7 @@ G_BEGIN_DECLS
 #define GTK_SCINTILLA_ALPHA_NOALPHA 256
 #define GTK_SCINTILLA_UNDO_MAY_COALESCE 1
 #define GTK_SCINTILLA_KEYWORDSET_MAX 8
-#define GTK_SCINTILLA_MODEVENTMASKALL 0x7FFFF
+#define GTK_SCINTILLA_MODEVENTMASKALL 0x3FFFFF
 
 
 /**
@@ -384,7 +384,9 @@ typedef enum {
 	GTK_SCINTILLA_MODIFICATION_FLAGS_CHANGE_LINE_STATE=0x8000,
 	GTK_SCINTILLA_MODIFICATION_FLAGS_CHANGE_MARGIN=0x10000,
 	GTK_SCINTILLA_MODIFICATION_FLAGS_CHANGE_ANNOTATION=0x20000,
-	GTK_SCINTILLA_MODIFICATION_FLAGS_CONTAINER=0x40000
+	GTK_SCINTILLA_MODIFICATION_FLAGS_CONTAINER=0x40000,
+	GTK_SCINTILLA_MODIFICATION_FLAGS_LINES_INDEXED=0x100000,
+	GTK_SCINTILLA_MODIFICATION_FLAGS_REPLACE_RANGES=0x200000
 	/* todo: these are separate */
 	/*GTK_SCINTILLA_MODIFICATION_FLAGS_CHANGE=768,*/
 	/*GTK_SCINTILLA_MODIFICATION_FLAGS_SETFOCUS=512,*/
@@ -427,6 +429,34 @@ typedef enum {
   GTK_SCINTILLA_CASE_SENSITIVE_BEHAVIOUR_IGNORE_CASE=1
 } GtkScintillaCaseSensitiveBehaviour;
 
+/**
+ * GtkScintillaDocumentOption:
+ * @GTK_SCINTILLA_DOCUMENT_OPTION_DEFAULT:	Store the text in a single gap
+ * 											buffer.
+ * @GTK_SCINTILLA_DOCUMENT_OPTION_TEXT_CHUNKED:	Store the text in bounded
+ * 											chunks so that edits at widely
+ * 											separated positions of a large
+ * 											document stay fast.
+ * @GTK_SCINTILLA_DOCUMENT_OPTION_LINES_TREE:	Store the line starts in a
+ * 											balanced tree so that adding and
+ * 											removing lines at widely
+ * 											separated lines stays fast.
+ * @GTK_SCINTILLA_DOCUMENT_OPTION_LOG:	A log that is appended to and has
+ * 											its oldest lines removed, which
+ * 											implies the chunked text and
+ * 											line tree options and starts without
+ * 											undo.  See gtk_scintilla_new_log().
+ *
+ * Options chosen when a document is created with
+ * gtk_scintilla_create_document_full().
+ */
+typedef enum {
+	GTK_SCINTILLA_DOCUMENT_OPTION_DEFAULT=0,
+	GTK_SCINTILLA_DOCUMENT_OPTION_TEXT_CHUNKED=0x200,
+	GTK_SCINTILLA_DOCUMENT_OPTION_LINES_TREE=0x400,
+	GTK_SCINTILLA_DOCUMENT_OPTION_LOG=0x800
+} GtkScintillaDocumentOption;
+
 /**
  * GtkScintillaLexers:
  * @GTK_SCINTILLA_LEXER_CONTAINER:	Specifies that you would like to perform
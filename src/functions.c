@@ -1,14 +1,14 @@
 #include <gtk/gtk.h>
 #include "gtkscintilla.h"
 
-gint gtk_scintilla_get_length (GtkScintilla *sci) {
-	return (gint)scintilla_send_message(SCINTILLA(sci), 2006, 0, 0);
+GtkScintillaPosition gtk_scintilla_get_length (GtkScintilla *sci) {
+	return (GtkScintillaPosition)scintilla_send_message(SCINTILLA(sci), 2006, 0, 0);
 }
-gint gtk_scintilla_get_current_pos (GtkScintilla *sci) {
-	return (gint)scintilla_send_message(SCINTILLA(sci), 2008, 0, 0);
+GtkScintillaPosition gtk_scintilla_get_current_pos (GtkScintilla *sci) {
+	return (GtkScintillaPosition)scintilla_send_message(SCINTILLA(sci), 2008, 0, 0);
 }
-gint gtk_scintilla_get_anchor (GtkScintilla *sci) {
-	return (gint)scintilla_send_message(SCINTILLA(sci), 2009, 0, 0);
+GtkScintillaPosition gtk_scintilla_get_anchor (GtkScintilla *sci) {
+	return (GtkScintillaPosition)scintilla_send_message(SCINTILLA(sci), 2009, 0, 0);
 }
 void gtk_scintilla_redo (GtkScintilla *sci) {
 	scintilla_send_message(SCINTILLA(sci), 2011, 0, 0);
@@ -1556,3 +1556,33 @@ GtkScintillaCaseSensitiveBehaviour gtk_scintilla_get_case_sensitive_behaviour (G
 {
   return (GtkScintillaCaseSensitiveBehaviour) scintilla_send_message(SCINTILLA(sci), 2635, 0, 0);
 }
+
+gint gtk_scintilla_create_document_full (GtkScintilla *sci, GtkScintillaPosition bytes, GtkScintillaDocumentOption options)
+{
+  return (gint)scintilla_send_message(SCINTILLA(sci), 2375, (uptr_t)bytes, (sptr_t)options);
+}
+
+GtkScintillaDocumentOption gtk_scintilla_get_document_options (GtkScintilla *sci)
+{
+  return (GtkScintillaDocumentOption) scintilla_send_message(SCINTILLA(sci), 2379, 0, 0);
+}
+
+void gtk_scintilla_set_undo_memory_limit (GtkScintilla *sci, GtkScintillaPosition bytes)
+{
+  scintilla_send_message(SCINTILLA(sci), 2644, (uptr_t)bytes, 0);
+}
+
+GtkScintillaPosition gtk_scintilla_get_undo_memory_limit (GtkScintilla *sci)
+{
+  return (GtkScintillaPosition) scintilla_send_message(SCINTILLA(sci), 2645, 0, 0);
+}
+
+GtkScintillaPosition gtk_scintilla_get_undo_memory (GtkScintilla *sci)
+{
+  return (GtkScintillaPosition) scintilla_send_message(SCINTILLA(sci), 2646, 0, 0);
+}
+
+gint gtk_scintilla_get_undo_actions (GtkScintilla *sci)
+{
+  return (gint) scintilla_send_message(SCINTILLA(sci), 2647, 0, 0);
+}
@@ -0,0 +1,33 @@
+/*
+ * gtkscintilla-private.h
+ *
+ * Copyright 2011 Matthew Brush <mbrush@codebrainz.ca>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef GTK_SCINTILLA_PRIVATE_H
+#define GTK_SCINTILLA_PRIVATE_H
+
+#include "gtkscintilla.h"
+
+/* Keeps the document read-only until each hold is released, remembering
+ * what the application sets meanwhile */
+void _gtk_scintilla_hold_read_only(GtkScintilla *sci);
+void _gtk_scintilla_release_read_only(GtkScintilla *sci);
+gboolean *_gtk_scintilla_held_read_only(GtkScintilla *sci);
+
+#endif /* #ifndef GTK_SCINTILLA_PRIVATE_H */
@@ -1,5 +1,7 @@
 #include <gtk/gtk.h>
 
+#include <string.h>
+
 #include <Scintilla.h>
 #include <ScintillaWidget.h>
 
@@ -7,6 +9,7 @@
 #include "properties.h"
 #include "style-properties.h"
 #include "signals.h"
+#include "gtkscintilla-private.h"
 
 static void on_sci_notify(GtkWidget *w, gint param, gpointer notif, gpointer data);
 void pass_throug_key(GtkScintilla *sci, gint ch, gint modifiers);
@@ -15,6 +18,8 @@ static void gtk_scintilla_finalize(GObject *object);
 static void gtk_scintilla_class_init(GtkScintillaClass *klass);
 static void gtk_scintilla_init(GtkScintilla *self);
 
+static void drain_appends(GtkScintilla *self);
+
 static gpointer parent_class;
 
 
@@ -26,6 +31,16 @@ struct _GtkScintillaPrivate
 	gint fold_margin_index;
 	gint fold_margin_width;
 	gchar *font;
+
+	/* Text queued by gtk_scintilla_queue_append, guarded by append_lock */
+	GMutex append_lock;
+	GString *append_queue;
+	GString *append_spare;
+	gboolean append_pending;
+
+	/* Saves keeping the document read-only and what the application wants */
+	guint read_only_holds;
+	gboolean read_only_wanted;
 };
 
 
@@ -64,6 +79,10 @@ static void gtk_scintilla_finalize(GObject *object)
 	if (self->priv->font != NULL)
 		g_free(self->priv->font);
 
+	g_string_free(self->priv->append_queue, TRUE);
+	g_string_free(self->priv->append_spare, TRUE);
+	g_mutex_clear(&self->priv->append_lock);
+
 	G_OBJECT_CLASS(gtk_scintilla_parent_class)->finalize(object);
 }
 
@@ -81,6 +100,14 @@ static void gtk_scintilla_init(GtkScintilla *self)
 	self->priv->fold_margin_index = GTK_SCINTILLA_FOLD_MARGIN_INDEX_DEFAULT;
 	self->priv->fold_margin_width = GTK_SCINTILLA_FOLD_MARGIN_WIDTH_DEFAULT;
 
+	g_mutex_init(&self->priv->append_lock);
+	self->priv->append_queue = g_string_new(NULL);
+	self->priv->append_spare = g_string_new(NULL);
+	self->priv->append_pending = FALSE;
+
+	self->priv->read_only_holds = 0;
+	self->priv->read_only_wanted = FALSE;
+
 	/* connect internal signals */
 	g_signal_connect(self, "sci-notify", G_CALLBACK(on_sci_notify), NULL);
 
@@ -145,7 +172,8 @@ void gtk_scintilla_update_line_numbers(GtkScintilla *self)
 		gchar tmp_str[15];
 		gint len, width;
 
-		len = SSM(sci, SCI_GETLINECOUNT, 0, 0);
+		/* a trimmed log numbers its lines from the first line ever appended */
+		len = SSM(sci, SCI_GETLINECOUNT, 0, 0) + SSM(sci, SCI_GETLOGLINESTRIMMED, 0, 0);
 		g_snprintf(tmp_str, 15, "_%d", len);
 		width = SSM(sci, SCI_TEXTWIDTH, STYLE_LINENUMBER, (sptr_t)tmp_str);
 		SSM(sci, SCI_SETMARGINWIDTHN, 0, width);
@@ -345,6 +373,186 @@ const gchar* gtk_scintilla_get_font (GtkScintilla *self)
 }
 
 
+/* Called by saves that read the text in place, so that edits can not move
+ * the gap and copy the text while it is being written. */
+void _gtk_scintilla_hold_read_only(GtkScintilla *sci)
+{
+	if (sci->priv->read_only_holds++ == 0)
+	{
+		sci->priv->read_only_wanted = SSM(sci, SCI_GETREADONLY, 0, 0);
+		SSM(sci, SCI_SETREADONLY, TRUE, 0);
+	}
+}
+
+void _gtk_scintilla_release_read_only(GtkScintilla *sci)
+{
+	g_return_if_fail(sci->priv->read_only_holds > 0);
+
+	if (--sci->priv->read_only_holds == 0)
+	{
+		SSM(sci, SCI_SETREADONLY, sci->priv->read_only_wanted, 0);
+		/* append what was queued while held */
+		drain_appends(sci);
+	}
+}
+
+/* Where to keep the read-only flag of the application while held, or NULL */
+gboolean *_gtk_scintilla_held_read_only(GtkScintilla *sci)
+{
+	return (sci->priv->read_only_holds > 0) ? &sci->priv->read_only_wanted : NULL;
+}
+
+
+/* Drained text larger than this is not kept around for the next batch */
+#define APPEND_SPARE_KEEP (64 * 1024)
+/* Drain interval when there is no frame clock to follow */
+#define APPEND_INTERVAL 16
+
+/* Insert everything queued as one append so the document sends one
+ * modification notification and the view repaints once. */
+static void drain_appends(GtkScintilla *self)
+{
+	GString *batch;
+	gboolean read_only, follow;
+	glong lines, last_visible;
+
+	/* Appending would copy the text a save is reading in place, so the
+	 * queue waits, still pending, until the save releases the document */
+	if (self->priv->read_only_holds > 0)
+		return;
+
+	g_mutex_lock(&self->priv->append_lock);
+	batch = self->priv->append_queue;
+	self->priv->append_queue = self->priv->append_spare;
+	self->priv->append_spare = batch;
+	self->priv->append_pending = FALSE;
+	g_mutex_unlock(&self->priv->append_lock);
+
+	if (batch->len == 0)
+		return;
+
+	/* Only follow the end when the last line is already being shown */
+	lines = SSM(self, SCI_GETLINECOUNT, 0, 0);
+	last_visible = SSM(self, SCI_GETFIRSTVISIBLELINE, 0, 0) +
+		SSM(self, SCI_LINESONSCREEN, 0, 0);
+	follow = last_visible > SSM(self, SCI_VISIBLEFROMDOCLINE, lines - 1, 0);
+
+	/* Saves write from a snapshot, so appending or trimming a chunked log
+	 * while one is in progress does not change the file, and read-only is
+	 * only set here by the application */
+	read_only = SSM(self, SCI_GETREADONLY, 0, 0);
+	if (read_only)
+		SSM(self, SCI_SETREADONLY, FALSE, 0);
+	SSM(self, SCI_APPENDTEXT, batch->len, (sptr_t)batch->str);
+	if (read_only)
+		SSM(self, SCI_SETREADONLY, TRUE, 0);
+
+	if (follow)
+		SSM(self, SCI_SCROLLTOEND, 0, 0);
+
+	/* The spare is only touched by the main thread so can be trimmed unlocked */
+	if (batch->allocated_len > APPEND_SPARE_KEEP)
+	{
+		g_string_free(batch, TRUE);
+		batch = g_string_sized_new(APPEND_SPARE_KEEP / 4);
+	}
+	else
+	{
+		g_string_truncate(batch, 0);
+	}
+	g_mutex_lock(&self->priv->append_lock);
+	self->priv->append_spare = batch;
+	g_mutex_unlock(&self->priv->append_lock);
+}
+
+static gboolean append_timeout(gpointer user_data)
+{
+	drain_appends(GTK_SCINTILLA(user_data));
+	return G_SOURCE_REMOVE;
+}
+
+#if GTK_CHECK_VERSION(3,8,0)
+static gboolean append_tick(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+	drain_appends(GTK_SCINTILLA(widget));
+	return G_SOURCE_REMOVE;
+}
+#endif
+
+/* Runs on the main thread after the first append of a batch to wait for
+ * the next frame, so that everything appended meanwhile goes in together. */
+static gboolean append_schedule(gpointer user_data)
+{
+	GtkWidget *widget = GTK_WIDGET(user_data);
+
+#if GTK_CHECK_VERSION(3,8,0)
+	if (gtk_widget_get_mapped(widget))
+	{
+		gtk_widget_add_tick_callback(widget, append_tick, NULL, NULL);
+		return G_SOURCE_REMOVE;
+	}
+#endif
+	g_timeout_add_full(G_PRIORITY_DEFAULT_IDLE, APPEND_INTERVAL, append_timeout,
+		g_object_ref(widget), g_object_unref);
+	return G_SOURCE_REMOVE;
+}
+
+
+/**
+ * gtk_scintilla_queue_append:
+ * @param sci		The #GtkScintilla to append to.
+ * @param text		The text to append.
+ * @param length	The length of @text in bytes, or -1 if it is nul-terminated.
+ *
+ * Queues @text to be added at the end of the document. Unlike other
+ * functions this may be called from any thread, as long as the caller holds
+ * a reference to @sci. Text queued before the next frame is drawn is
+ * appended together, with a single modification notification, and the view
+ * is scrolled to the end if it was showing the last line. Queued text is
+ * appended even when the document is read-only.  While gtk_scintilla_save_async()
+ * keeps a document that is not chunked read-only, queued text waits until
+ * the save ends.
+ */
+void gtk_scintilla_queue_append (GtkScintilla *sci, const gchar *text, gssize length)
+{
+	gboolean schedule;
+
+	g_return_if_fail(GTK_IS_SCINTILLA(sci));
+	g_return_if_fail(text != NULL);
+
+	if (length < 0)
+		length = strlen(text);
+	if (length == 0)
+		return;
+
+	g_mutex_lock(&sci->priv->append_lock);
+	g_string_append_len(sci->priv->append_queue, text, length);
+	schedule = !sci->priv->append_pending;
+	sci->priv->append_pending = TRUE;
+	g_mutex_unlock(&sci->priv->append_lock);
+
+	if (schedule)
+		g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, append_schedule,
+			g_object_ref(sci), g_object_unref);
+}
+
+
+/**
+ * gtk_scintilla_flush_appends:
+ * @param sci	The #GtkScintilla to operate on.
+ *
+ * Appends any text queued with gtk_scintilla_queue_append() now instead of
+ * at the next frame, unless a save is keeping the document read-only when
+ * the text is appended as the save ends. Must be called from the main thread.
+ */
+void gtk_scintilla_flush_appends (GtkScintilla *sci)
+{
+	g_return_if_fail(GTK_IS_SCINTILLA(sci));
+
+	drain_appends(sci);
+}
+
+
 /* To re-emit notifications as separate signals */
 static void on_sci_notify(GtkWidget *widget, gint param, gpointer notif, gpointer user_data)
 {
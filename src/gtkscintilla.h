@@ -76,6 +76,81 @@ G_BEGIN_DECLS
 /* should be done in Scintilla code */
 #define SCINTILLA_TYPE_OBJECT			(scintilla_get_type())
 
+/**
+ * GtkScintillaPosition:
+ *
+ * A position or length within a #GtkScintilla document.  This is a #gint
+ * unless GtkScintilla was configured with <literal>--enable-large-documents</literal>,
+ * in which case it is a #gssize so documents larger than 2GB can be held.
+ *
+ * The Scintilla messages and the editor still use 32 bit positions, so even
+ * with large documents, positions beyond 2GB can not yet be reached through
+ * the functions that take or return a #GtkScintillaPosition, nor through the
+ * #GtkScintilla:length, #GtkScintilla:current-pos and #GtkScintilla:anchor
+ * properties, which are #gint.
+ */
+#ifdef SCI_LARGE_DOCUMENTS
+typedef gssize GtkScintillaPosition;
+#else
+typedef gint GtkScintillaPosition;
+#endif
+
+/**
+ * GtkScintillaTextSegmentFunc:
+ * @text:		The text of the segment, which is not zero-terminated.
+ * @length:		The number of bytes in @text.
+ * @user_data:	The data passed to gtk_scintilla_foreach_text_segment().
+ *
+ * The type of function called for each segment of text by
+ * gtk_scintilla_foreach_text_segment().
+ *
+ * Returns:	%TRUE to continue with the next segment or %FALSE to stop.
+ */
+typedef gboolean (*GtkScintillaTextSegmentFunc) (const gchar *text, GtkScintillaPosition length, gpointer user_data);
+
+/**
+ * GtkScintillaSnapshot:
+ *
+ * An opaque, reference counted copy of the text and styles of a #GtkScintilla
+ * document at one moment, created by gtk_scintilla_create_snapshot().  It is
+ * not changed by later edits so it may be read, referenced and unreferenced
+ * from any thread.
+ */
+typedef struct _GtkScintillaSnapshot	GtkScintillaSnapshot;
+
+/**
+ * GtkScintillaMemoryUsage:
+ * @text:			Bytes allocated for the text, not counting a mapped file.
+ * @text_unused:	Bytes of @text not holding characters, such as the gap.
+ * @styles:			Bytes allocated for the styles of the text.
+ * @line_index:		Bytes allocated for the starts of the lines.
+ * @per_line:		Bytes allocated for markers, fold levels, line states, margin
+ * 					text and annotations.
+ * @undo:			Bytes allocated for the undo history.
+ * @decorations:	Bytes allocated for indicators.
+ * @layout_cache:	Bytes allocated for the layouts of lines cached by the widget.
+ * @position_cache:	Bytes allocated for the widths of text cached by the widget.
+ *
+ * The memory used by a #GtkScintilla and its document, filled in by
+ * gtk_scintilla_get_memory_usage().
+ */
+typedef struct _GtkScintillaMemoryUsage	GtkScintillaMemoryUsage;
+
+struct _GtkScintillaMemoryUsage
+{
+	gsize text;
+	gsize text_unused;
+	gsize styles;
+	gsize line_index;
+	gsize per_line;
+	gsize undo;
+	gsize decorations;
+	gsize layout_cache;
+	gsize position_cache;
+};
+
+#define GTK_TYPE_SCINTILLA_SNAPSHOT		(gtk_scintilla_snapshot_get_type())
+
 typedef struct _GtkScintilla			GtkScintilla;
 typedef struct _GtkScintillaClass		GtkScintillaClass;
 typedef struct _GtkScintillaPrivate		GtkScintillaPrivate;
@@ -154,21 +229,21 @@ void 				gtk_scintilla_set_style   				(GtkScintilla *self, gint style_number, c
 
 /* Scintilla Wrapper Function Prototypes */
 /* These functions are defined in functions.c */
-void 		gtk_scintilla_add_text (GtkScintilla *sci, guint length, const gchar *text);
-void 		gtk_scintilla_add_styled_text (GtkScintilla *sci, guint length, const gchar *styled_text);
-void 		gtk_scintilla_insert_text (GtkScintilla *sci, gint pos, const gchar *text);
+void 		gtk_scintilla_add_text (GtkScintilla *sci, GtkScintillaPosition length, const gchar *text);
+void 		gtk_scintilla_add_styled_text (GtkScintilla *sci, GtkScintillaPosition length, const gchar *styled_text);
+void 		gtk_scintilla_insert_text (GtkScintilla *sci, GtkScintillaPosition pos, const gchar *text);
 void 		gtk_scintilla_clear_all (GtkScintilla *sci);
 void 		gtk_scintilla_clear_document_style (GtkScintilla *sci);
-gint 		gtk_scintilla_get_length (GtkScintilla *sci);
-gchar 		gtk_scintilla_get_char_at (GtkScintilla *sci, guint pos);
-gint 		gtk_scintilla_get_current_pos (GtkScintilla *sci);
-gint 		gtk_scintilla_get_anchor (GtkScintilla *sci);
-gchar 		gtk_scintilla_get_style_at (GtkScintilla *sci, guint pos);
+GtkScintillaPosition gtk_scintilla_get_length (GtkScintilla *sci);
+gchar 		gtk_scintilla_get_char_at (GtkScintilla *sci, GtkScintillaPosition pos);
+GtkScintillaPosition gtk_scintilla_get_current_pos (GtkScintilla *sci);
+GtkScintillaPosition gtk_scintilla_get_anchor (GtkScintilla *sci);
+gchar 		gtk_scintilla_get_style_at (GtkScintilla *sci, GtkScintillaPosition pos);
 void 		gtk_scintilla_redo (GtkScintilla *sci);
 void 		gtk_scintilla_set_undo_collection (GtkScintilla *sci, gboolean collectUndo);
 void 		gtk_scintilla_select_all (GtkScintilla *sci);
 void 		gtk_scintilla_set_save_point (GtkScintilla *sci);
-gchar*		gtk_scintilla_get_styled_text_range (GtkScintilla *sci, guint start_pos, guint end_pos);
+gchar*		gtk_scintilla_get_styled_text_range (GtkScintilla *sci, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos);
 gboolean	gtk_scintilla_can_redo (GtkScintilla *sci);
 gint 		gtk_scintilla_marker_line_from_handle (GtkScintilla *sci, gint handle);
 void 		gtk_scintilla_marker_delete_handle (GtkScintilla *sci, gint handle);
@@ -322,7 +397,7 @@ gint 		gtk_scintilla_get_margin_right (GtkScintilla *sci);
 gboolean 	gtk_scintilla_get_modify (GtkScintilla *sci);
 void		gtk_scintilla_set_sel (GtkScintilla *sci, gint start, gint end);
 gint 		gtk_scintilla_get_sel_text (GtkScintilla *sci, gchar *text);
-gchar*		gtk_scintilla_get_text_range (GtkScintilla *sci, guint start_pos, gint end_pos);
+gchar*		gtk_scintilla_get_text_range (GtkScintilla *sci, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos);
 void		gtk_scintilla_hide_selection (GtkScintilla *sci, gboolean normal);
 gint 		gtk_scintilla_point_x_from_position (GtkScintilla *sci, gint pos);
 gint 		gtk_scintilla_point_y_from_position (GtkScintilla *sci, gint pos);
@@ -414,7 +489,7 @@ gboolean	gtk_scintilla_get_end_at_last_line (GtkScintilla *sci);
 gint		gtk_scintilla_text_height (GtkScintilla *sci, gint line);
 void		gtk_scintilla_set_vscrollbar (GtkScintilla *sci, gboolean show);
 gboolean	gtk_scintilla_get_vscrollbar (GtkScintilla *sci);
-void		gtk_scintilla_append_text (GtkScintilla *sci, guint length, const gchar *text);
+void		gtk_scintilla_append_text (GtkScintilla *sci, GtkScintillaPosition length, const gchar *text);
 gboolean	gtk_scintilla_get_two_phase_draw (GtkScintilla *sci);
 void		gtk_scintilla_set_two_phase_draw (GtkScintilla *sci, gboolean twoPhase);
 void		gtk_scintilla_set_font_quality (GtkScintilla *sci, gint fontQuality);
@@ -580,7 +655,7 @@ void		gtk_scintilla_set_whitespace_chars (GtkScintilla *sci, const gchar *charac
 void		gtk_scintilla_set_chars_default (GtkScintilla *sci);
 gint		gtk_scintilla_auto_completion_get_current (GtkScintilla *sci);
 gint		gtk_scintilla_auto_completion_get_current_text (GtkScintilla *sci, gchar *s);
-void		gtk_scintilla_allocate (GtkScintilla *sci, guint bytes);
+void		gtk_scintilla_allocate (GtkScintilla *sci, GtkScintillaPosition bytes);
 gchar*		gtk_scintilla_target_as_utf8 (GtkScintilla *sci);
 /*void 		gtk_scintilla_set_length_for_encode (GtkScintilla *sci, gint bytes);*/
 gchar*		gtk_scintilla_encoded_from_utf8 (GtkScintilla *sci, const gchar *utf8, gint bytes);
@@ -703,6 +778,49 @@ gint		gtk_scintilla_get_style_bits_needed (GtkScintilla *sci);
 gchar*		gtk_scintilla_get_lexer_language (GtkScintilla *sci);
 void		gtk_scintilla_set_case_sensitive_behaviour (GtkScintilla *sci, GtkScintillaCaseSensitiveBehaviour behaviour);
 GtkScintillaCaseSensitiveBehaviour gtk_scintilla_get_case_sensitive_behaviour (GtkScintilla *sci);
+gint		gtk_scintilla_create_document_full (GtkScintilla *sci, GtkScintillaPosition bytes, GtkScintillaDocumentOption options);
+GtkScintillaDocumentOption gtk_scintilla_get_document_options (GtkScintilla *sci);
+gboolean	gtk_scintilla_load_mapped_file (GtkScintilla *sci, const gchar *filename, GError **error);
+void		gtk_scintilla_load_async (GtkScintilla *sci, GInputStream *stream, GtkScintillaDocumentOption options, const gchar *charset, GCancellable *cancellable, GFileProgressCallback progress_callback, gpointer progress_data, GAsyncReadyCallback callback, gpointer user_data);
+gboolean	gtk_scintilla_load_finish (GtkScintilla *sci, GAsyncResult *result, GError **error);
+void		gtk_scintilla_save_async (GtkScintilla *sci, GOutputStream *stream, gint eol_mode, const gchar *charset, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean	gtk_scintilla_save_finish (GtkScintilla *sci, GAsyncResult *result, GError **error);
+void		gtk_scintilla_set_undo_memory_limit (GtkScintilla *sci, GtkScintillaPosition bytes);
+GtkScintillaPosition gtk_scintilla_get_undo_memory_limit (GtkScintilla *sci);
+GtkScintillaPosition gtk_scintilla_get_undo_memory (GtkScintilla *sci);
+gint		gtk_scintilla_get_undo_actions (GtkScintilla *sci);
+gint		gtk_scintilla_replace_ranges (GtkScintilla *sci, gint count, const struct Sci_Replacement *replacements);
+gint		gtk_scintilla_get_document_version (GtkScintilla *sci);
+const gchar* gtk_scintilla_get_text_segment (GtkScintilla *sci, GtkScintillaPosition pos, GtkScintillaPosition *length);
+gboolean	gtk_scintilla_foreach_text_segment (GtkScintilla *sci, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos, GtkScintillaTextSegmentFunc func, gpointer user_data);
+GType		gtk_scintilla_snapshot_get_type (void);
+GtkScintillaSnapshot* gtk_scintilla_create_snapshot (GtkScintilla *sci);
+GtkScintillaSnapshot* gtk_scintilla_snapshot_ref (GtkScintillaSnapshot *snapshot);
+void		gtk_scintilla_snapshot_unref (GtkScintillaSnapshot *snapshot);
+gint		gtk_scintilla_snapshot_get_version (GtkScintillaSnapshot *snapshot);
+GtkScintillaPosition gtk_scintilla_snapshot_get_length (GtkScintillaSnapshot *snapshot);
+gchar		gtk_scintilla_snapshot_get_char_at (GtkScintillaSnapshot *snapshot, GtkScintillaPosition pos);
+gchar		gtk_scintilla_snapshot_get_style_at (GtkScintillaSnapshot *snapshot, GtkScintillaPosition pos);
+gchar*		gtk_scintilla_snapshot_get_text_range (GtkScintillaSnapshot *snapshot, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos);
+guchar*		gtk_scintilla_snapshot_get_style_range (GtkScintillaSnapshot *snapshot, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos);
+const gchar* gtk_scintilla_snapshot_get_text_segment (GtkScintillaSnapshot *snapshot, GtkScintillaPosition pos, GtkScintillaPosition *length);
+void		gtk_scintilla_marker_set_masks (GtkScintilla *sci, gint count, const struct Sci_MarkerMask *masks);
+void		gtk_scintilla_margin_set_texts (GtkScintilla *sci, gint count, const gint *lines, const gchar * const *texts);
+void		gtk_scintilla_annotation_set_texts (GtkScintilla *sci, gint count, const gint *lines, const gchar * const *texts);
+gsize		gtk_scintilla_get_memory_usage (GtkScintilla *sci, GtkScintillaMemoryUsage *usage);
+void		gtk_scintilla_hibernate (GtkScintilla *sci);
+void		gtk_scintilla_rehydrate (GtkScintilla *sci);
+gboolean	gtk_scintilla_is_hibernating (GtkScintilla *sci);
+void		gtk_scintilla_new_log (GtkScintilla *sci, gint lines);
+void		gtk_scintilla_set_log_line_limit (GtkScintilla *sci, gint lines);
+gint		gtk_scintilla_get_log_line_limit (GtkScintilla *sci);
+gint		gtk_scintilla_get_log_lines_trimmed (GtkScintilla *sci);
+void		gtk_scintilla_set_background_lexing (GtkScintilla *sci, gboolean background);
+gboolean	gtk_scintilla_get_background_lexing (GtkScintilla *sci);
+void		gtk_scintilla_set_idle_styling (GtkScintilla *sci, gboolean idle_styling);
+gboolean	gtk_scintilla_get_idle_styling (GtkScintilla *sci);
+void		gtk_scintilla_queue_append (GtkScintilla *sci, const gchar *text, gssize length);
+void		gtk_scintilla_flush_appends (GtkScintilla *sci);
 
 G_END_DECLS
 
@@ -23,6 +23,12 @@
 #include "gtkscintilla.h"
 #include "properties.h"
 
+#ifdef SCI_LARGE_DOCUMENTS
+#define GTK_SCINTILLA_POSITION_MAX G_MAXSSIZE
+#else
+#define GTK_SCINTILLA_POSITION_MAX G_MAXINT
+#endif
+
 void _gtk_scintilla_class_install_properties(GtkScintillaClass *klass)
 {
 	GParamSpec *pspec;
@@ -713,4 +719,11 @@ void _gtk_scintilla_class_install_properties(GtkScintillaClass *klass)
 			G_PARAM_READWRITE);
 	g_object_class_install_property(object_class, PROP_CASE_SENSITIVE_BEHAVIOUR, pspec);
 
+	pspec = g_param_spec_int64("undo-memory-limit",
+			"Undo memory limit",
+			"Gets/sets the bytes the undo history may use before its oldest actions are forgotten, 0 for no limit.",
+			0, GTK_SCINTILLA_POSITION_MAX, 0,
+			G_PARAM_READWRITE);
+	g_object_class_install_property(object_class, PROP_UNDO_MEMORY_LIMIT, pspec);
+
 }
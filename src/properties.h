@@ -140,6 +140,7 @@ enum
 	PROP_LEXER_LANGUAGE,
 	PROP_STYLE_BITS_NEEDED,
   PROP_CASE_SENSITIVE_BEHAVIOUR,
+	PROP_UNDO_MEMORY_LIMIT,
 	/* non-scintilla properties */
 	PROP_LINE_NUMBERS_VISIBLE,
 	PROP_FOLDING_ENABLED,
@@ -56,6 +56,7 @@
  */
 
 #include "gtkscintilla.h"
+#include "gtkscintilla-private.h"
 
 /* todo:	implement properties for
  * 				- text
@@ -95,12 +96,12 @@ void gtk_scintilla_set_text (GtkScintilla *sci, const gchar *text)
  */
 gchar *gtk_scintilla_get_text (GtkScintilla *sci)
 {
-	gint len;
+	GtkScintillaPosition len;
 	gchar *tmp;
 
 	g_return_val_if_fail(sci != NULL, NULL);
 
-	len = gtk_scintilla_get_length(sci);
+	len = (GtkScintillaPosition)SSM(SCINTILLA(sci), SCI_GETLENGTH, 0, 0);
 	tmp = g_malloc0(len+1); /* NULL ok */
 	len = SSM(SCINTILLA(sci), SCI_GETTEXT, (uptr_t)(len+1), (sptr_t)tmp);
 
@@ -146,12 +147,12 @@ void gtk_scintilla_set_save_point (GtkScintilla *sci)
  */
 gchar *gtk_scintilla_get_line (GtkScintilla *sci, guint line)
 {
-	guint len;
+	GtkScintillaPosition len;
 	gchar *tmp;
 
 	g_return_val_if_fail(sci != NULL, NULL);
 
-	len = gtk_scintilla_line_length(sci, line);
+	len = (GtkScintillaPosition)SSM(SCINTILLA(sci), SCI_LINELENGTH, (uptr_t)line, 0);
 	tmp = g_malloc0(len+1); /* NULL ok */
 
 	len = SSM(SCINTILLA(sci), SCI_GETLINE, (uptr_t)line, (sptr_t)tmp);
@@ -190,27 +191,41 @@ void gtk_scintilla_replace_selection (GtkScintilla *sci, const gchar *text)
  *
  * Sets the read-only flag for the document.  If you mark a document as
  * read-only, attempts to modify the text cause the
- * #GtkScintilla::modify-attempt-ro signal to be emitted.
+ * #GtkScintilla::modify-attempt-ro signal to be emitted.  While
+ * gtk_scintilla_save_async() keeps the document read-only, the flag takes
+ * effect when the save ends.
  */
 void gtk_scintilla_set_read_only (GtkScintilla *sci, gboolean read_only)
 {
+	gboolean *held;
+
 	g_return_if_fail(sci != NULL);
 
-	SSM(SCINTILLA(sci), SCI_SETREADONLY, (uptr_t)read_only, 0);
+	held = _gtk_scintilla_held_read_only(sci);
+	if (held != NULL)
+		*held = read_only;
+	else
+		SSM(SCINTILLA(sci), SCI_SETREADONLY, (uptr_t)read_only, 0);
 }
 
 /**
  * gtk_scintilla_get_read_only:
  * @sci: The #GtkScintilla object.
  *
- * Gets the read-only flag for the document.
+ * Gets the read-only flag for the document, as last set by the application
+ * even while a save keeps the document read-only.
  *
  * Returns: TRUE if the document is read-only, FALSE if it is not.
  */
 gboolean gtk_scintilla_get_read_only (GtkScintilla *sci)
 {
+	gboolean *held;
+
 	g_return_val_if_fail(sci != NULL, FALSE);
 
+	held = _gtk_scintilla_held_read_only(sci);
+	if (held != NULL)
+		return *held;
 	return (gboolean)SSM(SCINTILLA(sci), SCI_GETREADONLY, 0, 0);
 }
 
@@ -227,16 +242,17 @@ gboolean gtk_scintilla_get_read_only (GtkScintilla *sci)
  * 			end position or NULL if the the text could not be retrieved or was
  * 			empty.  Free with g_free().
  */
-gchar *gtk_scintilla_get_text_range (GtkScintilla *sci, guint start_pos, gint end_pos)
+gchar *gtk_scintilla_get_text_range (GtkScintilla *sci, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos)
 {
 	gchar *tmp;
 	glong last_pos, start, num_bytes, num_chars;
 	struct Sci_TextRange tr;
 
 	g_return_val_if_fail(sci != NULL, NULL);
+	g_return_val_if_fail(start_pos >= 0, NULL);
 
 	start = (glong) start_pos;
-	last_pos = (glong) gtk_scintilla_get_length(sci) - 1;
+	last_pos = (glong) SSM(SCINTILLA(sci), SCI_GETLENGTH, 0, 0) - 1;
 
 	g_return_val_if_fail(end_pos == -1 || start <= end_pos, NULL);
 	g_return_val_if_fail(start <= last_pos, NULL);
@@ -280,16 +296,17 @@ gchar *gtk_scintilla_get_text_range (GtkScintilla *sci, guint start_pos, gint en
  * 			@start_pos and @end_pos or NULL if the text could not be retrieved
  * 			or was empty.  Free with g_free().
  */
-gchar *gtk_scintilla_get_styled_text_range (GtkScintilla *sci, guint start_pos, guint end_pos)
+gchar *gtk_scintilla_get_styled_text_range (GtkScintilla *sci, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos)
 {
 	gchar *tmp;
-	guint last_pos, num_bytes, num_chars;
+	glong last_pos, num_bytes, num_chars;
 	struct Sci_TextRange tr;
 
 	g_return_val_if_fail(sci != NULL, NULL);
 
-	last_pos = gtk_scintilla_get_length(sci) - 1;
+	last_pos = (glong) SSM(SCINTILLA(sci), SCI_GETLENGTH, 0, 0) - 1;
 
+	g_return_val_if_fail(start_pos >= 0, NULL);
 	g_return_val_if_fail(start_pos <= end_pos, NULL);
 	g_return_val_if_fail(end_pos <= last_pos, NULL);
 
@@ -325,9 +342,10 @@ gchar *gtk_scintilla_get_styled_text_range (GtkScintilla *sci, guint start_pos,
  * Allocates a document buffer large enough to store @bytes number of bytes.
  * The document will not be made smaller than its current contents.
  */
-void gtk_scintilla_allocate (GtkScintilla *sci, guint bytes)
+void gtk_scintilla_allocate (GtkScintilla *sci, GtkScintillaPosition bytes)
 {
 	g_return_if_fail(sci != NULL);
+	g_return_if_fail(bytes >= 0);
 
 	SSM(SCINTILLA(sci), SCI_ALLOCATE, (uptr_t)bytes, 0);
 }
@@ -343,9 +361,10 @@ void gtk_scintilla_allocate (GtkScintilla *sci, guint bytes)
  * to stop the insert operation.  The current position is set at the end of
  * the inserted text, but it is not scrolled into view.
  */
-void gtk_scintilla_add_text (GtkScintilla *sci, guint length, const gchar *text)
+void gtk_scintilla_add_text (GtkScintilla *sci, GtkScintillaPosition length, const gchar *text)
 {
 	g_return_if_fail(sci != NULL);
+	g_return_if_fail(length >= 0);
 
 	SSM(SCINTILLA(sci), SCI_ADDTEXT, (uptr_t)length, (sptr_t)text);
 }
@@ -363,9 +382,10 @@ void gtk_scintilla_add_text (GtkScintilla *sci, guint length, const gchar *text)
  * See also gtk_scintilla_get_styled_text_range() for a description of styled
  * text.
  */
-void gtk_scintilla_add_styled_text (GtkScintilla *sci, guint length, const gchar *styled_text)
+void gtk_scintilla_add_styled_text (GtkScintilla *sci, GtkScintillaPosition length, const gchar *styled_text)
 {
 	g_return_if_fail(sci != NULL);
+	g_return_if_fail(length >= 0);
 
 	SSM(SCINTILLA(sci), SCI_ADDSTYLEDTEXT, (uptr_t)length, (sptr_t)styled_text);
 }
@@ -381,9 +401,10 @@ void gtk_scintilla_add_styled_text (GtkScintilla *sci, guint length, const gchar
  * expected to stop the operation.  The current selection is not changed and
  * the new text is not scrolled into view.
  */
-void gtk_scintilla_append_text (GtkScintilla *sci, guint length, const gchar *text)
+void gtk_scintilla_append_text (GtkScintilla *sci, GtkScintillaPosition length, const gchar *text)
 {
 	g_return_if_fail(sci != NULL);
+	g_return_if_fail(length >= 0);
 
 	SSM(SCINTILLA(sci), SCI_APPENDTEXT, (uptr_t)length, (sptr_t)text);
 }
@@ -399,13 +420,659 @@ void gtk_scintilla_append_text (GtkScintilla *sci, guint length, const gchar *te
  * point then it is moved along with its surrounding text but no scrolling is
  * performed.
  */
-void gtk_scintilla_insert_text (GtkScintilla *sci, gint pos, const gchar *text)
+void gtk_scintilla_insert_text (GtkScintilla *sci, GtkScintillaPosition pos, const gchar *text)
 {
 	g_return_if_fail(sci != NULL);
 
 	SSM(SCINTILLA(sci), SCI_INSERTTEXT, (uptr_t)pos, (sptr_t)text);
 }
 
+/**
+ * gtk_scintilla_replace_ranges:
+ * @sci:			The #GtkScintilla object.
+ * @count:			The number of replacements in @replacements.
+ * @replacements:	The ranges to replace and their new text, sorted by position.
+ *
+ * Replaces each range in @replacements with its text in one pass through the
+ * document, such as for replacing every match of a search.  The ranges are
+ * positions before any of the replacements are made and must not overlap.  A
+ * replacement with a length of -1 uses all of its zero-terminated text.
+ *
+ * All the replacements are undone together and the #GtkScintilla::modified
+ * signal is emitted once, with the
+ * #GTK_SCINTILLA_MODIFICATION_FLAGS_REPLACE_RANGES flag, for the text from the
+ * start of the first replacement to the end of the last.
+ *
+ * Returns: The number of ranges replaced or -1 if they were not sorted, they
+ * 			overlapped or the document is read-only.
+ */
+gint gtk_scintilla_replace_ranges (GtkScintilla *sci, gint count, const struct Sci_Replacement *replacements)
+{
+	g_return_val_if_fail(sci != NULL, -1);
+	g_return_val_if_fail(count >= 0, -1);
+	g_return_val_if_fail(count == 0 || replacements != NULL, -1);
+
+	if (count == 0)
+		return 0;
+
+	return (gint)SSM(SCINTILLA(sci), SCI_REPLACERANGES, (uptr_t)count, (sptr_t)replacements);
+}
+
+/**
+ * gtk_scintilla_marker_set_masks:
+ * @sci:	The #GtkScintilla object.
+ * @count:	The number of lines in @masks.
+ * @masks:	The lines and the markers each should have, one bit per marker number.
+ *
+ * Sets the markers of many lines at once, such as when restoring bookmarks.
+ * Each line is left with exactly the markers in its mask: markers it already
+ * has keep their handles, others are deleted and missing ones are added.
+ * Lines outside the document are ignored.
+ *
+ * The #GtkScintilla::modified signal is emitted once, with the
+ * #GTK_SCINTILLA_MODIFICATION_FLAGS_CHANGE_MARKER flag and a line of -1, so the
+ * margin is only redrawn once.
+ */
+void gtk_scintilla_marker_set_masks (GtkScintilla *sci, gint count, const struct Sci_MarkerMask *masks)
+{
+	g_return_if_fail(sci != NULL);
+	g_return_if_fail(count >= 0);
+	g_return_if_fail(count == 0 || masks != NULL);
+
+	if (count == 0)
+		return;
+
+	SSM(SCINTILLA(sci), SCI_MARKERSETMASKS, (uptr_t)count, (sptr_t)masks);
+}
+
+static void set_line_texts (GtkScintilla *sci, guint message, gint count, const gint *lines, const gchar * const *texts)
+{
+	struct Sci_LineText *line_texts;
+	gint i;
+
+	line_texts = g_new(struct Sci_LineText, count);
+	for (i = 0; i < count; i++) {
+		line_texts[i].line = lines[i];
+		line_texts[i].text = texts[i];
+	}
+
+	SSM(SCINTILLA(sci), message, (uptr_t)count, (sptr_t)line_texts);
+	g_free(line_texts);
+}
+
+/**
+ * gtk_scintilla_margin_set_texts:
+ * @sci:	The #GtkScintilla object.
+ * @count:	The number of lines in @lines and texts in @texts.
+ * @lines:	The lines to set the margin text of.
+ * @texts:	The zero-terminated margin text for each of @lines or %NULL to clear it.
+ *
+ * Sets the text margin of many lines at once, such as for a blame margin.
+ * Lines outside the document are ignored.  The #GtkScintilla::modified signal is
+ * emitted once, with the #GTK_SCINTILLA_MODIFICATION_FLAGS_CHANGE_MARGIN flag
+ * and a line of -1, and the margin is only redrawn once.
+ */
+void gtk_scintilla_margin_set_texts (GtkScintilla *sci, gint count, const gint *lines, const gchar * const *texts)
+{
+	g_return_if_fail(sci != NULL);
+	g_return_if_fail(count >= 0);
+	g_return_if_fail(count == 0 || (lines != NULL && texts != NULL));
+
+	if (count == 0)
+		return;
+
+	set_line_texts(sci, SCI_MARGINSETTEXTS, count, lines, texts);
+}
+
+/**
+ * gtk_scintilla_annotation_set_texts:
+ * @sci:	The #GtkScintilla object.
+ * @count:	The number of lines in @lines and texts in @texts.
+ * @lines:	The lines to annotate.
+ * @texts:	The zero-terminated annotation for each of @lines or %NULL to clear it.
+ *
+ * Sets the annotations of many lines at once, such as for the diagnostics of a
+ * whole file.  Lines outside the document are ignored.  The
+ * #GtkScintilla::modified signal is emitted once, with the
+ * #GTK_SCINTILLA_MODIFICATION_FLAGS_CHANGE_ANNOTATION flag, a line of -1 and
+ * the total change in annotation lines, and the view is only redrawn once.
+ */
+void gtk_scintilla_annotation_set_texts (GtkScintilla *sci, gint count, const gint *lines, const gchar * const *texts)
+{
+	g_return_if_fail(sci != NULL);
+	g_return_if_fail(count >= 0);
+	g_return_if_fail(count == 0 || (lines != NULL && texts != NULL));
+
+	if (count == 0)
+		return;
+
+	set_line_texts(sci, SCI_ANNOTATIONSETTEXTS, count, lines, texts);
+}
+
+/**
+ * gtk_scintilla_get_memory_usage:
+ * @sci:	The #GtkScintilla object.
+ * @usage:	Location to store the memory used by each part, or %NULL.
+ *
+ * Finds how much memory the document of @sci, and the caches of @sci itself,
+ * use.  Memory that is viewed rather than allocated, such as a file loaded
+ * with gtk_scintilla_load_mapped_file(), is not counted.  Nothing is changed
+ * so this is cheap enough to call regularly, such as from a debugging panel.
+ *
+ * Returns: The total number of bytes used.
+ */
+gsize gtk_scintilla_get_memory_usage (GtkScintilla *sci, GtkScintillaMemoryUsage *usage)
+{
+	struct Sci_MemoryUsage sci_usage;
+	gsize total;
+
+	g_return_val_if_fail(sci != NULL, 0);
+
+	memset(&sci_usage, 0, sizeof(sci_usage));
+	total = (gsize)SSM(SCINTILLA(sci), SCI_GETMEMORYUSAGE, 0, (sptr_t)&sci_usage);
+
+	if (usage != NULL) {
+		usage->text = sci_usage.text;
+		usage->text_unused = sci_usage.textUnused;
+		usage->styles = sci_usage.styles;
+		usage->line_index = sci_usage.lineIndex;
+		usage->per_line = sci_usage.perLine;
+		usage->undo = sci_usage.undo;
+		usage->decorations = sci_usage.decorations;
+		usage->layout_cache = sci_usage.layoutCache;
+		usage->position_cache = sci_usage.positionCache;
+	}
+
+	return total;
+}
+
+/**
+ * gtk_scintilla_hibernate:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Releases as much memory as possible from the document of @sci, such as when
+ * it is in a background tab that has not been looked at for a while.  The text
+ * is compressed, the styles are discarded to be restyled later and the layout
+ * cache of @sci is freed.  Markers, folding, annotations, indicators and undo
+ * history are kept.  The document rehydrates by itself when it is next drawn,
+ * modified or read through @sci, while asking for its length, line count or
+ * modified state leaves it compressed.
+ */
+void gtk_scintilla_hibernate (GtkScintilla *sci)
+{
+	g_return_if_fail(sci != NULL);
+
+	SSM(SCINTILLA(sci), SCI_HIBERNATE, 0, 0);
+}
+
+/**
+ * gtk_scintilla_rehydrate:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Expands the text of a document hibernated with gtk_scintilla_hibernate()
+ * ahead of it being shown, such as when the pointer enters its tab.  Does
+ * nothing when the document is not hibernating.
+ */
+void gtk_scintilla_rehydrate (GtkScintilla *sci)
+{
+	g_return_if_fail(sci != NULL);
+
+	SSM(SCINTILLA(sci), SCI_REHYDRATE, 0, 0);
+}
+
+/**
+ * gtk_scintilla_is_hibernating:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Returns:	%TRUE if the document of @sci is hibernating.
+ */
+gboolean gtk_scintilla_is_hibernating (GtkScintilla *sci)
+{
+	g_return_val_if_fail(sci != NULL, FALSE);
+
+	return (gboolean)SSM(SCINTILLA(sci), SCI_ISHIBERNATING, 0, 0);
+}
+
+/**
+ * gtk_scintilla_new_log:
+ * @sci:	The #GtkScintilla object.
+ * @lines:	The number of lines to keep, or 0 to keep every line.
+ *
+ * Replaces the document with an empty document for a log or console that is
+ * appended to, such as with gtk_scintilla_append_text().  Undo is off and,
+ * once there are more than @lines lines, the oldest are deleted as text is
+ * added, which costs about the same however long the log is.  Line numbers
+ * shown in the margin keep counting from the first line ever added.
+ */
+void gtk_scintilla_new_log (GtkScintilla *sci, gint lines)
+{
+	sptr_t doc;
+
+	g_return_if_fail(sci != NULL);
+	g_return_if_fail(lines >= 0);
+
+	doc = SSM(SCINTILLA(sci), SCI_CREATEDOCUMENT, 0, SC_DOCUMENTOPTION_LOG);
+	SSM(SCINTILLA(sci), SCI_SETDOCPOINTER, 0, doc);
+	/* the widget holds its own reference now */
+	SSM(SCINTILLA(sci), SCI_RELEASEDOCUMENT, 0, doc);
+	SSM(SCINTILLA(sci), SCI_SETLOGLINELIMIT, lines, 0);
+}
+
+/**
+ * gtk_scintilla_set_log_line_limit:
+ * @sci:	The #GtkScintilla object.
+ * @lines:	The number of lines to keep, or 0 to keep every line.
+ *
+ * Keeps only the last @lines lines of the document, deleting the oldest ones
+ * without undo whenever text is inserted.  Works with any document but is
+ * only cheap for long documents made with gtk_scintilla_new_log().
+ */
+void gtk_scintilla_set_log_line_limit (GtkScintilla *sci, gint lines)
+{
+	g_return_if_fail(sci != NULL);
+	g_return_if_fail(lines >= 0);
+
+	SSM(SCINTILLA(sci), SCI_SETLOGLINELIMIT, lines, 0);
+}
+
+/**
+ * gtk_scintilla_get_log_line_limit:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Returns:	The number of lines kept, or 0 when every line is kept.
+ */
+gint gtk_scintilla_get_log_line_limit (GtkScintilla *sci)
+{
+	g_return_val_if_fail(sci != NULL, 0);
+
+	return (gint)SSM(SCINTILLA(sci), SCI_GETLOGLINELIMIT, 0, 0);
+}
+
+/**
+ * gtk_scintilla_get_log_lines_trimmed:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Gets how many lines the line limit has deleted from the start of the
+ * document.  Adding this to a line number gives the number shown in the
+ * margin.
+ *
+ * Returns:	The number of lines deleted.
+ */
+gint gtk_scintilla_get_log_lines_trimmed (GtkScintilla *sci)
+{
+	g_return_val_if_fail(sci != NULL, 0);
+
+	return (gint)SSM(SCINTILLA(sci), SCI_GETLOGLINESTRIMMED, 0, 0);
+}
+
+/**
+ * gtk_scintilla_set_background_lexing:
+ * @sci:		The #GtkScintilla object.
+ * @background:	Whether to lex on a worker thread.
+ *
+ * When @background is %TRUE only the visible text is lexed as it is shown,
+ * while the rest of the document is lexed on a worker thread and its styles
+ * and fold levels are merged in a piece at a time.  Opening a large file then
+ * does not stop the application responding while it is lexed.  The setting
+ * belongs to the document and stays off where threads are not available and
+ * for documents without #SC_DOCUMENTOPTION_TEXT_CHUNKED, whose text and
+ * styles would be copied by the first edit each time the worker starts.
+ */
+void gtk_scintilla_set_background_lexing (GtkScintilla *sci, gboolean background)
+{
+	g_return_if_fail(sci != NULL);
+
+	SSM(SCINTILLA(sci), SCI_SETBACKGROUNDLEXING, background, 0);
+}
+
+/**
+ * gtk_scintilla_get_background_lexing:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Returns:	%TRUE if the document is lexed on a worker thread.
+ */
+gboolean gtk_scintilla_get_background_lexing (GtkScintilla *sci)
+{
+	g_return_val_if_fail(sci != NULL, FALSE);
+
+	return SSM(SCINTILLA(sci), SCI_GETBACKGROUNDLEXING, 0, 0) != 0;
+}
+
+/**
+ * gtk_scintilla_set_idle_styling:
+ * @sci:		The #GtkScintilla object.
+ * @idle_styling:	Whether to style the rest of the document while idle.
+ *
+ * When @idle_styling is %TRUE the text after what is shown is styled and
+ * folded a few milliseconds at a time whenever the main loop is idle, so
+ * that going to the end of a large document or folding all of it later does
+ * not wait for it to be styled.  Nothing is done while the document is lexed
+ * in the background.  Use gtk_scintilla_get_end_styled() to follow progress.
+ */
+void gtk_scintilla_set_idle_styling (GtkScintilla *sci, gboolean idle_styling)
+{
+	g_return_if_fail(sci != NULL);
+
+	SSM(SCINTILLA(sci), SCI_SETIDLESTYLING, idle_styling, 0);
+}
+
+/**
+ * gtk_scintilla_get_idle_styling:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Returns:	%TRUE if the document is styled while idle.
+ */
+gboolean gtk_scintilla_get_idle_styling (GtkScintilla *sci)
+{
+	g_return_val_if_fail(sci != NULL, FALSE);
+
+	return SSM(SCINTILLA(sci), SCI_GETIDLESTYLING, 0, 0) != 0;
+}
+
+/**
+ * gtk_scintilla_get_document_version:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Gets a stamp that changes whenever the text of the document is modified or
+ * moved in memory.  Text returned by gtk_scintilla_get_text_segment() or
+ * passed to the function given to gtk_scintilla_foreach_text_segment() may
+ * only be read while the version stays the same.
+ *
+ * Returns:	The current version of the document text.
+ */
+gint gtk_scintilla_get_document_version (GtkScintilla *sci)
+{
+	g_return_val_if_fail(sci != NULL, 0);
+
+	return (gint)SSM(SCINTILLA(sci), SCI_GETDOCUMENTVERSION, 0, 0);
+}
+
+/**
+ * gtk_scintilla_get_text_segment:
+ * @sci:	The #GtkScintilla object.
+ * @pos:	The position of the first byte to retrieve.
+ * @length:	Return location for the number of bytes in the segment.
+ *
+ * Gets the text of the document that is contiguous in memory from @pos, up
+ * to the gap in the buffer, the end of a chunk or the end of the document.
+ * Nothing is copied and, unlike #SCI_GETCHARACTERPOINTER, the buffer is not
+ * rearranged, so reading a whole document segment by segment is cheap.
+ *
+ * The segment is borrowed from the document, so it is returned as a plain
+ * pointer rather than a #GBytes, which could be kept after the text it points
+ * to has changed.  Text that must stay readable after the document changes,
+ * or be read from another thread, can be read from a #GtkScintillaSnapshot
+ * with gtk_scintilla_snapshot_get_text_segment().
+ *
+ * Returns:	A pointer into the document, which is not zero-terminated and must
+ * 			not be modified or freed, or NULL if @pos is at or after the end
+ * 			of the document.  It becomes invalid when the value returned by
+ * 			gtk_scintilla_get_document_version() changes.
+ */
+const gchar *gtk_scintilla_get_text_segment (GtkScintilla *sci, GtkScintillaPosition pos, GtkScintillaPosition *length)
+{
+	struct Sci_TextSegment segment;
+
+	g_return_val_if_fail(sci != NULL, NULL);
+	g_return_val_if_fail(length != NULL, NULL);
+
+	segment.text = NULL;
+	segment.length = 0;
+	SSM(SCINTILLA(sci), SCI_GETTEXTSEGMENT, (uptr_t)pos, (sptr_t)&segment);
+	*length = (GtkScintillaPosition)segment.length;
+
+	return segment.text;
+}
+
+/**
+ * gtk_scintilla_foreach_text_segment:
+ * @sci:		The #GtkScintilla object.
+ * @start_pos:	The start position of the range.
+ * @end_pos:	The end position of the range or -1 for the end of the document.
+ * @func:		The function to call for each segment.
+ * @user_data:	Data to pass to @func.
+ *
+ * Calls @func with each segment of the text between @start_pos and @end_pos
+ * in order, without copying it.  The text passed to @func is only valid
+ * during the call and @func must not modify the document.
+ *
+ * Returns:	%TRUE if @func was called for the whole range or %FALSE if it
+ * 			stopped early.
+ */
+gboolean gtk_scintilla_foreach_text_segment (GtkScintilla *sci, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos, GtkScintillaTextSegmentFunc func, gpointer user_data)
+{
+	GtkScintillaPosition pos, len, doc_len;
+	const gchar *text;
+
+	g_return_val_if_fail(sci != NULL, FALSE);
+	g_return_val_if_fail(func != NULL, FALSE);
+	g_return_val_if_fail(start_pos >= 0, FALSE);
+
+	doc_len = (GtkScintillaPosition)SSM(SCINTILLA(sci), SCI_GETLENGTH, 0, 0);
+	if (end_pos == -1 || end_pos > doc_len)
+		end_pos = doc_len;
+
+	g_return_val_if_fail(start_pos <= end_pos, FALSE);
+
+	for (pos = start_pos; pos < end_pos; pos += len)
+	{
+		text = gtk_scintilla_get_text_segment(sci, pos, &len);
+		if (text == NULL || len <= 0)
+			return FALSE;
+		if (len > end_pos - pos)
+			len = end_pos - pos;
+		if (!func(text, len, user_data))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+G_DEFINE_BOXED_TYPE(GtkScintillaSnapshot, gtk_scintilla_snapshot, gtk_scintilla_snapshot_ref, gtk_scintilla_snapshot_unref)
+
+/**
+ * gtk_scintilla_create_snapshot:
+ * @sci:	The #GtkScintilla object.
+ *
+ * Takes a snapshot of the text and styles of the document, for reading in a
+ * worker thread while editing continues.  The document is not copied: a
+ * chunked document shares its chunks with the snapshot and copies a chunk
+ * when it is next modified, while other documents copy their text or styles
+ * when first modified while a snapshot still holds them.
+ *
+ * Returns:	A new #GtkScintillaSnapshot.  Free with
+ * 			gtk_scintilla_snapshot_unref().
+ */
+GtkScintillaSnapshot *gtk_scintilla_create_snapshot (GtkScintilla *sci)
+{
+	g_return_val_if_fail(sci != NULL, NULL);
+
+	return (GtkScintillaSnapshot *)SSM(SCINTILLA(sci), SCI_CREATESNAPSHOT, 0, 0);
+}
+
+/**
+ * gtk_scintilla_snapshot_ref:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ *
+ * Adds a reference to @snapshot.  This may be called from any thread.
+ *
+ * Returns:	@snapshot.
+ */
+GtkScintillaSnapshot *gtk_scintilla_snapshot_ref (GtkScintillaSnapshot *snapshot)
+{
+	g_return_val_if_fail(snapshot != NULL, NULL);
+
+	scintilla_snapshot_add_ref(snapshot);
+	return snapshot;
+}
+
+/**
+ * gtk_scintilla_snapshot_unref:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ *
+ * Removes a reference from @snapshot, freeing it when none are left.  This
+ * may be called from any thread.
+ */
+void gtk_scintilla_snapshot_unref (GtkScintillaSnapshot *snapshot)
+{
+	g_return_if_fail(snapshot != NULL);
+
+	scintilla_snapshot_release(snapshot);
+}
+
+/**
+ * gtk_scintilla_snapshot_get_version:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ *
+ * Gets the version of the document text when @snapshot was taken, so it can
+ * be compared with gtk_scintilla_get_document_version() to find whether the
+ * document has changed since.
+ *
+ * Returns:	The document version of @snapshot.
+ */
+gint gtk_scintilla_snapshot_get_version (GtkScintillaSnapshot *snapshot)
+{
+	g_return_val_if_fail(snapshot != NULL, 0);
+
+	return scintilla_snapshot_version(snapshot);
+}
+
+/**
+ * gtk_scintilla_snapshot_get_length:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ *
+ * Gets the number of bytes of text in @snapshot.
+ *
+ * Returns:	The length of @snapshot.
+ */
+GtkScintillaPosition gtk_scintilla_snapshot_get_length (GtkScintillaSnapshot *snapshot)
+{
+	g_return_val_if_fail(snapshot != NULL, 0);
+
+	return (GtkScintillaPosition)scintilla_snapshot_length(snapshot);
+}
+
+/**
+ * gtk_scintilla_snapshot_get_char_at:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ * @pos:		The position of the character to get.
+ *
+ * Gets the character at @pos in @snapshot.
+ *
+ * Returns:	The character at @pos or 0 if @pos is negative or past the end.
+ */
+gchar gtk_scintilla_snapshot_get_char_at (GtkScintillaSnapshot *snapshot, GtkScintillaPosition pos)
+{
+	g_return_val_if_fail(snapshot != NULL, '\0');
+
+	return scintilla_snapshot_char_at(snapshot, (glong)pos);
+}
+
+/**
+ * gtk_scintilla_snapshot_get_style_at:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ * @pos:		The position of the style to get.
+ *
+ * Gets the style at @pos in @snapshot.
+ *
+ * Returns:	The style at @pos or 0 if @pos is negative or past the end.
+ */
+gchar gtk_scintilla_snapshot_get_style_at (GtkScintillaSnapshot *snapshot, GtkScintillaPosition pos)
+{
+	g_return_val_if_fail(snapshot != NULL, '\0');
+
+	return scintilla_snapshot_style_at(snapshot, (glong)pos);
+}
+
+/* Checks a range of a snapshot, resolving an end of -1 to the end of the snapshot. */
+static gboolean snapshot_range (GtkScintillaSnapshot *snapshot, GtkScintillaPosition start_pos, GtkScintillaPosition *end_pos)
+{
+	GtkScintillaPosition length = (GtkScintillaPosition)scintilla_snapshot_length(snapshot);
+
+	if (*end_pos == -1)
+		*end_pos = length;
+
+	return start_pos >= 0 && start_pos <= *end_pos && *end_pos <= length;
+}
+
+/**
+ * gtk_scintilla_snapshot_get_text_range:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ * @start_pos:	The start position of the range.
+ * @end_pos:	The end position of the range or -1 for the end of @snapshot.
+ *
+ * Gets the text of @snapshot between @start_pos and @end_pos.
+ *
+ * Returns:	A newly-allocated, zero-terminated string or NULL if the range
+ * 			is invalid.  Free with g_free().
+ */
+gchar *gtk_scintilla_snapshot_get_text_range (GtkScintillaSnapshot *snapshot, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos)
+{
+	gchar *text;
+
+	g_return_val_if_fail(snapshot != NULL, NULL);
+	g_return_val_if_fail(snapshot_range(snapshot, start_pos, &end_pos), NULL);
+
+	text = g_malloc(end_pos - start_pos + 1);
+	scintilla_snapshot_get_char_range(snapshot, text, (glong)start_pos, (glong)(end_pos - start_pos));
+	text[end_pos - start_pos] = '\0';
+
+	return text;
+}
+
+/**
+ * gtk_scintilla_snapshot_get_style_range:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ * @start_pos:	The start position of the range.
+ * @end_pos:	The end position of the range or -1 for the end of @snapshot.
+ *
+ * Gets the style of each character of @snapshot between @start_pos and
+ * @end_pos.
+ *
+ * Returns:	A newly-allocated array of @end_pos - @start_pos styles or NULL if
+ * 			the range is invalid.  Free with g_free().
+ */
+guchar *gtk_scintilla_snapshot_get_style_range (GtkScintillaSnapshot *snapshot, GtkScintillaPosition start_pos, GtkScintillaPosition end_pos)
+{
+	guchar *styles;
+
+	g_return_val_if_fail(snapshot != NULL, NULL);
+	g_return_val_if_fail(snapshot_range(snapshot, start_pos, &end_pos), NULL);
+
+	/* At least one byte so an empty range is not mistaken for an error */
+	styles = g_malloc(end_pos - start_pos + 1);
+	scintilla_snapshot_get_style_range(snapshot, (gchar *)styles, (glong)start_pos, (glong)(end_pos - start_pos));
+
+	return styles;
+}
+
+/**
+ * gtk_scintilla_snapshot_get_text_segment:
+ * @snapshot:	A #GtkScintillaSnapshot.
+ * @pos:		The position of the first byte to retrieve.
+ * @length:		Return location for the number of bytes in the segment.
+ *
+ * Gets the text of @snapshot that is contiguous in memory from @pos without
+ * copying it, like gtk_scintilla_get_text_segment().
+ *
+ * Returns:	A pointer into @snapshot, which is not zero-terminated and must
+ * 			not be modified or freed, or NULL if @pos is at or after the end.
+ * 			It stays valid until @snapshot is freed.
+ */
+const gchar *gtk_scintilla_snapshot_get_text_segment (GtkScintillaSnapshot *snapshot, GtkScintillaPosition pos, GtkScintillaPosition *length)
+{
+	const gchar *text;
+	glong len = 0;
+
+	g_return_val_if_fail(snapshot != NULL, NULL);
+	g_return_val_if_fail(length != NULL, NULL);
+
+	text = scintilla_snapshot_text_segment(snapshot, (glong)pos, &len);
+	*length = (GtkScintillaPosition)len;
+
+	return text;
+}
+
 /**
  * gtk_scintilla_clear_all:
  * @sci:	The #GtkScintilla object.
@@ -444,7 +1111,7 @@ void gtk_scintilla_clear_document_style (GtkScintilla *sci)
  *
  * Returns: The character at @pos or 0 if @pos is invalid.
  */
-gchar gtk_scintilla_get_char_at (GtkScintilla *sci, guint pos)
+gchar gtk_scintilla_get_char_at (GtkScintilla *sci, GtkScintillaPosition pos)
 {
 	g_return_val_if_fail(sci != NULL, '\0');
 
@@ -461,7 +1128,7 @@ gchar gtk_scintilla_get_char_at (GtkScintilla *sci, guint pos)
  *
  * Returns: The style at @pos or 0 if @pos is invalid.
  */
-gchar gtk_scintilla_get_style_at (GtkScintilla *sci, guint pos)
+gchar gtk_scintilla_get_style_at (GtkScintilla *sci, GtkScintillaPosition pos)
 {
 	g_return_val_if_fail(sci != NULL, '\0');
 
@@ -575,6 +1242,660 @@ gchar *gtk_scintilla_encoded_from_utf8 (GtkScintilla *sci, const gchar *utf8, gi
 	return tmp;
 }
 
+/**
+ * gtk_scintilla_load_mapped_file:
+ * @sci:		The #GtkScintilla object.
+ * @filename:	The file to load.
+ * @error:		Return location for a #GError, or NULL.
+ *
+ * Replaces the document with a new document that maps @filename into memory
+ * instead of reading it, so even very large files open immediately.  Parts of
+ * the file are copied only when they are modified and the file itself is
+ * never written to.  The lines of the file are found while the widget is
+ * idle, so the line count keeps growing for a while after loading and each
+ * step emits #GtkScintilla::modified with
+ * #GTK_SCINTILLA_MODIFICATION_FLAGS_LINES_INDEXED.  The file must not be
+ * changed by another program while it is loaded.
+ *
+ * Returns:	TRUE if the file was loaded or FALSE with @error set if the file
+ * 			could not be mapped.
+ */
+gboolean gtk_scintilla_load_mapped_file (GtkScintilla *sci, const gchar *filename, GError **error)
+{
+	sptr_t doc;
+
+	g_return_val_if_fail(sci != NULL, FALSE);
+	g_return_val_if_fail(filename != NULL, FALSE);
+
+	doc = SSM(SCINTILLA(sci), SCI_CREATEMAPPEDDOCUMENT, 0, (sptr_t)filename);
+	if (doc == 0)
+	{
+		g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+			"Failed to map file '%s'", filename);
+		return FALSE;
+	}
+
+	SSM(SCINTILLA(sci), SCI_SETDOCPOINTER, 0, doc);
+	/* the widget holds its own reference now */
+	SSM(SCINTILLA(sci), SCI_RELEASEDOCUMENT, 0, doc);
+
+	return TRUE;
+}
+
+/* creates a converter between charset and the character set of the document,
+ * leaving it NULL when they are the same */
+static gboolean charset_converter_new (GtkScintilla *sci, const gchar *charset, gboolean to_document,
+	void **converter, GError **error)
+{
+	const gchar *doc_charset;
+
+	*converter = NULL;
+	doc_charset = scintilla_get_document_charset(SCINTILLA(sci));
+	if (*doc_charset == '\0')
+	{
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			"The character set of the document is not known");
+		return FALSE;
+	}
+	if (g_ascii_strcasecmp(charset, doc_charset) == 0)
+		return TRUE;
+
+	if (to_document)
+		*converter = scintilla_converter_new(doc_charset, charset);
+	else
+		*converter = scintilla_converter_new(charset, doc_charset);
+	if (*converter == NULL)
+	{
+		g_set_error(error, G_CONVERT_ERROR, G_CONVERT_ERROR_NO_CONVERSION,
+			"Conversion between '%s' and '%s' is not supported", charset, doc_charset);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* bytes read from the stream and added to the loader at a time */
+#define LOAD_CHUNK_SIZE (1024 * 1024)
+
+typedef struct
+{
+	GInputStream *stream;
+	void *loader;
+	/* converts the stream into the character set of the document or NULL */
+	void *converter;
+	GMainContext *context;
+	GFileProgressCallback progress_callback;
+	gpointer progress_data;
+} LoadData;
+
+typedef struct
+{
+	GFileProgressCallback progress_callback;
+	gpointer progress_data;
+	goffset current;
+	goffset total;
+} LoadProgress;
+
+static void load_data_free (LoadData *data)
+{
+	if (data->loader != NULL)
+		scintilla_loader_release(data->loader);
+	if (data->converter != NULL)
+		scintilla_converter_free(data->converter);
+	g_object_unref(data->stream);
+	g_main_context_unref(data->context);
+	g_slice_free(LoadData, data);
+}
+
+static gboolean load_progress_invoke (gpointer user_data)
+{
+	LoadProgress *progress = user_data;
+
+	progress->progress_callback(progress->current, progress->total,
+		progress->progress_data);
+
+	return FALSE;
+}
+
+static void load_progress_free (gpointer user_data)
+{
+	g_slice_free(LoadProgress, user_data);
+}
+
+/* adds text to the loader, converting it a bounded piece at a time if needed */
+static gboolean load_add (LoadData *data, const gchar *text, gsize len, gchar *conv_buf, GError **error)
+{
+	gchar *out;
+	gsize out_left;
+	gint converted = 1;
+	gint status = SC_STATUS_OK;
+
+	if (data->converter == NULL)
+		status = scintilla_loader_add_data(data->loader, (gchar *)text, (gint)len);
+
+	/* the converter returns 1 each time the output buffer is full */
+	while (data->converter != NULL && converted == 1 && status == SC_STATUS_OK)
+	{
+		out = conv_buf;
+		out_left = LOAD_CHUNK_SIZE;
+		converted = scintilla_converter_convert(data->converter, &text, &len, &out, &out_left);
+		if (converted == -1)
+		{
+			g_set_error(error, G_CONVERT_ERROR, G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+				"The stream contains text that can not be converted");
+			return FALSE;
+		}
+		if (out > conv_buf)
+			status = scintilla_loader_add_data(data->loader, conv_buf, (gint)(out - conv_buf));
+	}
+
+	if (status != SC_STATUS_OK)
+	{
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+			"Not enough memory to load the document");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* runs in a worker thread so the loader is only ever used by that thread */
+static void load_thread (GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	LoadData *data = task_data;
+	GFileInfo *info;
+	GError *error = NULL;
+	LoadProgress *progress;
+	goffset total = 0, current = 0;
+	gssize len;
+	gchar *buf, *conv_buf = NULL;
+	gpointer doc;
+
+	if (G_IS_FILE_INPUT_STREAM(data->stream))
+	{
+		info = g_file_input_stream_query_info(G_FILE_INPUT_STREAM(data->stream),
+			G_FILE_ATTRIBUTE_STANDARD_SIZE, cancellable, NULL);
+		if (info != NULL)
+		{
+			total = g_file_info_get_size(info);
+			g_object_unref(info);
+		}
+	}
+
+	buf = g_malloc(LOAD_CHUNK_SIZE);
+	if (data->converter != NULL)
+		conv_buf = g_malloc(LOAD_CHUNK_SIZE);
+	while ((len = g_input_stream_read(data->stream, buf, LOAD_CHUNK_SIZE, cancellable, &error)) > 0)
+	{
+		if (!load_add(data, buf, len, conv_buf, &error))
+			break;
+		current += len;
+		if (data->progress_callback != NULL)
+		{
+			progress = g_slice_new(LoadProgress);
+			progress->progress_callback = data->progress_callback;
+			progress->progress_data = data->progress_data;
+			progress->current = current;
+			progress->total = total;
+			g_main_context_invoke_full(data->context, G_PRIORITY_DEFAULT,
+				load_progress_invoke, progress, load_progress_free);
+		}
+	}
+	g_free(buf);
+	g_free(conv_buf);
+
+	if (error == NULL && data->converter != NULL && !scintilla_converter_complete(data->converter))
+		g_set_error(&error, G_CONVERT_ERROR, G_CONVERT_ERROR_PARTIAL_INPUT,
+			"The stream ends with an incomplete character");
+
+	if (error != NULL || g_cancellable_set_error_if_cancelled(cancellable, &error))
+	{
+		g_task_return_error(task, error);
+		return;
+	}
+
+	/* the lines are found here rather than in the main loop */
+	doc = scintilla_loader_convert_to_document(data->loader);
+	/* converting consumes the loader, even when it fails */
+	data->loader = NULL;
+	if (doc == NULL)
+	{
+		g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+			"Not enough memory to load the document");
+		return;
+	}
+
+	g_task_return_pointer(task, doc, NULL);
+}
+
+static void load_ready (GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+	GTask *task = user_data;
+	GError *error = NULL;
+	sptr_t doc;
+
+	doc = (sptr_t)g_task_propagate_pointer(G_TASK(result), &error);
+	if (doc != 0 && g_cancellable_set_error_if_cancelled(g_task_get_cancellable(task), &error))
+	{
+		/* cancelled after the last read so the document is not wanted */
+		SSM(SCINTILLA(source_object), SCI_RELEASEDOCUMENT, 0, doc);
+		doc = 0;
+	}
+	if (doc == 0)
+	{
+		g_task_return_error(task, error);
+		g_object_unref(task);
+		return;
+	}
+
+	SSM(SCINTILLA(source_object), SCI_SETDOCPOINTER, 0, doc);
+	/* the widget holds its own reference now */
+	SSM(SCINTILLA(source_object), SCI_RELEASEDOCUMENT, 0, doc);
+
+	g_task_return_boolean(task, TRUE);
+	g_object_unref(task);
+}
+
+/**
+ * gtk_scintilla_load_async:
+ * @sci:				The #GtkScintilla object.
+ * @stream:				The stream to read the document from.
+ * @options:			The #GtkScintillaDocumentOption flags for the new document.
+ * @charset:			The character set of @stream, or NULL to load its bytes as
+ * 						they are.
+ * @cancellable:		Optional #GCancellable object, or NULL.
+ * @progress_callback:	Function to call with the number of bytes read so far,
+ * 						or NULL.
+ * @progress_data:		Data to pass to @progress_callback.
+ * @callback:			A #GAsyncReadyCallback to call when the document is loaded.
+ * @user_data:			Data to pass to @callback.
+ *
+ * Reads @stream into a new document in a worker thread and then replaces the
+ * document in @sci with it, so the main loop keeps running while a large file
+ * is loaded.  The text and its lines are only added to the widget once the
+ * whole stream has been read, which takes no longer than setting a document.
+ * When @charset differs from the character set of @sci, the stream is
+ * converted a chunk at a time as it is read so only the converted text is
+ * kept in memory.
+ *
+ * @progress_callback is called in the thread default main context of the
+ * caller after each chunk of the stream is read.  The total is the size of the
+ * file for a #GFileInputStream or 0 when the size is not known.
+ *
+ * The document in @sci is unchanged if the load fails or is cancelled.  When
+ * the load is finished, @callback is called and should call
+ * gtk_scintilla_load_finish() to get the result.  @stream must not be used
+ * until then.
+ */
+void gtk_scintilla_load_async (GtkScintilla *sci, GInputStream *stream, GtkScintillaDocumentOption options,
+	const gchar *charset, GCancellable *cancellable, GFileProgressCallback progress_callback, gpointer progress_data,
+	GAsyncReadyCallback callback, gpointer user_data)
+{
+	GTask *task, *load_task;
+	LoadData *data;
+	sptr_t loader;
+	void *converter = NULL;
+	GError *error = NULL;
+
+	g_return_if_fail(sci != NULL);
+	g_return_if_fail(G_IS_INPUT_STREAM(stream));
+
+	task = g_task_new(sci, cancellable, callback, user_data);
+
+	if (charset != NULL && !charset_converter_new(sci, charset, TRUE, &converter, &error))
+	{
+		g_task_return_error(task, error);
+		g_object_unref(task);
+		return;
+	}
+
+	loader = SSM(SCINTILLA(sci), SCI_CREATELOADER, 0, (sptr_t)options);
+	if (loader == 0)
+	{
+		if (converter != NULL)
+			scintilla_converter_free(converter);
+		g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+			"Not enough memory to load the document");
+		g_object_unref(task);
+		return;
+	}
+
+	data = g_slice_new0(LoadData);
+	data->stream = g_object_ref(stream);
+	data->loader = (void *)loader;
+	data->converter = converter;
+	data->context = g_main_context_ref_thread_default();
+	data->progress_callback = progress_callback;
+	data->progress_data = progress_data;
+
+	load_task = g_task_new(sci, cancellable, load_ready, task);
+	/* load_ready always receives the document so it can be released */
+	g_task_set_check_cancellable(load_task, FALSE);
+	g_task_set_task_data(load_task, data, (GDestroyNotify)load_data_free);
+	g_task_run_in_thread(load_task, load_thread);
+	g_object_unref(load_task);
+}
+
+/**
+ * gtk_scintilla_load_finish:
+ * @sci:		The #GtkScintilla object.
+ * @result:		The #GAsyncResult passed to the callback of
+ * 				gtk_scintilla_load_async().
+ * @error:		Return location for a #GError, or NULL.
+ *
+ * Finishes loading a document started with gtk_scintilla_load_async().
+ *
+ * Returns:	TRUE if the document was loaded or FALSE with @error set if the
+ * 			stream could not be read, there was not enough memory or the load
+ * 			was cancelled.
+ */
+gboolean gtk_scintilla_load_finish (GtkScintilla *sci, GAsyncResult *result, GError **error)
+{
+	g_return_val_if_fail(sci != NULL, FALSE);
+	g_return_val_if_fail(g_task_is_valid(result, sci), FALSE);
+
+	return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+/* bytes copied from the document and written to the stream at a time */
+#define SAVE_CHUNK_SIZE (1024 * 1024)
+
+typedef struct
+{
+	GtkScintilla *sci;
+	GOutputStream *stream;
+	/* the text being saved, unchanged by edits made while saving */
+	GtkScintillaSnapshot *snapshot;
+	/* whether the document is held read-only until the save ends */
+	gboolean held_read_only;
+	/* converts the document into the character set of the stream or NULL */
+	void *converter;
+	/* whether the converter has written the end of the character set */
+	gboolean finished;
+	gint eol_mode;
+	gboolean after_cr;
+	GtkScintillaPosition pos;
+	/* text copied from the document and how much of it has been converted */
+	gchar *text;
+	gsize text_len;
+	gsize text_used;
+	/* the converted text or NULL when not converting */
+	gchar *conv_buf;
+	/* the bytes being written, either text or conv_buf */
+	gchar *buf;
+	gsize len;
+	gsize written;
+} SaveData;
+
+static void save_data_free (SaveData *data)
+{
+	g_object_unref(data->stream);
+	gtk_scintilla_snapshot_unref(data->snapshot);
+	if (data->converter != NULL)
+		scintilla_converter_free(data->converter);
+	g_free(data->text);
+	g_free(data->conv_buf);
+	g_slice_free(SaveData, data);
+}
+
+/* copies the next part of the snapshot, changing line ends as it goes, and
+ * returns FALSE at the end of the document */
+static gboolean save_fill (SaveData *data)
+{
+	GtkScintillaPosition seg_len, i;
+	const gchar *seg;
+	gsize room;
+	gchar ch;
+
+	data->text_len = 0;
+	data->text_used = 0;
+	while (data->text_len < SAVE_CHUNK_SIZE - 1)
+	{
+		seg = gtk_scintilla_snapshot_get_text_segment(data->snapshot, data->pos, &seg_len);
+		if (seg == NULL)
+			break;
+		room = SAVE_CHUNK_SIZE - data->text_len;
+		if (data->eol_mode == -1)
+		{
+			if ((gsize)seg_len > room)
+				seg_len = (GtkScintillaPosition)room;
+			memcpy(data->text + data->text_len, seg, seg_len);
+			data->text_len += seg_len;
+			data->pos += seg_len;
+			continue;
+		}
+		/* as Document::TransformLineEnds, each line end may take two bytes */
+		for (i = 0; i < seg_len && data->text_len < SAVE_CHUNK_SIZE - 1; i++)
+		{
+			ch = seg[i];
+			if (ch == '\r' || (ch == '\n' && !data->after_cr))
+			{
+				if (data->eol_mode != SC_EOL_LF)
+					data->text[data->text_len++] = '\r';
+				if (data->eol_mode != SC_EOL_CR)
+					data->text[data->text_len++] = '\n';
+			}
+			else if (ch != '\n')
+				data->text[data->text_len++] = ch;
+			data->after_cr = ch == '\r';
+		}
+		data->pos += i;
+	}
+
+	return data->text_len > 0;
+}
+
+/* prepares the next bytes to write and returns FALSE at the end of the
+ * document or with error set if the text could not be converted */
+static gboolean save_next (SaveData *data, GError **error)
+{
+	const gchar *src;
+	gchar *out;
+	gsize src_left, out_left;
+
+	data->len = 0;
+	data->written = 0;
+	if (data->converter == NULL)
+	{
+		data->buf = data->text;
+		data->len = save_fill(data) ? data->text_len : 0;
+		return data->len > 0;
+	}
+
+	data->buf = data->conv_buf;
+	out = data->conv_buf;
+	out_left = SAVE_CHUNK_SIZE;
+	while (out == data->conv_buf)
+	{
+		if (data->text_used == data->text_len && !save_fill(data))
+			break;
+		src = data->text + data->text_used;
+		src_left = data->text_len - data->text_used;
+		if (scintilla_converter_convert(data->converter, &src, &src_left, &out, &out_left) == -1)
+		{
+			g_set_error(error, G_CONVERT_ERROR, G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+				"The document contains text that can not be converted");
+			return FALSE;
+		}
+		data->text_used = data->text_len - src_left;
+	}
+
+	/* after the last of the text, a stateful character set such as
+	 * ISO-2022-JP shifts back to its initial state, in the next chunk when
+	 * there is no room left in this one */
+	if (!data->finished && data->text_used == data->text_len &&
+		data->pos == gtk_scintilla_snapshot_get_length(data->snapshot))
+	{
+		if (!scintilla_converter_complete(data->converter))
+		{
+			g_set_error(error, G_CONVERT_ERROR, G_CONVERT_ERROR_PARTIAL_INPUT,
+				"The document ends with an incomplete character");
+			return FALSE;
+		}
+		switch (scintilla_converter_finish(data->converter, &out, &out_left))
+		{
+			case 0:
+				data->finished = TRUE;
+				break;
+			case -1:
+				g_set_error(error, G_CONVERT_ERROR, G_CONVERT_ERROR_FAILED,
+					"The end of the document could not be converted");
+				return FALSE;
+		}
+	}
+
+	data->len = out - data->conv_buf;
+	return data->len > 0;
+}
+
+static void save_done (GTask *task, GError *error)
+{
+	SaveData *data = g_task_get_task_data(task);
+
+	/* before the callback so the document can be edited again from it */
+	if (data->held_read_only)
+	{
+		data->held_read_only = FALSE;
+		_gtk_scintilla_release_read_only(data->sci);
+	}
+
+	if (error != NULL)
+		g_task_return_error(task, error);
+	else
+		g_task_return_boolean(task, TRUE);
+	g_object_unref(task);
+}
+
+static void save_flushed (GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+	GTask *task = user_data;
+	GError *error = NULL;
+
+	g_output_stream_flush_finish(G_OUTPUT_STREAM(source_object), result, &error);
+
+	save_done(task, error);
+}
+
+static void save_written (GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+	GTask *task = user_data;
+	SaveData *data = g_task_get_task_data(task);
+	GError *error = NULL;
+	gssize n;
+
+	if (source_object != NULL)
+	{
+		n = g_output_stream_write_finish(data->stream, result, &error);
+		if (n < 0)
+		{
+			save_done(task, error);
+			return;
+		}
+		data->written += n;
+	}
+
+	if (data->written == data->len &&
+		!save_next(data, &error))
+	{
+		if (error != NULL)
+			save_done(task, error);
+		else
+			g_output_stream_flush_async(data->stream, G_PRIORITY_DEFAULT,
+				g_task_get_cancellable(task), save_flushed, task);
+		return;
+	}
+
+	g_output_stream_write_async(data->stream, data->buf + data->written, data->len - data->written,
+		G_PRIORITY_DEFAULT, g_task_get_cancellable(task), save_written, task);
+}
+
+/**
+ * gtk_scintilla_save_async:
+ * @sci:			The #GtkScintilla object.
+ * @stream:			The stream to write the document to.
+ * @eol_mode:		The #SC_EOL_CRLF, #SC_EOL_CR or #SC_EOL_LF line ends to write,
+ * 					or -1 to write line ends as they are.
+ * @charset:		The character set to write, or NULL to write the bytes of
+ * 					the document as they are.
+ * @cancellable:	Optional #GCancellable object, or NULL.
+ * @callback:		A #GAsyncReadyCallback to call when the document is saved.
+ * @user_data:		Data to pass to @callback.
+ *
+ * Writes the document to @stream from the main loop a chunk at a time,
+ * reading the text in place rather than copying all of it first.  Line ends
+ * and the character set are converted as each chunk is written.
+ *
+ * The text is read from a snapshot of the text, without its styles, taken
+ * when the save starts, so the file is a consistent copy and other saves may
+ * overlap this one.  A document with #SC_DOCUMENTOPTION_TEXT_CHUNKED stays
+ * editable, copying only the chunks that are edited.  Any other document is
+ * read-only until the last save ends, as an edit would copy all of its text,
+ * and gtk_scintilla_set_read_only() takes effect then.  @stream is flushed
+ * but not closed.  When
+ * the document is saved, @callback is called and should call
+ * gtk_scintilla_save_finish() to get the result.
+ */
+void gtk_scintilla_save_async (GtkScintilla *sci, GOutputStream *stream, gint eol_mode, const gchar *charset,
+	GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+	GTask *task;
+	SaveData *data;
+	GError *error = NULL;
+
+	g_return_if_fail(sci != NULL);
+	g_return_if_fail(G_IS_OUTPUT_STREAM(stream));
+	g_return_if_fail(eol_mode >= -1 && eol_mode <= SC_EOL_LF);
+
+	task = g_task_new(sci, cancellable, callback, user_data);
+
+	data = g_slice_new0(SaveData);
+	data->sci = sci;
+	data->stream = g_object_ref(stream);
+	data->snapshot = (GtkScintillaSnapshot *)SSM(SCINTILLA(sci), SCI_CREATESNAPSHOT, TRUE, 0);
+	if (!(SSM(SCINTILLA(sci), SCI_GETDOCUMENTOPTIONS, 0, 0) & SC_DOCUMENTOPTION_TEXT_CHUNKED))
+	{
+		_gtk_scintilla_hold_read_only(sci);
+		data->held_read_only = TRUE;
+	}
+	data->eol_mode = eol_mode;
+	data->text = g_malloc(SAVE_CHUNK_SIZE);
+	g_task_set_task_data(task, data, (GDestroyNotify)save_data_free);
+
+	if (charset != NULL)
+	{
+		if (!charset_converter_new(sci, charset, FALSE, &data->converter, &error))
+		{
+			save_done(task, error);
+			return;
+		}
+		if (data->converter != NULL)
+			data->conv_buf = g_malloc(SAVE_CHUNK_SIZE);
+	}
+
+	save_written(NULL, NULL, task);
+}
+
+/**
+ * gtk_scintilla_save_finish:
+ * @sci:		The #GtkScintilla object.
+ * @result:		The #GAsyncResult passed to the callback of
+ * 				gtk_scintilla_save_async().
+ * @error:		Return location for a #GError, or NULL.
+ *
+ * Finishes saving a document started with gtk_scintilla_save_async().
+ *
+ * Returns:	TRUE if the document was saved or FALSE with @error set if the
+ * 			stream could not be written, the text could not be converted or
+ * 			the save was cancelled.
+ */
+gboolean gtk_scintilla_save_finish (GtkScintilla *sci, GAsyncResult *result, GError **error)
+{
+	g_return_val_if_fail(sci != NULL, FALSE);
+	g_return_val_if_fail(g_task_is_valid(result, sci), FALSE);
+
+	return g_task_propagate_boolean(G_TASK(result), error);
+}
+
 
 
 